@@ -0,0 +1,27 @@
+/*
+ * Bootloader: starts the valid slot with the highest trailer sequence number
+ * (ch32v307/update.h). With no valid trailer at all it starts slot A if
+ * anything is programmed there, which is what make flash leaves behind.
+ * Build with make boot; it only reads flash, so it never needs updating.
+ */
+#include "ch32v307.h"
+#include "update.h"
+
+
+void main(void) {
+  uint32_t slot, best = 2;
+
+  for (slot = 0; slot < 2; slot++) {
+    if (image_valid(slot) &&
+        (best == 2 || (int32_t)(slot_trailer(slot)->seq - slot_trailer(best)->seq) > 0)) {
+      best = slot;
+    }
+  }
+  if (best == 2) {
+    while (*(const uint32_t *)slot_base(0) == FLASH_ERASED);
+    best = 0;
+  }
+
+  // crc.c gates the CRC unit per use, so the clocks are as reset left them
+  ((void (*)(void))slot_base(best))();
+}
@@ -0,0 +1,256 @@
+#include "adc.h"
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "pfic.h"
+#include "rcc.h"
+
+#define ADC1x               ((ADC_TypeDef *)ADC1)
+#define ADC2x               ((ADC_TypeDef *)ADC2)
+
+#define ADC_CTLR1_SCAN      (1 << 8)
+#define ADC_CTLR1_DUAL_REG  (0x6 << 16)
+#define ADC_CTLR2_ADON      (1 << 0)
+#define ADC_CTLR2_CAL       (1 << 2)
+#define ADC_CTLR2_RSTCAL    (1 << 3)
+#define ADC_CTLR2_DMA       (1 << 8)
+#define ADC_CTLR2_TIM3_TRGO (0x4 << 17)
+#define ADC_CTLR2_SWSTART_SEL (0x7 << 17)
+#define ADC_CTLR2_EXTTRIG   (1 << 20)
+
+#define TIM3_CR1            (*((volatile uint32_t *)(TIM3_BASE + 0x00)))
+#define TIM3_CR2            (*((volatile uint32_t *)(TIM3_BASE + 0x04)))
+#define TIM3_EGR            (*((volatile uint32_t *)(TIM3_BASE + 0x14)))
+#define TIM3_PSC            (*((volatile uint32_t *)(TIM3_BASE + 0x28)))
+#define TIM3_ARR            (*((volatile uint32_t *)(TIM3_BASE + 0x2C)))
+
+#define ADC_DMA             DMA1_CH(1)
+
+static struct {
+  uint32_t *buf;
+  uint32_t block;
+  uint8_t average;
+  void (*on_block)(void);
+  volatile uint8_t ready;     // Bit h: half h filled and not yet released
+  volatile uint8_t next;      // Half the consumer gets next
+  volatile uint8_t reduced;   // Bit h: half h already averaged in place
+  volatile uint8_t held;      // Bit h: half h handed out by adc_acq_peek()
+  volatile uint32_t seq[2];
+  volatile uint32_t blocks;
+  volatile uint32_t dropped;
+  bool clocked;
+} acq;
+
+
+// Half h was just filled; the DMA is now writing the other half
+static void adc_half_done(uint32_t h) {
+  uint32_t other = h ^ 1;
+
+  if (acq.ready & (1 << other)) {
+    // The DMA just started overwriting a half nobody released. One the
+    // consumer holds is counted when it comes back to adc_acq_release().
+    acq.ready &= ~(1 << other);
+    acq.next = h;
+    if (!(acq.held & (1 << other))) {
+      acq.dropped++;
+    }
+    acq.held &= ~(1 << other);
+  }
+  acq.seq[h] = acq.blocks++;
+  acq.reduced &= ~(1 << h);
+  acq.ready |= 1 << h;
+  if (acq.on_block) {
+    acq.on_block();
+  }
+}
+
+static void adc_dma(void *ctx, uint32_t flags) {
+  (void)ctx;
+  if (flags & DMA_FLAG_HTIF) {
+    adc_half_done(0);
+  }
+  if (flags & DMA_FLAG_TCIF) {
+    adc_half_done(1);
+  }
+}
+
+static void adc_calibrate(ADC_TypeDef *adc) {
+  adc->CTLR2 |= ADC_CTLR2_RSTCAL;
+  while (adc->CTLR2 & ADC_CTLR2_RSTCAL);
+  adc->CTLR2 |= ADC_CTLR2_CAL;
+  while (adc->CTLR2 & ADC_CTLR2_CAL);
+}
+
+static void adc_channel(ADC_TypeDef *adc, uint8_t ch, uint8_t smp) {
+  if (ch < 10) {
+    adc->SAMPTR2 = (uint32_t)(smp & 7) << (3 * ch);
+  } else {
+    adc->SAMPTR1 = (uint32_t)(smp & 7) << (3 * (ch - 10));
+  }
+  adc->RSQR1 = 0;       // One conversion
+  adc->RSQR3 = ch;
+}
+
+/**
+ * @brief Starts dual regular-simultaneous acquisition paced by TIM3 TRGO.
+ *
+ * @details Each TIM3 update converts ch_a on ADC1 and ch_b on ADC2 at the same
+ * instant; DMA1 channel 1 stores the pair as one word into a circular buffer of
+ * two halves. The ADC prescaler is chosen for the fastest clock at or below
+ * 14 MHz.
+ */
+bool adc_acq_start(const adc_acq_config_t *cfg) {
+  DMA_Channel_TypeDef *ch = dma_channel(ADC_DMA);
+  rcc_clocks_t clocks;
+  uint32_t timclk, ticks, psc, div;
+
+  if (!cfg->buf || cfg->block == 0 || cfg->rate_hz == 0 || 2 * cfg->block > 0xFFFF ||
+      (cfg->average > 1 && (cfg->block % cfg->average || (cfg->average & (cfg->average - 1))))) {
+    return false;
+  }
+  if (!dma_attach(ADC_DMA, adc_dma, NULL)) {
+    return false;
+  }
+  rcc_get_clocks(&clocks);
+  if (!acq.clocked) {
+    rcc_clock_acquire(RCC_ADC1);
+    rcc_clock_acquire(RCC_ADC2);
+    rcc_clock_acquire(RCC_TIM(3));
+    acq.clocked = true;
+  }
+
+  for (div = 0; div < 3 && clocks.pclk2 / (2 * (div + 1)) > 14000000; div++);
+  RCC->CFGR0 = (RCC->CFGR0 & ~(0x3 << 14)) | (div << 14);
+
+  acq.buf = cfg->buf;
+  acq.block = cfg->block;
+  acq.average = cfg->average > 1 ? cfg->average : 1;
+  acq.on_block = cfg->on_block;
+  acq.ready = 0;
+  acq.next = 0;
+  acq.reduced = 0;
+  acq.held = 0;
+  acq.blocks = 0;
+  acq.dropped = 0;
+
+  ADC1x->CTLR1 = ADC_CTLR1_DUAL_REG;
+  ADC2x->CTLR1 = 0;
+  adc_channel(ADC1x, cfg->ch_a, cfg->smp);
+  adc_channel(ADC2x, cfg->ch_b, cfg->smp);
+  ADC1x->CTLR2 = ADC_CTLR2_ADON;
+  ADC2x->CTLR2 = ADC_CTLR2_ADON;
+  adc_calibrate(ADC1x);
+  adc_calibrate(ADC2x);
+  // The slave must be triggerable by the master only
+  ADC2x->CTLR2 = ADC_CTLR2_ADON | ADC_CTLR2_SWSTART_SEL | ADC_CTLR2_EXTTRIG;
+
+  ch->CFGR = 0;
+  ch->PADDR = (uint32_t)&ADC1x->RDATAR;
+  ch->MADDR = (uint32_t)cfg->buf;
+  ch->CNTR = 2 * cfg->block;
+  ch->CFGR = DMA_CFGR_PSIZE_32 | DMA_CFGR_MSIZE_32 | DMA_CFGR_MINC | DMA_CFGR_CIRC |
+             DMA_CFGR_HTIE | DMA_CFGR_TCIE | DMA_CFGR_PL(3) | DMA_CFGR_EN;
+  ADC1x->CTLR2 = ADC_CTLR2_ADON | ADC_CTLR2_DMA | ADC_CTLR2_TIM3_TRGO | ADC_CTLR2_EXTTRIG;
+
+  // Timer clock is PCLK1, doubled when the APB1 prescaler is not 1
+  timclk = clocks.pclk1 == clocks.hclk ? clocks.pclk1 : 2 * clocks.pclk1;
+  ticks = (timclk + cfg->rate_hz / 2) / cfg->rate_hz;
+  psc = (ticks - 1) >> 16;
+  TIM3_CR1 = 0;
+  TIM3_PSC = psc;
+  TIM3_ARR = ticks / (psc + 1) - 1;
+  TIM3_CR2 = 0x2 << 4;  // MMS = update -> TRGO
+  TIM3_EGR = 1;
+  TIM3_CR1 = 1;
+  return true;
+}
+
+void adc_acq_stop(void) {
+  if (!acq.clocked) {
+    return;
+  }
+  TIM3_CR1 = 0;
+  dma_detach(ADC_DMA, adc_dma, NULL);
+  ADC1x->CTLR2 = 0;
+  ADC2x->CTLR2 = 0;
+  rcc_clock_release(RCC_ADC1);
+  rcc_clock_release(RCC_ADC2);
+  rcc_clock_release(RCC_TIM(3));
+  acq.clocked = false;
+}
+
+/**
+ * @brief Returns the oldest filled half, in place.
+ *
+ * @details With averaging enabled the half is reduced in place (pairs are
+ * averaged per channel into the start of the half), so the block is still
+ * handed out without copying and with no work in the DMA interrupt.
+ */
+bool adc_acq_peek(adc_block_t *blk) {
+  uint32_t h, *p, n, k, i, j, a, b;
+  bool ready;
+
+  pfic_disable_irq(dma_irq(ADC_DMA));
+  h = acq.next;
+  ready = acq.ready & (1 << h);
+  if (ready) {
+    acq.held |= 1 << h;
+    blk->seq = acq.seq[h];
+  }
+  pfic_enable_irq(dma_irq(ADC_DMA));
+  if (!ready) {
+    return false;
+  }
+  p = acq.buf + h * acq.block;
+  n = acq.block;
+  if (acq.average > 1) {
+    if (!(acq.reduced & (1 << h))) {
+      for (i = 0, k = 0; i < n; k++) {
+        a = 0;
+        b = 0;
+        for (j = 0; j < acq.average; j++, i++) {
+          a += ADC_ACQ_A(p[i]);
+          b += ADC_ACQ_B(p[i]);
+        }
+        p[k] = (a / acq.average) | ((b / acq.average) << 16);
+      }
+      acq.reduced |= 1 << h;
+    }
+    n /= acq.average;
+  }
+  blk->samples = p;
+  blk->count = n;
+  return true;
+}
+
+/**
+ * @brief Frees the half blk came from.
+ *
+ * @details Only a half still carrying blk's sequence number is freed. If the
+ * DMA has come back around to it while the consumer read it, the fresh half
+ * now next in line stays queued and the block counts as dropped, its samples
+ * having been overwritten under the consumer.
+ */
+void adc_acq_release(const adc_block_t *blk) {
+  uint32_t h;
+
+  pfic_disable_irq(dma_irq(ADC_DMA));
+  h = acq.next;
+  if (acq.ready & (1 << h) && acq.seq[h] == blk->seq) {
+    acq.ready &= ~(1 << h);
+    acq.held &= ~(1 << h);
+    acq.next = h ^ 1;
+  } else {
+    acq.dropped++;
+  }
+  pfic_enable_irq(dma_irq(ADC_DMA));
+}
+
+uint32_t adc_acq_blocks(void) {
+  return acq.blocks;
+}
+
+uint32_t adc_acq_dropped(void) {
+  return acq.dropped;
+}
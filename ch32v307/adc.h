@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief ADC register block (ADC1, ADC2)
+ *
+ * @details Both ADCs sit on APB2 (clock enable RCC_APB2ENR bits 9 and 10) and are
+ * clocked from PCLK2 through the RCC_CFGR0 ADCPRE divider (bits 15:14, /2../8),
+ * which must keep the ADC clock at or below 14 MHz. A conversion takes the
+ * sample time plus 12.5 ADC clocks.
+ *
+ * Bit fields of CTLR1:
+ * - Bit 8      : SCAN     - Scan mode
+ * - Bits 19:16 : DUALMOD  - 0110: regular simultaneous mode (ADC1 is master)
+ *
+ * Bit fields of CTLR2:
+ * - Bit 0      : ADON     - A/D converter on
+ * - Bit 2      : CAL      - Start calibration
+ * - Bit 3      : RSTCAL   - Reset calibration
+ * - Bit 8      : DMA      - DMA requests enable
+ * - Bits 19:17 : EXTSEL   - Regular trigger (100: TIM3_TRGO, 111: SWSTART)
+ * - Bit 20     : EXTTRIG  - External trigger enable
+ *
+ * @note In dual mode ADC1's RDATAR holds ADC2's result in bits 31:16, so a single
+ * 32-bit DMA stream on DMA1 channel 1 carries both channels.
+ */
+typedef struct {
+  volatile uint32_t STATR;
+  volatile uint32_t CTLR1;
+  volatile uint32_t CTLR2;
+  volatile uint32_t SAMPTR1;
+  volatile uint32_t SAMPTR2;
+  volatile uint32_t IOFR[4];
+  volatile uint32_t WDHTR;
+  volatile uint32_t WDLTR;
+  volatile uint32_t RSQR1;
+  volatile uint32_t RSQR2;
+  volatile uint32_t RSQR3;
+  volatile uint32_t ISQR;
+  volatile uint32_t IDATAR[4];
+  volatile uint32_t RDATAR;
+} ADC_TypeDef;
+
+#define ADC_ACQ_A(s)        ((uint16_t)(s))         // ADC1 sample of a pair
+#define ADC_ACQ_B(s)        ((uint16_t)((s) >> 16)) // ADC2 sample of a pair
+
+typedef struct {
+  uint8_t ch_a;         // ADC1 input channel (0-15)
+  uint8_t ch_b;         // ADC2 input channel (0-15)
+  uint8_t smp;          // Sample time code, 0: 1.5 .. 7: 239.5 ADC clocks
+  uint32_t rate_hz;     // Sample pairs per second, paced by TIM3
+  uint32_t *buf;        // Two halves of `block` pairs each
+  uint32_t block;
+  uint8_t average;      // Pairs averaged into one (power of two), 0 or 1: off
+  void (*on_block)(void); // ISR context: a half is ready
+} adc_acq_config_t;
+
+typedef struct {
+  const uint32_t *samples;
+  uint32_t count;       // Pairs, after averaging
+  uint32_t seq;         // Block sequence number
+} adc_block_t;
+
+// False if the configuration is invalid or DMA1 channel 1 is taken
+bool adc_acq_start(const adc_acq_config_t *cfg);
+void adc_acq_stop(void);
+
+// Blocks point into the DMA buffer; release each one once, before the DMA comes
+// back around. A block released too late counts in adc_acq_dropped().
+bool adc_acq_peek(adc_block_t *blk);
+void adc_acq_release(const adc_block_t *blk);
+uint32_t adc_acq_blocks(void);
+uint32_t adc_acq_dropped(void);
@@ -5,6 +5,6 @@
 #include "rcc.h"
 
 void enable_afioen() {
-  RCC->APB2ENR |= (1 << 1);
+  rcc_clock_acquire(RCC_AFIO);
 }
 
@@ -0,0 +1,39 @@
+#include "ao_port.h"
+
+#include "pfic.h"
+#include "power.h"
+
+
+uint32_t ao_port_now(void) {
+  return systime_us();
+}
+
+/*
+ * The check and the sleep both run with interrupts off: a post landing after
+ * the check leaves its interrupt pending, and that ends the wfi at once.
+ * pm_idle() enables them again on the way out.
+ */
+void ao_port_idle(void) {
+  irq_global_disable();
+  if (ao_pending()) {
+    irq_global_enable();
+    return;
+  }
+  pm_idle();
+}
+
+static void timer_post(void *ctx) {
+  ao_timer_t *t = ctx;
+
+  ao_post(t->ao, t->e);
+}
+
+void ao_timer_start(ao_timer_t *t, ao_t *ao, ao_event_t *e, uint32_t delay_us, uint32_t period_us) {
+  t->ao = ao;
+  t->e = e;
+  systime_start(&t->timer, delay_us, period_us, timer_post, t);
+}
+
+void ao_timer_stop(ao_timer_t *t) {
+  systime_stop(&t->timer);
+}
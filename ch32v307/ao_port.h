@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "ao.h"
+#include "systime.h"
+
+
+/**
+ * @brief CH32V307 port of the active-object framework in lib/ao.h.
+ *
+ * @details Latency stamps are systime_us(). When no object has events the
+ * dispatcher goes to pm_idle(), so an idle application sleeps, or stops, until
+ * the next timer or interrupt posts something. Call systime_init() and
+ * pm_init() before ao_run().
+ *
+ * ao_timer_t posts an event to an object after a delay, and then every period
+ * if one is given; it runs from the SysTick handler through systime_start().
+ */
+
+typedef struct {
+  swtimer_t timer;
+  ao_t *ao;
+  ao_event_t *e;
+} ao_timer_t;
+
+// Posts e to ao after delay_us, then every period_us unless that is 0
+void ao_timer_start(ao_timer_t *t, ao_t *ao, ao_event_t *e, uint32_t delay_us, uint32_t period_us);
+void ao_timer_stop(ao_timer_t *t);
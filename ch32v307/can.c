@@ -0,0 +1,415 @@
+#include "can.h"
+
+#include <stddef.h>
+
+#include "afio.h"
+#include "gpio.h"
+#include "pfic.h"
+#include "rcc.h"
+
+#define CANx(i)             ((CAN_TypeDef *)can_hw[i].base)
+#define CAN1x               ((CAN_TypeDef *)CAN1)
+
+#define CTLR_INRQ           (1 << 0)
+#define CTLR_SLEEP          (1 << 1)
+#define CTLR_ABOM           (1 << 6)
+#define STATR_INAK          (1 << 0)
+#define TSTATR_RQCP(m)      (1u << (8 * (m)))
+#define TSTATR_TXOK(m)      (2u << (8 * (m)))
+#define TSTATR_ABRQ(m)      (0x80u << (8 * (m)))
+#define RFIFO_FMP           0x3
+#define RFIFO_FOVR          (1 << 4)
+#define RFIFO_RFOM          (1 << 5)
+#define INTENR_TMEIE        (1 << 0)
+#define INTENR_FMPIE0       (1 << 1)
+#define INTENR_FOVIE0       (1 << 3)
+#define INTENR_FMPIE1       (1 << 4)
+#define INTENR_FOVIE1       (1 << 6)
+#define BTIMR_LBKM          (1u << 30)
+#define BTIMR_SILM          (1u << 31)
+#define FCTLR_FINIT         (1 << 0)
+#define TXMIR_TXRQ          (1 << 0)
+#define MIR_RTR             (1 << 1)
+#define MIR_IDE             (1 << 2)
+
+// AFIO_PCFR1: CAN1 remap in bits 14:13 (00 PA11/12, 10 PB8/9, 11 PD0/1), CAN2 in bit 22
+#define PCFR1_CAN1_RM(x)    ((x) << 13)
+#define PCFR1_CAN2_RM       (1 << 22)
+
+#define SPIN                100000
+
+typedef struct {
+  uint32_t base;
+  uint8_t clock;
+  uint8_t tx_irq, rx0_irq, rx1_irq;
+} can_hw_t;
+
+static const can_hw_t can_hw[2] = {
+  {CAN1, RCC_CAN1, CAN1_TX_IRQn, CAN1_RX0_IRQn, CAN1_RX1_IRQn},
+  {CAN2, RCC_CAN2, CAN2_TX_IRQn, CAN2_RX0_IRQn, CAN2_RX1_IRQn},
+};
+
+typedef struct {
+  can_frame_t rxq[2][CAN_RXQ_LEN];
+  volatile uint32_t rx_head[2];
+  volatile uint32_t rx_tail[2];
+  can_frame_t txq[CAN_TXQ_LEN];   // Most urgent first
+  uint32_t txq_len;
+  can_frame_t mbox[3];            // What each mailbox is sending
+  uint8_t busy;                   // Mailboxes in use
+  uint8_t aborting;
+  void (*on_rx)(uint32_t bus, uint32_t fifo);
+  can_stats_t stats;
+  bool clocked;
+  uint8_t pin_clock;              // GPIO port clock held for the pins, 0 if none
+} can_state_t;
+
+static can_state_t state[2];
+static bool filters_clocked;
+
+
+// Arbitration order: lower wins. Base ID, then RTR/SRR, IDE, extension, RTR.
+static uint32_t can_prio(const can_frame_t *f) {
+  uint32_t rtr = (f->flags & CAN_FRAME_RTR) ? 1 : 0;
+
+  if (f->flags & CAN_FRAME_EXT) {
+    return ((f->id >> 18) << 21) | (3 << 19) | ((f->id & 0x3FFFF) << 1) | rtr;
+  }
+  return (f->id << 21) | (rtr << 20);
+}
+
+static inline uint32_t le32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+// Sorted insert; when full, a more urgent frame pushes out the least urgent
+static bool txq_insert(can_state_t *s, const can_frame_t *f) {
+  uint32_t key = can_prio(f), i;
+
+  if (s->txq_len == CAN_TXQ_LEN) {
+    if (key >= can_prio(&s->txq[CAN_TXQ_LEN - 1])) {
+      return false;
+    }
+    s->txq_len--;
+  }
+  for (i = s->txq_len; i > 0 && can_prio(&s->txq[i - 1]) > key; i--) {
+    s->txq[i] = s->txq[i - 1];
+  }
+  s->txq[i] = *f;
+  s->txq_len++;
+  return true;
+}
+
+static void mbox_load(uint32_t i, uint32_t m) {
+  can_state_t *s = &state[i];
+  CAN_TxMailBox_TypeDef *tx = &CANx(i)->TX[m];
+  const can_frame_t *f = &s->txq[0];
+  uint32_t k;
+
+  tx->TXMIR = (f->flags & CAN_FRAME_EXT ? (f->id << 3) | MIR_IDE : f->id << 21) |
+              (f->flags & CAN_FRAME_RTR ? MIR_RTR : 0);
+  tx->TXMDTR = f->len & 0xF;
+  tx->TXMDLR = le32(f->data);
+  tx->TXMDHR = le32(f->data + 4);
+  tx->TXMIR |= TXMIR_TXRQ;
+  s->mbox[m] = *f;
+  s->busy |= 1 << m;
+  for (k = 1; k < s->txq_len; k++) {
+    s->txq[k - 1] = s->txq[k];
+  }
+  s->txq_len--;
+}
+
+/**
+ * @brief Keeps the mailboxes holding the most urgent frames.
+ *
+ * @details Empty mailboxes take the head of the queue. If none is empty and
+ * the head beats a mailbox, that mailbox is aborted; its completion
+ * interrupt puts the frame back in the queue and calls this again. One abort
+ * at a time is enough, since each completion re-evaluates.
+ */
+static void tx_pump(uint32_t i) {
+  can_state_t *s = &state[i];
+  uint32_t m, worst = 3;
+
+  for (m = 0; m < 3 && s->txq_len; m++) {
+    if (!(s->busy & (1 << m))) {
+      mbox_load(i, m);
+    }
+  }
+  if (!s->txq_len || s->aborting) {
+    return;
+  }
+  for (m = 0; m < 3; m++) {
+    if (worst == 3 || can_prio(&s->mbox[m]) > can_prio(&s->mbox[worst])) {
+      worst = m;
+    }
+  }
+  if (can_prio(&s->txq[0]) < can_prio(&s->mbox[worst])) {
+    s->aborting = 1 << worst;
+    CANx(i)->TSTATR = TSTATR_ABRQ(worst);
+  }
+}
+
+static void can_tx_irq(uint32_t i) {
+  can_state_t *s = &state[i];
+  uint32_t tsr = CANx(i)->TSTATR;
+  uint32_t m;
+
+  for (m = 0; m < 3; m++) {
+    if (!(tsr & TSTATR_RQCP(m))) {
+      continue;
+    }
+    CANx(i)->TSTATR = TSTATR_RQCP(m); // Also clears TXOK/ALST/TERR
+    s->busy &= ~(1 << m);
+    if (tsr & TSTATR_TXOK(m)) {
+      s->stats.tx++;
+    } else if (s->aborting & (1 << m)) {
+      s->stats.tx_requeued++;
+      txq_insert(s, &s->mbox[m]);
+    }
+    s->aborting &= ~(1 << m);
+  }
+  tx_pump(i);
+}
+
+static void can_rx_irq(uint32_t i, uint32_t fifo) {
+  can_state_t *s = &state[i];
+  CAN_TypeDef *b = CANx(i);
+  CAN_FIFOMailBox_TypeDef *mb = &b->RX[fifo];
+  can_frame_t *f;
+  uint32_t ir, dt;
+
+  while (b->RFIFO[fifo] & RFIFO_FMP) {
+    if (s->rx_head[fifo] - s->rx_tail[fifo] < CAN_RXQ_LEN) {
+      f = &s->rxq[fifo][s->rx_head[fifo] & (CAN_RXQ_LEN - 1)];
+      ir = mb->RXMIR;
+      dt = mb->RXMDTR;
+      f->id = ir & MIR_IDE ? ir >> 3 : ir >> 21;
+      f->flags = (ir & MIR_IDE ? CAN_FRAME_EXT : 0) | (ir & MIR_RTR ? CAN_FRAME_RTR : 0);
+      f->len = dt & 0xF;
+      f->filter = dt >> 8;
+      f->time = dt >> 16;
+      put32(f->data, mb->RXMDLR);
+      put32(f->data + 4, mb->RXMDHR);
+      s->rx_head[fifo]++;
+      s->stats.rx++;
+    } else {
+      s->stats.rx_dropped++;
+    }
+    b->RFIFO[fifo] = RFIFO_RFOM;
+  }
+  if (b->RFIFO[fifo] & RFIFO_FOVR) {
+    b->RFIFO[fifo] = RFIFO_FOVR;
+    s->stats.rx_dropped++;
+  }
+  if (s->on_rx) {
+    s->on_rx(i + 1, fifo);
+  }
+}
+
+IRQ_HANDLER_FPU(can1_tx_irq_handler) { can_tx_irq(0); }
+IRQ_HANDLER_FPU(can1_rx0_irq_handler) { can_rx_irq(0, 0); }
+IRQ_HANDLER_FPU(can1_rx1_irq_handler) { can_rx_irq(0, 1); }
+IRQ_HANDLER_FPU(can2_tx_irq_handler) { can_tx_irq(1); }
+IRQ_HANDLER_FPU(can2_rx0_irq_handler) { can_rx_irq(1, 0); }
+IRQ_HANDLER_FPU(can2_rx1_irq_handler) { can_rx_irq(1, 1); }
+
+/**
+ * @brief BTIMR for a bitrate with the sample point near 87.5 %.
+ *
+ * @details Takes the most time quanta per bit (up to 18, which keeps TS1
+ * within 16) that divide PCLK1 exactly.
+ */
+static bool can_timing(uint32_t pclk, uint32_t bitrate, uint32_t *btimr) {
+  uint32_t tq, brp, ts1, ts2;
+
+  for (tq = 18; tq >= 8; tq--) {
+    if (pclk % (bitrate * tq)) {
+      continue;
+    }
+    brp = pclk / (bitrate * tq);
+    if (brp < 1 || brp > 1024) {
+      continue;
+    }
+    ts2 = (tq + 4) / 8;
+    ts1 = tq - 1 - ts2;
+    *btimr = (brp - 1) | ((ts1 - 1) << 16) | ((ts2 - 1) << 20);
+    return true;
+  }
+  return false;
+}
+
+static bool can_wait(CAN_TypeDef *b, bool inak) {
+  uint32_t n = SPIN;
+
+  while (!(b->STATR & STATR_INAK) == inak) {
+    if (!--n) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void can_pins(uint32_t i, uint8_t pins) {
+  uint32_t rx_port, tx_port, rx, tx;
+
+  if (i == 0) {
+    AFIO_PCFR1 = (AFIO_PCFR1 & ~PCFR1_CAN1_RM(3)) |
+                 (pins == CAN_PINS_REMAP1 ? PCFR1_CAN1_RM(2) : pins == CAN_PINS_REMAP2 ? PCFR1_CAN1_RM(3) : 0);
+    rx_port = tx_port = pins == CAN_PINS_REMAP1 ? PB : pins == CAN_PINS_REMAP2 ? PD : PA;
+    rx = pins == CAN_PINS_REMAP1 ? 8 : pins == CAN_PINS_REMAP2 ? 0 : 11;
+  } else {
+    AFIO_PCFR1 = (AFIO_PCFR1 & ~PCFR1_CAN2_RM) | (pins == CAN_PINS_REMAP1 ? PCFR1_CAN2_RM : 0);
+    rx_port = tx_port = PB;
+    rx = pins == CAN_PINS_REMAP1 ? 5 : 12;
+  }
+  tx = rx + 1;
+  if (state[i].pin_clock != RCC_GPIO(rx_port)) {
+    if (state[i].pin_clock) {
+      rcc_clock_release(state[i].pin_clock);
+    }
+    state[i].pin_clock = RCC_GPIO(rx_port);
+    rcc_clock_acquire(state[i].pin_clock);
+  }
+  gpio_config(rx_port, rx, GPIO_IN_FLOATING);
+  gpio_config(tx_port, tx, GPIO_AF_PP_50MHZ);
+}
+
+bool can_init(uint32_t bus, const can_config_t *cfg) {
+  uint32_t i = bus - 1;
+  can_state_t *s;
+  CAN_TypeDef *b;
+  rcc_clocks_t clocks;
+  uint32_t btimr;
+
+  if (i > 1 || (i == 1 && cfg->pins == CAN_PINS_REMAP2)) {
+    return false;
+  }
+  rcc_get_clocks(&clocks);
+  if (!can_timing(clocks.pclk1, cfg->bitrate, &btimr)) {
+    return false;
+  }
+  s = &state[i];
+  b = CANx(i);
+  if (!s->clocked) {
+    // CAN2's filters live in CAN1
+    rcc_clock_acquire(can_hw[0].clock);
+    if (i) {
+      rcc_clock_acquire(can_hw[i].clock);
+    }
+    rcc_clock_acquire(RCC_AFIO);
+    s->clocked = true;
+  }
+  can_pins(i, cfg->pins);
+
+  pfic_disable_irq(can_hw[i].tx_irq);
+  pfic_disable_irq(can_hw[i].rx0_irq);
+  pfic_disable_irq(can_hw[i].rx1_irq);
+  b->CTLR = CTLR_INRQ;
+  if (!can_wait(b, true)) {
+    return false;
+  }
+  b->CTLR = CTLR_INRQ | CTLR_ABOM;
+  b->BTIMR = btimr | (cfg->loopback ? BTIMR_LBKM : 0) | (cfg->silent ? BTIMR_SILM : 0);
+  b->INTENR = INTENR_TMEIE | INTENR_FMPIE0 | INTENR_FOVIE0 | INTENR_FMPIE1 | INTENR_FOVIE1;
+
+  s->rx_head[0] = s->rx_tail[0] = 0;
+  s->rx_head[1] = s->rx_tail[1] = 0;
+  s->txq_len = 0;
+  s->busy = 0;
+  s->aborting = 0;
+  s->on_rx = cfg->on_rx;
+  s->stats = (can_stats_t){0};
+  pfic_enable_irq(can_hw[i].tx_irq);
+  pfic_enable_irq(can_hw[i].rx0_irq);
+  pfic_enable_irq(can_hw[i].rx1_irq);
+
+  // Leaves init mode after 11 recessive bits on RX
+  b->CTLR = CTLR_ABOM;
+  return can_wait(b, false);
+}
+
+bool can_set_filters(canfilt_rule_t *can1, uint32_t n1, canfilt_rule_t *can2, uint32_t n2, bool *exact) {
+  canfilt_bank_t banks[CANFILT_BANKS];
+  uint32_t n, k, split = 0, list = 0, scale = 0, fifo = 0;
+
+  *exact = true;
+  n = canfilt_share(can1, n1, can2, n2, banks, &split, exact);
+  if (n == 0 && (n1 || n2)) {
+    return false;
+  }
+  if (!filters_clocked) {
+    rcc_clock_acquire(can_hw[0].clock);
+    filters_clocked = true;
+  }
+  CAN1x->FCTLR = (split << 8) | FCTLR_FINIT;
+  CAN1x->FWR = 0;
+  for (k = 0; k < n; k++) {
+    list |= (uint32_t)banks[k].list << k;
+    scale |= (uint32_t)banks[k].scale32 << k;
+    fifo |= (uint32_t)banks[k].fifo << k;
+    CAN1x->FILTER[k].FR1 = banks[k].fr1;
+    CAN1x->FILTER[k].FR2 = banks[k].fr2;
+  }
+  CAN1x->FMCFGR = list;
+  CAN1x->FSCFGR = scale;
+  CAN1x->FAFIFOR = fifo;
+  CAN1x->FWR = n ? 0xFFFFFFFF >> (32 - n) : 0;
+  CAN1x->FCTLR = split << 8;
+  return true;
+}
+
+bool can_send(uint32_t bus, const can_frame_t *frame) {
+  uint32_t i = bus - 1;
+  bool ok;
+
+  if (i > 1 || frame->len > 8) {
+    return false;
+  }
+  pfic_disable_irq(can_hw[i].tx_irq);
+  ok = txq_insert(&state[i], frame);
+  if (ok) {
+    tx_pump(i);
+  }
+  pfic_enable_irq(can_hw[i].tx_irq);
+  return ok;
+}
+
+const can_frame_t *can_peek(uint32_t bus, uint32_t fifo) {
+  can_state_t *s = &state[(bus - 1) & 1];
+
+  fifo &= 1;
+  if (s->rx_head[fifo] == s->rx_tail[fifo]) {
+    return NULL;
+  }
+  return &s->rxq[fifo][s->rx_tail[fifo] & (CAN_RXQ_LEN - 1)];
+}
+
+void can_release(uint32_t bus, uint32_t fifo) {
+  can_state_t *s = &state[(bus - 1) & 1];
+
+  fifo &= 1;
+  if (s->rx_head[fifo] != s->rx_tail[fifo]) {
+    s->rx_tail[fifo]++;
+  }
+}
+
+void can_stats(uint32_t bus, can_stats_t *stats) {
+  uint32_t i = (bus - 1) & 1;
+
+  pfic_disable_irq(can_hw[i].tx_irq);
+  pfic_disable_irq(can_hw[i].rx0_irq);
+  pfic_disable_irq(can_hw[i].rx1_irq);
+  *stats = state[i].stats;
+  pfic_enable_irq(can_hw[i].tx_irq);
+  pfic_enable_irq(can_hw[i].rx0_irq);
+  pfic_enable_irq(can_hw[i].rx1_irq);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "canfilt.h"
+
+
+/**
+ * @brief bxCAN controller register block (CAN1, CAN2)
+ *
+ * @details Both controllers sit on APB1 (clock enable RCC_APB1ENR bits 25 and
+ * 26). The 28 filter banks live in CAN1's block only and are shared: FCTLR
+ * CAN2SB is the first bank belonging to CAN2, so CAN2 needs the CAN1 clock too.
+ * Bit time = (BRP + 1) * (3 + TS1 + TS2) PCLK1 cycles.
+ *
+ * Bit fields of CTLR:
+ * - Bit 0  : INRQ  - Initialisation request
+ * - Bit 1  : SLEEP - Sleep request
+ * - Bit 2  : TXFP  - 0: mailboxes go out by ID priority, 1: by request order
+ * - Bit 4  : NART  - No automatic retransmission
+ * - Bit 6  : ABOM  - Automatic bus-off recovery
+ *
+ * Bit fields of TSTATR (mailbox n at bit 8 * n):
+ * - Bit 0  : RQCP  - Request completed (sent, aborted or failed)
+ * - Bit 1  : TXOK  - Sent
+ * - Bit 7  : ABRQ  - Abort request
+ * - Bits 28:26 : TME - Mailbox empty
+ *
+ * Bit fields of RFIFOx:
+ * - Bits 1:0 : FMP  - Frames pending (0-3)
+ * - Bit 4    : FOVR - Overrun, a frame was lost
+ * - Bit 5    : RFOM - Release the output mailbox
+ *
+ * Bit fields of BTIMR:
+ * - Bits 9:0   : BRP  - Prescaler - 1
+ * - Bits 19:16 : TS1  - Segment 1 - 1
+ * - Bits 22:20 : TS2  - Segment 2 - 1
+ * - Bits 25:24 : SJW  - Resynchronisation jump width - 1
+ * - Bit 30     : LBKM - Loopback
+ * - Bit 31     : SILM - Silent
+ */
+typedef struct {
+  volatile uint32_t TXMIR;
+  volatile uint32_t TXMDTR;
+  volatile uint32_t TXMDLR;
+  volatile uint32_t TXMDHR;
+} CAN_TxMailBox_TypeDef;
+
+typedef struct {
+  volatile uint32_t RXMIR;
+  volatile uint32_t RXMDTR;
+  volatile uint32_t RXMDLR;
+  volatile uint32_t RXMDHR;
+} CAN_FIFOMailBox_TypeDef;
+
+typedef struct {
+  volatile uint32_t FR1;
+  volatile uint32_t FR2;
+} CAN_FilterRegister_TypeDef;
+
+typedef struct {
+  volatile uint32_t CTLR;
+  volatile uint32_t STATR;
+  volatile uint32_t TSTATR;
+  volatile uint32_t RFIFO[2];
+  volatile uint32_t INTENR;
+  volatile uint32_t ERRSR;
+  volatile uint32_t BTIMR;
+  uint32_t RESERVED0[88];
+  CAN_TxMailBox_TypeDef TX[3];
+  CAN_FIFOMailBox_TypeDef RX[2];
+  uint32_t RESERVED1[12];
+  volatile uint32_t FCTLR;
+  volatile uint32_t FMCFGR;
+  uint32_t RESERVED2;
+  volatile uint32_t FSCFGR;
+  uint32_t RESERVED3;
+  volatile uint32_t FAFIFOR;
+  uint32_t RESERVED4;
+  volatile uint32_t FWR;
+  uint32_t RESERVED5[8];
+  CAN_FilterRegister_TypeDef FILTER[28];
+} CAN_TypeDef;
+
+#define CAN_RXQ_LEN         16  // Frames per RX FIFO queue, power of two
+#define CAN_TXQ_LEN         16  // Frames waiting for a mailbox
+
+// Pin choices
+#define CAN_PINS_DEFAULT    0   // CAN1 PA11/PA12, CAN2 PB12/PB13
+#define CAN_PINS_REMAP1     1   // CAN1 PB8/PB9,   CAN2 PB5/PB6
+#define CAN_PINS_REMAP2     2   // CAN1 PD0/PD1
+
+#define CAN_FRAME_EXT       (1 << 0)
+#define CAN_FRAME_RTR       (1 << 1)
+
+typedef struct {
+  uint32_t id;
+  uint8_t flags;
+  uint8_t len;
+  uint8_t filter;               // Filter match index, RX only
+  uint16_t time;                // Bit-time stamp, RX only
+  uint8_t data[8] __attribute__((aligned(4)));
+} can_frame_t;
+
+typedef struct {
+  uint32_t bitrate;
+  uint8_t pins;
+  bool loopback;
+  bool silent;
+  void (*on_rx)(uint32_t bus, uint32_t fifo); // ISR context, a frame was queued
+} can_config_t;
+
+typedef struct {
+  uint32_t rx;
+  uint32_t rx_dropped;          // Queue full or hardware FIFO overrun
+  uint32_t tx;
+  uint32_t tx_requeued;         // Aborted for a higher-priority frame
+} can_stats_t;
+
+// bus is 1 or 2. Starts with no filters, i.e. receiving nothing.
+bool can_init(uint32_t bus, const can_config_t *cfg);
+
+/**
+ * @brief Compiles and loads the filters of both controllers.
+ *
+ * @details See canfilt_share(). Rule arrays are merged in place. Returns
+ * false if they do not fit; *exact is false when the banks accept more than
+ * the rules.
+ */
+bool can_set_filters(canfilt_rule_t *can1, uint32_t n1, canfilt_rule_t *can2, uint32_t n2, bool *exact);
+
+/**
+ * @brief Queues a frame for transmission in ID priority order.
+ *
+ * @details Frames wait in a software queue sorted by arbitration priority and
+ * the three mailboxes always hold the most urgent ones: a frame that beats
+ * everything in the mailboxes aborts the least urgent mailbox, which goes
+ * back to the queue. False if the queue is full.
+ */
+bool can_send(uint32_t bus, const can_frame_t *frame);
+
+// Oldest received frame of a FIFO, read in place; NULL if none
+const can_frame_t *can_peek(uint32_t bus, uint32_t fifo);
+void can_release(uint32_t bus, uint32_t fifo);
+
+void can_stats(uint32_t bus, can_stats_t *stats);
@@ -0,0 +1,211 @@
+#include "crc.h"
+
+#include <stddef.h>
+
+#include "crc32.h"
+#include "dma.h"
+#include "rcc.h"
+#include "systime.h"
+
+#define CRCx                ((CRC_TypeDef *)CRC)
+#define CRC_CTLR_RST        (1 << 0)
+
+#define DMA_CHUNK           0xFFFF
+
+static struct {
+  const uint32_t *next;
+  uint32_t left;        // Words not yet handed to the DMA
+  crc_done_t done;
+  void *ctx;
+  uint8_t ch;
+  volatile uint8_t busy;
+} job;
+
+
+// Reset, then one word that leads from 0xFFFFFFFF to state. The unit is
+// clocked from here until the result has been read.
+static void crc_seed(uint32_t state) {
+  rcc_clock_acquire(RCC_CRC);
+  CRCx->CTLR = CRC_CTLR_RST;
+  if (state != CRC_NATIVE_INIT) {
+    CRCx->DATAR = ~crc32_unshift(state);
+  }
+}
+
+/**
+ * @brief zlib-compatible CRC-32 on the CRC unit.
+ *
+ * @details Words are bit-reversed on the way in and the state is reversed and
+ * inverted on the way out. Short inputs, and all inputs while a DMA job owns the
+ * unit, stay in software.
+ */
+uint32_t crc_hw_update(uint32_t crc, const void *buf, uint32_t len) {
+  const uint8_t *p = buf;
+  uint32_t head = (4 - ((uintptr_t)p & 3)) & 3;
+  const uint32_t *w;
+  uint32_t n;
+
+  if (len < head + 4 * CRC_HW_MIN || job.busy) {
+    return crc32_update(crc, buf, len);
+  }
+  crc = crc32_update(crc, p, head);
+  p += head;
+  len -= head;
+
+  w = (const uint32_t *)p;
+  n = len >> 2;
+  crc_seed(crc32_rbit(~crc));
+  while (n--) {
+    CRCx->DATAR = crc32_rbit(*w++);
+  }
+  crc = ~crc32_rbit(CRCx->DATAR);
+  rcc_clock_release(RCC_CRC);
+
+  return crc32_update(crc, w, len & 3);
+}
+
+uint32_t crc_hw_words(uint32_t state, const uint32_t *words, uint32_t n) {
+  uint32_t k;
+
+  if (job.busy) {
+    while (n--) {
+      state = crc32_word(state, *words++);
+    }
+    return state;
+  }
+  crc_seed(state);
+  for (k = n >> 2; k; k--) {
+    CRCx->DATAR = words[0];
+    CRCx->DATAR = words[1];
+    CRCx->DATAR = words[2];
+    CRCx->DATAR = words[3];
+    words += 4;
+  }
+  for (k = n & 3; k; k--) {
+    CRCx->DATAR = *words++;
+  }
+  state = CRCx->DATAR;
+  rcc_clock_release(RCC_CRC);
+  return state;
+}
+
+static void crc_dma_next(void) {
+  DMA_Channel_TypeDef *ch = dma_channel(job.ch);
+  uint32_t n = job.left > DMA_CHUNK ? DMA_CHUNK : job.left;
+
+  ch->CFGR = 0;
+  ch->PADDR = (uint32_t)&CRCx->DATAR;
+  ch->MADDR = (uint32_t)job.next;
+  ch->CNTR = n;
+  job.next += n;
+  job.left -= n;
+  ch->CFGR = DMA_CFGR_MEM2MEM | DMA_CFGR_DIR | DMA_CFGR_MINC | DMA_CFGR_PSIZE_32 |
+             DMA_CFGR_MSIZE_32 | DMA_CFGR_TCIE | DMA_CFGR_TEIE | DMA_CFGR_PL(1) |
+             DMA_CFGR_EN;
+}
+
+static void crc_dma(void *ctx, uint32_t flags) {
+  bool ok = !(flags & DMA_FLAG_TEIF);
+  uint32_t state;
+
+  (void)ctx;
+  if (ok && !(flags & DMA_FLAG_TCIF)) {
+    return;
+  }
+  if (ok && job.left) {
+    crc_dma_next();
+    return;
+  }
+  dma_detach(job.ch, crc_dma, NULL);
+  state = CRCx->DATAR;
+  rcc_clock_release(RCC_CRC);
+  job.busy = 0;
+  if (job.done) {
+    job.done(job.ctx, ok, state);
+  }
+}
+
+// CRC_DMA if pinned, else the first channel nobody holds from the top down,
+// since drivers claim the low ones first
+static bool crc_dma_claim(void) {
+#ifdef CRC_DMA
+  job.ch = CRC_DMA;
+  return dma_attach(CRC_DMA, crc_dma, NULL);
+#else
+  uint32_t ch;
+
+  for (ch = DMA_CHANNELS; ch--;) {
+    if (dma_attach(ch, crc_dma, NULL)) {
+      job.ch = (uint8_t)ch;
+      return true;
+    }
+  }
+  return false;
+#endif
+}
+
+/**
+ * @brief Native unit CRC fed by memory-to-memory DMA.
+ *
+ * @details The CPU only seeds the unit and reloads the channel every 65535
+ * words, so a whole 256 KiB image costs two interrupts. Source must be word
+ * aligned (flash or SRAM).
+ */
+bool crc_hw_submit(uint32_t state, const uint32_t *words, uint32_t n, crc_done_t done, void *ctx) {
+  if (job.busy || n == 0 || ((uintptr_t)words & 3)) {
+    return false;
+  }
+  if (!crc_dma_claim()) {
+    return false;
+  }
+  job.busy = 1;
+  job.next = words;
+  job.left = n;
+  job.done = done;
+  job.ctx = ctx;
+  crc_seed(state);
+  crc_dma_next();
+  return true;
+}
+
+bool crc_hw_busy(void) {
+  return job.busy;
+}
+
+static void bench_done(void *ctx, bool ok, uint32_t state) {
+  *(uint32_t *)ctx = ok ? state : ~state;
+}
+
+static inline uint32_t per_kcycle(uint32_t bytes, uint32_t cycles) {
+  return cycles ? (uint32_t)((uint64_t)bytes * 1000 / cycles) : 0;
+}
+
+void crc_bench(const void *buf, uint32_t bytes, crc_bench_t *result) {
+  uint32_t n = bytes >> 2, t, sw, hw, words, dma = 0, model = CRC_NATIVE_INIT;
+
+  t = (uint32_t)systime_ticks();
+  sw = crc32_update(0, buf, bytes);
+  result->sw = per_kcycle(bytes, (uint32_t)systime_ticks() - t);
+
+  t = (uint32_t)systime_ticks();
+  hw = crc_hw_update(0, buf, bytes);
+  result->hw = per_kcycle(bytes, (uint32_t)systime_ticks() - t);
+
+  t = (uint32_t)systime_ticks();
+  words = crc_hw_words(CRC_NATIVE_INIT, buf, n);
+  result->words = per_kcycle(n * 4, (uint32_t)systime_ticks() - t);
+
+  result->dma = 0;
+  t = (uint32_t)systime_ticks();
+  if (crc_hw_submit(CRC_NATIVE_INIT, buf, n, bench_done, &dma)) {
+    while (job.busy) {
+    }
+    result->dma = per_kcycle(n * 4, (uint32_t)systime_ticks() - t);
+  }
+
+  // Software reference for the native CRC: the model of the unit in crc32.c
+  for (t = 0; t < n; t++) {
+    model = crc32_word(model, ((const uint32_t *)buf)[t]);
+  }
+  result->ok = hw == sw && words == model && dma == model;
+}
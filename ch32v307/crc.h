@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief CRC calculation unit register block
+ *
+ * @details The unit sits on AHB (clock enable RCC_AHBENR bit 6). Every 32-bit
+ * write to DATAR advances the CRC-32 (polynomial 0x04C11DB7, MSB first) by one
+ * word in a few cycles; reading DATAR returns the current state. IDATAR is a
+ * free 8-bit scratch register.
+ *
+ * Bit fields of CTLR:
+ * - Bit 0 : RST  - Reset DATAR to 0xFFFFFFFF
+ *
+ * @note The unit has no input/output reflection and no other initial value, so
+ * zlib-compatible results need each word bit-reversed by the CPU (see
+ * lib/crc32.h); only the native word CRC can be fed by DMA. The transfer is
+ * memory-to-memory, so it needs no request line: a job takes the highest
+ * numbered channel no driver holds at submit time and gives it back when done,
+ * which also means a driver initialised during a job may find its channel
+ * taken. Define CRC_DMA to pin one channel instead.
+ */
+typedef struct {
+  volatile uint32_t DATAR;
+  volatile uint32_t IDATAR;
+  volatile uint32_t CTLR;
+} CRC_TypeDef;
+
+#define CRC_HW_MIN          16  // Words below which the software path is faster
+
+#define CRC_NATIVE_INIT     0xFFFFFFFF
+
+typedef void (*crc_done_t)(void *ctx, bool ok, uint32_t state);
+
+// Same contract as crc32_update(); unaligned head and tail go through software
+uint32_t crc_hw_update(uint32_t crc, const void *buf, uint32_t len);
+
+// Native unit CRC over words, starting from state (CRC_NATIVE_INIT for a new one)
+uint32_t crc_hw_words(uint32_t state, const uint32_t *words, uint32_t n);
+
+// Same through DMA; done() runs in ISR context. False while a job is running
+// or when every DMA channel is taken.
+bool crc_hw_submit(uint32_t state, const uint32_t *words, uint32_t n, crc_done_t done, void *ctx);
+bool crc_hw_busy(void);
+
+typedef struct {
+  uint32_t sw;                  // Bytes per 1000 HCLK cycles, crc32_update()
+  uint32_t hw;                  // crc_hw_update(), words bit-reversed by the CPU
+  uint32_t words;               // crc_hw_words(), native
+  uint32_t dma;                 // crc_hw_submit() to done(), native
+  bool ok;                      // The hardware paths matched the software ones
+} crc_bench_t;
+
+// Runs each path over the same bytes (word aligned); call with nothing else
+// running and a DMA channel free
+void crc_bench(const void *buf, uint32_t bytes, crc_bench_t *result);
@@ -0,0 +1,211 @@
+#include "dac.h"
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "gpio.h"
+#include "pfic.h"
+#include "rcc.h"
+
+#define DACx                ((DAC_TypeDef *)DAC)
+
+#define DAC_CTLR_EN         (1 << 0)
+#define DAC_CTLR_TEN        (1 << 2)
+#define DAC_CTLR_TSEL(x)    ((x) << 3)
+#define DAC_CTLR_DMAEN      (1 << 12)
+
+#define TIM_CR1(t)          (*((volatile uint32_t *)((t) + 0x00)))
+#define TIM_CR2(t)          (*((volatile uint32_t *)((t) + 0x04)))
+#define TIM_EGR(t)          (*((volatile uint32_t *)((t) + 0x14)))
+#define TIM_PSC(t)          (*((volatile uint32_t *)((t) + 0x28)))
+#define TIM_ARR(t)          (*((volatile uint32_t *)((t) + 0x2C)))
+#define TIM_CR1_CEN         (1 << 0)
+#define TIM_CR1_ARPE        (1 << 7)
+
+typedef struct {
+  uint32_t tim;
+  uint8_t tim_clock;
+  uint8_t tsel;
+  uint8_t dma;
+  uint8_t pin;          // PA4 / PA5
+} dac_hw_t;
+
+static const dac_hw_t dac_hw[2] = {
+  {TIM6_BASE, RCC_TIM(6), 0x0, DMA2_CH(3), 4},
+  {TIM7_BASE, RCC_TIM(7), 0x2, DMA2_CH(4), 5},
+};
+
+static struct {
+  const void *next;
+  uint32_t next_len;
+  void (*on_swap)(void);
+  volatile uint8_t queued;
+  bool clocked;
+} dac[2];
+
+
+static inline uint32_t dac_index(uint8_t output) {
+  return output == DAC_OUT2 ? 1 : 0;
+}
+
+/**
+ * @brief End of a period: switch to the queued waveform, if any.
+ *
+ * @details The last sample of the period is already in the holding register, so
+ * the DMA is not needed again until the next trigger. Reprogramming the channel
+ * here starts the new waveform exactly after the old one; only an interrupt
+ * latency above one sample period repeats a sample.
+ */
+static void dac_dma(void *ctx, uint32_t flags) {
+  uint32_t i = (uint32_t)ctx;
+  DMA_Channel_TypeDef *ch = dma_channel(dac_hw[i].dma);
+
+  if (!(flags & DMA_FLAG_TCIF) || !dac[i].queued) {
+    return;
+  }
+  ch->CFGR &= ~DMA_CFGR_EN;
+  ch->MADDR = (uint32_t)dac[i].next;
+  ch->CNTR = dac[i].next_len;
+  ch->CFGR |= DMA_CFGR_EN;
+  dac[i].queued = 0;
+  if (dac[i].on_swap) {
+    dac[i].on_swap();
+  }
+}
+
+bool dac_set_rate(uint8_t output, uint32_t rate_hz) {
+  uint32_t tim = dac_hw[dac_index(output)].tim;
+  rcc_clocks_t clocks;
+  uint32_t timclk, ticks, psc;
+
+  if (rate_hz == 0) {
+    return false;
+  }
+  rcc_get_clocks(&clocks);
+  // Timer clock is PCLK1, doubled when the APB1 prescaler is not 1
+  timclk = clocks.pclk1 == clocks.hclk ? clocks.pclk1 : 2 * clocks.pclk1;
+  ticks = (timclk + rate_hz / 2) / rate_hz;
+  if (ticks == 0) {
+    return false;
+  }
+  // Both registers are preloaded, so a running waveform changes rate on the
+  // next update without a short period
+  psc = (ticks - 1) >> 16;
+  TIM_PSC(tim) = psc;
+  TIM_ARR(tim) = ticks / (psc + 1) - 1;
+  return true;
+}
+
+/**
+ * @brief Starts looping a waveform out of one or both DAC outputs.
+ *
+ * @details Each TIM6 (output 1, dual) or TIM7 (output 2) update moves the
+ * holding register to the output and requests the next sample from a circular
+ * DMA channel, so no CPU work is done per sample. The holding register is
+ * preloaded with the last sample so the loop starts at wave[0].
+ */
+bool dac_start(const dac_config_t *cfg) {
+  uint32_t i = dac_index(cfg->output);
+  const dac_hw_t *hw = &dac_hw[i];
+  DMA_Channel_TypeDef *ch = dma_channel(hw->dma);
+  bool dual = cfg->output == DAC_DUAL;
+  uint32_t bits, shift;
+
+  if (cfg->output < DAC_OUT1 || cfg->output > DAC_DUAL || !cfg->wave ||
+      cfg->len == 0 || cfg->len > 0xFFFF) {
+    return false;
+  }
+  // DAC1 and UART4 RX share a channel, as do DAC2, SDIO and UART5 TX
+  if (!dma_attach(hw->dma, dac_dma, (void *)i)) {
+    return false;
+  }
+  if (!dac[i].clocked) {
+    rcc_clock_acquire(RCC_DAC);
+    rcc_clock_acquire(hw->tim_clock);
+    rcc_clock_acquire(RCC_GPIOA);
+    dac[i].clocked = true;
+  }
+  gpio_config(PA, hw->pin, GPIO_IN_ANALOG);
+  if (dual) {
+    gpio_config(PA, dac_hw[1].pin, GPIO_IN_ANALOG);
+  }
+
+  TIM_CR1(hw->tim) = 0;
+  if (!dac_set_rate(cfg->output, cfg->rate_hz)) {
+    return false;
+  }
+  dac[i].on_swap = cfg->on_swap;
+  dac[i].queued = 0;
+
+  ch->CFGR = 0;
+  ch->MADDR = (uint32_t)cfg->wave;
+  ch->CNTR = cfg->len;
+  if (dual) {
+    ch->PADDR = (uint32_t)&DACx->RD12BDHR;
+    ch->CFGR = DMA_CFGR_PSIZE_32 | DMA_CFGR_MSIZE_32;
+    DACx->RD12BDHR = ((const uint32_t *)cfg->wave)[cfg->len - 1];
+  } else {
+    ch->PADDR = (uint32_t)(i ? &DACx->R12BDHR2 : &DACx->R12BDHR1);
+    ch->CFGR = DMA_CFGR_PSIZE_16 | DMA_CFGR_MSIZE_16;
+    *(i ? &DACx->R12BDHR2 : &DACx->R12BDHR1) = ((const uint16_t *)cfg->wave)[cfg->len - 1];
+  }
+  ch->CFGR |= DMA_CFGR_DIR | DMA_CFGR_MINC | DMA_CFGR_CIRC | DMA_CFGR_TCIE |
+              DMA_CFGR_PL(2) | DMA_CFGR_EN;
+
+  bits = DAC_CTLR_EN | DAC_CTLR_TEN | DAC_CTLR_TSEL(hw->tsel);
+  if (dual) {
+    // Output 2 follows the TIM6 trigger; output 1's stream feeds both
+    DACx->CTLR = (bits | DAC_CTLR_DMAEN) | (bits << 16);
+  } else {
+    shift = i * 16;
+    DACx->CTLR = (DACx->CTLR & ~(0xFFFFu << shift)) | ((bits | DAC_CTLR_DMAEN) << shift);
+  }
+
+  TIM_CR2(hw->tim) = 0x2 << 4; // MMS = update -> TRGO
+  TIM_EGR(hw->tim) = 1;
+  TIM_CR1(hw->tim) = TIM_CR1_ARPE | TIM_CR1_CEN;
+  return true;
+}
+
+void dac_stop(uint8_t output) {
+  uint32_t i = dac_index(output);
+
+  if (!dac[i].clocked) {
+    return;
+  }
+  TIM_CR1(dac_hw[i].tim) = 0;
+  dma_detach(dac_hw[i].dma, dac_dma, (void *)i);
+  if (output == DAC_DUAL) {
+    DACx->CTLR = 0;
+  } else {
+    DACx->CTLR &= ~(0xFFFFu << (i * 16));
+  }
+  dac[i].queued = 0;
+  rcc_clock_release(RCC_DAC);
+  rcc_clock_release(dac_hw[i].tim_clock);
+  rcc_clock_release(RCC_GPIOA);
+  dac[i].clocked = false;
+}
+
+bool dac_queue(uint8_t output, const void *wave, uint32_t len) {
+  uint32_t i = dac_index(output);
+  uint32_t irq = dma_irq(dac_hw[i].dma);
+  bool ok = false;
+
+  if (!wave || len == 0 || len > 0xFFFF) {
+    return false;
+  }
+  pfic_disable_irq(irq);
+  if (!dac[i].queued) {
+    dac[i].next = wave;
+    dac[i].next_len = len;
+    dac[i].queued = 1;
+    ok = true;
+  }
+  pfic_enable_irq(irq);
+  return ok;
+}
+
+bool dac_queued(uint8_t output) {
+  return dac[dac_index(output)].queued;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief DAC register block
+ *
+ * @details The DAC sits on APB1 (clock enable RCC_APB1ENR bit 29). Output 1 is on
+ * PA4 and output 2 on PA5, both in analog mode. With a trigger enabled the value
+ * written to a holding register is moved to the output on the next trigger event.
+ *
+ * Bit fields of CTLR (output 1 in 15:0, output 2 the same in 31:16):
+ * - Bit 0     : EN1     - Output enable
+ * - Bit 1     : BOFF1   - Output buffer disable
+ * - Bit 2     : TEN1    - Trigger enable
+ * - Bits 5:3  : TSEL1   - Trigger (000: TIM6 TRGO, 010: TIM7 TRGO, 111: software)
+ * - Bits 7:6  : WAVE1   - Built-in noise/triangle generator (00: off)
+ * - Bit 12    : DMAEN1  - DMA request on each trigger
+ *
+ * @note DMA channels: output 1 on DMA2 channel 3, output 2 on DMA2 channel 4.
+ * These are shared with UART4 RX and UART5 TX, so those cannot use DMA while the
+ * DAC streams. In dual mode both outputs take the TIM6 trigger and output 1's DMA
+ * stream writes both holding registers at once through RD12BDHR.
+ */
+typedef struct {
+  volatile uint32_t CTLR;
+  volatile uint32_t SWTR;
+  volatile uint32_t R12BDHR1;
+  volatile uint32_t L12BDHR1;
+  volatile uint32_t R8BDHR1;
+  volatile uint32_t R12BDHR2;
+  volatile uint32_t L12BDHR2;
+  volatile uint32_t R8BDHR2;
+  volatile uint32_t RD12BDHR;
+  volatile uint32_t LD12BDHR;
+  volatile uint32_t RD8BDHR;
+  volatile uint32_t DOR1;
+  volatile uint32_t DOR2;
+} DAC_TypeDef;
+
+#define DAC_OUT1            1 // TIM6, uint16_t samples
+#define DAC_OUT2            2 // TIM7, uint16_t samples
+#define DAC_DUAL            3 // TIM6, uint32_t samples packed by wave_pair()
+
+typedef struct {
+  uint8_t output;       // DAC_OUT1, DAC_OUT2 or DAC_DUAL
+  uint32_t rate_hz;     // Samples per second
+  const void *wave;     // Played in a loop until replaced
+  uint32_t len;         // Samples (pairs for DAC_DUAL), up to 65535
+  void (*on_swap)(void); // ISR context: a queued waveform started playing
+} dac_config_t;
+
+// False if the DMA channel belongs to another driver (UART4 RX, UART5 TX, SDIO)
+bool dac_start(const dac_config_t *cfg);
+void dac_stop(uint8_t output);
+bool dac_set_rate(uint8_t output, uint32_t rate_hz);
+
+// Replaces the waveform at the end of the current period; false if one is queued
+bool dac_queue(uint8_t output, const void *wave, uint32_t len);
+bool dac_queued(uint8_t output);
@@ -0,0 +1,123 @@
+#include "dma.h"
+
+#include <stddef.h>
+
+#include "bitops.h"
+#include "pfic.h"
+#include "rcc.h"
+
+#define DMA1_INTFR          (*((volatile uint32_t *)(DMA1 + 0x00)))
+#define DMA1_INTFCR         (*((volatile uint32_t *)(DMA1 + 0x04)))
+#define DMA2_INTFR          (*((volatile uint32_t *)(DMA2 + 0x00)))
+#define DMA2_INTFCR         (*((volatile uint32_t *)(DMA2 + 0x04)))
+#define DMA2_EXTEN_INTFR    (*((volatile uint32_t *)(DMA2 + 0xD0))) // Channels 8-11
+#define DMA2_EXTEN_INTFCR   (*((volatile uint32_t *)(DMA2 + 0xD4)))
+
+static struct {
+  dma_callback_t cb;
+  void *ctx;
+} handlers[DMA_CHANNELS];
+
+// Bit ch: the channel holds its controller's clock; drivers attach and detach
+// from interrupts too, so it changes by AMO only
+static uint32_t attached;
+
+DMA_Channel_TypeDef *dma_channel(uint32_t ch) {
+  if (ch < 7) {
+    return (DMA_Channel_TypeDef *)(DMA1 + 0x08 + 0x14 * ch);
+  }
+  ch -= 7;
+  if (ch < 7) {
+    return (DMA_Channel_TypeDef *)(DMA2 + 0x08 + 0x14 * ch);
+  }
+  return (DMA_Channel_TypeDef *)(DMA2 + 0x90 + 0x14 * (ch - 7));
+}
+
+uint32_t dma_irq(uint32_t ch) {
+  if (ch < 7) {
+    return DMA1_CH1_IRQn + ch;
+  }
+  ch -= 7;
+  return ch < 5 ? DMA2_CH1_IRQn + ch : DMA2_CH6_IRQn + ch - 5;
+}
+
+uint32_t dma_flags(uint32_t ch) {
+  if (ch < 7) {
+    return (DMA1_INTFR >> (4 * ch)) & 0xF;
+  }
+  ch -= 7;
+  if (ch < 7) {
+    return (DMA2_INTFR >> (4 * ch)) & 0xF;
+  }
+  return (DMA2_EXTEN_INTFR >> (4 * (ch - 7))) & 0xF;
+}
+
+void dma_clear(uint32_t ch, uint32_t flags) {
+  if (ch < 7) {
+    DMA1_INTFCR = flags << (4 * ch);
+    return;
+  }
+  ch -= 7;
+  if (ch < 7) {
+    DMA2_INTFCR = flags << (4 * ch);
+  } else {
+    DMA2_EXTEN_INTFCR = flags << (4 * (ch - 7));
+  }
+}
+
+bool dma_attach(uint32_t ch, dma_callback_t cb, void *ctx) {
+  if (bits_set(&attached, 1u << ch)) {
+    // Taken: only its owner may attach again
+    if (handlers[ch].cb != cb || handlers[ch].ctx != ctx) {
+      return false;
+    }
+  } else {
+    rcc_clock_acquire(ch < 7 ? RCC_DMA1 : RCC_DMA2);
+    handlers[ch].ctx = ctx;
+    handlers[ch].cb = cb;
+  }
+  dma_clear(ch, DMA_FLAG_GIF | DMA_FLAG_TCIF | DMA_FLAG_HTIF | DMA_FLAG_TEIF);
+  pfic_enable_irq(dma_irq(ch));
+  return true;
+}
+
+bool dma_detach(uint32_t ch, dma_callback_t cb, void *ctx) {
+  if (!bits_get(&attached, 1u << ch) || handlers[ch].cb != cb || handlers[ch].ctx != ctx ||
+      !bits_clear(&attached, 1u << ch)) {
+    return false;
+  }
+  pfic_disable_irq(dma_irq(ch));
+  dma_channel(ch)->CFGR = 0;
+  handlers[ch].cb = NULL;
+  handlers[ch].ctx = NULL;
+  rcc_clock_release(ch < 7 ? RCC_DMA1 : RCC_DMA2);
+  return true;
+}
+
+static void dma_dispatch(uint32_t ch) {
+  uint32_t flags = dma_flags(ch);
+
+  dma_clear(ch, flags);
+  if (handlers[ch].cb) {
+    handlers[ch].cb(handlers[ch].ctx, flags);
+  }
+}
+
+IRQ_HANDLER_FPU(dma1_channel1_irq_handler)  { dma_dispatch(DMA1_CH(1)); }
+IRQ_HANDLER_FPU(dma1_channel2_irq_handler)  { dma_dispatch(DMA1_CH(2)); }
+IRQ_HANDLER_FPU(dma1_channel3_irq_handler)  { dma_dispatch(DMA1_CH(3)); }
+IRQ_HANDLER_FPU(dma1_channel4_irq_handler)  { dma_dispatch(DMA1_CH(4)); }
+IRQ_HANDLER_FPU(dma1_channel5_irq_handler)  { dma_dispatch(DMA1_CH(5)); }
+IRQ_HANDLER_FPU(dma1_channel6_irq_handler)  { dma_dispatch(DMA1_CH(6)); }
+IRQ_HANDLER_FPU(dma1_channel7_irq_handler)  { dma_dispatch(DMA1_CH(7)); }
+IRQ_HANDLER_FPU(dma2_channel1_irq_handler)  { dma_dispatch(DMA2_CH(1)); }
+IRQ_HANDLER_FPU(dma2_channel2_irq_handler)  { dma_dispatch(DMA2_CH(2)); }
+IRQ_HANDLER_FPU(dma2_channel3_irq_handler)  { dma_dispatch(DMA2_CH(3)); }
+IRQ_HANDLER_FPU(dma2_channel4_irq_handler)  { dma_dispatch(DMA2_CH(4)); }
+IRQ_HANDLER_FPU(dma2_channel5_irq_handler)  { dma_dispatch(DMA2_CH(5)); }
+IRQ_HANDLER_FPU(dma2_channel6_irq_handler)  { dma_dispatch(DMA2_CH(6)); }
+IRQ_HANDLER_FPU(dma2_channel7_irq_handler)  { dma_dispatch(DMA2_CH(7)); }
+IRQ_HANDLER_FPU(dma2_channel8_irq_handler)  { dma_dispatch(DMA2_CH(8)); }
+IRQ_HANDLER_FPU(dma2_channel9_irq_handler)  { dma_dispatch(DMA2_CH(9)); }
+IRQ_HANDLER_FPU(dma2_channel10_irq_handler) { dma_dispatch(DMA2_CH(10)); }
+IRQ_HANDLER_FPU(dma2_channel11_irq_handler) { dma_dispatch(DMA2_CH(11)); }
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief DMA channel register block
+ *
+ * @details DMA1 (0x40020000) has channels 1-7 and DMA2 (0x40020400) has channels
+ * 1-11. Channel n of either controller starts at base + 0x08 + 0x14 * (n - 1);
+ * DMA2 channels 8-11 start at 0x40020490 and report their flags in the extended
+ * INTFR/INTFCR pair at 0x400204D0. The DMA clock must be enabled in RCC_AHBENR
+ * (bit 0 for DMA1, bit 1 for DMA2) before touching these registers.
+ *
+ * Bit fields of CFGR:
+ * - Bit 0      : EN       - Channel enable
+ * - Bit 1      : TCIE     - Transfer complete interrupt enable
+ * - Bit 2      : HTIE     - Half transfer interrupt enable
+ * - Bit 3      : TEIE     - Transfer error interrupt enable
+ * - Bit 4      : DIR      - 0: peripheral to memory, 1: memory to peripheral
+ * - Bit 5      : CIRC     - Circular mode
+ * - Bit 6      : PINC     - Peripheral address increment
+ * - Bit 7      : MINC     - Memory address increment
+ * - Bits 9:8   : PSIZE    - Peripheral size (00: 8, 01: 16, 10: 32 bits)
+ * - Bits 11:10 : MSIZE    - Memory size (00: 8, 01: 16, 10: 32 bits)
+ * - Bits 13:12 : PL       - Priority (00: low .. 11: very high)
+ * - Bit 14     : MEM2MEM  - Memory to memory mode
+ *
+ * @note CNTR can only be written while EN is clear. In circular mode CNTR counts
+ * down from the programmed length and reloads, so the write position in the
+ * buffer is length - CNTR.
+ */
+typedef struct {
+  volatile uint32_t CFGR;
+  volatile uint32_t CNTR;
+  volatile uint32_t PADDR;
+  volatile uint32_t MADDR;
+  uint32_t RESERVED;
+} DMA_Channel_TypeDef;
+
+#define DMA_CFGR_EN         (1 << 0)
+#define DMA_CFGR_TCIE       (1 << 1)
+#define DMA_CFGR_HTIE       (1 << 2)
+#define DMA_CFGR_TEIE       (1 << 3)
+#define DMA_CFGR_DIR        (1 << 4)
+#define DMA_CFGR_CIRC       (1 << 5)
+#define DMA_CFGR_PINC       (1 << 6)
+#define DMA_CFGR_MINC       (1 << 7)
+#define DMA_CFGR_PSIZE_8    (0 << 8)
+#define DMA_CFGR_PSIZE_16   (1 << 8)
+#define DMA_CFGR_PSIZE_32   (2 << 8)
+#define DMA_CFGR_MSIZE_8    (0 << 10)
+#define DMA_CFGR_MSIZE_16   (1 << 10)
+#define DMA_CFGR_MSIZE_32   (2 << 10)
+#define DMA_CFGR_PL(x)      ((x) << 12)
+#define DMA_CFGR_MEM2MEM    (1 << 14)
+
+// Per-channel flags, as returned by dma_flags()
+#define DMA_FLAG_GIF        (1 << 0)
+#define DMA_FLAG_TCIF       (1 << 1)
+#define DMA_FLAG_HTIF       (1 << 2)
+#define DMA_FLAG_TEIF       (1 << 3)
+
+// Channel identifiers: DMA1 channels 1-7 are 0-6, DMA2 channels 1-11 are 7-17
+#define DMA1_CH(n)          ((n) - 1)
+#define DMA2_CH(n)          ((n) + 6)
+#define DMA_CHANNELS        18
+
+typedef void (*dma_callback_t)(void *ctx, uint32_t flags);
+
+DMA_Channel_TypeDef *dma_channel(uint32_t ch);
+uint32_t dma_irq(uint32_t ch);
+uint32_t dma_flags(uint32_t ch);
+void dma_clear(uint32_t ch, uint32_t flags);
+
+/**
+ * @brief Claims the channel and routes its interrupt to cb; enables the DMA
+ * clock and the PFIC line.
+ *
+ * @details Several peripherals share fixed request lines (DAC1 and UART4 RX on
+ * DMA2 channel 3; DAC2, SDIO and UART5 TX on channel 4), so a channel has one
+ * owner at a time. False if another cb/ctx holds it; the same pair may attach
+ * again, as on a re-init. A polled user passes a NULL cb and its own ctx to
+ * hold the channel without a handler.
+ */
+bool dma_attach(uint32_t ch, dma_callback_t cb, void *ctx);
+// Frees the channel; false, leaving it alone, unless cb/ctx is its owner
+bool dma_detach(uint32_t ch, dma_callback_t cb, void *ctx);
+
+static inline uint32_t dma_remaining(uint32_t ch) {
+  return dma_channel(ch)->CNTR;
+}
@@ -0,0 +1,133 @@
+#include "dsp_bench.h"
+
+#include "systime.h"
+
+#define BLOCK               64
+#define TAPS                32
+#define STAGES              2
+#define FACTOR              4
+#define FFT_N               256
+
+static q15_t h15[TAPS], s15[2 * TAPS], x15[FFT_N], y15[BLOCK];
+static q31_t h31[TAPS], s31[2 * TAPS], x31[FFT_N], y31[BLOCK];
+static float hf[TAPS], sf[2 * TAPS], xf[FFT_N], yf[BLOCK];
+
+// Two low-pass sections, fc = fs / 10, Q = 0.707; Q14 / Q30 for the fixed ones
+static const float bq_f32[5 * STAGES] = {
+  0.0675f, 0.1349f, 0.0675f, -1.1430f, 0.4128f,
+  0.0675f, 0.1349f, 0.0675f, -1.1430f, 0.4128f,
+};
+static q15_t bq_q15[5 * STAGES], bq_s15[4 * STAGES];
+static q31_t bq_q31[5 * STAGES], bq_s31[4 * STAGES];
+static float bq_sf[2 * STAGES];
+
+
+static uint32_t cycles(void) {
+  return (uint32_t)systime_ticks();
+}
+
+// A small-amplitude triangle, in range for every kernel
+static void fill(void) {
+  uint32_t i;
+  int32_t v;
+
+  for (i = 0; i < FFT_N; i++) {
+    v = (int32_t)(i & 31) - 16;
+    x15[i] = (q15_t)(v * 1024);
+    x31[i] = v * (1 << 26);
+    xf[i] = (float)v / 32;
+  }
+  for (i = 0; i < TAPS; i++) {
+    h15[i] = 32768 / 2 / TAPS;
+    h31[i] = INT32_MAX / 2 / TAPS;
+    hf[i] = 0.5f / TAPS;
+  }
+  for (i = 0; i < 5 * STAGES; i++) {
+    bq_q15[i] = (q15_t)(bq_f32[i] * 16384);
+    bq_q31[i] = (q31_t)(bq_f32[i] * 1073741824.0f);
+  }
+}
+
+void dsp_bench(uint32_t n, dsp_bench_t *result) {
+  dsp_fir_q15_t f15;
+  dsp_fir_q31_t f31;
+  dsp_fir_f32_t ff;
+  dsp_biquad_q15_t b15;
+  dsp_biquad_q31_t b31;
+  dsp_biquad_f32_t bf;
+  uint32_t t[DSP_BENCH_FORMATS] = {0};
+  uint32_t s, i, k;
+
+  fill();
+
+  dsp_fir_q15_init(&f15, h15, TAPS, s15);
+  dsp_fir_q31_init(&f31, h31, TAPS, s31);
+  dsp_fir_f32_init(&ff, hf, TAPS, sf);
+  for (i = 0; i < n; i++) {
+    s = cycles();
+    dsp_fir_q15(&f15, x15, y15, BLOCK);
+    t[DSP_BENCH_Q15] += cycles() - s;
+    s = cycles();
+    dsp_fir_q31(&f31, x31, y31, BLOCK);
+    t[DSP_BENCH_Q31] += cycles() - s;
+    s = cycles();
+    dsp_fir_f32(&ff, xf, yf, BLOCK);
+    t[DSP_BENCH_F32] += cycles() - s;
+  }
+  for (k = 0; k < DSP_BENCH_FORMATS; k++) {
+    result->fir[k] = t[k] / (n * BLOCK);
+    t[k] = 0;
+  }
+
+  for (i = 0; i < n; i++) {
+    s = cycles();
+    dsp_decim_q15(&f15, FACTOR, x15, y15, BLOCK);
+    t[DSP_BENCH_Q15] += cycles() - s;
+    s = cycles();
+    dsp_decim_q31(&f31, FACTOR, x31, y31, BLOCK);
+    t[DSP_BENCH_Q31] += cycles() - s;
+    s = cycles();
+    dsp_decim_f32(&ff, FACTOR, xf, yf, BLOCK);
+    t[DSP_BENCH_F32] += cycles() - s;
+  }
+  for (k = 0; k < DSP_BENCH_FORMATS; k++) {
+    result->decim[k] = t[k] / (n * BLOCK / FACTOR);
+    t[k] = 0;
+  }
+
+  dsp_biquad_q15_init(&b15, bq_q15, STAGES, 1, bq_s15);
+  dsp_biquad_q31_init(&b31, bq_q31, STAGES, 1, bq_s31);
+  dsp_biquad_f32_init(&bf, bq_f32, STAGES, bq_sf);
+  for (i = 0; i < n; i++) {
+    s = cycles();
+    dsp_biquad_q15(&b15, x15, y15, BLOCK);
+    t[DSP_BENCH_Q15] += cycles() - s;
+    s = cycles();
+    dsp_biquad_q31(&b31, x31, y31, BLOCK);
+    t[DSP_BENCH_Q31] += cycles() - s;
+    s = cycles();
+    dsp_biquad_f32(&bf, xf, yf, BLOCK);
+    t[DSP_BENCH_F32] += cycles() - s;
+  }
+  for (k = 0; k < DSP_BENCH_FORMATS; k++) {
+    result->biquad[k] = t[k] / (n * BLOCK);
+    t[k] = 0;
+  }
+
+  // In place, so refill before each transform and keep that out of the figure
+  for (i = 0; i < n; i++) {
+    fill();
+    s = cycles();
+    dsp_rfft_q15(x15, FFT_N);
+    t[DSP_BENCH_Q15] += cycles() - s;
+    s = cycles();
+    dsp_rfft_q31(x31, FFT_N);
+    t[DSP_BENCH_Q31] += cycles() - s;
+    s = cycles();
+    dsp_rfft_f32(xf, FFT_N);
+    t[DSP_BENCH_F32] += cycles() - s;
+  }
+  for (k = 0; k < DSP_BENCH_FORMATS; k++) {
+    result->rfft[k] = t[k] / n;
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "dsp.h"
+
+
+/**
+ * @brief Cycle costs of the filter and spectrum kernels (lib/dsp.h) in each
+ * sample format.
+ *
+ * @details Figures are HCLK cycles, indexed by dsp_bench_fmt_t: per sample
+ * through a 32-tap FIR and a two-stage biquad cascade, per output of a
+ * decimate-by-4 on the same FIR, and per whole 256-point real FFT. Blocks are
+ * 64 samples, so the SysTick read and the call overhead are amortised the way
+ * a DMA half-buffer would amortise them. Float runs through the FPU only in a
+ * `make FPU=1` build; compare with fpu_bench.h.
+ *
+ * tools/dsp_test.c checks the same kernels for accuracy on the host.
+ */
+typedef enum {
+  DSP_BENCH_Q15,
+  DSP_BENCH_Q31,
+  DSP_BENCH_F32,
+  DSP_BENCH_FORMATS
+} dsp_bench_fmt_t;
+
+typedef struct {
+  uint32_t fir[DSP_BENCH_FORMATS];
+  uint32_t decim[DSP_BENCH_FORMATS];
+  uint32_t biquad[DSP_BENCH_FORMATS];
+  uint32_t rfft[DSP_BENCH_FORMATS];
+} dsp_bench_t;
+
+// n blocks (transforms for the FFT) per figure; call with nothing else running
+void dsp_bench(uint32_t n, dsp_bench_t *result);
@@ -0,0 +1,225 @@
+#include "dvp.h"
+
+#include <stddef.h>
+
+#include "gpio.h"
+#include "pfic.h"
+#include "rcc.h"
+
+#define DVPx                ((DVP_TypeDef *)DVP)
+
+#define CR0_ENABLE          (1 << 0)
+#define CR0_JPEG            (1 << 6)
+#define CR1_DMA_EN          (1 << 0)
+#define CR1_ALL_CLR         (1 << 1)
+#define CR1_RCV_CLR         (1 << 2)
+#define CR1_CM              (1 << 4)
+#define CR1_CROP            (1 << 5)
+#define CR1_FCRC(x)         ((x) << 6)
+
+#define IF_STR_FRM          (1 << 0)
+#define IF_ROW_DONE         (1 << 1)
+#define IF_FRM_DONE         (1 << 2)
+#define IF_FIFO_OV          (1 << 3)
+#define IF_STP_FRM          (1 << 4)
+
+#define STK_CTLR            (*((volatile uint32_t *)(SYSTICK_BASE + 0x00)))
+#define STK_CNTL            (*((volatile uint32_t *)(SYSTICK_BASE + 0x08)))
+#define STK_CTLR_STE        (1 << 0)
+#define STK_CTLR_STCLK      (1 << 2)
+
+typedef struct {
+  uint32_t port;
+  uint8_t pin;
+} dvp_pin_t;
+
+static const dvp_pin_t pins[] = {
+  {PA, 9}, {PA, 10}, {PC, 8}, {PC, 9}, {PC, 11}, {PB, 6}, {PB, 8}, {PB, 9},
+  {PA, 4}, {PA, 5}, {PA, 6},
+};
+
+static struct {
+  uint8_t *frames[2];
+  uint32_t row_bytes;
+  uint16_t rows;
+  volatile uint16_t row;        // Rows of the current frame written so far
+  uint8_t cur;                  // Buffer being captured into
+  volatile uint8_t held[2];     // Handed out, waiting for dvp_release()
+  dvp_line_t on_line;
+  dvp_frame_t on_frame;
+  void *ctx;
+  dvp_stats_t stats;
+  bool clocked;
+} dvp;
+
+
+static void dvp_rewind(void) {
+  uint8_t *base = dvp.frames[dvp.cur];
+
+  dvp.row = 0;
+  DVPx->DMA_BUF0 = (uint32_t)base;
+  DVPx->DMA_BUF1 = (uint32_t)(base + dvp.row_bytes);
+}
+
+static void dvp_frame_done(void) {
+  uint8_t *frame = dvp.frames[dvp.cur];
+  uint32_t len = dvp.row * dvp.row_bytes;
+
+  if (dvp.held[dvp.cur ^ 1]) {
+    dvp.stats.dropped++;
+    dvp_rewind();
+    return;
+  }
+  dvp.held[dvp.cur] = 1;
+  dvp.cur ^= 1;
+  dvp_rewind();
+  dvp.stats.frames++;
+  if (dvp.on_frame) {
+    dvp.on_frame(dvp.ctx, frame, len);
+  }
+}
+
+/**
+ * @brief Row and frame events.
+ *
+ * @details While row r is stored the hardware already owns the other buffer
+ * register for row r + 1, so the register that just finished is moved two rows
+ * on. The interrupt therefore has one row time to run.
+ */
+IRQ_HANDLER_FPU(dvp_irq_handler) {
+  uint32_t t0 = STK_CNTL;
+  uint8_t f = DVPx->IFR;
+  uint16_t row;
+
+  if (f & IF_STR_FRM) {
+    DVPx->IFR = (uint8_t)~IF_STR_FRM;
+  }
+  if (f & IF_ROW_DONE) {
+    DVPx->IFR = (uint8_t)~IF_ROW_DONE;
+    row = dvp.row;
+    if (row < dvp.rows) {
+      dvp.row = row + 1;
+      if (dvp.on_line) {
+        dvp.on_line(dvp.ctx, row, dvp.frames[dvp.cur] + row * dvp.row_bytes, dvp.row_bytes);
+      }
+      if (row + 2 < dvp.rows) {
+        if (row & 1) {
+          DVPx->DMA_BUF1 += 2 * dvp.row_bytes;
+        } else {
+          DVPx->DMA_BUF0 += 2 * dvp.row_bytes;
+        }
+      }
+    }
+  }
+  if (f & IF_FRM_DONE) {
+    DVPx->IFR = (uint8_t)~IF_FRM_DONE;
+    dvp_frame_done();
+  }
+  if (f & IF_FIFO_OV) {
+    DVPx->IFR = (uint8_t)~IF_FIFO_OV;
+    dvp.stats.overflows++;
+  }
+  if (f & IF_STP_FRM) {
+    DVPx->IFR = (uint8_t)~IF_STP_FRM;
+  }
+  dvp.stats.isr_ticks += STK_CNTL - t0;
+}
+
+bool dvp_start(const dvp_config_t *cfg) {
+  uint32_t bpp = cfg->format == DVP_RGB565 ? 2 : 1;
+  uint32_t i, rows, cols;
+  bool crop = cfg->crop_w != 0;
+
+  cols = (crop ? cfg->crop_w : cfg->width) * bpp;
+  rows = crop ? cfg->crop_h : cfg->height;
+  if (cfg->format == DVP_JPEG) {
+    // Rows are HSYNC bursts; capture no more than fit
+    crop = false;
+    cols = cfg->width;
+    rows = cfg->frame_size / cols < cfg->height ? cfg->frame_size / cols : cfg->height;
+  }
+  if (cols == 0 || rows < 2 || (cols & 3) || cols * rows > cfg->frame_size ||
+      ((uintptr_t)cfg->frames[0] & 3) || ((uintptr_t)cfg->frames[1] & 3) ||
+      (crop && (cfg->crop_x + cfg->crop_w > cfg->width || cfg->crop_y + cfg->crop_h > cfg->height))) {
+    return false;
+  }
+  dvp_stop();
+
+  rcc_clock_acquire(RCC_DVP);
+  rcc_clock_acquire(RCC_GPIOA);
+  rcc_clock_acquire(RCC_GPIOB);
+  rcc_clock_acquire(RCC_GPIOC);
+  dvp.clocked = true;
+  for (i = 0; i < sizeof(pins) / sizeof(pins[0]); i++) {
+    gpio_config(pins[i].port, pins[i].pin, GPIO_IN_FLOATING);
+  }
+  if (!(STK_CTLR & STK_CTLR_STE)) {
+    STK_CTLR = STK_CTLR_STE | STK_CTLR_STCLK;
+  }
+
+  dvp.frames[0] = cfg->frames[0];
+  dvp.frames[1] = cfg->frames[1];
+  dvp.row_bytes = cols;
+  dvp.rows = rows;
+  dvp.cur = 0;
+  dvp.held[0] = dvp.held[1] = 0;
+  dvp.on_line = cfg->on_line;
+  dvp.on_frame = cfg->on_frame;
+  dvp.ctx = cfg->ctx;
+  dvp.stats = (dvp_stats_t){0};
+
+  DVPx->CR0 = 0;
+  DVPx->CR1 = CR1_ALL_CLR | CR1_RCV_CLR;
+  DVPx->CR1 = 0;
+  DVPx->ROW_NUM = cfg->format == DVP_JPEG ? rows : cfg->height;
+  DVPx->COL_NUM = cfg->format == DVP_JPEG ? cols : cfg->width * bpp;
+  if (crop) {
+    DVPx->HOFFCNT = cfg->crop_x * bpp;
+    DVPx->CAPCNT = cols;
+    DVPx->VST = cfg->crop_y;
+    DVPx->VLINE = rows;
+  }
+  dvp_rewind();
+  DVPx->IFR = 0;
+  DVPx->IER = IF_STR_FRM | IF_ROW_DONE | IF_FRM_DONE | IF_FIFO_OV | IF_STP_FRM;
+  pfic_enable_irq(DVP_IRQn);
+  DVPx->CR1 = CR1_DMA_EN | (crop ? CR1_CROP : 0) | (cfg->single ? CR1_CM : 0) |
+              CR1_FCRC(cfg->skip & 3);
+  DVPx->CR0 = CR0_ENABLE | (cfg->polarity & (DVP_POL_VSYNC | DVP_POL_HSYNC | DVP_POL_PCLK)) |
+              (cfg->format == DVP_JPEG ? CR0_JPEG : 0);
+  return true;
+}
+
+void dvp_stop(void) {
+  if (!dvp.clocked) {
+    return;
+  }
+  pfic_disable_irq(DVP_IRQn);
+  DVPx->CR0 &= ~CR0_ENABLE;
+  DVPx->CR1 &= ~CR1_DMA_EN;
+  DVPx->IER = 0;
+  DVPx->IFR = 0;
+  rcc_clock_release(RCC_DVP);
+  rcc_clock_release(RCC_GPIOA);
+  rcc_clock_release(RCC_GPIOB);
+  rcc_clock_release(RCC_GPIOC);
+  dvp.clocked = false;
+}
+
+void dvp_release(const uint8_t *frame) {
+  uint32_t i;
+
+  for (i = 0; i < 2; i++) {
+    if (frame == dvp.frames[i]) {
+      dvp.held[i] = 0;
+    }
+  }
+}
+
+void dvp_stats(dvp_stats_t *stats) {
+  pfic_disable_irq(DVP_IRQn);
+  *stats = dvp.stats;
+  if (DVPx->CR0 & CR0_ENABLE) {
+    pfic_enable_irq(DVP_IRQn);
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief Digital video port register block
+ *
+ * @details The DVP sits on AHB (clock enable RCC_AHBENR bit 13) and has its own
+ * DMA: each row (one HSYNC active period) is written to DMA_BUF0 or DMA_BUF1,
+ * alternately, starting with BUF0 at the start of a frame. Pins, all inputs:
+ * D0 PA9, D1 PA10, D2 PC8, D3 PC9, D4 PC11, D5 PB6, D6 PB8, D7 PB9, HSYNC PA4,
+ * VSYNC PA5, PCLK PA6.
+ *
+ * Bit fields of CR0:
+ * - Bit 0     : ENABLE   - Interface enable
+ * - Bit 1     : V_POLAR  - VSYNC polarity
+ * - Bit 2     : H_POLAR  - HSYNC polarity
+ * - Bit 3     : P_POLAR  - PCLK sampling edge
+ * - Bits 5:4  : DAT_MOD  - Bus width (00: 8, 01: 10, 10: 12 bits)
+ * - Bit 6     : JPEG     - JPEG mode: HSYNC only qualifies data
+ *
+ * Bit fields of CR1:
+ * - Bit 0     : DMA_EN   - DMA enable
+ * - Bit 1     : ALL_CLR  - Reset the interface and flags
+ * - Bit 2     : RCV_CLR  - Reset the receive logic
+ * - Bit 3     : BUF_TOG  - Buffer the next row goes to
+ * - Bit 4     : CM       - 1: stop after one frame
+ * - Bit 5     : CROP     - Window with HOFFCNT/CAPCNT/VST/VLINE
+ * - Bits 7:6  : FCRC     - Capture every frame, every 2nd, every 4th
+ *
+ * Bit fields of IER/IFR (IFR clears by writing 0):
+ * - Bit 0     : STR_FRM  - Frame start
+ * - Bit 1     : ROW_DONE - Row written to memory
+ * - Bit 2     : FRM_DONE - Frame complete
+ * - Bit 3     : FIFO_OV  - Receive FIFO overflow, data lost
+ * - Bit 4     : STP_FRM  - Capture stopped
+ *
+ * @note COL_NUM and CAPCNT/HOFFCNT count PCLKs, so 2 per RGB565 pixel. PA4/PA5
+ * are also the DAC outputs and PA9/PA10 USART1.
+ */
+typedef struct {
+  volatile uint8_t CR0;
+  volatile uint8_t CR1;
+  volatile uint8_t IER;
+  uint8_t RESERVED0;
+  volatile uint16_t ROW_NUM;
+  volatile uint16_t COL_NUM;
+  volatile uint32_t DMA_BUF0;
+  volatile uint32_t DMA_BUF1;
+  volatile uint8_t IFR;
+  volatile uint8_t STATUS;
+  uint16_t RESERVED1;
+  volatile uint16_t ROW_CNT;
+  uint16_t RESERVED2;
+  volatile uint16_t HOFFCNT;
+  volatile uint16_t VST;
+  volatile uint16_t CAPCNT;
+  volatile uint16_t VLINE;
+  volatile uint32_t DR;
+} DVP_TypeDef;
+
+#define DVP_RAW8            0 // One PCLK per pixel (mono, Bayer)
+#define DVP_RGB565          1 // Two PCLKs per pixel (also YUV422)
+#define DVP_JPEG            2 // Byte stream; width is bytes per HSYNC burst
+
+// Polarity bits for dvp_config_t, written to CR0 as they are
+#define DVP_POL_VSYNC       (1 << 1)
+#define DVP_POL_HSYNC       (1 << 2)
+#define DVP_POL_PCLK        (1 << 3)
+
+// ISR context. Lines point into the frame being captured and stay valid until
+// that frame is handed out or recaptured.
+typedef void (*dvp_line_t)(void *ctx, uint16_t row, const uint8_t *data, uint32_t len);
+// The frame belongs to the callee until dvp_release(). A frame in SRAM can go
+// straight to usbhs_ep_submit() or a MAC descriptor; the USBHS DMA cannot reach
+// EXTRAM, so copy those frames out (or send them from the CPU) first.
+typedef void (*dvp_frame_t)(void *ctx, uint8_t *frame, uint32_t len);
+
+typedef struct {
+  uint8_t format;
+  uint16_t width, height;       // Sensor output in pixels
+  uint16_t crop_x, crop_y;      // Window; crop_w == 0 captures it all
+  uint16_t crop_w, crop_h;
+  uint8_t skip;                 // 0: every frame, 1: every 2nd, 2: every 4th
+  uint8_t polarity;
+  bool single;                  // Stop after one frame
+  uint8_t *frames[2];           // 4-byte aligned; EXTRAM works, see dvp_frame_t
+  uint32_t frame_size;
+  dvp_line_t on_line;
+  dvp_frame_t on_frame;
+  void *ctx;
+} dvp_config_t;
+
+typedef struct {
+  uint32_t frames;              // Handed to on_frame
+  uint32_t dropped;             // Captured while both buffers were held
+  uint32_t overflows;
+  uint32_t isr_ticks;           // SysTick ticks spent in the interrupt
+} dvp_stats_t;
+
+/**
+ * @brief Starts capturing into the two frame buffers, alternately.
+ *
+ * @details A finished frame goes to on_frame only if the other buffer is free
+ * to capture into; otherwise it is dropped and recaptured, so a slow consumer
+ * always gets the newest frame. Row bytes must be a multiple of 4. Frame rate
+ * is stats.frames over time; CPU load is isr_ticks over the SysTick ticks in
+ * the same time.
+ */
+bool dvp_start(const dvp_config_t *cfg);
+void dvp_stop(void);
+void dvp_release(const uint8_t *frame);
+void dvp_stats(dvp_stats_t *stats);
@@ -1,6 +1,9 @@
 #include "ethernet.h"
 
 
+// The MAC and its two DMA engines are on AHB
 void enable_emac() {
-  RCC_APB2EN |= (1 << 14);  
+  rcc_clock_acquire(RCC_ETH_MAC);
+  rcc_clock_acquire(RCC_ETH_MAC_TX);
+  rcc_clock_acquire(RCC_ETH_MAC_RX);
 }
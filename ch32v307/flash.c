@@ -0,0 +1,273 @@
+#include "flash.h"
+
+#include <stddef.h>
+
+#include "rcc.h"
+
+#define FLASHx              ((FLASH_TypeDef *)FLASH_INTER)
+
+#define KEY1                0x45670123
+#define KEY2                0xCDEF89AB
+
+#define CTLR_PG             (1 << 0)
+#define CTLR_PER            (1 << 1)
+#define CTLR_STRT           (1 << 6)
+#define CTLR_LOCK           (1 << 7)
+#define CTLR_FLOCK          (1 << 15)
+#define CTLR_FTPG           (1 << 16)
+#define CTLR_FTER           (1 << 17)
+#define CTLR_BER32          (1 << 23)
+#define STATR_BSY           (1 << 0)
+#define STATR_WRBSY         (1 << 1)
+#define STATR_WRPRTERR      (1 << 4)
+#define STATR_EOP           (1 << 5)
+
+#define PAGE_WORDS          (FLASH_PAGE / 4)
+
+#define STK_CTLR            (*((volatile uint32_t *)(SYSTICK_BASE + 0x00)))
+#define STK_CNTL            (*((volatile uint32_t *)(SYSTICK_BASE + 0x08)))
+#define STK_CTLR_STE        (1 << 0)
+#define STK_CTLR_STCLK      (1 << 2)
+
+static struct {
+  uint32_t page;
+  uint32_t buf[PAGE_WORDS];
+  bool valid;
+  bool dirty;
+} wb;
+
+extern uint8_t _skvstore[], _ekvstore[];
+
+
+static void flash_unlock(void) {
+  FLASHx->KEYR = KEY1;
+  FLASHx->KEYR = KEY2;
+  FLASHx->MODEKEYR = KEY1;
+  FLASHx->MODEKEYR = KEY2;
+}
+
+static void flash_lock(void) {
+  FLASHx->CTLR |= CTLR_LOCK | CTLR_FLOCK;
+}
+
+static inline bool in_flash(uint32_t addr, uint32_t len) {
+  addr -= FLASH;
+  return addr < FLASH_SIZE && len <= FLASH_SIZE - addr;
+}
+
+// One erase of the unit selected by mode at addr
+static RAMFUNC bool flash_erase_unit(uint32_t mode, uint32_t addr) {
+  uint32_t sr;
+
+  FLASHx->CTLR |= mode;
+  FLASHx->ADDR = addr;
+  FLASHx->CTLR |= CTLR_STRT;
+  while (FLASHx->STATR & STATR_BSY);
+  FLASHx->CTLR &= ~mode;
+  sr = FLASHx->STATR;
+  FLASHx->STATR = STATR_EOP | STATR_WRPRTERR;
+  return !(sr & STATR_WRPRTERR);
+}
+
+/**
+ * @brief Fast page program: 64 words into the page buffer, then one start.
+ *
+ * @details Each word store goes to the flash's own buffer and WRBSY covers
+ * the transfer; nothing is fetched from flash until BSY drops.
+ */
+static RAMFUNC bool flash_page_ram(uint32_t addr, const uint32_t *words) {
+  volatile uint32_t *dst = (volatile uint32_t *)addr;
+  uint32_t i, sr;
+
+  FLASHx->CTLR |= CTLR_FTPG;
+  while (FLASHx->STATR & (STATR_BSY | STATR_WRBSY));
+  for (i = 0; i < PAGE_WORDS; i++) {
+    dst[i] = words[i];
+    while (FLASHx->STATR & STATR_WRBSY);
+  }
+  FLASHx->CTLR |= CTLR_STRT;
+  while (FLASHx->STATR & STATR_BSY);
+  FLASHx->CTLR &= ~CTLR_FTPG;
+  sr = FLASHx->STATR;
+  FLASHx->STATR = STATR_EOP | STATR_WRPRTERR;
+  return !(sr & STATR_WRPRTERR);
+}
+
+static RAMFUNC bool flash_halfword_ram(uint32_t addr, uint16_t value) {
+  uint32_t sr;
+
+  FLASHx->CTLR |= CTLR_PG;
+  *(volatile uint16_t *)addr = value;
+  while (FLASHx->STATR & STATR_BSY);
+  FLASHx->CTLR &= ~CTLR_PG;
+  sr = FLASHx->STATR;
+  FLASHx->STATR = STATR_EOP | STATR_WRPRTERR;
+  return !(sr & STATR_WRPRTERR);
+}
+
+bool flash_erase(uint32_t addr, uint32_t len) {
+  uint32_t mode, unit;
+  bool ok = true;
+
+  if ((addr | len) & (FLASH_PAGE - 1) || !in_flash(addr, len)) {
+    return false;
+  }
+  flash_unlock();
+  while (ok && len) {
+    if (!(addr & (FLASH_BLOCK - 1)) && len >= FLASH_BLOCK) {
+      mode = CTLR_BER32;
+      unit = FLASH_BLOCK;
+    } else if (!(addr & (FLASH_SECTOR - 1)) && len >= FLASH_SECTOR) {
+      mode = CTLR_PER;
+      unit = FLASH_SECTOR;
+    } else {
+      mode = CTLR_FTER;
+      unit = FLASH_PAGE;
+    }
+    ok = flash_erase_unit(mode, addr);
+    addr += unit;
+    len -= unit;
+  }
+  flash_lock();
+  return ok;
+}
+
+bool flash_program_page(uint32_t addr, const uint32_t *words) {
+  bool ok;
+
+  if ((addr & (FLASH_PAGE - 1)) || !in_flash(addr, FLASH_PAGE)) {
+    return false;
+  }
+  flash_unlock();
+  ok = flash_page_ram(addr, words);
+  flash_lock();
+  return ok;
+}
+
+bool flash_program_halfword(uint32_t addr, uint16_t value) {
+  bool ok;
+
+  if ((addr & 1) || !in_flash(addr, 2)) {
+    return false;
+  }
+  flash_unlock();
+  ok = flash_halfword_ram(addr, value);
+  flash_lock();
+  return ok;
+}
+
+bool flash_flush(void) {
+  const uint32_t *old = (const uint32_t *)wb.page;
+  uint32_t i;
+  bool same = true, blank = true;
+
+  if (!wb.valid || !wb.dirty) {
+    return true;
+  }
+  for (i = 0; i < PAGE_WORDS; i++) {
+    same &= old[i] == wb.buf[i];
+    blank &= old[i] == FLASH_ERASED;
+  }
+  if (!same) {
+    // On failure the page stays buffered and dirty for another try
+    if (!blank && !flash_erase(wb.page, FLASH_PAGE)) {
+      return false;
+    }
+    if (!flash_program_page(wb.page, wb.buf)) {
+      return false;
+    }
+    for (i = 0; i < PAGE_WORDS; i++) {
+      if (old[i] != wb.buf[i]) {
+        return false;
+      }
+    }
+  }
+  wb.dirty = false;
+  return true;
+}
+
+bool flash_write(uint32_t addr, const void *data, uint32_t len) {
+  const uint8_t *src = data;
+  uint32_t page, off, i;
+
+  if (!in_flash(addr, len)) {
+    return false;
+  }
+  while (len) {
+    page = addr & ~(FLASH_PAGE - 1);
+    if (wb.valid && wb.page != page && !flash_flush()) {
+      return false;
+    }
+    if (!wb.valid || wb.page != page) {
+      for (i = 0; i < PAGE_WORDS; i++) {
+        wb.buf[i] = ((const uint32_t *)page)[i];
+      }
+      wb.page = page;
+      wb.valid = true;
+    }
+    for (off = addr - page; len && off < FLASH_PAGE; off++, len--, addr++) {
+      ((uint8_t *)wb.buf)[off] = *src++;
+    }
+    wb.dirty = true;
+  }
+  return true;
+}
+
+static bool kv_erase(void *ctx, uint32_t off) {
+  (void)ctx;
+  return flash_erase((uint32_t)_skvstore + off, FLASH_PAGE);
+}
+
+static bool kv_program(void *ctx, uint32_t off, const void *page) {
+  (void)ctx;
+  return flash_program_page((uint32_t)_skvstore + off, page);
+}
+
+const kv_flash_t *flash_kvstore(void) {
+  static kv_flash_t fl = {
+    _skvstore, 0, FLASH_PAGE, FLASH_PAGE, FLASH_ERASED, kv_erase, kv_program, NULL
+  };
+
+  fl.size = _ekvstore - _skvstore;
+  return &fl;
+}
+
+static inline uint32_t bytes_per_s(uint32_t bytes, uint32_t ticks, uint32_t hz) {
+  return ticks ? (uint32_t)((uint64_t)bytes * hz / ticks) : 0;
+}
+
+void flash_bench(uint32_t addr, uint32_t bytes, flash_bench_t *result) {
+  static uint32_t pattern[PAGE_WORDS];
+  rcc_clocks_t clocks;
+  uint32_t i, t, hz;
+
+  rcc_get_clocks(&clocks);
+  if (!(STK_CTLR & STK_CTLR_STE)) {
+    STK_CTLR = STK_CTLR_STE | STK_CTLR_STCLK;
+  }
+  hz = STK_CTLR & STK_CTLR_STCLK ? clocks.hclk : clocks.hclk / 8;
+  bytes &= ~(FLASH_PAGE - 1);
+  for (i = 0; i < PAGE_WORDS; i++) {
+    pattern[i] = 0x01010101 * i;
+  }
+
+  // Page by page, so the erase rate is the 256-byte one
+  t = STK_CNTL;
+  for (i = 0; i < bytes; i += FLASH_PAGE) {
+    flash_erase(addr + i, FLASH_PAGE);
+  }
+  result->erase = bytes_per_s(bytes, STK_CNTL - t, hz);
+
+  t = STK_CNTL;
+  for (i = 0; i < bytes; i += FLASH_PAGE) {
+    flash_program_page(addr + i, pattern);
+  }
+  result->fast = bytes_per_s(bytes, STK_CNTL - t, hz);
+
+  flash_erase(addr, bytes);
+  t = STK_CNTL;
+  for (i = 0; i < bytes; i += 2) {
+    flash_program_halfword(addr + i, (uint16_t)i);
+  }
+  result->halfword = bytes_per_s(bytes, STK_CNTL - t, hz);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "kvstore.h"
+
+
+/**
+ * @brief Flash interface register block
+ *
+ * @details Code flash is erased and programmed through these registers after
+ * unlocking CTLR with KEY1/KEY2 in KEYR; the fast page modes additionally need
+ * the same keys in MODEKEYR. Erased flash reads as FLASH_ERASED, not all ones,
+ * and a page must be erased before it is programmed again.
+ *
+ * Bit fields of CTLR:
+ * - Bit 0  : PG     - Standard half-word programming
+ * - Bit 1  : PER    - Sector (4 KiB) erase
+ * - Bit 6  : STRT   - Start the erase/program
+ * - Bit 7  : LOCK   - Lock CTLR, set to relock
+ * - Bit 15 : FLOCK  - Lock the fast modes
+ * - Bit 16 : FTPG   - Fast page (256 B) programming
+ * - Bit 17 : FTER   - Fast page (256 B) erase
+ * - Bit 23 : BER32  - Block (32 KiB) erase
+ *
+ * Bit fields of STATR:
+ * - Bit 0  : BSY    - Operation in progress
+ * - Bit 1  : WRBSY  - Fast programming buffer busy with the last word
+ * - Bit 4  : WRPRTERR - Write to a protected page (write 1 to clear)
+ * - Bit 5  : EOP    - Operation finished (write 1 to clear)
+ *
+ * @note The CPU stalls on any flash fetch while BSY is set, so the erase and
+ * program loops run from RAM (RAMFUNC) and interrupts stay enabled: handlers
+ * in flash wait for the current step, RAMFUNC handlers run at once.
+ */
+typedef struct {
+  volatile uint32_t ACTLR;
+  volatile uint32_t KEYR;
+  volatile uint32_t OBKEYR;
+  volatile uint32_t STATR;
+  volatile uint32_t CTLR;
+  volatile uint32_t ADDR;
+  uint32_t RESERVED;
+  volatile uint32_t OBR;
+  volatile uint32_t WPR;
+  volatile uint32_t MODEKEYR;
+} FLASH_TypeDef;
+
+// Code placed in .data: copied to RAM by the startup code and run from there
+#define RAMFUNC             __attribute__((section(".data.ramfunc"), noinline))
+
+#define FLASH_SIZE          (256 * 1024)
+#define FLASH_PAGE          256
+#define FLASH_SECTOR        4096
+#define FLASH_BLOCK         32768
+#define FLASH_ERASED        0xE339E339
+
+// addr and len page aligned; uses the largest erase units that fit
+bool flash_erase(uint32_t addr, uint32_t len);
+
+// One erased, aligned page of 64 words in a single fast program
+bool flash_program_page(uint32_t addr, const uint32_t *words);
+
+// Standard mode, for comparison and for single half-words
+bool flash_program_halfword(uint32_t addr, uint16_t value);
+
+/**
+ * @brief Buffered write of any size and alignment.
+ *
+ * @details Bytes collect in a one-page RAM buffer loaded from the current
+ * contents; leaving the page or flash_flush() writes it back as one fast
+ * page program (erasing first unless the page is blank, and skipping pages
+ * that did not change). Reads see the old data until then. A write-back that
+ * fails returns false from whichever call made it and keeps the page
+ * buffered, so flash_flush() can try again.
+ */
+bool flash_write(uint32_t addr, const void *data, uint32_t len);
+bool flash_flush(void);
+
+// The linker script's KVSTORE region for kv_mount(): fast page erase and program
+const kv_flash_t *flash_kvstore(void);
+
+typedef struct {
+  uint32_t erase;               // Bytes/s, fast page erase
+  uint32_t fast;                // Bytes/s, fast page programming
+  uint32_t halfword;            // Bytes/s, standard programming
+} flash_bench_t;
+
+// Erases and programs [addr, addr + bytes) several times; the area is lost
+void flash_bench(uint32_t addr, uint32_t bytes, flash_bench_t *result);
@@ -0,0 +1,114 @@
+#include "fpu_bench.h"
+
+#include "dsp.h"
+#include "pfic.h"
+#include "systime.h"
+
+#define LEN                 64
+
+static volatile float a[LEN], b[LEN];
+static float x[LEN], y[LEN];
+static volatile float sink;
+static volatile uint32_t hits;
+
+// Two low-pass sections, fc = fs / 10, Q = 0.707
+static const float biquad_coef[10] = {
+  0.0675f, 0.1349f, 0.0675f, -1.1430f, 0.4128f,
+  0.0675f, 0.1349f, 0.0675f, -1.1430f, 0.4128f,
+};
+static float biquad_state[4];
+
+
+IRQ_HANDLER(tim9_up_irq_handler) {
+  hits++;
+}
+
+IRQ_HANDLER_FPU(tim10_up_irq_handler) {
+  hits++;
+}
+
+static uint32_t cycles(void) {
+  return (uint32_t)systime_ticks();
+}
+
+// Sets mstatus.FS as if the interrupted code had (dirty) or had not (initial)
+// touched the FPU; nothing to do in the soft-float build
+static void fp_state(bool live) {
+#ifdef __riscv_flen
+  __asm__ volatile("csrc mstatus, %0" : : "r"(MSTATUS_FS));
+  __asm__ volatile("csrs mstatus, %0" : : "r"(live ? MSTATUS_FS : MSTATUS_FS_INITIAL));
+#else
+  (void)live;
+#endif
+}
+
+// Cycles per round trip through the handler on irq
+static uint32_t irq_round_trip(uint32_t irq, uint32_t n, bool live) {
+  uint32_t total = 0, t, i;
+
+  pfic_clear_pending(irq);
+  pfic_enable_irq(irq);
+  for (i = 0; i < n; i++) {
+    fp_state(live);
+    t = cycles();
+    pfic_set_pending(irq);
+    while (hits == i) {
+    }
+    total += cycles() - t;
+  }
+  pfic_disable_irq(irq);
+  hits = 0;
+  return total / n;
+}
+
+void fpu_bench(uint32_t n, fpu_bench_t *result) {
+  dsp_biquad_f32_t bq;
+  uint32_t t, total, i, j;
+  float acc;
+
+  for (j = 0; j < LEN; j++) {
+    a[j] = (float)(j + 1) * 0.01f;
+    b[j] = 1.0f - (float)j * 0.005f;
+    x[j] = (j & 8) ? 0.5f : -0.5f;
+  }
+
+  total = 0;
+  for (i = 0; i < n; i++) {
+    acc = 0;
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      acc += a[j] * b[j];
+    }
+    total += cycles() - t;
+    sink = acc;
+  }
+  result->mac = total / (n * LEN);
+
+  total = 0;
+  for (i = 0; i < n; i++) {
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      sink = a[j] / b[j];
+    }
+    total += cycles() - t;
+  }
+  result->div = total / (n * LEN);
+
+  dsp_biquad_f32_init(&bq, biquad_coef, 2, biquad_state);
+  total = 0;
+  for (i = 0; i < n; i++) {
+    t = cycles();
+    dsp_biquad_f32(&bq, x, y, LEN);
+    total += cycles() - t;
+  }
+  result->biquad = total / (n * LEN);
+  sink = y[LEN - 1];
+
+  hits = 0;
+  pfic_set_priority(TIM9_UP_IRQn, 0);
+  pfic_set_priority(TIM10_UP_IRQn, 0);
+  result->irq_int = irq_round_trip(TIM9_UP_IRQn, n, false);
+  result->irq_fpu_idle = irq_round_trip(TIM10_UP_IRQn, n, false);
+  result->irq_fpu_live = irq_round_trip(TIM10_UP_IRQn, n, true);
+  fp_state(true);
+}
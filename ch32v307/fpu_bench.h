@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief Soft-float against hard-float: what float code and FP-aware handlers
+ * cost in the build this runs in.
+ *
+ * @details Run it once from `make` and once from `make FPU=1` and compare.
+ * Figures are HCLK cycles: per multiply-accumulate of a 64-element dot product,
+ * per divide, and per sample through dsp_biquad_f32 (two stages).
+ *
+ * The irq_* figures are a whole round trip (pend, entry, an empty body,
+ * return), for a plain IRQ_HANDLER and for an IRQ_HANDLER_FPU, the latter with
+ * the interrupted code's FP state untouched (mstatus.FS initial, nothing to
+ * save) and live (dirty, the 20 caller-saved FP registers and fcsr go to the
+ * stack). In the soft-float build the two macros are the same and so are the
+ * figures.
+ *
+ * Borrows the TIM9 and TIM10 update interrupt lines, pended from software.
+ */
+typedef struct {
+  uint32_t mac;
+  uint32_t div;
+  uint32_t biquad;
+  uint32_t irq_int;
+  uint32_t irq_fpu_idle;
+  uint32_t irq_fpu_live;
+} fpu_bench_t;
+
+// n repetitions of each; call with interrupts enabled and nothing else running
+void fpu_bench(uint32_t n, fpu_bench_t *result);
@@ -0,0 +1,134 @@
+#include "fsmc.h"
+
+#include "gpio.h"
+#include "rcc.h"
+
+#define FSMCx               ((FSMC_Bank1_TypeDef *)FSMC)
+
+#define BCR_MBKEN           (1 << 0)
+#define BCR_MUXEN           (1 << 1)
+#define BCR_MTYP_PSRAM      (1 << 2)
+#define BCR_MWID_16         (1 << 4)
+#define BCR_WREN            (1 << 12)
+#define BCR_RESERVED        (1 << 7)  // Reads as 1, keep it
+
+#define STK_CTLR            (*((volatile uint32_t *)(SYSTICK_BASE + 0x00)))
+#define STK_CNTL            (*((volatile uint32_t *)(SYSTICK_BASE + 0x08)))
+#define STK_CTLR_STE        (1 << 0)
+#define STK_CTLR_STCLK      (1 << 2)  // HCLK, not HCLK/8
+
+extern uint32_t _sextram[], _eextram[], _extram_end[];
+
+typedef struct {
+  uint32_t port;
+  uint8_t pin;
+} fsmc_pin_t;
+
+// NOE, NWE, NE1, NBL0/1, NADV, then AD0-AD15 in order
+static const fsmc_pin_t bus_pins[] = {
+  {PD, 4}, {PD, 5}, {PD, 7}, {PE, 0}, {PE, 1}, {PB, 7},
+  {PD, 14}, {PD, 15}, {PD, 0}, {PD, 1},
+  {PE, 7}, {PE, 8}, {PE, 9}, {PE, 10}, {PE, 11}, {PE, 12}, {PE, 13}, {PE, 14}, {PE, 15},
+  {PD, 8}, {PD, 9}, {PD, 10},
+};
+
+// A16-A23
+static const fsmc_pin_t addr_pins[8] = {
+  {PD, 11}, {PD, 12}, {PD, 13}, {PE, 3}, {PE, 4}, {PE, 5}, {PE, 6}, {PE, 2},
+};
+
+static heap_t ext_heap;
+static bool clocked;
+
+
+static uint32_t ns_to_cycles(uint32_t ns, uint32_t hclk, uint32_t min, uint32_t max) {
+  uint32_t c = (ns * (hclk / 1000000) + 999) / 1000;
+
+  return c < min ? min : c > max ? max : c;
+}
+
+bool fsmc_init(const fsmc_sram_t *cfg) {
+  rcc_clocks_t clocks;
+  uint32_t i, end, *p;
+
+  if (cfg->addr_lines > 8 || cfg->size > (uint32_t)(_extram_end - _sextram) * 4) {
+    return false;
+  }
+  if (!clocked) {
+    rcc_clock_acquire(RCC_FSMC);
+    rcc_clock_acquire(RCC_AFIO);
+    rcc_clock_acquire(RCC_GPIOB);
+    rcc_clock_acquire(RCC_GPIOD);
+    rcc_clock_acquire(RCC_GPIOE);
+    clocked = true;
+  }
+  for (i = 0; i < sizeof(bus_pins) / sizeof(bus_pins[0]); i++) {
+    gpio_config(bus_pins[i].port, bus_pins[i].pin, GPIO_AF_PP_50MHZ);
+  }
+  for (i = 0; i < cfg->addr_lines; i++) {
+    gpio_config(addr_pins[i].port, addr_pins[i].pin, GPIO_AF_PP_50MHZ);
+  }
+
+  rcc_get_clocks(&clocks);
+  FSMCx->BCR1 = BCR_RESERVED | BCR_MUXEN | BCR_MWID_16 | BCR_WREN |
+                (cfg->psram ? BCR_MTYP_PSRAM : 0);
+  FSMCx->BTR1 = ns_to_cycles(cfg->t_addr_ns, clocks.hclk, 0, 15) |
+                (ns_to_cycles(cfg->t_hold_ns, clocks.hclk, 1, 15) << 4) |
+                (ns_to_cycles(cfg->t_data_ns, clocks.hclk, 1, 255) << 8) |
+                (ns_to_cycles(cfg->t_turn_ns, clocks.hclk, 0, 15) << 16);
+  FSMCx->BCR1 |= BCR_MBKEN;
+
+  for (p = _sextram; p < _eextram; p++) {
+    *p = 0;
+  }
+  end = PSRAM1 + cfg->size;
+  heap_init(&ext_heap, _eextram, end > (uint32_t)_eextram ? end - (uint32_t)_eextram : 0);
+  return end >= (uint32_t)_eextram;
+}
+
+heap_t *fsmc_heap(void) {
+  return &ext_heap;
+}
+
+static inline uint32_t bytes_per_s(uint32_t bytes, uint32_t cycles, uint32_t hclk) {
+  return cycles ? (uint32_t)((uint64_t)bytes * hclk / cycles) : 0;
+}
+
+void fsmc_bench(void *buf, uint32_t bytes, fsmc_bench_t *result) {
+  volatile uint32_t *w = buf;
+  uint32_t n = bytes / 4, mask = n - 1;
+  uint32_t i, t, x = 1, sum = 0;
+  rcc_clocks_t clocks;
+
+  rcc_get_clocks(&clocks);
+  if (!(STK_CTLR & STK_CTLR_STE)) {
+    STK_CTLR = STK_CTLR_STE | STK_CTLR_STCLK;
+  }
+  // The tick may be HCLK/8 if someone else started it
+  if (!(STK_CTLR & STK_CTLR_STCLK)) {
+    clocks.hclk /= 8;
+  }
+
+  t = STK_CNTL;
+  for (i = 0; i < n; i += 4) {
+    w[i] = i;
+    w[i + 1] = i;
+    w[i + 2] = i;
+    w[i + 3] = i;
+  }
+  result->seq_write = bytes_per_s(bytes, STK_CNTL - t, clocks.hclk);
+
+  t = STK_CNTL;
+  for (i = 0; i < n; i += 4) {
+    sum += w[i] + w[i + 1] + w[i + 2] + w[i + 3];
+  }
+  result->seq_read = bytes_per_s(bytes, STK_CNTL - t, clocks.hclk);
+
+  t = STK_CNTL;
+  for (i = 0; i < n; i++) {
+    x = x * 1664525 + 1013904223;
+    sum += w[(x >> 8) & mask];
+  }
+  result->rand_read = bytes_per_s(bytes, STK_CNTL - t, clocks.hclk);
+  w[0] = sum;  // Keep the reads
+}
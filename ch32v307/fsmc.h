@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "heap.h"
+
+
+/**
+ * @brief FSMC NOR/SRAM bank 1 registers
+ *
+ * @details The FSMC sits on AHB (clock enable RCC_AHBENR bit 8). Bank 1 region 1
+ * (chip select NE1, PD7) is mapped at PSRAM1 (0x60000000). The 100-pin package
+ * has no A0-A15 pins, so the bus runs multiplexed: AD0-AD15 on the data pins
+ * carry the low address while NADV (PB7) is low, A16-A23 come from PD11-PD13
+ * and PE2-PE6. An SRAM needs an external address latch on NADV; multiplexed
+ * PSRAMs take ADV directly.
+ *
+ * Bit fields of BCR1:
+ * - Bit 0      : MBKEN    - Bank enable
+ * - Bit 1      : MUXEN    - Address/data multiplexing
+ * - Bits 3:2   : MTYP     - Memory type (00: SRAM, 01: PSRAM, 10: NOR)
+ * - Bits 5:4   : MWID     - Data width (00: 8 bits, 01: 16 bits)
+ * - Bit 12     : WREN     - Writes allowed
+ * - Bit 14     : EXTMOD   - Separate write timing in BWTR1
+ *
+ * Bit fields of BTR1 (all in HCLK cycles):
+ * - Bits 3:0   : ADDSET   - Address setup, NADV low (0-15)
+ * - Bits 7:4   : ADDHLD   - Address hold after NADV rises (1-15)
+ * - Bits 15:8  : DATAST   - Data phase, NOE/NWE low (1-255)
+ * - Bits 19:16 : BUSTURN  - Turnaround after the access (0-15)
+ *
+ * @note An asynchronous multiplexed access takes about ADDSET + ADDHLD + DATAST + 2
+ * HCLK cycles per 16-bit half, so a 32-bit CPU access costs two of them.
+ */
+typedef struct {
+  volatile uint32_t BCR1;
+  volatile uint32_t BTR1;
+} FSMC_Bank1_TypeDef;
+
+#define FSMC_BWTR1          (*((volatile uint32_t *)(FSMC + 0x104)))
+
+// Static buffers in external RAM; zeroed by fsmc_init(), unusable before it
+#define EXTRAM              __attribute__((section(".extram")))
+
+typedef struct {
+  bool psram;           // MTYP PSRAM (ADV on the chip) rather than latched SRAM
+  uint8_t addr_lines;   // High address lines in use, A16 upward (0-8)
+  uint32_t size;        // Bytes fitted, at most the EXTRAM region in the linker script
+  // Datasheet timings in ns, rounded up to HCLK cycles by fsmc_init()
+  uint16_t t_addr_ns;   // Address valid to ADV high (latch setup)
+  uint16_t t_hold_ns;   // Address hold after ADV high
+  uint16_t t_data_ns;   // OE/WE pulse, i.e. access time plus margin
+  uint16_t t_turn_ns;   // Bus release between accesses
+} fsmc_sram_t;
+
+bool fsmc_init(const fsmc_sram_t *cfg);
+
+// External RAM not taken by EXTRAM statics; valid after fsmc_init()
+heap_t *fsmc_heap(void);
+
+/**
+ * @brief Sequential and random word bandwidth of a buffer, in bytes/s.
+ *
+ * @details Run it on an internal and an EXTRAM buffer of the same size to
+ * compare. Random reads include the index generator, equally for both.
+ * bytes must be a power of two. Overwrites the buffer.
+ */
+typedef struct {
+  uint32_t seq_write;
+  uint32_t seq_read;
+  uint32_t rand_read;
+} fsmc_bench_t;
+
+void fsmc_bench(void *buf, uint32_t bytes, fsmc_bench_t *result);
@@ -5,9 +5,16 @@
 
 
 void enable_gpioa() {
-  RCC->APB2ENR |= (1 << 2);
+  rcc_clock_acquire(RCC_GPIOA);
 }
 
 void enable_gpiob() {
-  RCC->APB2ENR |= (1 << 3);
+  rcc_clock_acquire(RCC_GPIOB);
+}
+
+void gpio_config(uint32_t port, uint32_t pin, uint32_t mode) {
+  volatile uint32_t *cr = (volatile uint32_t *)(port + (pin < 8 ? 0x00 : 0x04));
+  uint32_t shift = (pin & 7) * 4;
+
+  *cr = (*cr & ~(0xFu << shift)) | (mode << shift);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <inttypes.h>
 #include "mem_mapping.h"
 
 
@@ -20,6 +21,22 @@
 #define GPIOC_IDR       (*((volatile uint32_t *)(PC + 0x08))) // Input data
 #define GPIOC_ODR       (*((volatile uint32_t *)(PC + 0x0C))) // Output data
 
+// Any port: PA..PE base address
+#define GPIO_IDR(port)  (*((volatile uint32_t *)((port) + 0x08))) // Input data
+#define GPIO_ODR(port)  (*((volatile uint32_t *)((port) + 0x0C))) // Output data
+#define GPIO_BSHR(port) (*((volatile uint32_t *)((port) + 0x10))) // Bit set (15:0) / reset (31:16)
+
+// 4-bit CNF:MODE values for gpio_config()
+#define GPIO_IN_ANALOG      0x0
+#define GPIO_IN_FLOATING    0x4
+#define GPIO_IN_PULL        0x8 // Pull direction from ODR
+#define GPIO_OUT_PP_2MHZ    0x2
+#define GPIO_OUT_PP_50MHZ   0x3
+#define GPIO_OUT_OD_50MHZ   0x7
+#define GPIO_AF_PP_50MHZ    0xB
+#define GPIO_AF_OD_50MHZ    0xF
+
 void enable_gpioa();
 void enable_gpiob();
+void gpio_config(uint32_t port, uint32_t pin, uint32_t mode);
 
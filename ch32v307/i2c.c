@@ -0,0 +1,456 @@
+#include "i2c.h"
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "gpio.h"
+#include "pfic.h"
+#include "rcc.h"
+#include "systime.h"
+
+#define CTLR1_PE            (1 << 0)
+#define CTLR1_START         (1 << 8)
+#define CTLR1_STOP          (1 << 9)
+#define CTLR1_ACK           (1 << 10)
+#define CTLR1_POS           (1 << 11)
+#define CTLR1_SWRST         (1 << 15)
+#define CTLR2_ITERREN       (1 << 8)
+#define CTLR2_ITEVTEN       (1 << 9)
+#define CTLR2_ITBUFEN       (1 << 10)
+#define CTLR2_DMAEN         (1 << 11)
+#define CTLR2_LAST          (1 << 12)
+#define STAR1_SB            (1 << 0)
+#define STAR1_ADDR          (1 << 1)
+#define STAR1_BTF           (1 << 2)
+#define STAR1_RXNE          (1 << 6)
+#define STAR1_TXE           (1 << 7)
+#define STAR1_BERR          (1 << 8)
+#define STAR1_ARLO          (1 << 9)
+#define STAR1_AF            (1 << 10)
+#define STAR1_OVR           (1 << 11)
+#define STAR1_ERRORS        (STAR1_BERR | STAR1_ARLO | STAR1_AF | STAR1_OVR)
+
+enum {
+  PHASE_ADDR,
+  PHASE_WRITE,
+  PHASE_WRITE_DMA,
+  PHASE_READ,
+  PHASE_READ_DMA,
+};
+
+static const struct {
+  uint32_t base;
+  uint8_t clock;
+  uint8_t ev_irq;
+  uint8_t er_irq;
+  uint8_t tx_dma;
+  uint8_t rx_dma;
+} buses[2] = {
+  {I2C1, RCC_I2C1, I2C1_EV_IRQn, I2C1_ER_IRQn, DMA1_CH(6), DMA1_CH(7)},
+  {I2C2, RCC_I2C2, I2C2_EV_IRQn, I2C2_ER_IRQn, DMA1_CH(4), DMA1_CH(5)},
+};
+
+static struct {
+  i2c_config_t cfg;
+  i2c_xfer_t *head;
+  i2c_xfer_t *tail;
+  uint16_t pos;
+  uint8_t phase;
+  bool reading;
+  bool clocked;
+  bool stalled;         // Bus error: waiting for i2c_recover()
+  swtimer_t kick;       // Starts the next transfer once STOP is out
+} state[2];
+
+#define I2Cx(i)             ((I2C_TypeDef *)buses[i].base)
+
+
+static void i2c_lock(uint32_t i) {
+  pfic_disable_irq(buses[i].ev_irq);
+  pfic_disable_irq(buses[i].er_irq);
+  pfic_disable_irq(dma_irq(buses[i].rx_dma));
+  // TEIF on the transmit channel ends the transfer too
+  pfic_disable_irq(dma_irq(buses[i].tx_dma));
+}
+
+static void i2c_unlock(uint32_t i) {
+  pfic_enable_irq(dma_irq(buses[i].tx_dma));
+  pfic_enable_irq(dma_irq(buses[i].rx_dma));
+  pfic_enable_irq(buses[i].er_irq);
+  pfic_enable_irq(buses[i].ev_irq);
+}
+
+static void i2c_setup(uint32_t i) {
+  I2C_TypeDef *b = I2Cx(i);
+  rcc_clocks_t clocks;
+  uint32_t mhz, ccr, hz = state[i].cfg.hz;
+
+  rcc_get_clocks(&clocks);
+  mhz = clocks.pclk1 / 1000000;
+  b->CTLR1 = CTLR1_SWRST;
+  b->CTLR1 = 0;
+  b->CTLR2 = mhz | CTLR2_ITERREN | CTLR2_ITEVTEN;
+  if (hz <= 100000) {
+    ccr = clocks.pclk1 / (2 * hz);
+    b->CKCFGR = ccr < 4 ? 4 : ccr;
+    b->RTR = mhz + 1;                  // 1000 ns
+  } else {
+    ccr = clocks.pclk1 / (3 * hz);     // Fast mode, Tlow/Thigh = 2
+    b->CKCFGR = (1 << 15) | (ccr < 1 ? 1 : ccr);
+    b->RTR = mhz * 300 / 1000 + 1;     // 300 ns
+  }
+  b->CTLR1 = CTLR1_PE;
+}
+
+static void half_period(uint32_t i) {
+  rcc_clocks_t clocks;
+  volatile uint32_t n;
+
+  rcc_get_clocks(&clocks);
+  for (n = clocks.hclk / (state[i].cfg.hz * 8); n; n--);
+}
+
+static void i2c_start(uint32_t i) {
+  state[i].phase = PHASE_ADDR;
+  state[i].reading = state[i].head->wr_len == 0;
+  I2Cx(i)->CTLR1 |= CTLR1_START | CTLR1_ACK;
+}
+
+static void i2c_kick(void *ctx);
+
+// START must not be set until the controller has sent the STOP, a bit time or so
+static void i2c_next(uint32_t i) {
+  if (I2Cx(i)->CTLR1 & CTLR1_STOP) {
+    systime_start(&state[i].kick, 2000000 / state[i].cfg.hz + 1, 0, i2c_kick, (void *)i);
+  } else {
+    i2c_start(i);
+  }
+}
+
+static void i2c_kick(void *ctx) {
+  uint32_t i = (uint32_t)ctx;
+
+  i2c_lock(i);
+  if (state[i].head && !state[i].stalled) {
+    i2c_next(i);
+  }
+  i2c_unlock(i);
+}
+
+/**
+ * @brief Frees a bus held by a slave that lost track of a transfer.
+ *
+ * @details Clocks SCL by hand until the slave releases SDA (at most nine
+ * pulses), sends a STOP and resets the controller, then restarts the queue.
+ * That takes a dozen bit times of busy waiting, so the driver never does it
+ * from its interrupts: after a transfer ends in I2C_BUS_ERROR the bus stays
+ * stopped, queued transfers and all, until thread code calls this.
+ */
+void i2c_recover(uint32_t bus) {
+  uint32_t i = bus - 1;
+  const i2c_config_t *cfg = &state[i].cfg;
+  uint32_t n;
+
+  I2Cx(i)->CTLR1 = 0;
+  GPIO_BSHR(cfg->scl_port) = 1u << cfg->scl_pin;
+  GPIO_BSHR(cfg->sda_port) = 1u << cfg->sda_pin;
+  gpio_config(cfg->scl_port, cfg->scl_pin, GPIO_OUT_OD_50MHZ);
+  gpio_config(cfg->sda_port, cfg->sda_pin, GPIO_OUT_OD_50MHZ);
+
+  for (n = 0; n < 9 && !(GPIO_IDR(cfg->sda_port) & (1u << cfg->sda_pin)); n++) {
+    GPIO_BSHR(cfg->scl_port) = 1u << (cfg->scl_pin + 16);
+    half_period(i);
+    GPIO_BSHR(cfg->scl_port) = 1u << cfg->scl_pin;
+    half_period(i);
+  }
+  // STOP: SDA rises while SCL is high
+  GPIO_BSHR(cfg->scl_port) = 1u << (cfg->scl_pin + 16);
+  GPIO_BSHR(cfg->sda_port) = 1u << (cfg->sda_pin + 16);
+  half_period(i);
+  GPIO_BSHR(cfg->scl_port) = 1u << cfg->scl_pin;
+  half_period(i);
+  GPIO_BSHR(cfg->sda_port) = 1u << cfg->sda_pin;
+  half_period(i);
+
+  gpio_config(cfg->scl_port, cfg->scl_pin, GPIO_AF_OD_50MHZ);
+  gpio_config(cfg->sda_port, cfg->sda_pin, GPIO_AF_OD_50MHZ);
+  i2c_setup(i);
+
+  i2c_lock(i);
+  state[i].stalled = false;
+  if (state[i].head) {
+    i2c_start(i);
+  }
+  i2c_unlock(i);
+}
+
+static void i2c_finish(uint32_t i, int8_t status) {
+  I2C_TypeDef *b = I2Cx(i);
+  i2c_xfer_t *x = state[i].head;
+
+  b->CTLR2 &= ~(CTLR2_ITBUFEN | CTLR2_DMAEN | CTLR2_LAST);
+  b->CTLR1 &= ~CTLR1_POS;
+  dma_channel(buses[i].tx_dma)->CFGR = 0;
+  dma_channel(buses[i].rx_dma)->CFGR = 0;
+  if (status == I2C_BUS_ERROR) {
+    b->CTLR1 = 0;
+    state[i].stalled = true;
+  }
+
+  state[i].head = x->next;
+  if (!state[i].head) {
+    state[i].tail = NULL;
+  } else if (!state[i].stalled) {
+    i2c_next(i);
+  }
+  x->status = status;
+  if (x->done) {
+    x->done(x);
+  }
+}
+
+static void i2c_write_done(uint32_t i) {
+  I2C_TypeDef *b = I2Cx(i);
+
+  b->CTLR2 &= ~(CTLR2_ITBUFEN | CTLR2_DMAEN);
+  if (state[i].head->rd_len) {
+    state[i].phase = PHASE_ADDR;
+    state[i].reading = true;
+    b->CTLR1 |= CTLR1_START | CTLR1_ACK;
+  } else {
+    b->CTLR1 |= CTLR1_STOP;
+    i2c_finish(i, I2C_OK);
+  }
+}
+
+static void i2c_dma(uint32_t ch, const void *mem, uint32_t len, uint32_t dir, uint32_t base) {
+  DMA_Channel_TypeDef *c = dma_channel(ch);
+
+  c->CFGR = 0;
+  c->PADDR = base + 0x10; // DATAR
+  c->MADDR = (uint32_t)mem;
+  c->CNTR = len;
+  c->CFGR = dir | DMA_CFGR_MINC | DMA_CFGR_PL(2) | DMA_CFGR_EN |
+            (dir ? 0 : DMA_CFGR_TCIE) | DMA_CFGR_TEIE;
+}
+
+// ADDR was acknowledged: set up the data phase, then clear ADDR to release SCL
+static void i2c_addr(uint32_t i) {
+  I2C_TypeDef *b = I2Cx(i);
+  i2c_xfer_t *x = state[i].head;
+  uint32_t n = x->rd_len;
+
+  state[i].pos = 0;
+  if (!state[i].reading) {
+    if (x->wr_len >= I2C_DMA_MIN) {
+      state[i].phase = PHASE_WRITE_DMA;
+      i2c_dma(buses[i].tx_dma, x->wr, x->wr_len, DMA_CFGR_DIR, buses[i].base);
+      b->CTLR2 |= CTLR2_DMAEN;
+    } else {
+      state[i].phase = PHASE_WRITE;
+      b->CTLR2 |= CTLR2_ITBUFEN;
+    }
+  } else {
+    state[i].phase = PHASE_READ;
+    if (n >= I2C_DMA_MIN) {
+      state[i].phase = PHASE_READ_DMA;
+      i2c_dma(buses[i].rx_dma, x->rd, n, 0, buses[i].base);
+      b->CTLR2 |= CTLR2_DMAEN | CTLR2_LAST;
+    } else if (n == 1) {
+      b->CTLR1 &= ~CTLR1_ACK;
+    } else if (n == 2) {
+      b->CTLR1 = (b->CTLR1 & ~CTLR1_ACK) | CTLR1_POS;
+    } else if (n > 3) {
+      b->CTLR2 |= CTLR2_ITBUFEN;
+    }
+  }
+  (void)b->STAR2;
+  if (state[i].reading && n == 1) {
+    b->CTLR1 |= CTLR1_STOP;
+    b->CTLR2 |= CTLR2_ITBUFEN;
+  }
+}
+
+/**
+ * @brief Event interrupt: one step of the master state machine.
+ *
+ * @details Reads of three or more bytes without DMA follow the reference
+ * sequence: RXNE-driven until three bytes are left, then BTF-driven so that the
+ * NACK and STOP land on the right bytes.
+ */
+static void i2c_ev(uint32_t i) {
+  I2C_TypeDef *b = I2Cx(i);
+  i2c_xfer_t *x = state[i].head;
+  uint32_t sr1 = b->STAR1;
+  uint32_t left;
+
+  if (!x) {
+    return;
+  }
+  if (sr1 & STAR1_SB) {
+    b->DATAR = (x->addr << 1) | state[i].reading;
+    return;
+  }
+  if (sr1 & STAR1_ADDR) {
+    i2c_addr(i);
+    return;
+  }
+
+  switch (state[i].phase) {
+  case PHASE_WRITE:
+    if (state[i].pos < x->wr_len && (sr1 & STAR1_TXE)) {
+      b->DATAR = x->wr[state[i].pos++];
+      if (state[i].pos == x->wr_len) {
+        b->CTLR2 &= ~CTLR2_ITBUFEN; // Wait for BTF
+      }
+    } else if (state[i].pos == x->wr_len && (sr1 & STAR1_BTF)) {
+      i2c_write_done(i);
+    }
+    break;
+  case PHASE_WRITE_DMA:
+    if ((sr1 & STAR1_BTF) && dma_remaining(buses[i].tx_dma) == 0) {
+      i2c_write_done(i);
+    }
+    break;
+  case PHASE_READ:
+    left = x->rd_len - state[i].pos;
+    if (x->rd_len == 1) {
+      if (sr1 & STAR1_RXNE) {
+        x->rd[0] = b->DATAR;
+        i2c_finish(i, I2C_OK);
+      }
+    } else if (left == 2) {
+      if (sr1 & STAR1_BTF) {
+        b->CTLR1 |= CTLR1_STOP;
+        x->rd[state[i].pos++] = b->DATAR;
+        x->rd[state[i].pos++] = b->DATAR;
+        i2c_finish(i, I2C_OK);
+      }
+    } else if (left == 3) {
+      if (sr1 & STAR1_BTF) {
+        b->CTLR1 &= ~CTLR1_ACK;
+        x->rd[state[i].pos++] = b->DATAR;
+      }
+    } else if (sr1 & STAR1_RXNE) {
+      x->rd[state[i].pos++] = b->DATAR;
+      if (x->rd_len - state[i].pos == 3) {
+        b->CTLR2 &= ~CTLR2_ITBUFEN;
+      }
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static void i2c_er(uint32_t i) {
+  I2C_TypeDef *b = I2Cx(i);
+  uint32_t sr1 = b->STAR1;
+  int8_t status;
+
+  b->STAR1 = ~(sr1 & STAR1_ERRORS) & 0xFFFF; // Write zero to clear
+  if (!state[i].head) {
+    return;
+  }
+  if (sr1 & STAR1_AF) {
+    b->CTLR1 |= CTLR1_STOP;
+    status = I2C_NACK;
+  } else if (sr1 & STAR1_ARLO) {
+    status = I2C_ARB_LOST;
+  } else {
+    status = I2C_BUS_ERROR;
+  }
+  i2c_finish(i, status);
+}
+
+static void i2c_rx_dma(void *ctx, uint32_t flags) {
+  uint32_t i = (uint32_t)ctx;
+
+  if (state[i].phase != PHASE_READ_DMA) {
+    return;
+  }
+  if (flags & DMA_FLAG_TEIF) {
+    i2c_finish(i, I2C_BUS_ERROR);
+  } else if (flags & DMA_FLAG_TCIF) {
+    I2Cx(i)->CTLR1 |= CTLR1_STOP;
+    i2c_finish(i, I2C_OK);
+  }
+}
+
+static void i2c_tx_dma(void *ctx, uint32_t flags) {
+  uint32_t i = (uint32_t)ctx;
+
+  // Completion is taken from BTF; only errors matter here
+  if ((flags & DMA_FLAG_TEIF) && state[i].phase == PHASE_WRITE_DMA) {
+    i2c_finish(i, I2C_BUS_ERROR);
+  }
+}
+
+bool i2c_init(uint32_t bus, const i2c_config_t *cfg) {
+  uint32_t i = bus - 1;
+
+  if (i >= 2 || cfg->hz == 0 || cfg->hz > 400000) {
+    return false;
+  }
+  if (!state[i].clocked) {
+    rcc_clock_acquire(buses[i].clock);
+    state[i].clocked = true;
+  }
+  state[i].cfg = *cfg;
+  state[i].head = NULL;
+  state[i].tail = NULL;
+  state[i].stalled = false;
+
+  if (!dma_attach(buses[i].tx_dma, i2c_tx_dma, (void *)i)) {
+    return false;
+  }
+  if (!dma_attach(buses[i].rx_dma, i2c_rx_dma, (void *)i)) {
+    dma_detach(buses[i].tx_dma, i2c_tx_dma, (void *)i);
+    return false;
+  }
+  // A slave may still be holding SDA from before the reset
+  if (!(GPIO_IDR(cfg->sda_port) & (1u << cfg->sda_pin))) {
+    i2c_recover(bus);
+  } else {
+    i2c_setup(i);
+  }
+  pfic_enable_irq(buses[i].ev_irq);
+  pfic_enable_irq(buses[i].er_irq);
+  return true;
+}
+
+bool i2c_submit(i2c_xfer_t *xfer) {
+  uint32_t i = xfer->bus - 1;
+
+  if (i >= 2 || (xfer->wr_len == 0 && xfer->rd_len == 0)) {
+    return false;
+  }
+  xfer->next = NULL;
+  xfer->status = I2C_PENDING;
+  i2c_lock(i);
+  if (state[i].tail) {
+    state[i].tail->next = xfer;
+    state[i].tail = xfer;
+  } else {
+    state[i].head = xfer;
+    state[i].tail = xfer;
+    if (!state[i].stalled) {
+      i2c_next(i);
+    }
+  }
+  i2c_unlock(i);
+  return true;
+}
+
+bool i2c_busy(uint32_t bus) {
+  return state[bus - 1].head != NULL;
+}
+
+bool i2c_stalled(uint32_t bus) {
+  return state[bus - 1].stalled;
+}
+
+IRQ_HANDLER_FPU(i2c1_ev_irq_handler) { i2c_ev(0); }
+IRQ_HANDLER_FPU(i2c1_er_irq_handler) { i2c_er(0); }
+IRQ_HANDLER_FPU(i2c2_ev_irq_handler) { i2c_ev(1); }
+IRQ_HANDLER_FPU(i2c2_er_irq_handler) { i2c_er(1); }
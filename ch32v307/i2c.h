@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief I2C register block (I2C1, I2C2)
+ *
+ * @details Both controllers sit on APB1 (clock enable RCC_APB1ENR bits 21 and 22).
+ * CTLR2.FREQ must hold PCLK1 in MHz; the SCL period is set by CKCFGR.CCR and the
+ * maximum rise time by RTR.
+ *
+ * Bit fields of CTLR1:
+ * - Bit 0  : PE     - Peripheral enable
+ * - Bit 8  : START  - Generate (repeated) start
+ * - Bit 9  : STOP   - Generate stop after the current byte
+ * - Bit 10 : ACK    - Acknowledge received bytes
+ * - Bit 11 : POS    - ACK applies to the next byte (two-byte reads)
+ * - Bit 15 : SWRST  - Software reset
+ *
+ * Bit fields of CTLR2:
+ * - Bits 5:0 : FREQ     - Peripheral clock in MHz
+ * - Bit 8    : ITERREN  - Error interrupt enable
+ * - Bit 9    : ITEVTEN  - Event interrupt enable
+ * - Bit 10   : ITBUFEN  - Buffer (TXE/RXNE) interrupt enable
+ * - Bit 11   : DMAEN    - DMA requests enable
+ * - Bit 12   : LAST     - Next DMA EOT is the last transfer (NACK it)
+ *
+ * Bit fields of STAR1:
+ * - Bit 0  : SB     - Start bit sent
+ * - Bit 1  : ADDR   - Address sent (cleared by reading STAR1 then STAR2)
+ * - Bit 2  : BTF    - Byte transfer finished
+ * - Bit 6  : RXNE   - Data register not empty
+ * - Bit 7  : TXE    - Data register empty
+ * - Bit 8  : BERR   - Bus error
+ * - Bit 9  : ARLO   - Arbitration lost
+ * - Bit 10 : AF     - Acknowledge failure
+ * - Bit 11 : OVR    - Overrun/underrun
+ *
+ * @note DMA channels: I2C1 TX/RX on DMA1 channels 6/7 (shared with UART2),
+ * I2C2 TX/RX on DMA1 channels 4/5 (shared with USART1 and SPI2). A transfer
+ * queued behind one that just ended starts from a SysTick timer once the STOP
+ * is out, so call systime_init() first.
+ */
+typedef struct {
+  volatile uint32_t CTLR1;
+  volatile uint32_t CTLR2;
+  volatile uint32_t OADDR1;
+  volatile uint32_t OADDR2;
+  volatile uint32_t DATAR;
+  volatile uint32_t STAR1;
+  volatile uint32_t STAR2;
+  volatile uint32_t CKCFGR;
+  volatile uint32_t RTR;
+} I2C_TypeDef;
+
+#ifndef I2C_DMA_MIN
+#define I2C_DMA_MIN         4  // Shorter data phases are handled by interrupts
+#endif
+
+// i2c_xfer_t.status
+#define I2C_PENDING         1
+#define I2C_OK              0
+#define I2C_NACK            -1
+#define I2C_ARB_LOST        -2
+#define I2C_BUS_ERROR       -3
+
+typedef struct {
+  uint32_t hz;          // Up to 400000
+  uint32_t scl_port;    // Pins, used for bus recovery
+  uint8_t scl_pin;
+  uint32_t sda_port;
+  uint8_t sda_pin;
+} i2c_config_t;
+
+// Writes wr (if any), then reads rd (if any) after a repeated start
+typedef struct i2c_xfer {
+  uint8_t bus;          // 1 or 2
+  uint8_t addr;         // 7-bit address
+  const uint8_t *wr;
+  uint16_t wr_len;
+  uint8_t *rd;
+  uint16_t rd_len;
+  volatile int8_t status;
+  void (*done)(struct i2c_xfer *xfer); // ISR context
+  void *ctx;
+  struct i2c_xfer *next;
+} i2c_xfer_t;
+
+// False if the DMA channels belong to another driver (UART2, USART1, SPI2)
+bool i2c_init(uint32_t bus, const i2c_config_t *cfg);
+bool i2c_submit(i2c_xfer_t *xfer);
+bool i2c_busy(uint32_t bus);
+
+// True after a transfer ended in I2C_BUS_ERROR; the queue waits for i2c_recover()
+bool i2c_stalled(uint32_t bus);
+// Thread context only: busy-waits through the bit-banged recovery
+void i2c_recover(uint32_t bus);
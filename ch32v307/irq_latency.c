@@ -0,0 +1,91 @@
+#include "irq_latency.h"
+
+#include "pfic.h"
+#include "rcc.h"
+#include "systime.h"
+
+#define TIM_CR1             (*((volatile uint32_t *)(TIM7_BASE + 0x00)))
+#define TIM_DIER            (*((volatile uint32_t *)(TIM7_BASE + 0x0C)))
+#define TIM_INTFR           (*((volatile uint32_t *)(TIM7_BASE + 0x10)))
+#define TIM_CNT             (*((volatile uint32_t *)(TIM7_BASE + 0x24)))
+#define TIM_PSC             (*((volatile uint32_t *)(TIM7_BASE + 0x28)))
+#define TIM_ARR             (*((volatile uint32_t *)(TIM7_BASE + 0x2C)))
+#define TIM_CR1_CEN         (1 << 0)
+#define TIM_DIER_UIE        (1 << 0)
+#define TIM_INTFR_UIF       (1 << 0)
+
+#define PERIOD              997     // Timer ticks; prime, so it drifts across the sections
+
+static struct {
+  volatile uint32_t count;
+  uint32_t max;
+  uint64_t sum;
+} lat;
+
+
+IRQ_HANDLER(tim7_irq_handler) {
+  uint32_t ticks = TIM_CNT;
+
+  TIM_INTFR = 0;
+  if (ticks > lat.max) {
+    lat.max = ticks;
+  }
+  lat.sum += ticks;
+  lat.count++;
+}
+
+static void spin(uint32_t cycles) {
+  uint64_t t = systime_ticks();
+
+  while (systime_ticks() - t < cycles) {
+  }
+}
+
+void irq_latency_bench(uint32_t section_cycles, uint32_t n, irq_latency_t *result) {
+  rcc_clocks_t clocks;
+  uint32_t timclk, mode, irq;
+
+  rcc_get_clocks(&clocks);
+  timclk = clocks.pclk1 == clocks.hclk ? clocks.pclk1 : 2 * clocks.pclk1;
+  rcc_clock_acquire(RCC_TIM(7));
+  TIM_CR1 = 0;
+  TIM_PSC = 0;
+  TIM_ARR = PERIOD - 1;
+  TIM_DIER = TIM_DIER_UIE;
+  pfic_set_priority(TIM7_IRQn, 0);
+
+  for (mode = 0; mode < IRQ_LATENCY_MODES; mode++) {
+    lat.count = 0;
+    lat.max = 0;
+    lat.sum = 0;
+    TIM_CNT = 0;
+    TIM_INTFR = 0;
+    pfic_clear_pending(TIM7_IRQn);
+    pfic_enable_irq(TIM7_IRQn);
+    TIM_CR1 = TIM_CR1_CEN;
+    while (lat.count < n) {
+      switch (mode) {
+      case IRQ_LATENCY_GLOBAL:
+        irq = irq_save();
+        spin(section_cycles);
+        irq_restore(irq);
+        break;
+      case IRQ_LATENCY_CEILING:
+        irq = irq_ceiling_save(IRQ_CEILING);
+        spin(section_cycles);
+        irq_ceiling_restore(irq);
+        break;
+      default:
+        spin(section_cycles);
+        break;
+      }
+    }
+    TIM_CR1 = 0;
+    pfic_disable_irq(TIM7_IRQn);
+    result->max_cycles[mode] = (uint64_t)lat.max * clocks.hclk / timclk;
+    result->avg_cycles[mode] = lat.sum * clocks.hclk / timclk / lat.count;
+  }
+
+  TIM_DIER = 0;
+  rcc_clock_release(RCC_TIM(7));
+}
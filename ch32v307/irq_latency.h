@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief Worst-case interrupt latency under critical sections, measured.
+ *
+ * @details TIM7 raises its update interrupt at priority 0 (a fast handler)
+ * every 997 timer ticks while the caller runs back-to-back critical sections
+ * of section_cycles each: none at all, masking with irq_save() and raising the
+ * threshold with irq_ceiling_save(IRQ_CEILING). The handler reads the
+ * timer's count, which is how long ago the update happened, and converts it to
+ * HCLK cycles. The handler's own entry is in every figure, so the baseline is
+ * the floor; with irq_save() the worst case grows by about section_cycles,
+ * with the ceiling it should stay at the floor.
+ *
+ * Borrows TIM7 (the DAC's output 2 trigger) and its interrupt.
+ */
+
+typedef enum {
+  IRQ_LATENCY_NONE,
+  IRQ_LATENCY_GLOBAL,           // irq_save()
+  IRQ_LATENCY_CEILING,          // irq_ceiling_save(IRQ_CEILING)
+  IRQ_LATENCY_MODES
+} irq_latency_mode_t;
+
+typedef struct {
+  uint32_t max_cycles[IRQ_LATENCY_MODES];
+  uint32_t avg_cycles[IRQ_LATENCY_MODES];
+} irq_latency_t;
+
+// n interrupts per mode; call with interrupts enabled. section_cycles must
+// stay well under one timer period (997 ticks) or masked updates get lost.
+void irq_latency_bench(uint32_t section_cycles, uint32_t n, irq_latency_t *result);
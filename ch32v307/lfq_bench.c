@@ -0,0 +1,121 @@
+#include "lfq_bench.h"
+
+#include "pfic.h"
+#include "systime.h"
+
+#define LEN                 16
+
+// What lfq.h replaces: a ring with interrupts masked around every access
+typedef struct {
+  uint32_t items[LEN];
+  uint32_t head;
+  uint32_t tail;
+} locked_t;
+
+static spsc_t spsc;
+static uint32_t spsc_buf[LEN];
+static mpsc_t mpsc;
+static uint32_t mpsc_buf[MPSC_BUF_SIZE(4, LEN) / 4];
+static locked_t locked;
+
+
+static bool locked_push(locked_t *q, uint32_t item) {
+  uint32_t irq = irq_save();
+  bool ok = q->head - q->tail < LEN;
+
+  if (ok) {
+    q->items[q->head++ % LEN] = item;
+  }
+  irq_restore(irq);
+  return ok;
+}
+
+static bool locked_pop(locked_t *q, uint32_t *item) {
+  uint32_t irq = irq_save();
+  bool ok = q->head != q->tail;
+
+  if (ok) {
+    *item = q->items[q->tail++ % LEN];
+  }
+  irq_restore(irq);
+  return ok;
+}
+
+static uint32_t cycles(void) {
+  return (uint32_t)systime_ticks();
+}
+
+// Cycles per operation over n bursts of LEN
+static uint32_t per_op(uint32_t total, uint32_t n) {
+  return total / (n * LEN);
+}
+
+void lfq_bench(uint32_t n, lfq_bench_t *result) {
+  uint32_t push = 0, pop = 0, t, i, j, v;
+
+  spsc_init(&spsc, spsc_buf, 4, LEN);
+  for (i = 0; i < n; i++) {
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      spsc_push(&spsc, &j);
+    }
+    push += cycles() - t;
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      spsc_pop(&spsc, &v);
+    }
+    pop += cycles() - t;
+  }
+  result->spsc_push = per_op(push, n);
+  result->spsc_pop = per_op(pop, n);
+
+  push = pop = 0;
+  mpsc_init(&mpsc, mpsc_buf, 4, LEN);
+  for (i = 0; i < n; i++) {
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      mpsc_push(&mpsc, &j);
+    }
+    push += cycles() - t;
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      mpsc_pop(&mpsc, &v);
+    }
+    pop += cycles() - t;
+  }
+  result->mpsc_push = per_op(push, n);
+  result->mpsc_pop = per_op(pop, n);
+
+  push = pop = 0;
+  locked = (locked_t){{0}, 0, 0};
+  for (i = 0; i < n; i++) {
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      locked_push(&locked, j);
+    }
+    push += cycles() - t;
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      locked_pop(&locked, &v);
+    }
+    pop += cycles() - t;
+  }
+  result->locked_push = per_op(push, n);
+  result->locked_pop = per_op(pop, n);
+
+  // The masked window alone: save to restore around the same ring update
+  push = 0;
+  for (i = 0; i < n; i++) {
+    uint32_t irq;
+
+    t = cycles();
+    for (j = 0; j < LEN; j++) {
+      irq = irq_save();
+      locked.items[locked.head++ % LEN] = j;
+      locked.tail++;
+      irq_restore(irq);
+    }
+    push += cycles() - t;
+  }
+  result->masked_cycles = per_op(push, n);
+}
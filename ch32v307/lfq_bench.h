@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "lfq.h"
+
+
+/**
+ * @brief Cycle costs of the lock-free queues (lib/lfq.h) against a ring that
+ * masks interrupts around each operation.
+ *
+ * @details Figures are HCLK cycles per operation on one-word items, averaged
+ * over bursts that fill and drain a 16-entry queue, with the SysTick read
+ * amortised over the burst. masked_cycles is how long the locked ring keeps
+ * interrupts off per operation, which the lock-free queues add nothing to.
+ */
+typedef struct {
+  uint32_t spsc_push;
+  uint32_t spsc_pop;
+  uint32_t mpsc_push;
+  uint32_t mpsc_pop;
+  uint32_t locked_push;
+  uint32_t locked_pop;
+  uint32_t masked_cycles;
+} lfq_bench_t;
+
+// n bursts; call with interrupts enabled and nothing else running
+void lfq_bench(uint32_t n, lfq_bench_t *result);
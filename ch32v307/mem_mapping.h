@@ -75,3 +75,5 @@
 #define CORE_PPHY     0xE0000000
 
 
+#define PFIC_BASE     0xE000E000
+#define SYSTICK_BASE  0xE000F000
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief PFIC - Programmable Fast Interrupt Controller
+ *
+ * @details The PFIC of the QingKe V4F core, located at 0xE000E000. Each of the
+ * external interrupt lines (16 and up) has an enable bit in IENR, a disable bit
+ * in IRER (both write-one), pending set/clear bits in IPSR/IPRR, an active flag in
+ * IACTR and an 8-bit priority in IPRIOR. Lower IPRIOR values mean higher
+ * priority; only the upper bits are implemented. ITHRESDR masks every interrupt
+ * whose priority value is greater than or equal to the threshold (0 disables the
+ * threshold).
+ *
+ * @note The vector table is installed in mtvec in absolute-address mode by the
+ * startup code (startup.c). Handlers are plain C functions declared with
+ * IRQ_HANDLER() and must use the names listed in startup.c.
+ */
+typedef struct {
+  volatile uint32_t ISR[8];
+  volatile uint32_t IPR[8];
+  volatile uint32_t ITHRESDR;
+  uint32_t RESERVED0;
+  volatile uint32_t CFGR;
+  volatile uint32_t GISR;
+  volatile uint8_t  VTFIDR[4];
+  uint8_t RESERVED1[12];
+  volatile uint32_t VTFADDR[4];
+  uint8_t RESERVED2[0x90];
+  volatile uint32_t IENR[8];
+  uint8_t RESERVED3[0x60];
+  volatile uint32_t IRER[8];
+  uint8_t RESERVED4[0x60];
+  volatile uint32_t IPSR[8];
+  uint8_t RESERVED5[0x60];
+  volatile uint32_t IPRR[8];
+  uint8_t RESERVED6[0x60];
+  volatile uint32_t IACTR[8];
+  uint8_t RESERVED7[0xE0];
+  volatile uint8_t  IPRIOR[256];
+  uint8_t RESERVED8[0x810];
+  volatile uint32_t SCTLR;
+} PFIC_TypeDef;
+
+#define PFIC                ((PFIC_TypeDef *)PFIC_BASE)
+
+// Interrupt numbers (vector table index)
+#define NMI_IRQn            2
+#define HARDFAULT_IRQn      3
+#define SYSTICK_IRQn        12
+#define SOFTWARE_IRQn       14
+#define WWDG_IRQn           16
+#define PVD_IRQn            17
+#define TAMPER_IRQn         18
+#define RTC_IRQn            19
+#define FLASH_IRQn          20
+#define RCC_IRQn            21
+#define EXTI0_IRQn          22
+#define EXTI1_IRQn          23
+#define EXTI2_IRQn          24
+#define EXTI3_IRQn          25
+#define EXTI4_IRQn          26
+#define DMA1_CH1_IRQn       27 // DMA1 channels 1..7 are 27..33
+#define ADC1_2_IRQn         34
+#define CAN1_TX_IRQn        35
+#define CAN1_RX0_IRQn       36
+#define CAN1_RX1_IRQn       37
+#define CAN1_SCE_IRQn       38
+#define EXTI9_5_IRQn        39
+#define TIM1_BRK_IRQn       40
+#define TIM1_UP_IRQn        41
+#define TIM1_TRG_COM_IRQn   42
+#define TIM1_CC_IRQn        43
+#define TIM2_IRQn           44
+#define TIM3_IRQn           45
+#define TIM4_IRQn           46
+#define I2C1_EV_IRQn        47
+#define I2C1_ER_IRQn        48
+#define I2C2_EV_IRQn        49
+#define I2C2_ER_IRQn        50
+#define SPI1_IRQn           51
+#define SPI2_IRQn           52
+#define USART1_IRQn         53
+#define USART2_IRQn         54
+#define USART3_IRQn         55
+#define EXTI15_10_IRQn      56
+#define RTCALARM_IRQn       57
+#define USBWAKEUP_IRQn      58
+#define TIM8_BRK_IRQn       59
+#define TIM8_UP_IRQn        60
+#define TIM8_TRG_COM_IRQn   61
+#define TIM8_CC_IRQn        62
+#define RNG_IRQn            63
+#define FSMC_IRQn           64
+#define SDIO_IRQn           65
+#define TIM5_IRQn           66
+#define SPI3_IRQn           67
+#define UART4_IRQn          68
+#define UART5_IRQn          69
+#define TIM6_IRQn           70
+#define TIM7_IRQn           71
+#define DMA2_CH1_IRQn       72 // DMA2 channels 1..5 are 72..76
+#define ETH_IRQn            77
+#define ETH_WKUP_IRQn       78
+#define CAN2_TX_IRQn        79
+#define CAN2_RX0_IRQn       80
+#define CAN2_RX1_IRQn       81
+#define CAN2_SCE_IRQn       82
+#define OTG_FS_IRQn         83
+#define USBHS_WKUP_IRQn     84
+#define USBHS_IRQn          85
+#define DVP_IRQn            86
+#define UART6_IRQn          87
+#define UART7_IRQn          88
+#define UART8_IRQn          89
+#define TIM9_BRK_IRQn       90
+#define TIM9_UP_IRQn        91
+#define TIM9_TRG_COM_IRQn   92
+#define TIM9_CC_IRQn        93
+#define TIM10_BRK_IRQn      94
+#define TIM10_UP_IRQn       95
+#define TIM10_TRG_COM_IRQn  96
+#define TIM10_CC_IRQn       97
+#define DMA2_CH6_IRQn       98 // DMA2 channels 6..11 are 98..103
+#define IRQ_COUNT           104
+
+#define MSTATUS_FS          0x6000 // FPU state: 0 off, 1 initial, 2 clean, 3 dirty
+#define MSTATUS_FS_INITIAL  0x2000
+
+/**
+ * @brief Interrupt handler definitions.
+ *
+ * @details Without an FPU, GCC's interrupt attribute saves exactly the registers
+ * a handler needs. With the FPU enabled (-mabi=ilp32f) it would also save all 20
+ * caller-saved FP registers in every handler that calls a function, which is
+ * every driver handler. There, handlers become a trampoline that saves only the
+ * integer caller-saved registers and calls the body as a normal function, so
+ * integer-only handlers pay nothing for the FPU.
+ *
+ * Handlers that do use floating point must be declared IRQ_HANDLER_FPU. Their
+ * trampoline saves ft0-ft11, fa0-fa7 and fcsr only when mstatus.FS says the
+ * interrupted context has live FP state (clean or dirty); code that never
+ * touched the FPU leaves FS at initial and the save is skipped. That includes
+ * every handler that calls back into application code (DMA, SysTick timers,
+ * USART, CAN, I2C, DVP and USB callbacks), since the callback may use float
+ * even when the driver does not; plain IRQ_HANDLER is only for handlers whose
+ * whole body is driver code. ch32v307/fpu_bench.h measures what each costs.
+ */
+#ifdef __riscv_flen
+
+#define IRQ_SAVE_INT(frame)                                                   \
+  "addi sp, sp, -" #frame "\n"                                               \
+  "sw ra, 0(sp)\n  sw t0, 4(sp)\n  sw t1, 8(sp)\n  sw t2, 12(sp)\n"       \
+  "sw a0, 16(sp)\n sw a1, 20(sp)\n sw a2, 24(sp)\n sw a3, 28(sp)\n"       \
+  "sw a4, 32(sp)\n sw a5, 36(sp)\n sw a6, 40(sp)\n sw a7, 44(sp)\n"       \
+  "sw t3, 48(sp)\n sw t4, 52(sp)\n sw t5, 56(sp)\n sw t6, 60(sp)\n"
+
+#define IRQ_RESTORE_INT(frame)                                                \
+  "lw ra, 0(sp)\n  lw t0, 4(sp)\n  lw t1, 8(sp)\n  lw t2, 12(sp)\n"       \
+  "lw a0, 16(sp)\n lw a1, 20(sp)\n lw a2, 24(sp)\n lw a3, 28(sp)\n"       \
+  "lw a4, 32(sp)\n lw a5, 36(sp)\n lw a6, 40(sp)\n lw a7, 44(sp)\n"       \
+  "lw t3, 48(sp)\n lw t4, 52(sp)\n lw t5, 56(sp)\n lw t6, 60(sp)\n"       \
+  "addi sp, sp, " #frame "\n"                                                \
+  "mret\n"
+
+#define IRQ_FP_REGS(op)                                                       \
+  #op " ft0, 80(sp)\n  " #op " ft1, 84(sp)\n  " #op " ft2, 88(sp)\n"        \
+  #op " ft3, 92(sp)\n  " #op " ft4, 96(sp)\n  " #op " ft5, 100(sp)\n"       \
+  #op " ft6, 104(sp)\n " #op " ft7, 108(sp)\n " #op " ft8, 112(sp)\n"       \
+  #op " ft9, 116(sp)\n " #op " ft10, 120(sp)\n " #op " ft11, 124(sp)\n"     \
+  #op " fa0, 128(sp)\n " #op " fa1, 132(sp)\n " #op " fa2, 136(sp)\n"       \
+  #op " fa3, 140(sp)\n " #op " fa4, 144(sp)\n " #op " fa5, 148(sp)\n"       \
+  #op " fa6, 152(sp)\n " #op " fa7, 156(sp)\n"
+
+#define IRQ_HANDLER(name)                                                     \
+  void name##_body(void);                                                     \
+  __attribute__((naked)) void name(void) {                                    \
+    __asm__ volatile(IRQ_SAVE_INT(64) "call " #name "_body\n" IRQ_RESTORE_INT(64)); \
+  }                                                                           \
+  void name##_body(void)
+
+#define IRQ_HANDLER_FPU(name)                                                 \
+  void name##_body(void);                                                     \
+  __attribute__((naked)) void name(void) {                                    \
+    __asm__ volatile(                                                         \
+      IRQ_SAVE_INT(176)                                                       \
+      "csrr t0, mstatus\n"                                                   \
+      "sw t0, 64(sp)\n"                                                      \
+      "li t1, 0x4000\n"            /* FS clean or dirty: state is live */    \
+      "and t1, t0, t1\n"                                                     \
+      "beqz t1, 1f\n"                                                        \
+      IRQ_FP_REGS(fsw)                                                        \
+      "frcsr t1\n"                                                           \
+      "sw t1, 160(sp)\n"                                                     \
+      "1:\n"                                                                 \
+      "li t1, 0x2000\n"            /* make sure the body may use the FPU */  \
+      "csrs mstatus, t1\n"                                                   \
+      "call " #name "_body\n"                                                \
+      "lw t0, 64(sp)\n"                                                      \
+      "li t1, 0x4000\n"                                                      \
+      "and t1, t0, t1\n"                                                     \
+      "beqz t1, 2f\n"                                                        \
+      IRQ_FP_REGS(flw)                                                        \
+      "lw t1, 160(sp)\n"                                                     \
+      "fscsr t1\n"                                                           \
+      "2:\n"                                                                 \
+      "csrw mstatus, t0\n"                                                   \
+      IRQ_RESTORE_INT(176));                                                  \
+  }                                                                           \
+  void name##_body(void)
+
+#else
+
+#define IRQ_HANDLER(name)     __attribute__((interrupt)) void name(void)
+#define IRQ_HANDLER_FPU(name) IRQ_HANDLER(name)
+
+#endif
+
+static inline void pfic_enable_irq(uint32_t irq) {
+  PFIC->IENR[irq >> 5] = 1u << (irq & 31);
+}
+
+static inline void pfic_disable_irq(uint32_t irq) {
+  PFIC->IRER[irq >> 5] = 1u << (irq & 31);
+}
+
+static inline void pfic_set_pending(uint32_t irq) {
+  PFIC->IPSR[irq >> 5] = 1u << (irq & 31);
+}
+
+static inline void pfic_clear_pending(uint32_t irq) {
+  PFIC->IPRR[irq >> 5] = 1u << (irq & 31);
+}
+
+static inline void pfic_set_priority(uint32_t irq, uint8_t priority) {
+  PFIC->IPRIOR[irq] = priority;
+}
+
+static inline void irq_global_enable() {
+  __asm__ volatile("csrs mstatus, %0" :: "r"(0x8));
+}
+
+static inline void irq_global_disable() {
+  __asm__ volatile("csrc mstatus, %0" :: "r"(0x8));
+}
+
+// Disables interrupts and returns the previous state for irq_restore(); nests
+static inline uint32_t irq_save() {
+  uint32_t mstatus;
+
+  __asm__ volatile("csrrci %0, mstatus, 0x8" : "=r"(mstatus) :: "memory");
+  return mstatus;
+}
+
+static inline void irq_restore(uint32_t mstatus) {
+  __asm__ volatile("csrs mstatus, %0" :: "r"(mstatus & 0x8) : "memory");
+}
+
+/**
+ * @brief Critical sections by priority: handlers more urgent than the ceiling
+ * keep running.
+ *
+ * @details irq_ceiling_save(c) raises ITHRESDR so that every interrupt with a
+ * priority value of c or more is held off, while those below c (Ethernet,
+ * fast timers) are still taken. Sections nest: an inner one never lowers a
+ * threshold an outer one set, and irq_ceiling_restore() puts back what was
+ * there. Use it for data shared with handlers at priority c or lower (a larger
+ * value); handlers above the ceiling must not touch that data. The hardware
+ * resets every IPRIOR to 0, above any ceiling, so the startup code sets them
+ * all to IRQ_CEILING: driver handlers are held off by these sections and may
+ * call the kernel. A handler that needs to stay fast is moved below
+ * IRQ_CEILING with pfic_set_priority() and then must keep away from both.
+ *
+ * The threshold is written over the bus, so a pending interrupt it releases
+ * may be taken a few instructions after irq_ceiling_restore() rather than
+ * right away. The read-back only makes sure that raising the threshold has
+ * taken effect before the section's first access.
+ */
+#define IRQ_CEILING         0x80    // Default split: 0x00-0x7F fast, 0x80-0xFF kernel and drivers
+
+static inline uint32_t irq_ceiling_save(uint8_t ceiling) {
+  uint32_t prev = PFIC->ITHRESDR;
+
+  if (!prev || ceiling < prev) {
+    PFIC->ITHRESDR = ceiling;
+    (void)PFIC->ITHRESDR;
+  }
+  __asm__ volatile("" ::: "memory");
+  return prev;
+}
+
+static inline void irq_ceiling_restore(uint32_t prev) {
+  __asm__ volatile("" ::: "memory");
+  PFIC->ITHRESDR = prev;
+}
@@ -0,0 +1,390 @@
+#include "power.h"
+
+#include "pfic.h"
+#include "rcc.h"
+#include "systime.h"
+
+#define PWRx                ((PWR_TypeDef *)PWR)
+#define RTCx                ((RTC_TypeDef *)RTC)
+#define BKPx                ((BKP_TypeDef *)BKP)
+
+#define PWR_CTLR_LPDS       (1 << 0)
+#define PWR_CTLR_PDDS       (1 << 1)
+#define PWR_CTLR_CWUF       (1 << 2)
+#define PWR_CTLR_CSBF       (1 << 3)
+#define PWR_CTLR_DBP        (1 << 8)
+#define PWR_CSR_SBF         (1 << 1)
+
+#define RTC_ALRIE           (1 << 1)
+#define RTC_ALRF            (1 << 1)
+#define RTC_RSF             (1 << 3)
+#define RTC_CNF             (1 << 4)
+#define RTC_RTOFF           (1 << 5)
+#define RTC_PSC             1       // RTCCLK / 2: 61 us per count on LSE
+
+#define RCC_HSEON           (1 << 16)
+#define RCC_HSERDY          (1 << 17)
+#define RCC_PLLON           (1 << 24)
+#define RCC_PLLRDY          (1 << 25)
+#define RCC_SW              0x3
+#define RCC_LSEON           (1 << 0)
+#define RCC_LSERDY          (1 << 1)
+#define RCC_RTCSEL          (3 << 8)
+#define RCC_RTCSEL_LSE      (1 << 8)
+#define RCC_RTCSEL_LSI      (2 << 8)
+#define RCC_RTCEN           (1 << 15)
+#define RCC_LSION           (1 << 0)
+#define RCC_LSIRDY          (1 << 1)
+
+#define EXTI_INTENR         (*((volatile uint32_t *)(EXTI + 0x00)))
+#define EXTI_RTENR          (*((volatile uint32_t *)(EXTI + 0x08)))
+#define EXTI_INTFR          (*((volatile uint32_t *)(EXTI + 0x14)))
+#define EXTI_RTC_ALARM      (1 << 17)
+
+#define SCTLR_SLEEPDEEP     (1 << 2)
+
+// Backup registers kept across standby: RTC counts at entry and of the alarm,
+// standby milliseconds and entries over all boots
+#define BKP_ENTRY           0
+#define BKP_ALARM           2
+#define BKP_STANDBY_MS      4
+#define BKP_STANDBY_N       6
+
+#define LSE_START_MS        2000
+#define LSI_CAL_COUNTS      32
+#define PM_STOP_WAKE_US     2000    // Until a stop has been measured
+
+static struct {
+  volatile uint8_t locks[PM_MODES];
+  uint32_t hclk;
+  uint32_t rtc_hz;
+  uint32_t rtc_frac;            // Remainder of RTC counts converted to ticks
+  bool lse;
+  uint32_t stop_wake_us;        // Stop ends this much before a deadline
+  uint64_t ticks[PM_MODES];
+  uint32_t entries[PM_MODES];
+  uint32_t wake_last_us[PM_MODES];
+  uint32_t wake_max_us[PM_MODES];
+} pm;
+
+
+static void rtc_sync(void) {
+  RTCx->CTLRL &= ~RTC_RSF;
+  while (!(RTCx->CTLRL & RTC_RSF)) {
+  }
+}
+
+static uint32_t rtc_count(void) {
+  uint16_t hi, lo;
+
+  do {
+    hi = RTCx->CNTH;
+    lo = RTCx->CNTL;
+  } while (hi != RTCx->CNTH);
+  return (uint32_t)hi << 16 | lo;
+}
+
+// Waits for the counter to tick, so intervals between edges are exact
+static uint32_t rtc_edge(void) {
+  uint32_t r = rtc_count(), n;
+
+  while ((n = rtc_count()) == r) {
+  }
+  return n;
+}
+
+static void rtc_config_begin(void) {
+  while (!(RTCx->CTLRL & RTC_RTOFF)) {
+  }
+  RTCx->CTLRL |= RTC_CNF;
+}
+
+static void rtc_config_end(void) {
+  RTCx->CTLRL &= ~RTC_CNF;
+  while (!(RTCx->CTLRL & RTC_RTOFF)) {
+  }
+}
+
+static void rtc_set_alarm(uint32_t alarm) {
+  rtc_config_begin();
+  RTCx->ALRMH = alarm >> 16;
+  RTCx->ALRML = alarm;
+  rtc_config_end();
+  RTCx->CTLRL &= ~RTC_ALRF;
+  EXTI_INTFR = EXTI_RTC_ALARM;
+}
+
+static uint32_t us_to_rtc(uint32_t us) {
+  return (uint64_t)us * pm.rtc_hz / 1000000;
+}
+
+// HCLK ticks in n RTC counts; the remainder carries over so nothing drifts
+static uint64_t rtc_to_ticks(uint32_t n) {
+  uint64_t x = (uint64_t)n * pm.hclk + pm.rtc_frac;
+
+  pm.rtc_frac = x % pm.rtc_hz;
+  return x / pm.rtc_hz;
+}
+
+static void bkp_write32(uint32_t i, uint32_t v) {
+  BKPx->DATAR[i] = v & 0xFFFF;
+  BKPx->DATAR[i + 1] = v >> 16;
+}
+
+static uint32_t bkp_read32(uint32_t i) {
+  return (BKPx->DATAR[i] & 0xFFFF) | (BKPx->DATAR[i + 1] & 0xFFFF) << 16;
+}
+
+static void wake_record(pm_mode_t mode, uint32_t us) {
+  pm.wake_last_us[mode] = us;
+  if (us > pm.wake_max_us[mode]) {
+    pm.wake_max_us[mode] = us;
+  }
+}
+
+/**
+ * @brief Brings back HSE, the PLL and the system clock switch as they were.
+ *
+ * @details Stop leaves the chip running on HSI with HSE and the PLL off; the
+ * prescalers and PLL settings in CFGR0 are kept, so only the oscillators and
+ * the switch need restoring.
+ */
+static void clocks_restore(uint32_t ctlr, uint32_t cfgr) {
+  if (ctlr & RCC_HSEON) {
+    RCC->CTLR |= RCC_HSEON;
+    while (!(RCC->CTLR & RCC_HSERDY)) {
+    }
+  }
+  if (ctlr & RCC_PLLON) {
+    RCC->CTLR |= RCC_PLLON;
+    while (!(RCC->CTLR & RCC_PLLRDY)) {
+    }
+  }
+  RCC->CFGR0 = (RCC->CFGR0 & ~RCC_SW) | (cfgr & RCC_SW);
+  while (((RCC->CFGR0 >> 2) & RCC_SW) != (cfgr & RCC_SW)) {
+  }
+}
+
+static void pm_sleep(bool timed, uint32_t in) {
+  uint64_t t0 = systime_ticks(), t1, due = t0 + (uint64_t)in * systime_ticks_per_us();
+
+  PFIC->SCTLR &= ~SCTLR_SLEEPDEEP;
+  __asm__ volatile("wfi");
+  t1 = systime_ticks();
+  pm.ticks[PM_SLEEP] += t1 - t0;
+  pm.entries[PM_SLEEP]++;
+  if (timed && t1 >= due) {
+    wake_record(PM_SLEEP, (t1 - due) / systime_ticks_per_us());
+  }
+}
+
+/**
+ * @brief Stops the clocks until shortly before the deadline.
+ *
+ * @details SysTick does not count in stop. Entry and exit are both taken on
+ * an RTC tick edge, so the time in between is a whole number of RTC counts and
+ * goes back into the time base exactly, less what SysTick did count (before
+ * the stop and while the clocks came back on HSI).
+ */
+static void pm_stop(bool timed, uint32_t in) {
+  uint32_t ctlr = RCC->CTLR, cfgr = RCC->CFGR0;
+  uint32_t r0, r1, s_wake, us;
+  uint64_t t0, t1, stopped;
+  rcc_clocks_t clocks;
+
+  r0 = rtc_edge();
+  t0 = systime_ticks();
+  rtc_set_alarm(timed ? r0 + us_to_rtc(in - pm.stop_wake_us) : r0 - 1);
+  PWRx->CTLR = (PWRx->CTLR & ~PWR_CTLR_PDDS) | PWR_CTLR_LPDS;
+  PFIC->SCTLR |= SCTLR_SLEEPDEEP;
+  __asm__ volatile("wfi");
+  PFIC->SCTLR &= ~SCTLR_SLEEPDEEP;
+
+  s_wake = systime_ticks();
+  rcc_get_clocks(&clocks);
+  clocks_restore(ctlr, cfgr);
+  us = ((uint32_t)systime_ticks() - s_wake) / (clocks.hclk / 1000000);
+  wake_record(PM_STOP, us);
+  // Regulator and HSI start-up come before the measured part
+  pm.stop_wake_us = pm.wake_max_us[PM_STOP] + 3 * 1000000 / pm.rtc_hz;
+
+  rtc_sync();
+  r1 = rtc_edge();
+  t1 = systime_ticks();
+  stopped = rtc_to_ticks(r1 - r0);
+  if (stopped > t1 - t0) {
+    systime_skip(stopped - (t1 - t0));
+  }
+  pm.ticks[PM_STOP] += stopped;
+  pm.entries[PM_STOP]++;
+}
+
+static void pm_standby(bool timed, uint32_t in) {
+  uint32_t r = rtc_count();
+  uint32_t alarm = timed ? r + us_to_rtc(in) : r - 1;
+
+  bkp_write32(BKP_ENTRY, r);
+  bkp_write32(BKP_ALARM, timed ? alarm : r);
+  rtc_set_alarm(alarm);
+  PWRx->CTLR |= PWR_CTLR_PDDS | PWR_CTLR_CWUF;
+  PFIC->SCTLR |= SCTLR_SLEEPDEEP;
+  __asm__ volatile("wfi");
+  // Only reached if an interrupt was already pending
+  PFIC->SCTLR &= ~SCTLR_SLEEPDEEP;
+  PWRx->CTLR &= ~PWR_CTLR_PDDS;
+}
+
+// Time spent in standby before this boot, from the backup registers
+static void standby_account(void) {
+  uint32_t r = rtc_count(), entry = bkp_read32(BKP_ENTRY), alarm = bkp_read32(BKP_ALARM);
+
+  PWRx->CTLR |= PWR_CTLR_CSBF | PWR_CTLR_CWUF;
+  bkp_write32(BKP_STANDBY_MS, bkp_read32(BKP_STANDBY_MS) +
+              (uint32_t)((uint64_t)(r - entry) * 1000 / pm.rtc_hz));
+  bkp_write32(BKP_STANDBY_N, bkp_read32(BKP_STANDBY_N) + 1);
+  if (alarm != entry) {
+    wake_record(PM_STANDBY, (uint64_t)(r - alarm) * 1000000 / pm.rtc_hz);
+  }
+}
+
+static bool rtc_start(void) {
+  uint64_t t;
+
+  if (RCC->BDCTLR & RCC_RTCEN) {
+    return (RCC->BDCTLR & RCC_RTCSEL) == RCC_RTCSEL_LSE;
+  }
+  RCC->BDCTLR |= RCC_LSEON;
+  t = systime_ticks() + (uint64_t)LSE_START_MS * 1000 * systime_ticks_per_us();
+  while (!(RCC->BDCTLR & RCC_LSERDY) && systime_ticks() < t) {
+  }
+  if (RCC->BDCTLR & RCC_LSERDY) {
+    RCC->BDCTLR |= RCC_RTCSEL_LSE | RCC_RTCEN;
+  } else {
+    RCC->BDCTLR &= ~RCC_LSEON;
+    RCC->RSTSCKR |= RCC_LSION;
+    while (!(RCC->RSTSCKR & RCC_LSIRDY)) {
+    }
+    RCC->BDCTLR |= RCC_RTCSEL_LSI | RCC_RTCEN;
+  }
+  rtc_sync();
+  rtc_config_begin();
+  RTCx->PSCRH = 0;
+  RTCx->PSCRL = RTC_PSC;
+  rtc_config_end();
+  return (RCC->BDCTLR & RCC_RTCSEL) == RCC_RTCSEL_LSE;
+}
+
+void pm_init(void) {
+  rcc_clocks_t clocks;
+  uint64_t t;
+  uint32_t i;
+
+  rcc_get_clocks(&clocks);
+  pm.hclk = clocks.hclk;
+  rcc_clock_acquire(RCC_PWR);
+  rcc_clock_acquire(RCC_BKP);
+  PWRx->CTLR |= PWR_CTLR_DBP;
+
+  pm.lse = rtc_start();
+  if (pm.lse) {
+    pm.rtc_hz = 32768 / (RTC_PSC + 1);
+  } else {
+    // A reset turns LSI off even when it clocks the RTC
+    RCC->RSTSCKR |= RCC_LSION;
+    while (!(RCC->RSTSCKR & RCC_LSIRDY)) {
+    }
+  }
+  rtc_sync();
+  if (!pm.lse) {
+    rtc_edge();
+    t = systime_ticks();
+    for (i = 0; i < LSI_CAL_COUNTS; i++) {
+      rtc_edge();
+    }
+    pm.rtc_hz = (uint64_t)LSI_CAL_COUNTS * pm.hclk / (systime_ticks() - t);
+  }
+  if (PWRx->CSR & PWR_CSR_SBF) {
+    standby_account();
+  }
+
+  RTCx->CTLRH = RTC_ALRIE;
+  EXTI_RTENR |= EXTI_RTC_ALARM;
+  EXTI_INTENR |= EXTI_RTC_ALARM;
+  pfic_enable_irq(RTCALARM_IRQn);
+
+  pm.stop_wake_us = PM_STOP_WAKE_US;
+  pm.locks[PM_STANDBY] = 1;
+}
+
+IRQ_HANDLER(rtcalarm_irq_handler) {
+  RTCx->CTLRL &= ~RTC_ALRF;
+  EXTI_INTFR = EXTI_RTC_ALARM;
+}
+
+void pm_lock(pm_mode_t mode) {
+  __atomic_fetch_add(&pm.locks[mode], 1, __ATOMIC_RELAXED);
+}
+
+void pm_unlock(pm_mode_t mode) {
+  __atomic_fetch_sub(&pm.locks[mode], 1, __ATOMIC_RELAXED);
+}
+
+pm_mode_t pm_idle(void) {
+  pm_mode_t mode = PM_SLEEP;
+  uint32_t in = 0;
+  bool timed;
+
+  irq_global_disable();
+  // A lock on a mode also rules out every deeper one
+  while (mode < PM_MODES && !pm.locks[mode]) {
+    mode++;
+  }
+  mode--;
+  timed = systime_next(&in);
+  if (timed && mode == PM_STANDBY && in < PM_STANDBY_MIN_US) {
+    mode = PM_STOP;
+  }
+  if (timed && mode == PM_STOP && in < PM_STOP_MIN_US + pm.stop_wake_us) {
+    mode = PM_SLEEP;
+  }
+  if (timed && in == 0) {
+    mode = PM_RUN;
+  }
+
+  switch (mode) {
+  case PM_SLEEP:
+    pm_sleep(timed, in);
+    break;
+  case PM_STOP:
+    pm_stop(timed, in);
+    break;
+  case PM_STANDBY:
+    pm_standby(timed, in);
+    break;
+  default:
+    break;
+  }
+  // Pending interrupts, the wake-up source among them, run here
+  irq_global_enable();
+  return mode;
+}
+
+void pm_stats(pm_stats_t *stats) {
+  uint32_t tpu = systime_ticks_per_us();
+  uint64_t busy;
+  uint32_t i;
+
+  irq_global_disable();
+  busy = systime_ticks() - pm.ticks[PM_SLEEP] - pm.ticks[PM_STOP];
+  for (i = 0; i < PM_MODES; i++) {
+    stats->us[i] = (i == PM_RUN ? busy : pm.ticks[i]) / tpu;
+    stats->entries[i] = pm.entries[i];
+    stats->wake_last_us[i] = pm.wake_last_us[i];
+    stats->wake_max_us[i] = pm.wake_max_us[i];
+  }
+  stats->us[PM_STANDBY] = (uint64_t)bkp_read32(BKP_STANDBY_MS) * 1000;
+  stats->entries[PM_STANDBY] = bkp_read32(BKP_STANDBY_N);
+  stats->rtc_hz = pm.rtc_hz;
+  stats->lse = pm.lse;
+  irq_global_enable();
+}
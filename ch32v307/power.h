@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief Power control registers
+ *
+ * @details On APB1 (clock enable RCC_APB1ENR bit 28).
+ *
+ * Bit fields of CTLR:
+ * - Bit 0     : LPDS     - Regulator in low-power mode during stop
+ * - Bit 1     : PDDS     - Deep sleep is standby instead of stop
+ * - Bit 2     : CWUF     - Clear WUF (write 1)
+ * - Bit 3     : CSBF     - Clear SBF (write 1)
+ * - Bit 8     : DBP      - Backup domain (RTC, BKP, RCC_BDCTLR) write access
+ *
+ * Bit fields of CSR:
+ * - Bit 0     : WUF      - A wake-up event occurred (WKUP pin or RTC alarm)
+ * - Bit 1     : SBF      - The chip was in standby
+ * - Bit 8     : EWUP     - PA0 is the WKUP pin
+ */
+typedef struct {
+  volatile uint32_t CTLR;
+  volatile uint32_t CSR;
+} PWR_TypeDef;
+
+/**
+ * @brief Real-time clock registers
+ *
+ * @details A 32-bit counter in the backup domain, clocked by RTCCLK (LSE or
+ * LSI, RCC_BDCTLR) divided by PSCR + 1. It keeps counting in stop and standby
+ * and across resets. Its alarm wakes the chip from stop through EXTI line 17
+ * and from standby directly. The 16-bit halves sit at word offsets.
+ *
+ * Bit fields of CTLRH:
+ * - Bit 0     : SECIE    - Counter tick interrupt enable
+ * - Bit 1     : ALRIE    - Alarm interrupt enable
+ * - Bit 2     : OWIE     - Overflow interrupt enable
+ *
+ * Bit fields of CTLRL (flags clear by writing 0):
+ * - Bit 0     : SECF     - Counter ticked
+ * - Bit 1     : ALRF     - Counter reached the alarm
+ * - Bit 2     : OWF      - Counter overflowed
+ * - Bit 3     : RSF      - Registers synchronized with the RTC domain
+ * - Bit 4     : CNF      - Configuration mode: PSCR, CNT and ALRM are writable
+ * - Bit 5     : RTOFF    - Last write finished (read-only)
+ *
+ * @note After a reset or a wake-up from stop, clear RSF and wait for it before
+ * reading; writes take effect once RTOFF is set again.
+ */
+typedef struct {
+  volatile uint16_t CTLRH;
+  uint16_t RESERVED0;
+  volatile uint16_t CTLRL;
+  uint16_t RESERVED1;
+  volatile uint16_t PSCRH;
+  uint16_t RESERVED2;
+  volatile uint16_t PSCRL;
+  uint16_t RESERVED3;
+  volatile uint16_t DIVH;
+  uint16_t RESERVED4;
+  volatile uint16_t DIVL;
+  uint16_t RESERVED5;
+  volatile uint16_t CNTH;
+  uint16_t RESERVED6;
+  volatile uint16_t CNTL;
+  uint16_t RESERVED7;
+  volatile uint16_t ALRMH;
+  uint16_t RESERVED8;
+  volatile uint16_t ALRML;
+} RTC_TypeDef;
+
+/**
+ * @brief Backup registers
+ *
+ * @details DATAR1..DATAR10 hold 16 bits each in the low half of a word and
+ * survive standby and resets as long as VDD or VBAT is present. Writable only
+ * with PWR_CTLR DBP set.
+ */
+typedef struct {
+  uint32_t RESERVED0;
+  volatile uint32_t DATAR[10];
+  volatile uint32_t OCTLR;
+  volatile uint32_t TPCTLR;
+  volatile uint32_t TPCSR;
+} BKP_TypeDef;
+
+typedef enum {
+  PM_RUN,
+  PM_SLEEP,                 // WFI; everything keeps running, any interrupt wakes
+  PM_STOP,                  // Clocks off, RAM and registers kept; RTC alarm or EXTI wakes
+  PM_STANDBY,               // Core off, RAM lost; wakes through reset
+  PM_MODES
+} pm_mode_t;
+
+// Shorter idle times are not worth stopping the clocks for
+#define PM_STOP_MIN_US      5000
+#define PM_STANDBY_MIN_US   1000000
+
+typedef struct {
+  uint64_t us[PM_MODES];        // Standby: total over all boots (backup registers)
+  uint32_t entries[PM_MODES];
+  // Sleep: deadline to resuming. Stop: wake-up to the clocks being back,
+  // after the regulator and HSI start-up. Standby: RTC alarm to pm_init().
+  uint32_t wake_last_us[PM_MODES];
+  uint32_t wake_max_us[PM_MODES];
+  uint32_t rtc_hz;              // Time base in stop and standby
+  bool lse;                     // RTC on the 32.768 kHz crystal, else LSI
+} pm_stats_t;
+
+/**
+ * @brief Starts the RTC and the wake-up paths; call after systime_init().
+ *
+ * @details The RTC runs on LSE if the crystal starts, otherwise on LSI, whose
+ * rate is measured against HCLK here. An RTC that is already running (after a
+ * reset or standby) is left alone. Standby comes up locked (see pm_lock()).
+ */
+void pm_init(void);
+
+/**
+ * @brief Keeps the chip out of mode and every deeper one until pm_unlock().
+ *
+ * @details Drivers hold PM_STOP while a transfer needs its clocks (DMA, a UART
+ * receiving, USB); locks are counted and may be taken in interrupts. Standby
+ * loses RAM, so pm_init() holds one PM_STANDBY lock that the application drops
+ * once it can resume from reset.
+ */
+void pm_lock(pm_mode_t mode);
+void pm_unlock(pm_mode_t mode);
+
+/**
+ * @brief Waits in the deepest mode the locks and the next timer deadline allow.
+ *
+ * @details Returns after the wake-up, once pending interrupts have run, with
+ * the clocks as they were before; the main loop calls it whenever it has
+ * nothing left to do. Stop ends early by the measured clock restore time and
+ * the rest is slept on SysTick, so timers fire on time. Standby does not
+ * return.
+ */
+pm_mode_t pm_idle(void);
+
+void pm_stats(pm_stats_t *stats);
@@ -0,0 +1,159 @@
+#include "rcc.h"
+
+#include <inttypes.h>
+
+#include "pfic.h"
+
+
+// PLLMUL (CFGR0 bits 21:18) on the V307, in half steps because of the x6.5 setting
+static const uint8_t pll_mul_x2[16] = {
+  36, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 13, 30, 32
+};
+
+static const uint16_t ahb_div[16] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 2, 4, 8, 16, 64, 128, 256, 512
+};
+
+static const uint8_t apb_div[8] = {
+  1, 1, 1, 1, 2, 4, 8, 16
+};
+
+void rcc_get_clocks(rcc_clocks_t *clocks) {
+  uint32_t cfgr = RCC->CFGR0;
+  uint32_t sysclk;
+
+  switch ((cfgr >> 2) & 0x3) { // SWS
+  case 0x1:
+    sysclk = HSE_VALUE;
+    break;
+  case 0x2: {
+    uint32_t src;
+    if (cfgr & (1 << 16)) { // PLLSRC = HSE / PREDIV1
+      src = HSE_VALUE / ((RCC->CFGR2 & 0xF) + 1);
+    } else if (EXTEN_CTR & EXTEN_PLL_HSI_PRE) {
+      src = HSI_VALUE;
+    } else {
+      src = HSI_VALUE / 2;
+    }
+    sysclk = src / 2 * pll_mul_x2[(cfgr >> 18) & 0xF];
+    break;
+  }
+  default:
+    sysclk = HSI_VALUE;
+    break;
+  }
+
+  clocks->sysclk = sysclk;
+  clocks->hclk = sysclk / ahb_div[(cfgr >> 4) & 0xF];
+  clocks->pclk1 = clocks->hclk / apb_div[(cfgr >> 8) & 0x7];
+  clocks->pclk2 = clocks->hclk / apb_div[(cfgr >> 11) & 0x7];
+}
+
+static uint8_t clock_refs[3 * 32];
+
+static const struct {
+  const char *name;
+  uint8_t clock;
+} clock_names[] = {
+  {"DMA1", RCC_DMA1}, {"DMA2", RCC_DMA2}, {"SRAM", RCC_SRAM}, {"FLITF", RCC_FLITF},
+  {"CRC", RCC_CRC}, {"FSMC", RCC_FSMC}, {"RNG", RCC_RNG}, {"SDIO", RCC_SDIO},
+  {"USBHS", RCC_USBHS}, {"OTG_FS", RCC_OTG_FS}, {"DVP", RCC_DVP}, {"ETH_MAC", RCC_ETH_MAC},
+  {"ETH_MAC_TX", RCC_ETH_MAC_TX}, {"ETH_MAC_RX", RCC_ETH_MAC_RX},
+  {"AFIO", RCC_AFIO}, {"GPIOA", RCC_GPIOA}, {"GPIOB", RCC_GPIOB}, {"GPIOC", RCC_GPIOC},
+  {"GPIOD", RCC_GPIOD}, {"GPIOE", RCC_GPIOE}, {"ADC1", RCC_ADC1}, {"ADC2", RCC_ADC2},
+  {"TIM1", RCC_TIM1}, {"SPI1", RCC_SPI1}, {"TIM8", RCC_TIM8}, {"USART1", RCC_USART1},
+  {"TIM9", RCC_TIM9}, {"TIM10", RCC_TIM10},
+  {"TIM2", RCC_TIM(2)}, {"TIM3", RCC_TIM(3)}, {"TIM4", RCC_TIM(4)}, {"TIM5", RCC_TIM(5)},
+  {"TIM6", RCC_TIM(6)}, {"TIM7", RCC_TIM(7)}, {"UART6", RCC_UART6}, {"UART7", RCC_UART7},
+  {"UART8", RCC_UART8}, {"WWDG", RCC_WWDG}, {"SPI2", RCC_SPI2}, {"SPI3", RCC_SPI3},
+  {"USART2", RCC_USART2}, {"USART3", RCC_USART3}, {"UART4", RCC_UART4}, {"UART5", RCC_UART5},
+  {"I2C1", RCC_I2C1}, {"I2C2", RCC_I2C2}, {"USBD", RCC_USBD}, {"CAN1", RCC_CAN1},
+  {"CAN2", RCC_CAN2}, {"BKP", RCC_BKP}, {"PWR", RCC_PWR}, {"DAC", RCC_DAC},
+};
+
+
+static volatile uint32_t *clock_enr(uint8_t clock) {
+  switch (RCC_BUS(clock)) {
+  case RCC_AHB:
+    return &RCC->AHBENR;
+  case RCC_APB2:
+    return &RCC->APB2ENR;
+  default:
+    return &RCC->APB1ENR;
+  }
+}
+
+void rcc_clock_acquire(uint8_t clock) {
+  uint32_t irq = irq_save();
+
+  if (clock_refs[clock]++ == 0) {
+    *clock_enr(clock) |= 1u << (clock & 31);
+  }
+  irq_restore(irq);
+}
+
+void rcc_clock_release(uint8_t clock) {
+  uint32_t irq = irq_save();
+
+  if (clock_refs[clock] && --clock_refs[clock] == 0) {
+    *clock_enr(clock) &= ~(1u << (clock & 31));
+  }
+  irq_restore(irq);
+}
+
+uint8_t rcc_clock_refs(uint8_t clock) {
+  return clock_refs[clock];
+}
+
+void rcc_clock_gate_unused(void) {
+  uint32_t irq = irq_save();
+  uint32_t bus, bit, keep;
+
+  for (bus = RCC_AHB; bus <= RCC_APB1; bus++) {
+    keep = bus == RCC_AHB ? (1u << (RCC_SRAM & 31)) | (1u << (RCC_FLITF & 31)) : 0;
+    for (bit = 0; bit < 32; bit++) {
+      if (clock_refs[RCC_CLOCK(bus, bit)]) {
+        keep |= 1u << bit;
+      }
+    }
+    *clock_enr(RCC_CLOCK(bus, 0)) &= keep;
+  }
+  irq_restore(irq);
+}
+
+void rcc_periph_reset(uint8_t clock) {
+  volatile uint32_t *rstr;
+
+  switch (RCC_BUS(clock)) {
+  case RCC_AHB:
+    rstr = &RCC->AHBRSTR;
+    break;
+  case RCC_APB2:
+    rstr = &RCC->APB2PRSTR;
+    break;
+  default:
+    rstr = &RCC->APB1PRSTR;
+    break;
+  }
+  *rstr |= 1u << (clock & 31);
+  *rstr &= ~(1u << (clock & 31));
+}
+
+uint32_t rcc_clock_list(rcc_clock_info_t *info, uint32_t max) {
+  uint32_t i, n = 0;
+  uint8_t clock;
+  bool on;
+
+  for (i = 0; i < sizeof(clock_names) / sizeof(clock_names[0]) && n < max; i++) {
+    clock = clock_names[i].clock;
+    on = (*clock_enr(clock) >> (clock & 31)) & 1;
+    if (on || clock_refs[clock]) {
+      info[n].name = clock_names[i].name;
+      info[n].clock = clock;
+      info[n].refs = clock_refs[clock];
+      info[n].on = on;
+      n++;
+    }
+  }
+  return n;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+#include <inttypes.h>
 #include "mem_mapping.h"
 
 
@@ -315,91 +317,28 @@
  * (RCC base + 0x18). Setting a bit to 1 enables the clock for the corresponding
  * peripheral, allowing it to operate, while setting it to 0 disables the clock to
  * save power. Peripherals include timers (TIM1, TIM8), USART1, ADCs (ADC1–ADC2),
- * SPI1, GPIOs (GPIOA–GPIOE), AFIO, and EMAC. The system clock must be configured
+ * SPI1, GPIOs (GPIOA–GPIOE) and AFIO. The system clock must be configured
  * via RCC_CR and RCC_CFGR, and the APB2 prescaler must be set in RCC_CFGR
  * (bits 13:11) to define the APB2 clock frequency.
  *
  * @note The CH32V307 supports high-speed APB2 peripherals for critical functions
- * like Ethernet (EMAC) and GPIO configuration. Ensure the APB2 clock frequency is
+ * like GPIO configuration; the Ethernet MAC is on AHB. Ensure the APB2 clock frequency is
  * appropriate for the peripheral's requirements. Disabling unused peripheral clocks
  * reduces power consumption. Consult the CH32V307 datasheet and reference manual
  * for clock configuration and peripheral initialization details.
  *
  * Bit fields:
- * - Bits 31:15 : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 14     : EMACEN
- *   - Description: Ethernet MAC clock enable
- *   - Values:
- *     - 0: EMAC clock disabled
- *     - 1: EMAC clock enabled
- * - Bit 13     : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 12     : ADC2EN
- *   - Description: ADC2 clock enable
- *   - Values:
- *     - 0: ADC2 clock disabled
- *     - 1: ADC2 clock enabled
- * - Bit 11     : ADC1EN
- *   - Description: ADC1 clock enable
- *   - Values:
- *     - 0: ADC1 clock disabled
- *     - 1: ADC1 clock enabled
- * - Bit 10     : USART1EN
- *   - Description: USART1 clock enable
- *   - Values:
- *     - 0: USART1 clock disabled
- *     - 1: USART1 clock enabled
- * - Bit 9      : TIM8EN
- *   - Description: TIM8 clock enable
- *   - Values:
- *     - 0: TIM8 clock disabled
- *     - 1: TIM8 clock enabled
- * - Bit 8      : SPI1EN
- *   - Description: SPI1 clock enable
- *   - Values:
- *     - 0: SPI1 clock disabled
- *     - 1: SPI1 clock enabled
- * - Bit 7      : TIM1EN
- *   - Description: TIM1 clock enable
- *   - Values:
- *     - 0: TIM1 clock disabled
- *     - 1: TIM1 clock enabled
- * - Bit 6      : GPIOEEN
- *   - Description: GPIOE clock enable
- *   - Values:
- *     - 0: GPIOE clock disabled
- *     - 1: GPIOE clock enabled
- * - Bit 5      : GPIODEN
- *   - Description: GPIOD clock enable
- *   - Values:
- *     - 0: GPIOD clock disabled
- *     - 1: GPIOD clock enabled
- * - Bit 4      : GPIOCEN
- *   - Description: GPIOC clock enable
- *   - Values:
- *     - 0: GPIOC clock disabled
- *     - 1: GPIOC clock enabled
- * - Bit 3      : GPIOBEN
- *   - Description: GPIOB clock enable
- *   - Values:
- *     - 0: GPIOB clock disabled
- *     - 1: GPIOB clock enabled
- * - Bit 2      : GPIOAEN
- *   - Description: GPIOA clock enable
- *   - Values:
- *     - 0: GPIOA clock disabled
- *     - 1: GPIOA clock enabled
- * - Bit 1      : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 0      : AFIOEN
- *   - Description: Alternate function I/O clock enable
- *   - Values:
- *     - 0: AFIO clock disabled
- *     - 1: AFIO clock enabled
+ * - Bit 0      : AFIOEN   - Alternate function I/O
+ * - Bits 6:2   : IOPxEN   - GPIOA..GPIOE
+ * - Bit 9      : ADC1EN
+ * - Bit 10     : ADC2EN
+ * - Bit 11     : TIM1EN
+ * - Bit 12     : SPI1EN
+ * - Bit 13     : TIM8EN
+ * - Bit 14     : USART1EN
+ * - Bit 19     : TIM9EN
+ * - Bit 20     : TIM10EN
+ * Other bits are reserved. APB2PRSTR has the reset bits at the same positions.
  */
 
  /**
@@ -414,7 +353,7 @@
  * while writing 0 disables it. Ensure stable system clocks (via RCC_CR, RCC_CFGR)
  * before accessing this register. This register is particularly relevant for
  * Ethernet applications (e.g., enabling DMA2 for ETH frame handling) and CRC
- * calculations, complementing RCC_APB2ENR (EMACEN) settings.
+ * calculations, together with the ETHMAC bits below.
  *
  * @note Bits not listed are reserved and should be kept at reset value (0).
  * Consult the CH32V307 reference manual (CH32FV2x_V3xRM.PDF) for detailed
@@ -422,30 +361,22 @@
  * monitorable via RCC_CIR (e.g., PLLRDYF, CSSF).
  *
  * Bit fields:
- * - Bit 0 : DMA1EN
- *   - Description: DMA1 clock enable
- *   - Values: 0 = Disabled, 1 = Enabled
- * - Bit 1 : DMA2EN
- *   - Description: DMA2 clock enable (used for Ethernet)
- *   - Values: 0 = Disabled, 1 = Enabled
- * - Bit 2 : SRAMEN
- *   - Description: SRAM clock enable
- *   - Values: 0 = Disabled, 1 = Enabled
- * - Bit 3 : Reserved
- *   - Description: Reserved, keep at 0
- *   - Values: 0
- * - Bit 4 : USBEN
- *   - Description: USB clock enable
- *   - Values: 0 = Disabled, 1 = Enabled
- * - Bit 5 : Reserved
- *   - Description: Reserved, keep at 0
- *   - Values: 0
- * - Bit 6 : CRCEN
- *   - Description: CRC clock enable
- *   - Values: 0 = Disabled, 1 = Enabled
- * - Bits 7-31 : Reserved
- *   - Description: Reserved, keep at 0
- *   - Values: 0
+ * - Bit 0      : DMA1EN
+ * - Bit 1      : DMA2EN
+ * - Bit 2      : SRAMEN   - SRAM clock during sleep (on at reset)
+ * - Bit 4      : FLITFEN  - Flash interface clock during sleep (on at reset)
+ * - Bit 6      : CRCEN
+ * - Bit 8      : FSMCEN
+ * - Bit 9      : RNGEN
+ * - Bit 10     : SDIOEN
+ * - Bit 11     : USBHSEN
+ * - Bit 12     : OTGFSEN
+ * - Bit 13     : DVPEN
+ * - Bit 14     : ETHMACEN
+ * - Bit 15     : ETHMACTXEN
+ * - Bit 16     : ETHMACRXEN
+ * Other bits are reserved. AHBRSTR resets OTG FS (12), DVP (13), ETH MAC (14)
+ * and USBHS (11) at the same positions.
  */
 #define RCC_AHBENR      (*((volatile uint32_t *)(RCC_BASE + 0x14)))
 
@@ -470,116 +401,24 @@
  * initialization details.
  *
  * Bit fields:
- * - Bits 31:30 : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 29     : PWREN
- *   - Description: Power interface clock enable
- *   - Values:
- *     - 0: Power interface clock disabled
- *     - 1: Power interface clock enabled
- * - Bit 28     : BKPEN
- *   - Description: Backup interface clock enable
- *   - Values:
- *     - 0: Backup interface clock disabled
- *     - 1: Backup interface clock enabled
- * - Bits 27:26 : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 25     : CANEN
- *   - Description: CAN clock enable
- *   - Values:
- *     - 0: CAN clock disabled
- *     - 1: CAN clock enabled
- * - Bit 24     : USBEN
- *   - Description: USB clock enable
- *   - Values:
- *     - 0: USB clock disabled
- *     - 1: USB clock enabled
- * - Bit 23     : I2C2EN
- *   - Description: I2C2 clock enable
- *   - Values:
- *     - 0: I2C2 clock disabled
- *     - 1: I2C2 clock enabled
- * - Bit 22     : I2C1EN
- *   - Description: I2C1 clock enable
- *   - Values:
- *     - 0: I2C1 clock disabled
- *     - 1: I2C1 clock enabled
- * - Bit 21     : UART5EN
- *   - Description: UART5 clock enable
- *   - Values:
- *     - 0: UART5 clock disabled
- *     - 1: UART5 clock enabled
- * - Bit 20     : UART4EN
- *   - Description: UART4 clock enable
- *   - Values:
- *     - 0: UART4 clock disabled
- *     - 1: UART4 clock enabled
- * - Bit 19     : UART3EN
- *   - Description: UART3 clock enable
- *   - Values:
- *     - 0: UART3 clock disabled
- *     - 1: UART3 clock enabled
- * - Bit 18     : UART2EN
- *   - Description: UART2 clock enable
- *   - Values:
- *     - 0: UART2 clock disabled
- *     - 1: UART2 clock enabled
- * - Bit 17     : SPI3EN
- *   - Description: SPI3 clock enable
- *   - Values:
- *     - 0: SPI3 clock disabled
- *     - 1: SPI3 clock enabled
- * - Bit 16     : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 15     : SPI2EN
- *   - Description: SPI2 clock enable
- *   - Values:
- *     - 0: SPI2 clock disabled
- *     - 1: SPI2 clock enabled
- * - Bits 14:11 : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 10     : DACEN
- *   - Description: DAC clock enable
- *   - Values:
- *     - 0: DAC clock disabled
- *     - 1: DAC clock enabled
- * - Bits 9:6   : Reserved
- *   - Description: Reserved, should be kept at 0
- *   - Values: N/A
- * - Bit 5      : TIM7EN
- *   - Description: TIM7 clock enable
- *   - Values:
- *     - 0: TIM7 clock disabled
- *     - 1: TIM7 clock enabled
- * - Bit 4      : TIM6EN
- *   - Description: TIM6 clock enable
- *   - Values:
- *     - 0: TIM6 clock disabled
- *     - 1: TIM6 clock enabled
- * - Bit 3      : TIM5EN
- *   - Description: TIM5 clock enable
- *   - Values:
- *     - 0: TIM5 clock disabled
- *     - 1: TIM5 clock enabled
- * - Bit 2      : TIM4EN
- *   - Description: TIM4 clock enable
- *   - Values:
- *     - 0: TIM4 clock disabled
- *     - 1: TIM4 clock enabled
- * - Bit 1      : TIM3EN
- *   - Description: TIM3 clock enable
- *   - Values:
- *     - 0: TIM3 clock disabled
- *     - 1: TIM3 clock enabled
- * - Bit 0      : TIM2EN
- *   - Description: TIM2 clock enable
- *   - Values:
- *     - 0: TIM2 clock disabled
- *     - 1: TIM2 clock enabled
+ * - Bits 5:0   : TIMxEN   - TIM2..TIM7
+ * - Bits 8:6   : UARTxEN  - UART6..UART8
+ * - Bit 11     : WWDGEN
+ * - Bit 14     : SPI2EN
+ * - Bit 15     : SPI3EN
+ * - Bit 17     : USART2EN
+ * - Bit 18     : USART3EN
+ * - Bit 19     : UART4EN
+ * - Bit 20     : UART5EN
+ * - Bit 21     : I2C1EN
+ * - Bit 22     : I2C2EN
+ * - Bit 23     : USBDEN   - USB full-speed device
+ * - Bit 25     : CAN1EN
+ * - Bit 26     : CAN2EN
+ * - Bit 27     : BKPEN    - Backup registers
+ * - Bit 28     : PWREN    - Power control
+ * - Bit 29     : DACEN
+ * Other bits are reserved. APB1PRSTR has the reset bits at the same positions.
  */
 #define RCC_APB1ENR     (*((volatile uint32_t *)(RCC_BASE + 0x1C)))
 
@@ -600,3 +439,114 @@ typedef struct {
 
 #define RCC                 ((RCC_TypeDef *)RCC_BASE)
 
+
+#define HSI_VALUE           8000000
+#ifndef HSE_VALUE
+#define HSE_VALUE           8000000
+#endif
+
+#define EXTEN_CTR           (*((volatile uint32_t *)(EXTEN_BASE + 0x00)))
+#define EXTEN_PLL_HSI_PRE   (1 << 4) // PLL fed by HSI instead of HSI/2
+
+/**
+ * @brief Bus clock frequencies in Hz, decoded from RCC_CFGR0/RCC_CFGR2.
+ *
+ * @details Drivers must derive baud rates and prescalers from these values rather
+ * than assuming 72 MHz, since the system clock is whatever the boot code left in
+ * RCC_CFGR0. PLL2/PLL3 as PREDIV1 source is not decoded (HSE is assumed).
+ */
+typedef struct {
+  uint32_t sysclk;
+  uint32_t hclk;
+  uint32_t pclk1; // APB1: TIM2-7, UART2-8, SPI2/3, I2C, CAN, DAC
+  uint32_t pclk2; // APB2: TIM1/8/9/10, USART1, SPI1, ADC
+} rcc_clocks_t;
+
+void rcc_get_clocks(rcc_clocks_t *clocks);
+
+/**
+ * @brief Peripheral clock gates: bus << 5 | bit in that bus's enable register.
+ *
+ * @details Drivers take a clock with rcc_clock_acquire() when they start using a
+ * block and give it back with rcc_clock_release() when they stop; the enable bit
+ * follows the reference count, so a block no driver holds has its clock off.
+ * Counts are kept under irq_save(), so interrupts may acquire and release too.
+ */
+#define RCC_AHB             0
+#define RCC_APB2            1
+#define RCC_APB1            2
+#define RCC_CLOCK(bus, bit) ((bus) << 5 | (bit))
+#define RCC_BUS(clock)      ((clock) >> 5)
+
+#define RCC_DMA1            RCC_CLOCK(RCC_AHB, 0)
+#define RCC_DMA2            RCC_CLOCK(RCC_AHB, 1)
+#define RCC_SRAM            RCC_CLOCK(RCC_AHB, 2)
+#define RCC_FLITF           RCC_CLOCK(RCC_AHB, 4)
+#define RCC_CRC             RCC_CLOCK(RCC_AHB, 6)
+#define RCC_FSMC            RCC_CLOCK(RCC_AHB, 8)
+#define RCC_RNG             RCC_CLOCK(RCC_AHB, 9)
+#define RCC_SDIO            RCC_CLOCK(RCC_AHB, 10)
+#define RCC_USBHS           RCC_CLOCK(RCC_AHB, 11)
+#define RCC_OTG_FS          RCC_CLOCK(RCC_AHB, 12)
+#define RCC_DVP             RCC_CLOCK(RCC_AHB, 13)
+#define RCC_ETH_MAC         RCC_CLOCK(RCC_AHB, 14)
+#define RCC_ETH_MAC_TX      RCC_CLOCK(RCC_AHB, 15)
+#define RCC_ETH_MAC_RX      RCC_CLOCK(RCC_AHB, 16)
+
+#define RCC_AFIO            RCC_CLOCK(RCC_APB2, 0)
+#define RCC_GPIOA           RCC_CLOCK(RCC_APB2, 2)
+#define RCC_GPIOB           RCC_CLOCK(RCC_APB2, 3)
+#define RCC_GPIOC           RCC_CLOCK(RCC_APB2, 4)
+#define RCC_GPIOD           RCC_CLOCK(RCC_APB2, 5)
+#define RCC_GPIOE           RCC_CLOCK(RCC_APB2, 6)
+#define RCC_ADC1            RCC_CLOCK(RCC_APB2, 9)
+#define RCC_ADC2            RCC_CLOCK(RCC_APB2, 10)
+#define RCC_TIM1            RCC_CLOCK(RCC_APB2, 11)
+#define RCC_SPI1            RCC_CLOCK(RCC_APB2, 12)
+#define RCC_TIM8            RCC_CLOCK(RCC_APB2, 13)
+#define RCC_USART1          RCC_CLOCK(RCC_APB2, 14)
+#define RCC_TIM9            RCC_CLOCK(RCC_APB2, 19)
+#define RCC_TIM10           RCC_CLOCK(RCC_APB2, 20)
+
+#define RCC_TIM2            RCC_CLOCK(RCC_APB1, 0) // TIM2..TIM7 are 0..5
+#define RCC_UART6           RCC_CLOCK(RCC_APB1, 6)
+#define RCC_UART7           RCC_CLOCK(RCC_APB1, 7)
+#define RCC_UART8           RCC_CLOCK(RCC_APB1, 8)
+#define RCC_WWDG            RCC_CLOCK(RCC_APB1, 11)
+#define RCC_SPI2            RCC_CLOCK(RCC_APB1, 14)
+#define RCC_SPI3            RCC_CLOCK(RCC_APB1, 15)
+#define RCC_USART2          RCC_CLOCK(RCC_APB1, 17)
+#define RCC_USART3          RCC_CLOCK(RCC_APB1, 18)
+#define RCC_UART4           RCC_CLOCK(RCC_APB1, 19)
+#define RCC_UART5           RCC_CLOCK(RCC_APB1, 20)
+#define RCC_I2C1            RCC_CLOCK(RCC_APB1, 21)
+#define RCC_I2C2            RCC_CLOCK(RCC_APB1, 22)
+#define RCC_USBD            RCC_CLOCK(RCC_APB1, 23)
+#define RCC_CAN1            RCC_CLOCK(RCC_APB1, 25)
+#define RCC_CAN2            RCC_CLOCK(RCC_APB1, 26)
+#define RCC_BKP             RCC_CLOCK(RCC_APB1, 27)
+#define RCC_PWR             RCC_CLOCK(RCC_APB1, 28)
+#define RCC_DAC             RCC_CLOCK(RCC_APB1, 29)
+
+#define RCC_GPIO(port)      (RCC_GPIOA + ((port) - PA) / 0x400)
+#define RCC_TIM(n)          ((n) == 1 ? RCC_TIM1 : (n) == 8 ? RCC_TIM8 : (n) >= 9 ? RCC_TIM9 + (n) - 9 : RCC_TIM2 + (n) - 2)
+
+typedef struct {
+  const char *name;
+  uint8_t clock;
+  uint8_t refs;
+  bool on;                  // Enable bit; on with no references was left by someone else
+} rcc_clock_info_t;
+
+void rcc_clock_acquire(uint8_t clock);
+void rcc_clock_release(uint8_t clock);
+uint8_t rcc_clock_refs(uint8_t clock);
+
+// Turns off every clock nobody holds; SRAM and flash keep theirs
+void rcc_clock_gate_unused(void);
+
+// Pulses the block's reset line (AHB: USBHS, OTG FS, DVP and ETH MAC only)
+void rcc_periph_reset(uint8_t clock);
+
+// Fills up to max entries for the clocks that are on or held; returns how many
+uint32_t rcc_clock_list(rcc_clock_info_t *info, uint32_t max);
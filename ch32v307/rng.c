@@ -0,0 +1,132 @@
+#include "rng.h"
+
+#include "pfic.h"
+#include "prng.h"
+#include "rcc.h"
+#include "rng_health.h"
+
+#define RNGx                ((RNG_TypeDef *)TRNG)
+
+#define RNG_CR_RNGEN        (1 << 2)
+#define RNG_CR_IE           (1 << 3)
+#define RNG_SR_DRDY         (1 << 0)
+#define RNG_SR_CEIS         (1 << 5)
+#define RNG_SR_SEIS         (1 << 6)
+
+#define ESIG_UNIID          ((const volatile uint32_t *)0x1FFFF7E8) // 96-bit unique ID
+
+static struct {
+  uint32_t pool[RNG_POOL_WORDS];
+  volatile uint32_t head;       // Words added by the interrupt
+  volatile uint32_t tail;       // Words taken by the generator
+  rng_health_t health;
+  volatile uint32_t hw_errors;
+  prng_t prng;
+  uint32_t outputs;             // Since the last reseed
+  bool seeded;
+  bool clocked;
+} rng;
+
+
+/**
+ * @brief Moves one TRNG word into the pool.
+ *
+ * @details A word that fails a health test is dropped together with everything
+ * still in the pool. The generator is stopped while the pool is full and
+ * restarted by random_u32() when it takes words out.
+ */
+IRQ_HANDLER(rng_irq_handler) {
+  uint32_t sr = RNGx->SR;
+  uint32_t w;
+
+  if (sr & (RNG_SR_CEIS | RNG_SR_SEIS)) {
+    // Restarting the generator clears the seed error condition
+    RNGx->SR = 0;
+    RNGx->CR = RNG_CR_IE;
+    RNGx->CR = RNG_CR_IE | RNG_CR_RNGEN;
+    rng.hw_errors++;
+    rng.head = rng.tail;
+    return;
+  }
+  if (!(sr & RNG_SR_DRDY)) {
+    return;
+  }
+  w = RNGx->DR;
+  if (!rng_health_feed(&rng.health, w)) {
+    rng.head = rng.tail;
+    return;
+  }
+  rng.pool[rng.head & (RNG_POOL_WORDS - 1)] = w;
+  rng.head++;
+  if (rng.head - rng.tail == RNG_POOL_WORDS) {
+    RNGx->CR = RNG_CR_IE;
+  }
+}
+
+void rng_init(void) {
+  uint32_t id[4] = {ESIG_UNIID[0], ESIG_UNIID[1], ESIG_UNIID[2], 0};
+
+  // Until the first reseed the generator at least differs between devices
+  prng_seed(&rng.prng, id);
+  if (!rng.clocked) {
+    rcc_clock_acquire(RCC_RNG);
+    rng.clocked = true;
+  }
+  rng_health_init(&rng.health);
+  rng.head = 0;
+  rng.tail = 0;
+  rng.outputs = 0;
+  rng.seeded = false;
+  pfic_enable_irq(RNG_IRQn);
+  RNGx->CR = RNG_CR_IE | RNG_CR_RNGEN;
+}
+
+bool rng_seeded(void) {
+  return rng.seeded;
+}
+
+// Takes RNG_RESEED_WORDS from the pool if it has them
+static void rng_reseed(void) {
+  uint32_t w[RNG_RESEED_WORDS];
+  uint32_t i;
+
+  pfic_disable_irq(RNG_IRQn);
+  if (rng.head - rng.tail < RNG_RESEED_WORDS) {
+    pfic_enable_irq(RNG_IRQn);
+    return;
+  }
+  for (i = 0; i < RNG_RESEED_WORDS; i++) {
+    w[i] = rng.pool[rng.tail++ & (RNG_POOL_WORDS - 1)];
+  }
+  RNGx->CR = RNG_CR_IE | RNG_CR_RNGEN;
+  pfic_enable_irq(RNG_IRQn);
+
+  prng_mix(&rng.prng, w, RNG_RESEED_WORDS);
+  rng.outputs = 0;
+  rng.seeded = true;
+}
+
+static inline void rng_count(void) {
+  if (!rng.seeded || rng.outputs >= RNG_RESEED) {
+    rng_reseed();
+  }
+  rng.outputs++;
+}
+
+uint32_t random_u32(void) {
+  rng_count();
+  return prng_next(&rng.prng);
+}
+
+uint32_t random_below(uint32_t bound) {
+  rng_count();
+  return prng_below(&rng.prng, bound);
+}
+
+uint32_t rng_health_failures(void) {
+  return rng.health.rct_failures + rng.health.apt_failures;
+}
+
+uint32_t rng_hw_errors(void) {
+  return rng.hw_errors;
+}
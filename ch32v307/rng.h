@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief True random number generator register block
+ *
+ * @details The TRNG sits on AHB (clock enable RCC_AHBENR bit 9) and produces a
+ * 32-bit word from an analog noise source every few dozen AHB cycles.
+ *
+ * Bit fields of CR:
+ * - Bit 2 : RNGEN  - Generator enable
+ * - Bit 3 : IE     - Interrupt on DRDY, CEIS and SEIS
+ *
+ * Bit fields of SR:
+ * - Bit 0 : DRDY   - DR holds a new word (cleared by reading DR)
+ * - Bit 1 : CECS   - Clock error (AHB clock too slow)
+ * - Bit 2 : SECS   - Seed error (noise source stuck)
+ * - Bit 5 : CEIS   - Clock error interrupt status, write 0 to clear
+ * - Bit 6 : SEIS   - Seed error interrupt status, write 0 to clear
+ *
+ * @note random_u32() never waits for the hardware: the TRNG interrupt fills an
+ * entropy pool through the health tests of lib/rng_health.h, and the pool is
+ * folded into an xoshiro128** generator every RNG_RESEED outputs. The generator
+ * keeps one state, so call it from one interrupt level only.
+ */
+typedef struct {
+  volatile uint32_t CR;
+  volatile uint32_t SR;
+  volatile uint32_t DR;
+} RNG_TypeDef;
+
+#define RNG_POOL_WORDS      16  // Power of two
+#define RNG_RESEED          1024 // Outputs between reseeds
+#define RNG_RESEED_WORDS    4
+
+void rng_init(void);
+// True once the generator has been seeded from the TRNG at least once
+bool rng_seeded(void);
+
+uint32_t random_u32(void);
+uint32_t random_below(uint32_t bound);
+
+// Statistics: rejected words, hardware seed/clock errors
+uint32_t rng_health_failures(void);
+uint32_t rng_hw_errors(void);
@@ -0,0 +1,265 @@
+#include "rtos_port.h"
+
+#include <stddef.h>
+#include "pfic.h"
+#include "power.h"
+#include "systime.h"
+
+#define MSTATUS_MPP_M       0x1800
+#define MSTATUS_MPIE        0x0080
+#define SWITCH_PRIORITY     0xFF    // Below every handler
+
+#define BENCH_WORDS         256
+
+static swtimer_t alarm;
+
+
+/*
+ * Context frame, in words: ra, t0-t2, a0-a7, t3-t6 as in pfic.h's trampoline,
+ * then s0-s11, mepc and mstatus; with the FPU f0-f31 from word 32 and fcsr at
+ * word 64.
+ */
+#define SWITCH_INT_REGS(op)                                                   \
+  #op " ra, 0(sp)\n  " #op " t0, 4(sp)\n   " #op " t1, 8(sp)\n   " #op " t2, 12(sp)\n" \
+  #op " a0, 16(sp)\n " #op " a1, 20(sp)\n  " #op " a2, 24(sp)\n  " #op " a3, 28(sp)\n" \
+  #op " a4, 32(sp)\n " #op " a5, 36(sp)\n  " #op " a6, 40(sp)\n  " #op " a7, 44(sp)\n" \
+  #op " t3, 48(sp)\n " #op " t4, 52(sp)\n  " #op " t5, 56(sp)\n  " #op " t6, 60(sp)\n" \
+  #op " s0, 64(sp)\n " #op " s1, 68(sp)\n  " #op " s2, 72(sp)\n  " #op " s3, 76(sp)\n" \
+  #op " s4, 80(sp)\n " #op " s5, 84(sp)\n  " #op " s6, 88(sp)\n  " #op " s7, 92(sp)\n" \
+  #op " s8, 96(sp)\n " #op " s9, 100(sp)\n " #op " s10, 104(sp)\n " #op " s11, 108(sp)\n"
+
+#ifdef __riscv_flen
+
+#define SWITCH_FP_REGS(op)                                                    \
+  #op " f0, 128(sp)\n  " #op " f1, 132(sp)\n  " #op " f2, 136(sp)\n  " #op " f3, 140(sp)\n" \
+  #op " f4, 144(sp)\n  " #op " f5, 148(sp)\n  " #op " f6, 152(sp)\n  " #op " f7, 156(sp)\n" \
+  #op " f8, 160(sp)\n  " #op " f9, 164(sp)\n  " #op " f10, 168(sp)\n " #op " f11, 172(sp)\n" \
+  #op " f12, 176(sp)\n " #op " f13, 180(sp)\n " #op " f14, 184(sp)\n " #op " f15, 188(sp)\n" \
+  #op " f16, 192(sp)\n " #op " f17, 196(sp)\n " #op " f18, 200(sp)\n " #op " f19, 204(sp)\n" \
+  #op " f20, 208(sp)\n " #op " f21, 212(sp)\n " #op " f22, 216(sp)\n " #op " f23, 220(sp)\n" \
+  #op " f24, 224(sp)\n " #op " f25, 228(sp)\n " #op " f26, 232(sp)\n " #op " f27, 236(sp)\n" \
+  #op " f28, 240(sp)\n " #op " f29, 244(sp)\n " #op " f30, 248(sp)\n " #op " f31, 252(sp)\n"
+
+// t0 holds mstatus; FS clean or dirty means the task's FP state is live
+#define SWITCH_FP_SAVE                                                        \
+  "li t1, 0x4000\n"                                                          \
+  "and t1, t0, t1\n"                                                         \
+  "beqz t1, 1f\n"                                                            \
+  SWITCH_FP_REGS(fsw)                                                         \
+  "frcsr t1\n"                                                               \
+  "sw t1, 256(sp)\n"                                                         \
+  "1:\n"
+
+#define SWITCH_FP_RESTORE                                                     \
+  "li t1, 0x4000\n"                                                          \
+  "and t1, t0, t1\n"                                                         \
+  "beqz t1, 2f\n"                                                            \
+  SWITCH_FP_REGS(flw)                                                         \
+  "lw t1, 256(sp)\n"                                                         \
+  "fscsr t1\n"                                                               \
+  "2:\n"
+
+#else
+
+#define SWITCH_FP_SAVE      ""
+#define SWITCH_FP_RESTORE   ""
+
+#endif
+
+#define STR(x)              #x
+#define XSTR(x)             STR(x)
+
+void *rtos_port_switch(void *sp);
+
+/**
+ * @brief The switch itself: saves the preempted task, asks the kernel who runs
+ * next and returns into that task's frame.
+ */
+__attribute__((naked)) void software_irq_handler(void) {
+  __asm__ volatile(
+    "addi sp, sp, -" XSTR(RTOS_PORT_FRAME) "\n"
+    SWITCH_INT_REGS(sw)
+    "csrr t0, mepc\n"
+    "sw t0, 112(sp)\n"
+    "csrr t0, mstatus\n"
+    "sw t0, 116(sp)\n"
+    SWITCH_FP_SAVE
+    "mv a0, sp\n"
+    "call rtos_port_switch\n"
+    "mv sp, a0\n"
+    "lw t0, 112(sp)\n"
+    "csrw mepc, t0\n"
+    "lw t0, 116(sp)\n"
+    SWITCH_FP_RESTORE
+    "csrw mstatus, t0\n"
+    SWITCH_INT_REGS(lw)
+    "addi sp, sp, " XSTR(RTOS_PORT_FRAME) "\n"
+    "mret\n");
+}
+
+// Called from the handler with the outgoing frame; returns the incoming one
+void *rtos_port_switch(void *sp) {
+  rtos_task_t *t = rtos_self();
+
+  pfic_clear_pending(SOFTWARE_IRQn);
+  // Before the first task there is nobody to save: main() is left behind
+  if (t) {
+    t->sp = sp;
+  }
+  return rtos_switch_in()->sp;
+}
+
+uint32_t rtos_port_irq_save(void) {
+  return irq_ceiling_save(IRQ_CEILING);
+}
+
+void rtos_port_irq_restore(uint32_t state) {
+  irq_ceiling_restore(state);
+}
+
+void rtos_port_pend_switch(void) {
+  pfic_set_pending(SOFTWARE_IRQn);
+}
+
+void rtos_port_task_init(rtos_task_t *t, rtos_entry_t entry, void *arg) {
+  // The ABI wants sp 16-byte aligned
+  uint32_t top = (uint32_t)(t->stack + t->stack_words) & ~15u;
+  uint32_t *frame = (uint32_t *)(top - RTOS_PORT_FRAME);
+
+  frame[0] = (uint32_t)rtos_task_exit;        // ra: returning from entry ends the task
+  frame[4] = (uint32_t)arg;                   // a0
+  frame[28] = (uint32_t)entry;                // mepc
+  frame[29] = MSTATUS_MPP_M | MSTATUS_MPIE;   // Interrupts on once it runs
+#ifdef __riscv_flen
+  frame[29] |= MSTATUS_FS_INITIAL;
+#endif
+  t->sp = frame;
+}
+
+void rtos_port_start(void) {
+  pfic_set_priority(SOFTWARE_IRQn, SWITCH_PRIORITY);
+  // Timer callbacks include the kernel's alarm
+  pfic_set_priority(SYSTICK_IRQn, IRQ_CEILING);
+  pfic_enable_irq(SOFTWARE_IRQn);
+  pfic_set_pending(SOFTWARE_IRQn);
+  // Drop rtos_start()'s section: main() is never returned to
+  PFIC->ITHRESDR = 0;
+  irq_global_enable();
+  while (1) {
+  }
+}
+
+uint32_t rtos_port_now(void) {
+  return systime_us();
+}
+
+static void alarm_fired(void *ctx) {
+  (void)ctx;
+  rtos_timeout_isr();
+}
+
+void rtos_port_alarm(bool armed, uint32_t at) {
+  int32_t in;
+
+  if (!armed) {
+    systime_stop(&alarm);
+    return;
+  }
+  in = (int32_t)(at - systime_us());
+  systime_start(&alarm, in > 0 ? (uint32_t)in : 0, 0, alarm_fired, NULL);
+}
+
+void rtos_port_idle(void) {
+  pm_idle();
+}
+
+static struct {
+  rtos_task_t task;
+  uint32_t stack[BENCH_WORDS];
+  rtos_sem_t go;
+  rtos_sem_t done;
+  swtimer_t timer;
+  volatile bool stop;
+  volatile uint32_t t0;
+  uint32_t t1;
+} bench;
+
+static uint32_t cycles(void) {
+  return (uint32_t)systime_ticks();
+}
+
+static void bench_yielder(void *arg) {
+  (void)arg;
+  while (!bench.stop) {
+    rtos_yield();
+  }
+}
+
+static void bench_taker(void *arg) {
+  (void)arg;
+  while (!bench.stop) {
+    rtos_sem_take(&bench.go, RTOS_FOREVER);
+    bench.t1 = cycles();
+    rtos_sem_give(&bench.done);
+  }
+}
+
+static void bench_fire(void *ctx) {
+  (void)ctx;
+  bench.t0 = cycles();
+  rtos_sem_give(&bench.go);
+}
+
+void rtos_bench(rtos_bench_t *b, uint32_t n) {
+  uint8_t prio = rtos_self()->prio;
+  uint32_t i, t, d;
+  uint64_t sum = 0;
+
+  *b = (rtos_bench_t){0};
+  b->wake_min_cycles = UINT32_MAX;
+
+  // Two tasks of one priority taking turns: each rtos_yield() is one switch
+  bench.stop = false;
+  rtos_task_create(&bench.task, "bench", prio, bench.stack, BENCH_WORDS, bench_yielder, NULL);
+  rtos_yield();
+  t = cycles();
+  for (i = 0; i < n; i++) {
+    rtos_yield();
+  }
+  b->yield_cycles = (cycles() - t) / (2 * n);
+  bench.stop = true;
+  rtos_yield();
+
+  // A task giving to a higher-priority one, which takes and gives back at once
+  rtos_sem_init(&bench.go, 0, 1);
+  rtos_sem_init(&bench.done, 0, 1);
+  bench.stop = false;
+  rtos_task_create(&bench.task, "bench", prio - 1, bench.stack, BENCH_WORDS, bench_taker, NULL);
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    t = cycles();
+    rtos_sem_give(&bench.go);
+    sum += bench.t1 - t;
+    rtos_sem_take(&bench.done, RTOS_FOREVER);
+  }
+  b->sem_cycles = sum / n;
+
+  // The same taker woken from a timer callback while this task sleeps
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    systime_start(&bench.timer, 500, 0, bench_fire, NULL);
+    rtos_sem_take(&bench.done, RTOS_FOREVER);
+    d = bench.t1 - bench.t0;
+    sum += d;
+    if (d < b->wake_min_cycles) {
+      b->wake_min_cycles = d;
+    }
+    if (d > b->wake_max_cycles) {
+      b->wake_max_cycles = d;
+    }
+  }
+  b->wake_avg_cycles = sum / n;
+
+  bench.stop = true;
+  rtos_sem_give(&bench.go);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "rtos.h"
+
+
+/**
+ * @brief CH32V307 port of the kernel in lib/rtos.h.
+ *
+ * @details Switches run in the software interrupt at the lowest priority, so
+ * a switch requested by an interrupt handler happens once every nested handler
+ * has returned, and one requested by a task as soon as its critical section
+ * ends. The handler saves the whole integer context and mepc/mstatus on the
+ * outgoing task's stack, plus f0-f31 and fcsr in FPU builds when mstatus.FS
+ * says the task has live FP state, and restores the incoming one the same way.
+ *
+ * The hardware prologue/epilogue (HPE, INTSYSCR) stays off, as startup.c
+ * leaves it: its shadow register stack belongs to whatever the interrupt
+ * preempted and mret pops it into whatever runs next, so a switch made inside
+ * an HPE frame would hand the old task's registers to the new one. Handlers
+ * keep using the IRQ_HANDLER() frames that pfic.h already trims.
+ *
+ * Interrupts run on the stack of the task they preempt, so every task stack
+ * needs room for a context frame (RTOS_PORT_FRAME) and the deepest nesting of
+ * handlers on top of what the task itself uses. The stack main() ran on is not
+ * used once rtos_start() is called.
+ *
+ * Kernel critical sections raise the PFIC threshold to IRQ_CEILING instead of
+ * clearing mstatus.MIE, so handlers more urgent than that keep their latency
+ * while tasks run the kernel. In exchange only handlers at IRQ_CEILING or
+ * below may call it (semaphore gives, queue sends). The startup code puts every
+ * interrupt at IRQ_CEILING, so that holds unless a handler has been given a
+ * more urgent priority with pfic_set_priority().
+ *
+ * Timeouts are SysTick deadlines through systime_start() and the idle task
+ * calls pm_idle(), so an idle system sleeps, or stops, until the next
+ * timeout or interrupt. Call systime_init() and pm_init() before rtos_init().
+ */
+
+#ifdef __riscv_flen
+#define RTOS_PORT_FRAME     272     // Bytes: 32 integer words, then f0-f31 and fcsr
+#else
+#define RTOS_PORT_FRAME     128
+#endif
+
+#define RTOS_IDLE_WORDS     128
+
+typedef struct {
+  uint32_t yield_cycles;        // Task yields, the other task runs: per switch
+  uint32_t sem_cycles;          // Give to a blocked higher-priority task, until it runs
+  // Timer callback giving a semaphore, until the woken task runs
+  uint32_t wake_min_cycles;
+  uint32_t wake_avg_cycles;
+  uint32_t wake_max_cycles;
+} rtos_bench_t;
+
+/**
+ * @brief Measures switch and wake-up costs in HCLK cycles on SysTick.
+ *
+ * @details Call from a task of priority 1 or lower (a larger number); it runs
+ * a helper task at the caller's priority, then one a level above it, takes
+ * about n milliseconds and leaves nothing behind. Every figure includes
+ * reading the 64-bit SysTick count once (a few cycles). The wake-up figures start in the
+ * SysTick callback, after the interrupt entry and the timer list walk.
+ */
+void rtos_bench(rtos_bench_t *b, uint32_t n);
@@ -0,0 +1,326 @@
+#include "sdio.h"
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "gpio.h"
+#include "rcc.h"
+
+#define SDIOx               ((SDIO_TypeDef *)SDIO)
+#define SDIO_DMA            DMA2_CH(4)
+
+#define CLKCR_CLKEN         (1 << 8)
+#define CLKCR_WIDBUS_4      (1 << 11)
+#define CLKCR_HWFC_EN       (1 << 14)
+
+#define CMD_RESP_SHORT      (1 << 6)
+#define CMD_RESP_LONG       (3 << 6)
+#define CMD_CPSMEN          (1 << 10)
+
+#define DCTRL_DTEN          (1 << 0)
+#define DCTRL_DTDIR         (1 << 1)
+#define DCTRL_DMAEN         (1 << 3)
+#define DCTRL_BLOCK(n)      ((n) << 4) // 2^n bytes
+
+#define STA_CCRCFAIL        (1 << 0)
+#define STA_DCRCFAIL        (1 << 1)
+#define STA_CTIMEOUT        (1 << 2)
+#define STA_DTIMEOUT        (1 << 3)
+#define STA_TXUNDERR        (1 << 4)
+#define STA_RXOVERR         (1 << 5)
+#define STA_CMDREND         (1 << 6)
+#define STA_CMDSENT         (1 << 7)
+#define STA_DATAEND         (1 << 8)
+#define STA_STBITERR        (1 << 9)
+#define STA_CMDACT          (1 << 11)
+#define STA_RXDAVL          (1 << 21)
+#define STA_DATA_ERR        (STA_DCRCFAIL | STA_DTIMEOUT | STA_TXUNDERR | STA_RXOVERR | STA_STBITERR)
+#define ICR_ALL             0x7FF
+
+// Response types: R1/R1b/R6/R7 are short with CRC, R3 has no valid CRC
+#define R_NONE              0
+#define R_SHORT             1
+#define R_R3                2
+#define R_LONG              3
+
+#define R1_STATE(r)         (((r) >> 9) & 0xF)
+#define R1_READY            (1 << 8)
+#define R1_ERRORS           0xFDF90000
+#define STATE_TRAN          4
+
+#define INIT_HZ             400000
+#define DEFAULT_HZ          24000000
+#define HIGH_SPEED_HZ       48000000
+#define SPIN                1000000   // Polls before a command or busy wait gives up
+#define CHUNK               256       // Blocks per command; one DMA load is < 64K words
+
+static struct {
+  sdio_card_t card;
+  uint32_t hclk;
+  uint32_t data_timeout;  // Card clocks
+  bool clocked;
+} sd;
+
+
+static void sdio_clock(uint32_t hz, uint32_t flags) {
+  uint32_t div = (sd.hclk + hz - 1) / hz;
+
+  div = div < 2 ? 0 : div - 2;
+  SDIOx->CLKCR = (div > 255 ? 255 : div) | CLKCR_CLKEN | flags;
+  sd.data_timeout = hz / 4;   // 250 ms, the SDHC write limit
+}
+
+static bool sdio_cmd(uint8_t index, uint32_t arg, uint8_t resp) {
+  uint32_t sta, n = SPIN;
+  uint32_t done = resp == R_NONE ? STA_CMDSENT : STA_CMDREND | STA_CTIMEOUT | STA_CCRCFAIL;
+
+  SDIOx->ICR = STA_CCRCFAIL | STA_CTIMEOUT | STA_CMDREND | STA_CMDSENT;
+  SDIOx->ARG = arg;
+  SDIOx->CMD = index | CMD_CPSMEN | (resp == R_LONG ? CMD_RESP_LONG : resp ? CMD_RESP_SHORT : 0);
+  while (!((sta = SDIOx->STA) & done)) {
+    if (!--n) {
+      return false;
+    }
+  }
+  SDIOx->ICR = STA_CCRCFAIL | STA_CTIMEOUT | STA_CMDREND | STA_CMDSENT;
+  if (sta & STA_CTIMEOUT) {
+    return false;
+  }
+  if (resp == R_R3) {
+    return true;  // No CRC over the OCR, CCRCFAIL is expected
+  }
+  if (sta & STA_CCRCFAIL) {
+    return false;
+  }
+  return resp != R_SHORT || SDIOx->RESPCMD == index;
+}
+
+static bool sdio_acmd(uint8_t index, uint32_t arg, uint8_t resp) {
+  return sdio_cmd(55, (uint32_t)sd.card.rca << 16, R_SHORT) && sdio_cmd(index, arg, resp);
+}
+
+// CMD13 until the card is back in transfer state, i.e. done programming
+static bool sdio_wait_ready(void) {
+  uint32_t n;
+
+  for (n = SPIN; n; n--) {
+    if (!sdio_cmd(13, (uint32_t)sd.card.rca << 16, R_SHORT) || (SDIOx->RESP[0] & R1_ERRORS)) {
+      return false;
+    }
+    if (R1_STATE(SDIOx->RESP[0]) == STATE_TRAN && (SDIOx->RESP[0] & R1_READY)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint32_t csd_blocks(void) {
+  const volatile uint32_t *r = SDIOx->RESP;
+  uint32_t c_size, mult, bl_len;
+
+  if ((r[0] >> 30) == 1) {
+    c_size = ((r[1] & 0x3F) << 16) | (r[2] >> 16);
+    return (c_size + 1) << 10;
+  }
+  bl_len = (r[1] >> 16) & 0xF;
+  c_size = ((r[1] & 0x3FF) << 2) | (r[2] >> 30);
+  mult = (r[2] >> 15) & 7;
+  return ((c_size + 1) << (mult + 2 + bl_len)) / BLOCK_SIZE;
+}
+
+/**
+ * @brief CMD6 switch to high speed.
+ *
+ * @details The 64-byte status block is short enough to drain from the FIFO by
+ * hand. Bits 379:376 (byte 16, low nibble) hold the function group 1 result.
+ */
+static bool sdio_high_speed(void) {
+  uint32_t status[16], i = 0, n = SPIN;
+
+  SDIOx->DTIMER = sd.data_timeout;
+  SDIOx->DLEN = sizeof(status);
+  SDIOx->DCTRL = DCTRL_DTEN | DCTRL_DTDIR | DCTRL_BLOCK(6);
+  if (!sdio_cmd(6, 0x80FFFFF1, R_SHORT)) {
+    SDIOx->DCTRL = 0;
+    return false;
+  }
+  while (i < 16 && !(SDIOx->STA & STA_DATA_ERR) && --n) {
+    if (SDIOx->STA & STA_RXDAVL) {
+      status[i++] = SDIOx->FIFO;
+    }
+  }
+  SDIOx->DCTRL = 0;
+  SDIOx->ICR = ICR_ALL;
+  return i == 16 && ((status[4] & 0xF) == 1);
+}
+
+bool sdio_init(sdio_card_t *card) {
+  rcc_clocks_t clocks;
+  uint32_t pin, n, hcs;
+
+  // Polled, so no handler; holding the channel keeps DAC2 and UART5 TX off it
+  if (!dma_attach(SDIO_DMA, NULL, &sd)) {
+    return false;
+  }
+  if (!sd.clocked) {
+    rcc_clock_acquire(RCC_SDIO);
+    rcc_clock_acquire(RCC_GPIOC);
+    rcc_clock_acquire(RCC_GPIOD);
+    sd.clocked = true;
+  }
+  for (pin = 8; pin <= 12; pin++) {
+    gpio_config(PC, pin, GPIO_AF_PP_50MHZ);
+  }
+  gpio_config(PD, 2, GPIO_AF_PP_50MHZ);
+
+  rcc_get_clocks(&clocks);
+  sd.hclk = clocks.hclk;
+  sd.card.rca = 0;
+  SDIOx->POWER = 3;
+  sdio_clock(INIT_HZ, 0);
+  SDIOx->DCTRL = 0;
+  SDIOx->MASK = 0;
+  SDIOx->ICR = ICR_ALL;
+  for (n = 0; n < 100000; n++) {
+    __asm volatile ("nop"); // 74+ clocks at 400 kHz before the first command
+  }
+
+  if (!sdio_cmd(0, 0, R_NONE)) {
+    return false;
+  }
+  // Version 2 cards echo the check pattern; older ones stay silent
+  hcs = sdio_cmd(8, 0x1AA, R_SHORT) && (SDIOx->RESP[0] & 0xFFF) == 0x1AA ? (1 << 30) : 0;
+  for (n = 0; n < 10000; n++) {
+    if (!sdio_acmd(41, 0x00FF8000 | hcs, R_R3)) {
+      return false;
+    }
+    if (SDIOx->RESP[0] & (1u << 31)) {
+      break;
+    }
+  }
+  if (!(SDIOx->RESP[0] & (1u << 31))) {
+    return false;
+  }
+  sd.card.high_capacity = (SDIOx->RESP[0] >> 30) & 1;
+
+  if (!sdio_cmd(2, 0, R_LONG) || !sdio_cmd(3, 0, R_SHORT)) {
+    return false;
+  }
+  sd.card.rca = SDIOx->RESP[0] >> 16;
+  if (!sdio_cmd(9, (uint32_t)sd.card.rca << 16, R_LONG)) {
+    return false;
+  }
+  sd.card.blocks = csd_blocks();
+
+  if (!sdio_cmd(7, (uint32_t)sd.card.rca << 16, R_SHORT) ||
+      !sdio_acmd(6, 2, R_SHORT) ||
+      (!sd.card.high_capacity && !sdio_cmd(16, BLOCK_SIZE, R_SHORT))) {
+    return false;
+  }
+  sdio_clock(DEFAULT_HZ, CLKCR_WIDBUS_4);
+  sd.card.high_speed = sdio_high_speed();
+  sdio_clock(sd.card.high_speed ? HIGH_SPEED_HZ : DEFAULT_HZ, CLKCR_WIDBUS_4 | CLKCR_HWFC_EN);
+
+  *card = sd.card;
+  return true;
+}
+
+/**
+ * @brief One multi-block command with the data moved by DMA.
+ *
+ * @details Reads arm the data path before CMD18 so the first block has
+ * somewhere to go; writes start it after the CMD25 response, as the card
+ * expects. DATAEND only says the controller is done with its FIFO, so reads
+ * also wait for the DMA to store the last words. CMD12 ends the transfer and
+ * CMD13 waits out the card's programming busy.
+ */
+static bool sdio_transfer(uint32_t lba, uint32_t buf, uint32_t count, bool write) {
+  DMA_Channel_TypeDef *ch = dma_channel(SDIO_DMA);
+  uint32_t dctrl = DCTRL_DTEN | DCTRL_DMAEN | DCTRL_BLOCK(9) | (write ? 0 : DCTRL_DTDIR);
+  uint32_t addr = sd.card.high_capacity ? lba : lba * BLOCK_SIZE;
+  uint32_t sta, n = SPIN * 16;
+  bool ok;
+
+  ch->CFGR = 0;
+  dma_clear(SDIO_DMA, DMA_FLAG_GIF | DMA_FLAG_TCIF | DMA_FLAG_HTIF | DMA_FLAG_TEIF);
+  ch->PADDR = (uint32_t)&SDIOx->FIFO;
+  ch->MADDR = buf;
+  ch->CNTR = count * BLOCK_SIZE / 4;
+  ch->CFGR = DMA_CFGR_MINC | DMA_CFGR_PSIZE_32 | DMA_CFGR_MSIZE_32 | DMA_CFGR_PL(3) |
+             (write ? DMA_CFGR_DIR : 0) | DMA_CFGR_EN;
+
+  SDIOx->ICR = ICR_ALL;
+  SDIOx->DTIMER = sd.data_timeout;
+  SDIOx->DLEN = count * BLOCK_SIZE;
+  if (!write) {
+    SDIOx->DCTRL = dctrl;
+  }
+  ok = sdio_cmd(write ? 25 : 18, addr, R_SHORT) && !(SDIOx->RESP[0] & R1_ERRORS);
+  if (ok && write) {
+    SDIOx->DCTRL = dctrl;
+  }
+  while (ok && !((sta = SDIOx->STA) & STA_DATAEND)) {
+    ok = !(sta & STA_DATA_ERR) && --n;
+  }
+  while (ok && !write && dma_remaining(SDIO_DMA)) {
+    ok = --n != 0;
+  }
+
+  ch->CFGR = 0;
+  SDIOx->DCTRL = 0;
+  SDIOx->ICR = ICR_ALL;
+  // Stop even after an error, so the card leaves the data state
+  if (!sdio_cmd(12, 0, R_SHORT)) {
+    ok = false;
+  }
+  return sdio_wait_ready() && ok;
+}
+
+bool sdio_read(uint32_t lba, void *buf, uint32_t count) {
+  uint32_t n;
+
+  if ((uintptr_t)buf & 3) {
+    return false;
+  }
+  for (; count; count -= n, lba += n) {
+    n = count > CHUNK ? CHUNK : count;
+    if (!sdio_transfer(lba, (uint32_t)buf, n, false)) {
+      return false;
+    }
+    buf = (uint8_t *)buf + n * BLOCK_SIZE;
+  }
+  return true;
+}
+
+bool sdio_write(uint32_t lba, const void *buf, uint32_t count) {
+  uint32_t n;
+
+  if ((uintptr_t)buf & 3) {
+    return false;
+  }
+  for (; count; count -= n, lba += n) {
+    n = count > CHUNK ? CHUNK : count;
+    if (!sdio_transfer(lba, (uint32_t)buf, n, true)) {
+      return false;
+    }
+    buf = (const uint8_t *)buf + n * BLOCK_SIZE;
+  }
+  return true;
+}
+
+static bool blk_read(void *ctx, uint32_t lba, void *buf, uint32_t count) {
+  (void)ctx;
+  return sdio_read(lba, buf, count);
+}
+
+static bool blk_write(void *ctx, uint32_t lba, const void *buf, uint32_t count) {
+  (void)ctx;
+  return sdio_write(lba, buf, count);
+}
+
+const blockdev_t *sdio_blockdev(void) {
+  static blockdev_t dev = {blk_read, blk_write, NULL, 0};
+
+  dev.blocks = sd.card.blocks;
+  return &dev;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "blockdev.h"
+
+
+/**
+ * @brief SDIO host controller register block
+ *
+ * @details The controller sits on AHB (clock enable RCC_AHBENR bit 10) and is
+ * clocked from HCLK; the card clock is HCLK / (CLKDIV + 2). Pins: PC8-PC11 D0-D3,
+ * PC12 CK, PD2 CMD, all alternate function push-pull. Data moves through a
+ * 32-word FIFO at 0x80 that DMA2 channel 4 drains or fills in 32-bit words.
+ *
+ * Bit fields of CLKCR:
+ * - Bits 7:0   : CLKDIV   - Card clock divider
+ * - Bit 8      : CLKEN    - Card clock enable
+ * - Bit 9      : PWRSAV   - Stop the clock while the bus is idle
+ * - Bits 12:11 : WIDBUS   - Bus width (00: 1 bit, 01: 4 bits, 10: 8 bits)
+ * - Bit 14     : HWFC_EN  - Stop the card clock instead of under/overrunning
+ *
+ * Bit fields of CMD:
+ * - Bits 5:0   : CMDINDEX - Command index
+ * - Bits 7:6   : WAITRESP - 00/10: no response, 01: short, 11: long (R2)
+ * - Bit 10     : CPSMEN   - Send the command
+ *
+ * Bit fields of DCTRL:
+ * - Bit 0      : DTEN     - Start the data transfer
+ * - Bit 1      : DTDIR    - 1: card to controller
+ * - Bit 3      : DMAEN    - DMA requests
+ * - Bits 7:4   : DBLOCKSIZE - Block size 2^n bytes
+ *
+ * Bit fields of STA (cleared through ICR):
+ * - Bit 0 : CCRCFAIL - Response CRC error   - Bit 6  : CMDREND - Response received
+ * - Bit 1 : DCRCFAIL - Data CRC error       - Bit 7  : CMDSENT - Command sent
+ * - Bit 2 : CTIMEOUT - Response timeout     - Bit 8  : DATAEND - DCOUNT reached 0
+ * - Bit 3 : DTIMEOUT - Data timeout         - Bit 9  : STBITERR - Start bit error
+ * - Bit 4 : TXUNDERR - FIFO underrun        - Bit 11 : CMDACT  - Command in progress
+ * - Bit 5 : RXOVERR  - FIFO overrun         - Bit 21 : RXDAVL  - FIFO has data
+ *
+ * @note DMA2 channel 4 is shared with UART5 TX and DAC output 2. The driver
+ * only owns it for the duration of a transfer.
+ */
+typedef struct {
+  volatile uint32_t POWER;
+  volatile uint32_t CLKCR;
+  volatile uint32_t ARG;
+  volatile uint32_t CMD;
+  volatile uint32_t RESPCMD;
+  volatile uint32_t RESP[4];
+  volatile uint32_t DTIMER;
+  volatile uint32_t DLEN;
+  volatile uint32_t DCTRL;
+  volatile uint32_t DCOUNT;
+  volatile uint32_t STA;
+  volatile uint32_t ICR;
+  volatile uint32_t MASK;
+  uint32_t RESERVED0[2];
+  volatile uint32_t FIFOCNT;
+  uint32_t RESERVED1[13];
+  volatile uint32_t FIFO;
+} SDIO_TypeDef;
+
+typedef struct {
+  uint32_t blocks;      // Capacity in 512-byte blocks
+  uint16_t rca;
+  bool high_capacity;   // SDHC/SDXC: block addressing
+  bool high_speed;      // 48 MHz card clock, else 24 MHz
+} sdio_card_t;
+
+/**
+ * @brief Identifies the card and brings it to 4-bit transfer state.
+ *
+ * @details Switches to high speed if the card supports it. Returns false if no
+ * card answers; the clock and pins stay configured so it can be retried. Also
+ * false if DMA2 channel 4 belongs to DAC2 or UART5 TX.
+ */
+bool sdio_init(sdio_card_t *card);
+
+// Synchronous multi-block transfers; buf must be 4-byte aligned
+bool sdio_read(uint32_t lba, void *buf, uint32_t count);
+bool sdio_write(uint32_t lba, const void *buf, uint32_t count);
+
+// Block device view of the card initialised by sdio_init()
+const blockdev_t *sdio_blockdev(void);
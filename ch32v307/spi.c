@@ -0,0 +1,265 @@
+#include "spi.h"
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "gpio.h"
+#include "pfic.h"
+#include "rcc.h"
+
+static const struct {
+  uint32_t base;
+  uint8_t clock;
+  uint8_t rx_dma;
+  uint8_t tx_dma;
+} buses[3] = {
+  {SPI1, RCC_SPI1, DMA1_CH(2), DMA1_CH(3)},
+  {SPI2, RCC_SPI2, DMA1_CH(4), DMA1_CH(5)},
+  {SPI3, RCC_SPI3, DMA2_CH(1), DMA2_CH(2)},
+};
+
+static struct {
+  spi_xfer_t *head;
+  spi_xfer_t *tail;
+  uint16_t ctlr1;
+  bool clocked;
+} state[3];
+
+static const uint8_t fill_tx = 0xFF;
+static uint8_t sink_rx;
+
+#define SPIx(i)             ((SPI_TypeDef *)buses[i].base)
+
+#define STK_CTLR            (*((volatile uint32_t *)(SYSTICK_BASE + 0x00)))
+#define STK_CNTL            (*((volatile uint32_t *)(SYSTICK_BASE + 0x08)))
+#define STK_CTLR_STE        (1 << 0)
+#define STK_CTLR_STCLK      (1 << 2)
+
+#define BENCH_XFERS         8
+
+
+static inline void cs_assert(const spi_device_t *dev, bool on) {
+  if (dev->cs_port) {
+    GPIO_BSHR(dev->cs_port) = on ? 1u << (dev->cs_pin + 16) : 1u << dev->cs_pin;
+  }
+}
+
+static void spi_configure(uint32_t i, const spi_device_t *dev) {
+  SPI_TypeDef *spi = SPIx(i);
+
+  if (state[i].ctlr1 != dev->ctlr1) {
+    spi->CTLR1 = dev->ctlr1 & ~SPI_CTLR1_SPE;
+    spi->CTLR1 = dev->ctlr1;
+    state[i].ctlr1 = dev->ctlr1;
+  }
+}
+
+static void spi_start(uint32_t i) {
+  spi_xfer_t *x = state[i].head;
+  DMA_Channel_TypeDef *rx = dma_channel(buses[i].rx_dma);
+  DMA_Channel_TypeDef *tx = dma_channel(buses[i].tx_dma);
+  uint32_t base = DMA_CFGR_PL(2) | DMA_CFGR_TEIE;
+
+  spi_configure(i, x->dev);
+  if (x->start) {
+    x->start(x);
+  }
+  cs_assert(x->dev, true);
+
+  rx->CFGR = 0;
+  rx->MADDR = x->rx ? (uint32_t)x->rx : (uint32_t)&sink_rx;
+  rx->CNTR = x->len;
+  rx->CFGR = base | DMA_CFGR_TCIE | (x->rx ? DMA_CFGR_MINC : 0) | DMA_CFGR_EN;
+
+  tx->CFGR = 0;
+  tx->MADDR = x->tx ? (uint32_t)x->tx : (uint32_t)&fill_tx;
+  tx->CNTR = x->len;
+  tx->CFGR = base | DMA_CFGR_DIR | (x->tx ? DMA_CFGR_MINC : 0) | DMA_CFGR_EN;
+}
+
+static void spi_finish(uint32_t i, int8_t status) {
+  spi_xfer_t *x = state[i].head;
+
+  dma_channel(buses[i].rx_dma)->CFGR = 0;
+  dma_channel(buses[i].tx_dma)->CFGR = 0;
+  x->status = status;
+  state[i].head = x->next;
+  if (!state[i].head) {
+    state[i].tail = NULL;
+  }
+  if (!x->keep_cs) {
+    cs_assert(x->dev, false);
+  }
+  // Start the next transfer before running the callback to keep the bus busy
+  if (state[i].head) {
+    spi_start(i);
+  }
+  if (x->done) {
+    x->done(x);
+  }
+}
+
+// RX finishes last, so its completion means the whole transfer is on the wire
+static void spi_rx_dma(void *ctx, uint32_t flags) {
+  uint32_t i = (uint32_t)ctx;
+
+  if (!state[i].head || !(flags & (DMA_FLAG_TCIF | DMA_FLAG_TEIF))) {
+    return;
+  }
+  spi_finish(i, flags & DMA_FLAG_TEIF ? SPI_DMA_ERROR : SPI_OK);
+}
+
+// Only errors: an RX that will never complete once TX has stopped
+static void spi_tx_dma(void *ctx, uint32_t flags) {
+  uint32_t i = (uint32_t)ctx;
+
+  if (state[i].head && (flags & DMA_FLAG_TEIF)) {
+    spi_finish(i, SPI_DMA_ERROR);
+  }
+}
+
+bool spi_init(uint32_t bus) {
+  uint32_t i = bus - 1;
+  SPI_TypeDef *spi;
+
+  if (i >= 3) {
+    return false;
+  }
+  if (!state[i].clocked) {
+    rcc_clock_acquire(buses[i].clock);
+    state[i].clocked = true;
+  }
+  spi = SPIx(i);
+  spi->CTLR1 = 0;
+  spi->CTLR2 = SPI_CTLR2_RXDMAEN | SPI_CTLR2_TXDMAEN;
+  state[i].head = NULL;
+  state[i].tail = NULL;
+  state[i].ctlr1 = 0;
+
+  if (!dma_attach(buses[i].rx_dma, spi_rx_dma, (void *)i)) {
+    return false;
+  }
+  if (!dma_attach(buses[i].tx_dma, spi_tx_dma, (void *)i)) {
+    dma_detach(buses[i].rx_dma, spi_rx_dma, (void *)i);
+    return false;
+  }
+  dma_channel(buses[i].rx_dma)->PADDR = (uint32_t)&spi->DATAR;
+  dma_channel(buses[i].tx_dma)->PADDR = (uint32_t)&spi->DATAR;
+  return true;
+}
+
+void spi_device_init(spi_device_t *dev) {
+  rcc_clocks_t clocks;
+  uint32_t pclk, br = 0;
+
+  rcc_get_clocks(&clocks);
+  pclk = RCC_BUS(buses[dev->bus - 1].clock) == RCC_APB2 ? clocks.pclk2 : clocks.pclk1;
+  while (br < 7 && (pclk >> (br + 1)) > dev->max_hz) {
+    br++;
+  }
+  dev->ctlr1 = SPI_CTLR1_MSTR | SPI_CTLR1_SSM | SPI_CTLR1_SSI | SPI_CTLR1_SPE |
+               (br << 3) | (dev->mode & 0x3) | (dev->lsb_first ? SPI_CTLR1_LSBFIRST : 0);
+  cs_assert(dev, false);
+}
+
+bool spi_submit(spi_xfer_t *xfer) {
+  uint32_t i = xfer->dev->bus - 1;
+  uint32_t rx_irq, tx_irq;
+
+  if (i >= 3 || xfer->len == 0) {
+    return false;
+  }
+  xfer->next = NULL;
+  xfer->status = SPI_PENDING;
+  // Both channels' handlers can finish the head transfer
+  rx_irq = dma_irq(buses[i].rx_dma);
+  tx_irq = dma_irq(buses[i].tx_dma);
+  pfic_disable_irq(rx_irq);
+  pfic_disable_irq(tx_irq);
+  if (state[i].tail) {
+    state[i].tail->next = xfer;
+    state[i].tail = xfer;
+  } else {
+    state[i].head = xfer;
+    state[i].tail = xfer;
+    spi_start(i);
+  }
+  pfic_enable_irq(tx_irq);
+  pfic_enable_irq(rx_irq);
+  return true;
+}
+
+bool spi_busy(uint32_t bus) {
+  return state[bus - 1].head != NULL;
+}
+
+void spi_transfer_polled(const spi_device_t *dev, const void *tx, void *rx, uint32_t len) {
+  uint32_t i = dev->bus - 1;
+  SPI_TypeDef *spi = SPIx(i);
+  const uint8_t *out = tx;
+  uint8_t *in = rx;
+  uint32_t n;
+  uint8_t b;
+
+  spi_configure(i, dev);
+  spi->CTLR2 = 0;
+  cs_assert(dev, true);
+  for (n = 0; n < len; n++) {
+    while (!(spi->STATR & SPI_STATR_TXE));
+    spi->DATAR = out ? out[n] : 0xFF;
+    while (!(spi->STATR & SPI_STATR_RXNE));
+    b = spi->DATAR;
+    if (in) {
+      in[n] = b;
+    }
+  }
+  while (spi->STATR & SPI_STATR_BSY);
+  cs_assert(dev, false);
+  spi->CTLR2 = SPI_CTLR2_RXDMAEN | SPI_CTLR2_TXDMAEN;
+}
+
+static inline uint32_t bytes_per_s(uint32_t bytes, uint32_t ticks, uint32_t hz) {
+  return ticks ? (uint32_t)((uint64_t)bytes * hz / ticks) : 0;
+}
+
+void spi_bench(const spi_device_t *dev, void *buf, uint32_t bytes, spi_bench_t *result) {
+  static spi_xfer_t x[BENCH_XFERS];
+  rcc_clocks_t clocks;
+  uint32_t pclk, hz, t, n, i, off = 0;
+
+  rcc_get_clocks(&clocks);
+  pclk = RCC_BUS(buses[dev->bus - 1].clock) == RCC_APB2 ? clocks.pclk2 : clocks.pclk1;
+  result->wire = (pclk >> (((dev->ctlr1 >> 3) & 7) + 1)) / 8;
+  if (!(STK_CTLR & STK_CTLR_STE)) {
+    STK_CTLR = STK_CTLR_STE | STK_CTLR_STCLK;
+  }
+  hz = STK_CTLR & STK_CTLR_STCLK ? clocks.hclk : clocks.hclk / 8;
+  if (bytes > BENCH_XFERS * 0xFFFF) {
+    bytes = BENCH_XFERS * 0xFFFF;
+  }
+
+  t = STK_CNTL;
+  spi_transfer_polled(dev, buf, buf, bytes);
+  result->polled = bytes_per_s(bytes, STK_CNTL - t, hz);
+
+  // In place: each byte is sent before the one received over it lands
+  for (i = 0; i < BENCH_XFERS; i++) {
+    n = (bytes - off) / (BENCH_XFERS - i);
+    x[i] = (spi_xfer_t){.dev = dev, .tx = (uint8_t *)buf + off, .rx = (uint8_t *)buf + off,
+                        .len = n, .keep_cs = off + n < bytes};
+    off += n;
+  }
+  t = STK_CNTL;
+  for (i = 0; i < BENCH_XFERS; i++) {
+    if (x[i].len) {
+      spi_submit(&x[i]);
+    }
+  }
+  while (spi_busy(dev->bus)) {
+  }
+  result->dma = bytes_per_s(bytes, STK_CNTL - t, hz);
+  result->errors = 0;
+  for (i = 0; i < BENCH_XFERS; i++) {
+    result->errors += x[i].len && x[i].status != SPI_OK;
+  }
+}
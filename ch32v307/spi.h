@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief SPI register block (SPI1, SPI2, SPI3)
+ *
+ * @details SPI1 sits on APB2 (clock enable RCC_APB2ENR bit 12), SPI2 and SPI3 on
+ * APB1 (bits 14 and 15). The serial clock is PCLK / 2^(BR + 1).
+ *
+ * Bit fields of CTLR1:
+ * - Bit 0     : CPHA      - Clock phase
+ * - Bit 1     : CPOL      - Clock polarity
+ * - Bit 2     : MSTR      - Master mode
+ * - Bits 5:3  : BR        - Baud rate divider (000: /2 .. 111: /256)
+ * - Bit 6     : SPE       - SPI enable
+ * - Bit 7     : LSBFIRST  - Frame format
+ * - Bit 8     : SSI       - Internal slave select
+ * - Bit 9     : SSM       - Software slave management
+ * - Bit 11    : DFF       - 16-bit frames
+ *
+ * Bit fields of CTLR2:
+ * - Bit 0 : RXDMAEN  - RX DMA enable
+ * - Bit 1 : TXDMAEN  - TX DMA enable
+ *
+ * Bit fields of STATR:
+ * - Bit 0 : RXNE  - Receive buffer not empty
+ * - Bit 1 : TXE   - Transmit buffer empty
+ * - Bit 7 : BSY   - Busy
+ *
+ * @note DMA channels: SPI1 RX/TX on DMA1 channels 2/3, SPI2 on DMA1 channels 4/5,
+ * SPI3 on DMA2 channels 1/2. SPI1 shares both of its channels with USART3 (TX on
+ * 2, RX on 3), SPI2 both of its with USART1 (TX on 4, RX on 5) and SPI3 channel 2
+ * with UART5 RX. While SPI1 or SPI2 uses DMA, neither direction of USART3 or
+ * USART1 respectively can, and UART5 RX cannot while SPI3 does. Pins (SCK and
+ * MOSI alternate function push-pull, MISO input) are set up by the caller; chip
+ * select is a plain GPIO output driven by the driver.
+ */
+typedef struct {
+  volatile uint32_t CTLR1;
+  volatile uint32_t CTLR2;
+  volatile uint32_t STATR;
+  volatile uint32_t DATAR;
+  volatile uint32_t CRCR;
+  volatile uint32_t RCRCR;
+  volatile uint32_t TCRCR;
+  volatile uint32_t I2SCFGR;
+  volatile uint32_t I2SPR;
+  volatile uint32_t HSCR;
+} SPI_TypeDef;
+
+#define SPI_CTLR1_MSTR      (1 << 2)
+#define SPI_CTLR1_SPE       (1 << 6)
+#define SPI_CTLR1_LSBFIRST  (1 << 7)
+#define SPI_CTLR1_SSI       (1 << 8)
+#define SPI_CTLR1_SSM       (1 << 9)
+#define SPI_CTLR2_RXDMAEN   (1 << 0)
+#define SPI_CTLR2_TXDMAEN   (1 << 1)
+#define SPI_STATR_RXNE      (1 << 0)
+#define SPI_STATR_TXE       (1 << 1)
+#define SPI_STATR_BSY       (1 << 7)
+
+// spi_xfer_t.status
+#define SPI_PENDING         1
+#define SPI_OK              0
+#define SPI_DMA_ERROR       -1  // A bus error on either channel; the data is incomplete
+
+typedef struct {
+  uint8_t bus;          // 1..3
+  uint8_t mode;         // CPOL << 1 | CPHA
+  bool lsb_first;
+  uint32_t max_hz;
+  uint32_t cs_port;     // PA..PE, 0 for no chip select
+  uint8_t cs_pin;
+  uint16_t ctlr1;       // Filled in by spi_device_init()
+} spi_device_t;
+
+typedef struct spi_xfer {
+  const spi_device_t *dev;
+  const void *tx;       // NULL sends 0xFF
+  void *rx;             // NULL discards
+  uint16_t len;
+  bool keep_cs;         // Leave CS asserted after this transfer
+  volatile int8_t status; // SPI_PENDING until done() is called
+  void (*start)(struct spi_xfer *xfer); // ISR context, right before the DMA starts
+  void (*done)(struct spi_xfer *xfer); // ISR context; status is final
+  void *ctx;
+  struct spi_xfer *next;
+} spi_xfer_t;
+
+// False if the DMA channels belong to another driver (UART3, USART1, I2C2)
+bool spi_init(uint32_t bus);
+void spi_device_init(spi_device_t *dev);
+
+// Queued transfers run back to back, each started from the previous one's DMA
+// completion interrupt. The transfer and its buffers belong to the driver until
+// done() is called.
+bool spi_submit(spi_xfer_t *xfer);
+bool spi_busy(uint32_t bus);
+
+// Blocking byte-by-byte transfer, for early boot and as a throughput baseline.
+// The bus must be idle.
+void spi_transfer_polled(const spi_device_t *dev, const void *tx, void *rx, uint32_t len);
+
+typedef struct {
+  uint32_t wire;                // Bytes/s the serial clock allows
+  uint32_t polled;              // Bytes/s, spi_transfer_polled()
+  uint32_t dma;                 // Bytes/s, queued DMA transfers back to back
+  uint32_t errors;              // DMA transfers that did not end SPI_OK
+} spi_bench_t;
+
+/**
+ * @brief Sustained throughput of both transfer paths on dev, full duplex.
+ *
+ * @details Moves bytes (up to 8 * 65535) out of and back into buf, first byte
+ * by byte and then as eight queued DMA transfers under one chip select, and
+ * times both on SysTick. The device sees the data, so use one that ignores it
+ * or a MOSI-MISO loopback. The bus must be idle.
+ */
+void spi_bench(const spi_device_t *dev, void *buf, uint32_t bytes, spi_bench_t *result);
@@ -0,0 +1,243 @@
+#include "ch32v307.h"
+#include "pfic.h"
+
+
+extern uint32_t _sidata[], _sdata[], _edata[], _sbss[], _ebss[];
+extern void main(void);
+
+void reset_handler(void);
+
+IRQ_HANDLER(default_handler) {
+  while (1);
+}
+
+void nmi_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void hardfault_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void ecall_m_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void ecall_u_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void breakpoint_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void systick_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void software_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void wwdg_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void pvd_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tamper_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void rtc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void flash_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void rcc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti0_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti3_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti4_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel3_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel4_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel5_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel6_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma1_channel7_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void adc1_2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can1_tx_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can1_rx0_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can1_rx1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can1_sce_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti9_5_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim1_brk_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim1_up_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim1_trg_com_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim1_cc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim3_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim4_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void i2c1_ev_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void i2c1_er_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void i2c2_ev_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void i2c2_er_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void spi1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void spi2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void usart1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void usart2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void usart3_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void exti15_10_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void rtcalarm_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void usbwakeup_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim8_brk_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim8_up_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim8_trg_com_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim8_cc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void rng_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void fsmc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void sdio_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim5_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void spi3_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void uart4_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void uart5_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim6_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim7_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel2_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel3_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel4_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel5_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void eth_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void eth_wkup_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can2_tx_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can2_rx0_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can2_rx1_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void can2_sce_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void otg_fs_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void usbhs_wkup_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void usbhs_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dvp_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void uart6_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void uart7_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void uart8_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim9_brk_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim9_up_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim9_trg_com_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim9_cc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim10_brk_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim10_up_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim10_trg_com_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void tim10_cc_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel6_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel7_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel8_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel9_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel10_irq_handler(void) __attribute__((weak, alias("default_handler")));
+void dma2_channel11_irq_handler(void) __attribute__((weak, alias("default_handler")));
+
+// Absolute handler addresses, mtvec mode 3 (entry 0 is unused: reset enters at _start)
+__attribute__((section(".vector"), aligned(4), used))
+void (*const vector_table[IRQ_COUNT])(void) = {
+  [2] = nmi_irq_handler,
+  [3] = hardfault_irq_handler,
+  [5] = ecall_m_irq_handler,
+  [8] = ecall_u_irq_handler,
+  [9] = breakpoint_irq_handler,
+  [12] = systick_irq_handler,
+  [14] = software_irq_handler,
+  [16] = wwdg_irq_handler,
+  [17] = pvd_irq_handler,
+  [18] = tamper_irq_handler,
+  [19] = rtc_irq_handler,
+  [20] = flash_irq_handler,
+  [21] = rcc_irq_handler,
+  [22] = exti0_irq_handler,
+  [23] = exti1_irq_handler,
+  [24] = exti2_irq_handler,
+  [25] = exti3_irq_handler,
+  [26] = exti4_irq_handler,
+  [27] = dma1_channel1_irq_handler,
+  [28] = dma1_channel2_irq_handler,
+  [29] = dma1_channel3_irq_handler,
+  [30] = dma1_channel4_irq_handler,
+  [31] = dma1_channel5_irq_handler,
+  [32] = dma1_channel6_irq_handler,
+  [33] = dma1_channel7_irq_handler,
+  [34] = adc1_2_irq_handler,
+  [35] = can1_tx_irq_handler,
+  [36] = can1_rx0_irq_handler,
+  [37] = can1_rx1_irq_handler,
+  [38] = can1_sce_irq_handler,
+  [39] = exti9_5_irq_handler,
+  [40] = tim1_brk_irq_handler,
+  [41] = tim1_up_irq_handler,
+  [42] = tim1_trg_com_irq_handler,
+  [43] = tim1_cc_irq_handler,
+  [44] = tim2_irq_handler,
+  [45] = tim3_irq_handler,
+  [46] = tim4_irq_handler,
+  [47] = i2c1_ev_irq_handler,
+  [48] = i2c1_er_irq_handler,
+  [49] = i2c2_ev_irq_handler,
+  [50] = i2c2_er_irq_handler,
+  [51] = spi1_irq_handler,
+  [52] = spi2_irq_handler,
+  [53] = usart1_irq_handler,
+  [54] = usart2_irq_handler,
+  [55] = usart3_irq_handler,
+  [56] = exti15_10_irq_handler,
+  [57] = rtcalarm_irq_handler,
+  [58] = usbwakeup_irq_handler,
+  [59] = tim8_brk_irq_handler,
+  [60] = tim8_up_irq_handler,
+  [61] = tim8_trg_com_irq_handler,
+  [62] = tim8_cc_irq_handler,
+  [63] = rng_irq_handler,
+  [64] = fsmc_irq_handler,
+  [65] = sdio_irq_handler,
+  [66] = tim5_irq_handler,
+  [67] = spi3_irq_handler,
+  [68] = uart4_irq_handler,
+  [69] = uart5_irq_handler,
+  [70] = tim6_irq_handler,
+  [71] = tim7_irq_handler,
+  [72] = dma2_channel1_irq_handler,
+  [73] = dma2_channel2_irq_handler,
+  [74] = dma2_channel3_irq_handler,
+  [75] = dma2_channel4_irq_handler,
+  [76] = dma2_channel5_irq_handler,
+  [77] = eth_irq_handler,
+  [78] = eth_wkup_irq_handler,
+  [79] = can2_tx_irq_handler,
+  [80] = can2_rx0_irq_handler,
+  [81] = can2_rx1_irq_handler,
+  [82] = can2_sce_irq_handler,
+  [83] = otg_fs_irq_handler,
+  [84] = usbhs_wkup_irq_handler,
+  [85] = usbhs_irq_handler,
+  [86] = dvp_irq_handler,
+  [87] = uart6_irq_handler,
+  [88] = uart7_irq_handler,
+  [89] = uart8_irq_handler,
+  [90] = tim9_brk_irq_handler,
+  [91] = tim9_up_irq_handler,
+  [92] = tim9_trg_com_irq_handler,
+  [93] = tim9_cc_irq_handler,
+  [94] = tim10_brk_irq_handler,
+  [95] = tim10_up_irq_handler,
+  [96] = tim10_trg_com_irq_handler,
+  [97] = tim10_cc_irq_handler,
+  [98] = dma2_channel6_irq_handler,
+  [99] = dma2_channel7_irq_handler,
+  [100] = dma2_channel8_irq_handler,
+  [101] = dma2_channel9_irq_handler,
+  [102] = dma2_channel10_irq_handler,
+  [103] = dma2_channel11_irq_handler,
+};
+
+__attribute__((naked, section(".init"))) void _start(void) {
+  __asm__ volatile(
+    ".option push\n"
+    ".option norelax\n"
+    "la gp, __global_pointer$\n"
+    ".option pop\n"
+    "la sp, _estack\n"
+    "j reset_handler\n");
+}
+
+void reset_handler(void) {
+  uint32_t *src = _sidata;
+  uint32_t *dst = _sdata;
+  uint32_t irq;
+
+  while (dst < _edata) {
+    *dst++ = *src++;
+  }
+  for (dst = _sbss; dst < _ebss; dst++) {
+    *dst = 0;
+  }
+
+  __asm__ volatile("csrw mtvec, %0" :: "r"((uint32_t)vector_table | 3));
+  // Every handler starts under the kernel's ceiling; fast ones opt out
+  for (irq = 0; irq < IRQ_COUNT; irq++) {
+    pfic_set_priority(irq, IRQ_CEILING);
+  }
+#ifdef __riscv_flen
+  __asm__ volatile("csrs mstatus, %0" :: "r"(MSTATUS_FS_INITIAL));
+#endif
+
+  main();
+  while (1);
+}
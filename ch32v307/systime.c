@@ -0,0 +1,140 @@
+#include "systime.h"
+
+#include "pfic.h"
+#include "rcc.h"
+
+#define STK_CTLR            (*((volatile uint32_t *)(SYSTICK_BASE + 0x00)))
+#define STK_SR              (*((volatile uint32_t *)(SYSTICK_BASE + 0x04)))
+#define STK_CNTL            (*((volatile uint32_t *)(SYSTICK_BASE + 0x08)))
+#define STK_CNTH            (*((volatile uint32_t *)(SYSTICK_BASE + 0x0C)))
+#define STK_CMPLR           (*((volatile uint32_t *)(SYSTICK_BASE + 0x10)))
+#define STK_CMPHR           (*((volatile uint32_t *)(SYSTICK_BASE + 0x14)))
+#define STK_CTLR_STE        (1 << 0)
+#define STK_CTLR_STIE       (1 << 1)
+#define STK_CTLR_STCLK      (1 << 2)  // HCLK, not HCLK/8
+#define STK_SR_CNTIF        (1 << 0)
+
+static struct {
+  uint64_t offset;              // Ticks SysTick did not count
+  uint32_t tpu;                 // Ticks per microsecond
+  swtimer_list_t timers;
+} st;
+
+
+static uint64_t stk_count(void) {
+  uint32_t hi, lo;
+
+  do {
+    hi = STK_CNTH;
+    lo = STK_CNTL;
+  } while (hi != STK_CNTH);
+  return (uint64_t)hi << 32 | lo;
+}
+
+/**
+ * @brief Points the compare register at the first deadline.
+ *
+ * @details The compare only fires on an exact match, so a deadline the
+ * counter has already passed (or passes while the two halves are written) is
+ * raised by hand instead.
+ */
+static void systime_arm(void) {
+  uint64_t now = stk_count() + st.offset;
+  uint64_t cmp;
+  uint32_t in;
+
+  if (!swtimer_next(&st.timers, now / st.tpu, &in)) {
+    STK_CTLR &= ~STK_CTLR_STIE;
+    return;
+  }
+  cmp = (now / st.tpu + in) * st.tpu - st.offset;
+  STK_CMPLR = 0xFFFFFFFF;
+  STK_CMPHR = cmp >> 32;
+  STK_CMPLR = (uint32_t)cmp;
+  STK_CTLR |= STK_CTLR_STIE;
+  if (stk_count() >= cmp) {
+    pfic_set_pending(SYSTICK_IRQn);
+  }
+}
+
+IRQ_HANDLER_FPU(systick_irq_handler) {
+  STK_SR &= ~STK_SR_CNTIF;
+  swtimer_expire(&st.timers, systime_us());
+  systime_arm();
+}
+
+void systime_init(void) {
+  rcc_clocks_t clocks;
+
+  rcc_get_clocks(&clocks);
+  st.tpu = clocks.hclk / 1000000;
+  st.offset = 0;
+  st.timers = (swtimer_list_t){0};
+  // Up-counting with no reload; a tick someone else started keeps its count
+  STK_CTLR = STK_CTLR_STE | STK_CTLR_STCLK;
+  STK_SR = 0;
+  pfic_enable_irq(SYSTICK_IRQn);
+}
+
+uint64_t systime_ticks(void) {
+  return stk_count() + st.offset;
+}
+
+uint32_t systime_ticks_per_us(void) {
+  return st.tpu;
+}
+
+uint32_t systime_us(void) {
+  return systime_ticks() / st.tpu;
+}
+
+void systime_delay_us(uint32_t us) {
+  uint64_t end = systime_ticks() + (uint64_t)us * st.tpu;
+
+  while (systime_ticks() < end) {
+  }
+}
+
+void systime_delay_ms(uint32_t ms) {
+  systime_delay_us(ms * 1000);
+}
+
+void systime_start(swtimer_t *t, uint32_t delay_us, uint32_t period_us, swtimer_fn_t fn, void *ctx) {
+  pfic_disable_irq(SYSTICK_IRQn);
+  t->due = systime_us() + delay_us;
+  t->period = period_us;
+  t->fn = fn;
+  t->ctx = ctx;
+  swtimer_insert(&st.timers, t);
+  systime_arm();
+  pfic_enable_irq(SYSTICK_IRQn);
+}
+
+void systime_stop(swtimer_t *t) {
+  pfic_disable_irq(SYSTICK_IRQn);
+  swtimer_remove(&st.timers, t);
+  systime_arm();
+  pfic_enable_irq(SYSTICK_IRQn);
+}
+
+bool systime_next(uint32_t *in_us) {
+  bool armed;
+
+  pfic_disable_irq(SYSTICK_IRQn);
+  armed = swtimer_next(&st.timers, systime_us(), in_us);
+  pfic_enable_irq(SYSTICK_IRQn);
+  return armed;
+}
+
+void systime_skip(uint64_t ticks) {
+  st.offset += ticks;
+  systime_arm();
+}
+
+void systime_stats(systime_stats_t *stats) {
+  pfic_disable_irq(SYSTICK_IRQn);
+  stats->fired = st.timers.fired;
+  stats->missed = st.timers.missed;
+  stats->late_max_us = st.timers.late_max;
+  pfic_enable_irq(SYSTICK_IRQn);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "swtimer.h"
+
+
+/**
+ * @brief Monotonic time base and software timers on the core's SysTick.
+ *
+ * @details SysTick counts HCLK upwards through all 64 bits and is never
+ * reloaded, so the STK_CNTL deltas the driver benchmarks take stay valid. Its
+ * compare register holds the earliest timer deadline only: timers cost an
+ * interrupt when one expires and an idle system takes no tick interrupts.
+ * Callbacks run in the SysTick interrupt.
+ *
+ * SysTick stops with HCLK in stop mode. power.c measures the time spent there
+ * on the RTC and adds it back with systime_skip(), so the time and every armed
+ * deadline stay right across stop.
+ *
+ * @note HCLK must be a whole number of MHz and must not change after
+ * systime_init(). Deadlines are at most 2^31 us (35 minutes) ahead.
+ */
+
+typedef struct {
+  uint32_t fired;
+  uint32_t missed;              // Periods skipped by late periodic timers
+  uint32_t late_max_us;         // Deadline to callback, worst case
+} systime_stats_t;
+
+void systime_init(void);
+
+// HCLK cycles since SysTick started, time in stop mode included
+uint64_t systime_ticks(void);
+uint32_t systime_ticks_per_us(void);
+// Wraps every 71 minutes; compare differences
+uint32_t systime_us(void);
+
+// Busy-waits on SysTick, so no timer has to be kept running for it; call after
+// systime_init()
+void systime_delay_us(uint32_t us);
+void systime_delay_ms(uint32_t ms);
+
+/**
+ * @brief Arms t to call fn(ctx) delay_us from now, then every period_us (0:
+ * once). Restarting an armed timer moves it.
+ *
+ * @details Callable from thread context, from timer callbacks and from
+ * handlers SysTick cannot be running under (at its priority or below).
+ */
+void systime_start(swtimer_t *t, uint32_t delay_us, uint32_t period_us, swtimer_fn_t fn, void *ctx);
+void systime_stop(swtimer_t *t);
+
+// Time until the next deadline; false if no timer is armed
+bool systime_next(uint32_t *in_us);
+
+// Adds time SysTick did not count (HCLK was stopped); interrupts disabled
+void systime_skip(uint64_t ticks);
+
+void systime_stats(systime_stats_t *stats);
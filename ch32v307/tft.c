@@ -0,0 +1,107 @@
+#include "tft.h"
+
+#include <stddef.h>
+
+#include "gpio.h"
+#include "systime.h"
+
+#define TFT_SWRESET         0x01
+#define TFT_SLPOUT          0x11
+#define TFT_DISPON          0x29
+#define TFT_CASET           0x2A
+#define TFT_RASET           0x2B
+#define TFT_RAMWR           0x2C
+#define TFT_MADCTL          0x36
+#define TFT_COLMOD          0x3A
+
+
+static void tft_dc_command(spi_xfer_t *x) {
+  tft_t *tft = x->ctx;
+
+  GPIO_BSHR(tft->dc_port) = 1u << (tft->dc_pin + 16);
+}
+
+static void tft_dc_data(spi_xfer_t *x) {
+  tft_t *tft = x->ctx;
+
+  GPIO_BSHR(tft->dc_port) = 1u << tft->dc_pin;
+}
+
+static void tft_pixels_done(spi_xfer_t *x) {
+  tft_t *tft = x->ctx;
+
+  gfx_write_done(tft->gfx, x->tx);
+}
+
+static void tft_command(tft_t *tft, uint8_t cmd, const uint8_t *data, uint32_t len) {
+  GPIO_BSHR(tft->dc_port) = 1u << (tft->dc_pin + 16);
+  spi_transfer_polled(&tft->dev, &cmd, NULL, 1);
+  GPIO_BSHR(tft->dc_port) = 1u << tft->dc_pin;
+  if (len) {
+    spi_transfer_polled(&tft->dev, data, NULL, len);
+  }
+}
+
+void tft_init(tft_t *tft) {
+  uint8_t colmod = 0x55; // 16 bits per pixel
+
+  spi_device_init(&tft->dev);
+  tft->next_slot = 0;
+  tft_command(tft, TFT_SWRESET, NULL, 0);
+  systime_delay_ms(150);
+  tft_command(tft, TFT_SLPOUT, NULL, 0);
+  systime_delay_ms(10);
+  tft_command(tft, TFT_COLMOD, &colmod, 1);
+  tft_command(tft, TFT_MADCTL, &tft->madctl, 1);
+  tft_command(tft, TFT_DISPON, NULL, 0);
+}
+
+static void tft_xfer(tft_t *tft, spi_xfer_t *x, const void *data, uint16_t len, bool command) {
+  x->dev = &tft->dev;
+  x->tx = data;
+  x->rx = NULL;
+  x->len = len;
+  x->keep_cs = true;
+  x->start = command ? tft_dc_command : tft_dc_data;
+  x->done = NULL;
+  x->ctx = tft;
+}
+
+static void tft_write(void *ctx, const gfx_rect_t *r, const uint16_t *px, uint32_t count) {
+  tft_t *tft = ctx;
+  tft_slot_t *s = &tft->slot[tft->next_slot];
+  uint16_t x1 = r->x + r->w - 1;
+  uint16_t y1 = r->y + r->h - 1;
+  uint32_t n = 0, i;
+
+  tft->next_slot ^= 1;
+  s->cmd[0] = TFT_CASET;
+  s->cmd[1] = TFT_RASET;
+  s->cmd[2] = TFT_RAMWR;
+  s->caset[0] = r->x >> 8;
+  s->caset[1] = r->x;
+  s->caset[2] = x1 >> 8;
+  s->caset[3] = x1;
+  s->raset[0] = r->y >> 8;
+  s->raset[1] = r->y;
+  s->raset[2] = y1 >> 8;
+  s->raset[3] = y1;
+
+  tft_xfer(tft, &s->xfer[n++], &s->cmd[0], 1, true);
+  tft_xfer(tft, &s->xfer[n++], s->caset, 4, false);
+  tft_xfer(tft, &s->xfer[n++], &s->cmd[1], 1, true);
+  tft_xfer(tft, &s->xfer[n++], s->raset, 4, false);
+  tft_xfer(tft, &s->xfer[n++], &s->cmd[2], 1, true);
+  tft_xfer(tft, &s->xfer[n++], px, count * 2, false);
+  s->xfer[n - 1].keep_cs = false;
+  s->xfer[n - 1].done = tft_pixels_done;
+
+  for (i = 0; i < n; i++) {
+    spi_submit(&s->xfer[i]);
+  }
+}
+
+void tft_panel(tft_t *tft, gfx_panel_t *panel) {
+  panel->write = tft_write;
+  panel->ctx = tft;
+}
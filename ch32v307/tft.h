@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "gfx.h"
+#include "spi.h"
+
+
+/**
+ * @brief MIPI-DCS SPI TFT panel (ST7789/ILI9341 family) as a gfx_panel_t.
+ *
+ * @details Each gfx burst is queued on the SPI bus as CASET + RASET + RAMWR and
+ * the pixel data, with the D/C line switched from the transfers' start hooks, so
+ * a whole tile goes out without CPU involvement after gfx_poll() queues it. Two
+ * bursts can be queued at once, matching the two gfx tile buffers.
+ *
+ * @note The SPI bus must be initialised with spi_init() and the D/C, CS and reset
+ * pins configured as push-pull outputs by the caller. tft_init() waits with
+ * systime_delay_ms(), so systime_init() must come first. A burst is one DMA
+ * transfer, so gfx tile buffers must hold at most 32767 pixels.
+ */
+
+#define TFT_XFERS           6
+
+typedef struct {
+  spi_xfer_t xfer[TFT_XFERS];
+  uint8_t cmd[3];
+  uint8_t caset[4];
+  uint8_t raset[4];
+} tft_slot_t;
+
+typedef struct {
+  spi_device_t dev;
+  uint32_t dc_port;
+  uint8_t dc_pin;
+  uint8_t madctl;       // Memory access control (rotation, RGB/BGR)
+  gfx_t *gfx;
+  tft_slot_t slot[2];
+  uint8_t next_slot;
+} tft_t;
+
+void tft_init(tft_t *tft);
+void tft_panel(tft_t *tft, gfx_panel_t *panel);
@@ -1,8 +0,0 @@
-#pragma once
-
-#include <inttypes.h>
-#include "mem_mapping.h"
-
-void tim2_init();
-void delay_ms(uint32_t ms);
-
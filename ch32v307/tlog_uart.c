@@ -0,0 +1,63 @@
+#include "tlog_uart.h"
+
+#include <stddef.h>
+
+#include "bitops.h"
+#include "systime.h"
+#include "usart.h"
+
+static struct {
+  uint32_t port;
+  const void *span;         // In flight, as passed to usart_write()
+  uint32_t draining;        // Bit 0: a drain is running
+  swtimer_t timer;
+} tu;
+
+
+static bool tlog_uart_send(void *ctx, const void *data, uint32_t len) {
+  uint32_t port = (uint32_t)(uintptr_t)ctx;
+
+  if (len > 0xFFFF) {
+    return false;
+  }
+  // Set first: the DMA may be done before usart_write() returns
+  tu.span = data;
+  if (!usart_write(port, data, len)) {
+    tu.span = NULL;
+    return false;
+  }
+  return true;
+}
+
+static void tlog_uart_drain(void) {
+  if (bits_set(&tu.draining, 1)) {
+    return;
+  }
+  tlog_drain(tlog_uart_send, (void *)(uintptr_t)tu.port);
+  bits_clear(&tu.draining, 1);
+}
+
+static void tlog_uart_tick(void *ctx) {
+  (void)ctx;
+  tlog_uart_drain();
+}
+
+void tlog_uart_start(uint32_t port, uint32_t period_us) {
+  tu.port = port;
+  tu.span = NULL;
+  tu.draining = 0;
+  systime_start(&tu.timer, period_us, period_us, tlog_uart_tick, NULL);
+}
+
+void tlog_uart_stop(void) {
+  systime_stop(&tu.timer);
+}
+
+void tlog_uart_tx_done(uint32_t port, const void *data) {
+  if (port != tu.port || !data || data != tu.span) {
+    return;
+  }
+  tu.span = NULL;
+  tlog_sent();
+  tlog_uart_drain();
+}
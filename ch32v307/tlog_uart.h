@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "tlog.h"
+
+
+/**
+ * @brief Background drain of the lib/tlog.h ring over a USART's TX DMA.
+ *
+ * @details Each span goes out with usart_write() straight from the ring. When
+ * its DMA completes, tlog_uart_tx_done() releases it with tlog_sent() and hands
+ * over the next span from the same interrupt, so a busy log streams with no
+ * thread involvement. A periodic SysTick timer starts the stream again after
+ * the ring has run dry. The port may carry other writes too; its on_tx_done
+ * passes every segment on and tlog_uart_tx_done() ignores the ones that are
+ * not its own.
+ *
+ * The timer and the DMA interrupt may preempt each other, so a drain that
+ * finds another one running returns at once and leaves the records to that
+ * one or to the next tick.
+ */
+
+// Drains to port, already set up by usart_init(), checking every period_us
+void tlog_uart_start(uint32_t port, uint32_t period_us);
+void tlog_uart_stop(void);
+
+// The port's on_tx_done, or called from it with every segment
+void tlog_uart_tx_done(uint32_t port, const void *data);
@@ -0,0 +1,82 @@
+#include "update.h"
+
+#include <stddef.h>
+
+static struct {
+  delta_t delta;
+  uint32_t slot;        // Being written
+  bool active;
+  uint32_t trailer[FLASH_PAGE / 4];
+} up;
+
+
+uint32_t update_running(void) {
+  return (uint32_t)update_running >= (uint32_t)_slot_b;
+}
+
+static bool blank(const uint32_t *w) {
+  uint32_t i;
+
+  for (i = 0; i < FLASH_PAGE / 4; i++) {
+    if (w[i] != FLASH_ERASED) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// page is the applier's whole DELTA_PAGE buffer, so a short last page programs as is
+static bool slot_write(void *ctx, uint32_t off, const void *page, uint32_t len) {
+  uint32_t addr = (uint32_t)slot_base(up.slot) + off;
+
+  (void)ctx;
+  (void)len;
+  if (off + FLASH_PAGE > slot_capacity()) {
+    return false;
+  }
+  if (!blank((const uint32_t *)addr) && !flash_erase(addr, FLASH_PAGE)) {
+    return false;
+  }
+  return flash_program_page(addr, page);
+}
+
+bool update_begin(void) {
+  uint32_t run = update_running();
+
+  up.active = false;
+  up.slot = !run;
+  if (!flash_erase((uint32_t)slot_trailer(up.slot), FLASH_PAGE)) {
+    return false;
+  }
+  delta_init(&up.delta, slot_base(run), slot_capacity(), slot_write, crc_hw_update, NULL);
+  up.active = true;
+  return true;
+}
+
+bool update_feed(const void *buf, uint32_t len) {
+  return up.active && delta_feed(&up.delta, buf, len);
+}
+
+bool update_finish(void) {
+  const image_trailer_t *cur = slot_trailer(!up.slot);
+  image_trailer_t *t = (image_trailer_t *)up.trailer;
+  uint32_t i;
+
+  if (!up.active || !delta_done(&up.delta)) {
+    return false;
+  }
+  up.active = false;
+  // What is in flash, not what was sent to it
+  if (crc_hw_update(0, slot_base(up.slot), up.delta.new_size) != up.delta.new_crc) {
+    return false;
+  }
+  for (i = 0; i < FLASH_PAGE / 4; i++) {
+    up.trailer[i] = FLASH_ERASED;
+  }
+  t->magic = IMAGE_MAGIC;
+  t->seq = (trailer_ok(cur) ? cur->seq : 0) + 1;
+  t->size = up.delta.new_size;
+  t->crc = up.delta.new_crc;
+  t->trailer_crc = crc_hw_update(0, t, 16);
+  return flash_program_page((uint32_t)slot_trailer(up.slot), up.trailer);
+}
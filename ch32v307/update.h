@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "crc.h"
+#include "delta.h"
+#include "flash.h"
+
+/**
+ * @brief A/B firmware slots and the in-application update agent.
+ *
+ * @details The application runs from one of two slots (ld/ch32v307.ld) and is
+ * linked for it (make SLOT=A or SLOT=B). An update is a delta patch
+ * (lib/delta.h, made by tools/delta.c) from the image in the running slot to
+ * one linked for the other slot:
+ *  - update_begin() erases the other slot's trailer, so it cannot boot;
+ *  - update_feed() takes patch bytes as they arrive and programs the new image
+ *    page by page, erasing each page just before, so no call blocks for long;
+ *  - update_finish() reads the slot back through the CRC unit and programs
+ *    the trailer that makes it bootable.
+ *
+ * The trailer, in the last page of a slot, carries a sequence number and the
+ * bootloader (boot/boot.c) starts the valid slot with the highest one. That
+ * one CRC-checked page program is the switch: after a power loss either the
+ * old or the new image is selected, never a mix.
+ */
+
+#define IMAGE_MAGIC         0x474D4941  // "AIMG"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t seq;             // The valid slot with the highest one boots
+  uint32_t size;            // Image bytes from the slot base
+  uint32_t crc;             // zlib CRC-32 of the image
+  uint32_t trailer_crc;     // Of the fields above
+} image_trailer_t;
+
+extern uint8_t _slot_a[], _slot_b[], _slot_size[];
+
+static inline uint8_t *slot_base(uint32_t slot) {
+  return slot ? _slot_b : _slot_a;
+}
+
+// Room for the image: the slot less its trailer page
+static inline uint32_t slot_capacity(void) {
+  return (uint32_t)_slot_size - FLASH_PAGE;
+}
+
+static inline const image_trailer_t *slot_trailer(uint32_t slot) {
+  return (const image_trailer_t *)(slot_base(slot) + slot_capacity());
+}
+
+static inline bool trailer_ok(const image_trailer_t *t) {
+  return t->magic == IMAGE_MAGIC && t->size <= slot_capacity() &&
+    crc_hw_update(0, t, 16) == t->trailer_crc;
+}
+
+// Trailer and image both check out
+static inline bool image_valid(uint32_t slot) {
+  const image_trailer_t *t = slot_trailer(slot);
+
+  return trailer_ok(t) && crc_hw_update(0, slot_base(slot), t->size) == t->crc;
+}
+
+// Slot this code was linked for and runs from
+uint32_t update_running(void);
+
+bool update_begin(void);
+// False once the patch turns out bad; start over with update_begin()
+bool update_feed(const void *buf, uint32_t len);
+bool update_finish(void);
@@ -0,0 +1,245 @@
+#include "usart.h"
+
+#include <stddef.h>
+
+#include "dma.h"
+#include "pfic.h"
+#include "rcc.h"
+
+
+static const struct {
+  uint32_t base;
+  uint8_t clock;
+  uint8_t irq;
+  uint8_t rx_dma;
+  uint8_t tx_dma;
+} ports[USART_PORTS] = {
+  {USART1, RCC_USART1, USART1_IRQn, DMA1_CH(5),  DMA1_CH(4)},
+  {UART2,  RCC_USART2, USART2_IRQn, DMA1_CH(6),  DMA1_CH(7)},
+  {UART3,  RCC_USART3, USART3_IRQn, DMA1_CH(3),  DMA1_CH(2)},
+  {UART4,  RCC_UART4,  UART4_IRQn,  DMA2_CH(3),  DMA2_CH(5)},
+  {UART5,  RCC_UART5,  UART5_IRQn,  DMA2_CH(2),  DMA2_CH(4)},
+  {UART6,  RCC_UART6,  UART6_IRQn,  DMA2_CH(7),  DMA2_CH(6)},
+  {UART7,  RCC_UART7,  UART7_IRQn,  DMA2_CH(9),  DMA2_CH(8)},
+  {UART8,  RCC_UART8,  UART8_IRQn,  DMA2_CH(11), DMA2_CH(10)},
+};
+
+typedef struct {
+  rxring_t rx;
+  usart_seg_t txq[USART_TXQ_LEN];
+  volatile uint32_t tx_head;
+  volatile uint32_t tx_tail;
+  volatile bool tx_busy;
+  uint32_t port;
+  void (*on_rx)(uint32_t port);
+  void (*on_tx_done)(uint32_t port, const void *data);
+  bool clocked;
+} usart_state_t;
+
+static usart_state_t state[USART_PORTS];
+
+#define USARTx(i)           ((USART_TypeDef *)ports[i].base)
+
+
+static void usart_tx_start(uint32_t i) {
+  usart_state_t *s = &state[i];
+  DMA_Channel_TypeDef *ch = dma_channel(ports[i].tx_dma);
+  usart_seg_t *seg;
+
+  if (s->tx_tail == s->tx_head) {
+    s->tx_busy = false;
+    return;
+  }
+  seg = &s->txq[s->tx_tail & (USART_TXQ_LEN - 1)];
+  s->tx_busy = true;
+  ch->CFGR &= ~DMA_CFGR_EN;
+  ch->MADDR = (uint32_t)seg->data;
+  ch->CNTR = seg->len;
+  ch->CFGR |= DMA_CFGR_EN;
+}
+
+static void usart_tx_dma(void *ctx, uint32_t flags) {
+  uint32_t i = (uint32_t)ctx;
+  usart_state_t *s = &state[i];
+  const void *data;
+
+  if (!(flags & (DMA_FLAG_TCIF | DMA_FLAG_TEIF))) {
+    return;
+  }
+  data = s->txq[s->tx_tail & (USART_TXQ_LEN - 1)].data;
+  s->tx_tail++;
+  if (s->on_tx_done) {
+    s->on_tx_done(s->port, data);
+  }
+  usart_tx_start(i);
+}
+
+static void usart_rx_sample(uint32_t i) {
+  rxring_t *r = &state[i].rx;
+
+  rxring_advance(r, r->mask + 1 - dma_remaining(ports[i].rx_dma));
+}
+
+static void usart_rx_dma(void *ctx, uint32_t flags) {
+  (void)flags;
+  usart_rx_sample((uint32_t)ctx);
+}
+
+static void usart_irq(uint32_t i) {
+  USART_TypeDef *u = USARTx(i);
+  usart_state_t *s = &state[i];
+  uint32_t sr = u->STATR;
+
+  if (sr & (USART_STATR_IDLE | USART_STATR_ORE)) {
+    (void)u->DATAR; // STATR then DATAR read clears IDLE/ORE
+    usart_rx_sample(i);
+    if (rxring_commit(&s->rx) && s->on_rx) {
+      s->on_rx(s->port);
+    }
+  }
+}
+
+bool usart_set_baud(uint32_t port, uint32_t baud) {
+  rcc_clocks_t clocks;
+  uint32_t i = port - 1;
+  uint32_t pclk;
+
+  if (i >= USART_PORTS || baud == 0) {
+    return false;
+  }
+  rcc_get_clocks(&clocks);
+  pclk = RCC_BUS(ports[i].clock) == RCC_APB2 ? clocks.pclk2 : clocks.pclk1;
+  if (pclk / baud < 16) {
+    return false;
+  }
+  USARTx(i)->BRR = (pclk + baud / 2) / baud;
+  return true;
+}
+
+bool usart_init(uint32_t port, const usart_config_t *cfg) {
+  uint32_t i = port - 1;
+  usart_state_t *s;
+  USART_TypeDef *u;
+  DMA_Channel_TypeDef *rx, *tx;
+
+  if (i >= USART_PORTS || cfg->rx_size < 2 || (cfg->rx_size & (cfg->rx_size - 1))) {
+    return false;
+  }
+  s = &state[i];
+  u = USARTx(i);
+
+  if (!s->clocked) {
+    rcc_clock_acquire(ports[i].clock);
+    s->clocked = true;
+  }
+  u->CTLR1 = 0;
+  if (!usart_set_baud(port, cfg->baud)) {
+    return false;
+  }
+
+  rxring_init(&s->rx, cfg->rx_buf, cfg->rx_size);
+  s->tx_head = 0;
+  s->tx_tail = 0;
+  s->tx_busy = false;
+  s->port = port;
+  s->on_rx = cfg->on_rx;
+  s->on_tx_done = cfg->on_tx_done;
+
+  // A port whose channels another driver holds cannot run
+  if (!dma_attach(ports[i].rx_dma, usart_rx_dma, (void *)i)) {
+    return false;
+  }
+  if (!dma_attach(ports[i].tx_dma, usart_tx_dma, (void *)i)) {
+    dma_detach(ports[i].rx_dma, usart_rx_dma, (void *)i);
+    return false;
+  }
+  rx = dma_channel(ports[i].rx_dma);
+  rx->CFGR = 0;
+  rx->PADDR = (uint32_t)&u->DATAR;
+  rx->MADDR = (uint32_t)cfg->rx_buf;
+  rx->CNTR = cfg->rx_size;
+  rx->CFGR = DMA_CFGR_MINC | DMA_CFGR_CIRC | DMA_CFGR_HTIE | DMA_CFGR_TCIE |
+             DMA_CFGR_PL(3) | DMA_CFGR_EN;
+
+  tx = dma_channel(ports[i].tx_dma);
+  tx->CFGR = 0;
+  tx->PADDR = (uint32_t)&u->DATAR;
+  tx->CFGR = DMA_CFGR_DIR | DMA_CFGR_MINC | DMA_CFGR_TCIE | DMA_CFGR_TEIE | DMA_CFGR_PL(1);
+
+  u->CTLR3 = USART_CTLR3_DMAR | USART_CTLR3_DMAT;
+  u->CTLR1 = USART_CTLR1_UE | USART_CTLR1_TE | USART_CTLR1_RE | USART_CTLR1_IDLEIE;
+  pfic_enable_irq(ports[i].irq);
+  return true;
+}
+
+bool usart_writev(uint32_t port, const usart_seg_t *segs, uint32_t count) {
+  uint32_t i = port - 1;
+  usart_state_t *s = &state[i];
+  uint32_t irq, head, n;
+
+  if (i >= USART_PORTS) {
+    return false;
+  }
+  irq = dma_irq(ports[i].tx_dma);
+  head = s->tx_head;
+  if (USART_TXQ_LEN - (head - s->tx_tail) < count) {
+    return false;
+  }
+  for (n = 0; n < count; n++) {
+    if (segs[n].len) {
+      s->txq[head++ & (USART_TXQ_LEN - 1)] = segs[n];
+    }
+  }
+  __asm__ volatile("" ::: "memory");
+  s->tx_head = head;
+
+  // The DMA completion interrupt chains segments; only kick an idle channel
+  pfic_disable_irq(irq);
+  if (!s->tx_busy) {
+    usart_tx_start(i);
+  }
+  pfic_enable_irq(irq);
+  return true;
+}
+
+bool usart_write(uint32_t port, const void *data, uint16_t len) {
+  usart_seg_t seg = {data, len};
+
+  return usart_writev(port, &seg, 1);
+}
+
+bool usart_tx_busy(uint32_t port) {
+  return state[port - 1].tx_busy;
+}
+
+bool usart_rx_peek(uint32_t port, rxring_msg_t *msg) {
+  return rxring_peek(&state[port - 1].rx, msg);
+}
+
+bool usart_rx_release(uint32_t port) {
+  uint32_t i = port - 1;
+  uint32_t dma = dma_irq(ports[i].rx_dma);
+  bool intact;
+
+  // Take a fresh DMA position so a lap during processing is not missed
+  pfic_disable_irq(ports[i].irq);
+  pfic_disable_irq(dma);
+  usart_rx_sample(i);
+  intact = rxring_release(&state[i].rx);
+  pfic_enable_irq(dma);
+  pfic_enable_irq(ports[i].irq);
+  return intact;
+}
+
+uint32_t usart_rx_overruns(uint32_t port) {
+  return state[port - 1].rx.overruns;
+}
+
+IRQ_HANDLER_FPU(usart1_irq_handler) { usart_irq(0); }
+IRQ_HANDLER_FPU(usart2_irq_handler) { usart_irq(1); }
+IRQ_HANDLER_FPU(usart3_irq_handler) { usart_irq(2); }
+IRQ_HANDLER_FPU(uart4_irq_handler)  { usart_irq(3); }
+IRQ_HANDLER_FPU(uart5_irq_handler)  { usart_irq(4); }
+IRQ_HANDLER_FPU(uart6_irq_handler)  { usart_irq(5); }
+IRQ_HANDLER_FPU(uart7_irq_handler)  { usart_irq(6); }
+IRQ_HANDLER_FPU(uart8_irq_handler)  { usart_irq(7); }
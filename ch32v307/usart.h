@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+#include "rxring.h"
+
+
+/**
+ * @brief USART/UART register block (USART1, UART2-UART8)
+ *
+ * @details USART1 sits on APB2 (clock enable RCC_APB2ENR bit 14), UART2-UART5 on
+ * APB1 (bits 17-20) and UART6-UART8 on APB1 (bits 6-8). With 16x oversampling
+ * BRR holds PCLK / baud as a 12.4 fixed-point value.
+ *
+ * Bit fields of STATR:
+ * - Bit 0 : PE    - Parity error
+ * - Bit 1 : FE    - Framing error
+ * - Bit 2 : NE    - Noise error
+ * - Bit 3 : ORE   - Overrun error
+ * - Bit 4 : IDLE  - Idle line detected (cleared by reading STATR then DATAR)
+ * - Bit 5 : RXNE  - Receive data register not empty
+ * - Bit 6 : TC    - Transmission complete
+ * - Bit 7 : TXE   - Transmit data register empty
+ *
+ * Bit fields of CTLR1:
+ * - Bit 2  : RE      - Receiver enable
+ * - Bit 3  : TE      - Transmitter enable
+ * - Bit 4  : IDLEIE  - Idle interrupt enable
+ * - Bit 5  : RXNEIE  - RXNE interrupt enable
+ * - Bit 13 : UE      - USART enable
+ *
+ * Bit fields of CTLR3:
+ * - Bit 0 : EIE   - Error interrupt enable
+ * - Bit 6 : DMAR  - DMA receive enable
+ * - Bit 7 : DMAT  - DMA transmit enable
+ *
+ * @note The driver does not configure pins: TX must be set to alternate function
+ * push-pull and RX to floating input (plus AFIO remap if needed) by the caller.
+ */
+typedef struct {
+  volatile uint32_t STATR;
+  volatile uint32_t DATAR;
+  volatile uint32_t BRR;
+  volatile uint32_t CTLR1;
+  volatile uint32_t CTLR2;
+  volatile uint32_t CTLR3;
+  volatile uint32_t GPR;
+} USART_TypeDef;
+
+#define USART_STATR_ORE     (1 << 3)
+#define USART_STATR_IDLE    (1 << 4)
+#define USART_CTLR1_RE      (1 << 2)
+#define USART_CTLR1_TE      (1 << 3)
+#define USART_CTLR1_IDLEIE  (1 << 4)
+#define USART_CTLR1_UE      (1 << 13)
+#define USART_CTLR3_DMAR    (1 << 6)
+#define USART_CTLR3_DMAT    (1 << 7)
+
+#define USART_PORTS         8  // Ports are numbered 1 (USART1) to 8 (UART8)
+#define USART_TXQ_LEN       8  // Queued TX segments per port, power of two
+
+typedef struct {
+  const void *data;
+  uint16_t len;
+} usart_seg_t;
+
+typedef struct {
+  uint32_t baud;
+  uint8_t *rx_buf;                // DMA ring, power-of-two size
+  uint32_t rx_size;
+  void (*on_rx)(uint32_t port);   // ISR context: a message is ready to peek
+  void (*on_tx_done)(uint32_t port, const void *data); // ISR context
+} usart_config_t;
+
+// False if the DMA channels belong to another driver (UART4/5 share with DAC and SDIO)
+bool usart_init(uint32_t port, const usart_config_t *cfg);
+bool usart_set_baud(uint32_t port, uint32_t baud);
+
+// Segments are sent back to back by DMA; the memory must stay valid until
+// on_tx_done reports it. A gather list is queued entirely or not at all.
+bool usart_writev(uint32_t port, const usart_seg_t *segs, uint32_t count);
+bool usart_write(uint32_t port, const void *data, uint16_t len);
+bool usart_tx_busy(uint32_t port);
+
+// Messages are delimited by the idle line and returned as spans into rx_buf.
+bool usart_rx_peek(uint32_t port, rxring_msg_t *msg);
+bool usart_rx_release(uint32_t port);
+uint32_t usart_rx_overruns(uint32_t port);
@@ -0,0 +1,166 @@
+#include "usb_cdc.h"
+
+#include <stddef.h>
+
+#define ESIG_UNIID          ((const volatile uint32_t *)0x1FFFF7E8) // 96-bit unique ID
+
+// CDC class requests
+#define CDC_SET_LINE_CODING 0x20
+#define CDC_GET_LINE_CODING 0x21
+#define CDC_SET_LINE_STATE  0x22
+#define CDC_SEND_BREAK      0x23
+
+#define LE16(x)             ((x) & 0xFF), ((x) >> 8)
+
+static const uint8_t device_desc[18] = {
+  18, 1, LE16(0x0200),
+  0xEF, 0x02, 0x01,     // Miscellaneous / IAD
+  USBHS_EP0_SIZE,
+  LE16(USB_VID), LE16(USB_PID), LE16(0x0100),
+  1, 2, 3,              // Manufacturer, product, serial strings
+  1,
+};
+
+#define CONFIG_LEN          98
+
+static const uint8_t config_desc[CONFIG_LEN] = {
+  9, 2, LE16(CONFIG_LEN), 3, 1, 0, 0x80, 250,   // 3 interfaces, bus powered, 500 mA
+  // Interface association: CDC control + data
+  8, 11, 0, 2, 0x02, 0x02, 0x01, 0,
+  // Interface 0: CDC communication, ACM
+  9, 4, 0, 0, 1, 0x02, 0x02, 0x01, 0,
+  5, 0x24, 0x00, LE16(0x0110),                  // Header
+  5, 0x24, 0x01, 0x00, 1,                       // Call management: data on interface 1
+  4, 0x24, 0x02, 0x02,                          // ACM: line coding and state
+  5, 0x24, 0x06, 0, 1,                          // Union: 0 controls 1
+  7, 5, USB_CDC_NOTIFY, 0x03, LE16(16), 8,      // Interrupt IN, 16 bytes, 16 ms at HS
+  // Interface 1: CDC data
+  9, 4, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+  7, 5, USB_CDC_OUT, 0x02, LE16(512), 0,
+  7, 5, USB_CDC_IN, 0x02, LE16(512), 0,
+  // Interface 2: vendor bulk
+  9, 4, 2, 0, 2, 0xFF, 0x00, 0x00, 0,
+  7, 5, USB_BULK_OUT, 0x02, LE16(512), 0,
+  7, 5, USB_BULK_IN, 0x02, LE16(512), 0,
+};
+
+#define STRING_DESC(name, str)                                                \
+  static const struct {                                                       \
+    uint8_t len;                                                              \
+    uint8_t type;                                                             \
+    uint16_t s[sizeof(u"" str) / 2 - 1];                                      \
+  } __attribute__((packed)) name = {sizeof(name), 3, u"" str}
+
+static const uint8_t lang_desc[4] = {4, 3, LE16(0x0409)};
+STRING_DESC(manufacturer_desc, "ch32v307");
+STRING_DESC(product_desc, "CH32V307 CDC + bulk");
+
+static uint8_t serial_desc[2 + 2 * 24];
+
+static const uint8_t *strings[4] = {
+  lang_desc,
+  (const uint8_t *)&manufacturer_desc,
+  (const uint8_t *)&product_desc,
+  serial_desc,
+};
+
+static struct {
+  usb_cdc_config_t cfg;
+  usb_line_coding_t coding;
+  bool dtr;
+} cdc;
+
+
+static void cdc_configured(bool on) {
+  uint16_t mps = usb_cdc_packet();
+
+  if (on) {
+    usbhs_ep_open(USB_CDC_NOTIFY, 16, false, cdc.cfg.done, cdc.cfg.ctx);
+    usbhs_ep_open(USB_CDC_IN, mps, true, cdc.cfg.done, cdc.cfg.ctx);
+    usbhs_ep_open(USB_CDC_OUT, mps, false, cdc.cfg.done, cdc.cfg.ctx);
+    usbhs_ep_open(USB_BULK_IN, mps, false, cdc.cfg.done, cdc.cfg.ctx);
+    usbhs_ep_open(USB_BULK_OUT, mps, false, cdc.cfg.done, cdc.cfg.ctx);
+  } else {
+    cdc.dtr = false;
+  }
+  if (cdc.cfg.on_state) {
+    cdc.cfg.on_state(on);
+  }
+}
+
+static bool cdc_request(const usb_setup_t *s, uint8_t *buf, uint16_t *len) {
+  // Class requests to the CDC control interface only
+  if ((s->bmRequestType & 0x7F) != 0x21 || (s->wIndex & 0xFF) != 0) {
+    return false;
+  }
+  switch (s->bRequest) {
+    case CDC_SET_LINE_CODING:
+      if (*len != 7) {
+        return false;
+      }
+      cdc.coding.baud = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+      cdc.coding.stop_bits = buf[4];
+      cdc.coding.parity = buf[5];
+      cdc.coding.data_bits = buf[6];
+      break;
+    case CDC_GET_LINE_CODING:
+      buf[0] = cdc.coding.baud;
+      buf[1] = cdc.coding.baud >> 8;
+      buf[2] = cdc.coding.baud >> 16;
+      buf[3] = cdc.coding.baud >> 24;
+      buf[4] = cdc.coding.stop_bits;
+      buf[5] = cdc.coding.parity;
+      buf[6] = cdc.coding.data_bits;
+      *len = 7;
+      return true;
+    case CDC_SET_LINE_STATE:
+      cdc.dtr = s->wValue & 1;
+      break;
+    case CDC_SEND_BREAK:
+      return true;
+    default:
+      return false;
+  }
+  if (cdc.cfg.on_line) {
+    cdc.cfg.on_line(&cdc.coding, cdc.dtr);
+  }
+  return true;
+}
+
+static const usbhs_class_t cdc_class = {
+  device_desc,
+  config_desc,
+  strings,
+  4,
+  cdc_configured,
+  cdc_request,
+};
+
+void usb_cdc_init(const usb_cdc_config_t *cfg) {
+  static const char hex[] = "0123456789ABCDEF";
+  uint32_t i, w;
+
+  cdc.cfg = *cfg;
+  cdc.coding.baud = 115200;
+  cdc.coding.stop_bits = 0;
+  cdc.coding.parity = 0;
+  cdc.coding.data_bits = 8;
+  cdc.dtr = false;
+
+  serial_desc[0] = sizeof(serial_desc);
+  serial_desc[1] = 3;
+  for (i = 0; i < 24; i++) {
+    w = ESIG_UNIID[i / 8];
+    serial_desc[2 + 2 * i] = hex[(w >> (28 - 4 * (i % 8))) & 0xF];
+    serial_desc[3 + 2 * i] = 0;
+  }
+  usbhs_init(&cdc_class);
+}
+
+uint16_t usb_cdc_packet(void) {
+  return usbhs_high_speed() ? 512 : 64;
+}
+
+bool usb_cdc_dtr(void) {
+  return cdc.dtr;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "usbhs.h"
+
+
+/**
+ * @brief Composite USBHS device: CDC-ACM serial port plus a vendor bulk pipe.
+ *
+ * @details The serial port enumerates as /dev/ttyACMx (interfaces 0-1, grouped
+ * by an interface association), the vendor interface (2) is claimed from user
+ * space through libusb; tools/usb_bench.c measures both.
+ *
+ * Data moves through usbhs_ep_submit() on the endpoints below, zero-copy and up
+ * to two transfers queued per endpoint, so a stream keeps the bus busy by
+ * resubmitting from the completion callback. OUT transfers must be a multiple
+ * of usb_cdc_packet() bytes.
+ */
+
+#ifndef USB_VID
+#define USB_VID             0x1209  // pid.codes test VID/PID, replace for products
+#define USB_PID             0x0001
+#endif
+
+#define USB_CDC_NOTIFY      0x83
+#define USB_CDC_IN          0x81
+#define USB_CDC_OUT         0x01
+#define USB_BULK_IN         0x82
+#define USB_BULK_OUT        0x02
+
+typedef struct {
+  uint32_t baud;
+  uint8_t stop_bits;    // 0: 1, 1: 1.5, 2: 2
+  uint8_t parity;       // 0: none, 1: odd, 2: even
+  uint8_t data_bits;
+} usb_line_coding_t;
+
+typedef struct {
+  usbhs_done_t done;    // Completion of every endpoint above, ISR context
+  void *ctx;
+  void (*on_state)(bool configured);
+  void (*on_line)(const usb_line_coding_t *coding, bool dtr);
+} usb_cdc_config_t;
+
+void usb_cdc_init(const usb_cdc_config_t *cfg);
+// Bulk packet size of the current connection: 512 at high speed, else 64
+uint16_t usb_cdc_packet(void);
+bool usb_cdc_dtr(void);
@@ -0,0 +1,613 @@
+#include "usbhs.h"
+
+#include <stddef.h>
+
+#include "pfic.h"
+#include "rcc.h"
+#include "systime.h"
+
+#define USBHSx              ((USBHS_TypeDef *)USBHS)
+
+#define UC_DMA_EN           (1 << 0)
+#define UC_CLR_ALL          (1 << 1)
+#define UC_RESET_SIE        (1 << 2)
+#define UC_INT_BUSY         (1 << 3)
+#define UC_DEV_PU_EN        (1 << 4)
+#define UC_SPEED_HIGH       (1 << 5)
+#define UH_PHY_SUSPENDM     (1 << 6)
+
+#define UIF_BUS_RST         (1 << 0)
+#define UIF_TRANSFER        (1 << 1)
+#define UIF_SUSPEND         (1 << 2)
+#define UIF_SETUP_ACT       (1 << 5)
+
+#define UIS_ENDP(st)        ((st) & 0x0F)
+#define UIS_TOKEN(st)       (((st) >> 4) & 0x3)
+#define UIS_TOKEN_OUT       0
+#define UIS_TOKEN_IN        2
+#define UIS_TOG_OK          (1 << 6)
+
+#define UEP_RES_MASK        0x03
+#define UEP_RES_ACK         0x00
+#define UEP_RES_NAK         0x02
+#define UEP_RES_STALL       0x03
+#define UEP_TOG             (1 << 3)
+
+// Standard requests and descriptor types (USB 2.0 chapter 9)
+#define REQ_GET_STATUS      0
+#define REQ_CLEAR_FEATURE   1
+#define REQ_SET_FEATURE     3
+#define REQ_SET_ADDRESS     5
+#define REQ_GET_DESCRIPTOR  6
+#define REQ_GET_CONFIG      8
+#define REQ_SET_CONFIG      9
+#define REQ_GET_INTERFACE   10
+#define REQ_SET_INTERFACE   11
+#define DESC_DEVICE         1
+#define DESC_CONFIG         2
+#define DESC_STRING         3
+#define DESC_ENDPOINT       5
+#define DESC_QUALIFIER      6
+#define DESC_OTHER_SPEED    7
+
+enum { CTL_IDLE, CTL_DATA_IN, CTL_DATA_OUT, CTL_STATUS_IN, CTL_STATUS_OUT };
+
+typedef struct {
+  uint8_t *buf[2];
+  uint32_t len[2];
+  uint32_t pos;         // Bytes moved in the transfer at head
+  uint8_t head;
+  volatile uint8_t count;
+  uint16_t mps;
+  bool zlp;
+  bool zlp_sent;
+  bool open;
+  usbhs_done_t done;
+  void *ctx;
+} ep_state_t;
+
+static ep_state_t eps[2][USBHS_EPS]; // [0]: OUT, [1]: IN
+
+static struct {
+  const usbhs_class_t *cls;
+  usb_setup_t setup;
+  const uint8_t *data;  // Rest of a device-to-host data stage
+  uint16_t left;
+  bool zlp;
+  uint8_t stage;
+  uint8_t tog_in;
+  uint8_t addr;
+  uint8_t config;
+  bool clocked;
+} dev;
+
+static uint8_t ep0_buf[USBHS_EP0_SIZE] __attribute__((aligned(4)));
+static uint8_t desc_buf[256] __attribute__((aligned(4)));
+
+
+static inline ep_state_t *ep_state(uint8_t ep) {
+  return &eps[ep & USBHS_EP_IN ? 1 : 0][ep & 0x7F];
+}
+
+static inline void ep0_tx(uint8_t res) {
+  USBHSx->UEP[0].TX_CTRL = (dev.tog_in ? UEP_TOG : 0) | res;
+}
+
+static void ep0_stall(void) {
+  USBHSx->UEP[0].TX_CTRL = UEP_RES_STALL;
+  USBHSx->UEP[0].RX_CTRL = UEP_RES_STALL;
+  dev.stage = CTL_IDLE;
+}
+
+// Next packet of a device-to-host data stage; DMA reads SRAM only, so copy
+static void ep0_send_next(void) {
+  uint16_t n = dev.left > USBHS_EP0_SIZE ? USBHS_EP0_SIZE : dev.left;
+  uint16_t i;
+
+  for (i = 0; i < n; i++) {
+    ep0_buf[i] = dev.data[i];
+  }
+  dev.data += n;
+  dev.left -= n;
+  if (n < USBHS_EP0_SIZE) {
+    dev.zlp = false;  // This short packet ends the stage
+  }
+  USBHSx->UEP[0].T_LEN = n;
+  ep0_tx(UEP_RES_ACK);
+}
+
+static void ep0_send(const uint8_t *data, uint16_t len) {
+  if (len > dev.setup.wLength) {
+    len = dev.setup.wLength;
+  }
+  dev.data = data;
+  dev.left = len;
+  // A stage shorter than requested that fills its last packet needs a ZLP
+  dev.zlp = len < dev.setup.wLength && (len % USBHS_EP0_SIZE) == 0;
+  dev.stage = CTL_DATA_IN;
+  ep0_send_next();
+}
+
+static void ep0_status_in(void) {
+  dev.stage = CTL_STATUS_IN;
+  USBHSx->UEP[0].T_LEN = 0;
+  ep0_tx(UEP_RES_ACK);
+}
+
+/**
+ * @brief Copies a configuration descriptor and sets its bulk packet sizes.
+ *
+ * @details Bulk endpoints are 512 bytes at high speed and 64 at full speed;
+ * type is DESC_CONFIG or DESC_OTHER_SPEED.
+ */
+static uint16_t config_for_speed(uint8_t type, bool high) {
+  const uint8_t *src = dev.cls->config;
+  uint16_t total = src[2] | (src[3] << 8);
+  uint16_t i;
+
+  if (total > sizeof(desc_buf)) {
+    return 0;
+  }
+  for (i = 0; i < total; i++) {
+    desc_buf[i] = src[i];
+  }
+  desc_buf[1] = type;
+  for (i = 0; i + 1 < total && desc_buf[i]; i += desc_buf[i]) {
+    if (desc_buf[i + 1] == DESC_ENDPOINT && (desc_buf[i + 3] & 0x3) == 2) {
+      desc_buf[i + 4] = high ? 0x00 : 0x40;
+      desc_buf[i + 5] = high ? 0x02 : 0x00;
+    }
+  }
+  return total;
+}
+
+static bool get_descriptor(void) {
+  const usbhs_class_t *c = dev.cls;
+  uint8_t type = dev.setup.wValue >> 8;
+  uint8_t index = dev.setup.wValue & 0xFF;
+  bool hs = usbhs_high_speed();
+  uint16_t len;
+
+  switch (type) {
+    case DESC_DEVICE:
+      ep0_send(c->device, c->device[0]);
+      return true;
+    case DESC_CONFIG:
+    case DESC_OTHER_SPEED:
+      len = config_for_speed(type, type == DESC_CONFIG ? hs : !hs);
+      if (!len) {
+        return false;
+      }
+      ep0_send(desc_buf, len);
+      return true;
+    case DESC_QUALIFIER:
+      desc_buf[0] = 10;
+      desc_buf[1] = DESC_QUALIFIER;
+      for (len = 2; len < 8; len++) {
+        desc_buf[len] = c->device[len]; // bcdUSB, class, subclass, protocol, EP0 size
+      }
+      desc_buf[8] = c->device[17];      // bNumConfigurations
+      desc_buf[9] = 0;
+      ep0_send(desc_buf, 10);
+      return true;
+    case DESC_STRING:
+      if (index >= c->nstrings) {
+        return false;
+      }
+      ep0_send(c->strings[index], c->strings[index][0]);
+      return true;
+  }
+  return false;
+}
+
+static void ep_reset_all(void) {
+  uint32_t i;
+
+  for (i = 1; i < USBHS_EPS; i++) {
+    eps[0][i].open = false;
+    eps[1][i].open = false;
+    eps[0][i].count = 0;
+    eps[1][i].count = 0;
+  }
+  USBHSx->ENDP_CONFIG = (1 << 0) | (1 << 16);
+}
+
+static bool set_configuration(void) {
+  uint8_t cfg = dev.setup.wValue & 0xFF;
+
+  if (cfg > 1) {
+    return false;
+  }
+  if (dev.config && dev.cls->configured) {
+    dev.cls->configured(false);
+  }
+  ep_reset_all();
+  dev.config = cfg;
+  if (cfg && dev.cls->configured) {
+    dev.cls->configured(true);
+  }
+  return true;
+}
+
+static bool endpoint_halt(uint8_t ep, bool halt) {
+  uint8_t n = ep & 0x7F;
+
+  if (n == 0 || n >= USBHS_EPS || !ep_state(ep)->open) {
+    return false;
+  }
+  // Clearing a halt also resets the data toggle to DATA0
+  if (ep & USBHS_EP_IN) {
+    USBHSx->UEP[n].TX_CTRL = halt ? UEP_RES_STALL : (ep_state(ep)->count ? UEP_RES_ACK : UEP_RES_NAK);
+  } else {
+    USBHSx->UEP[n].RX_CTRL = halt ? UEP_RES_STALL : (ep_state(ep)->count ? UEP_RES_ACK : UEP_RES_NAK);
+  }
+  return true;
+}
+
+static bool standard_request(void) {
+  usb_setup_t *s = &dev.setup;
+  uint8_t recipient = s->bmRequestType & 0x1F;
+
+  switch (s->bRequest) {
+    case REQ_GET_DESCRIPTOR:
+      return get_descriptor();
+    case REQ_SET_ADDRESS:
+      dev.addr = s->wValue & 0x7F;  // Applied after the status stage
+      ep0_status_in();
+      return true;
+    case REQ_SET_CONFIG:
+      if (!set_configuration()) {
+        return false;
+      }
+      ep0_status_in();
+      return true;
+    case REQ_GET_CONFIG:
+      desc_buf[0] = dev.config;
+      ep0_send(desc_buf, 1);
+      return true;
+    case REQ_GET_STATUS:
+      desc_buf[0] = 0;
+      desc_buf[1] = 0;
+      if (recipient == 2) {
+        uint8_t n = s->wIndex & 0x7F;
+        volatile uint8_t *ctrl = s->wIndex & USBHS_EP_IN ? &USBHSx->UEP[n].TX_CTRL : &USBHSx->UEP[n].RX_CTRL;
+
+        desc_buf[0] = n < USBHS_EPS && (*ctrl & UEP_RES_MASK) == UEP_RES_STALL;
+      }
+      ep0_send(desc_buf, 2);
+      return true;
+    case REQ_CLEAR_FEATURE:
+    case REQ_SET_FEATURE:
+      if (recipient == 2 && s->wValue == 0 &&
+          !endpoint_halt(s->wIndex & 0xFF, s->bRequest == REQ_SET_FEATURE)) {
+        return false;
+      }
+      ep0_status_in();
+      return true;
+    case REQ_GET_INTERFACE:
+      desc_buf[0] = 0;
+      ep0_send(desc_buf, 1);
+      return true;
+    case REQ_SET_INTERFACE:
+      if (s->wValue != 0) {
+        return false;
+      }
+      ep0_status_in();
+      return true;
+  }
+  return false;
+}
+
+static void ep0_setup(void) {
+  usb_setup_t *s = &dev.setup;
+  uint16_t len = 0;
+  bool ok;
+
+  s->bmRequestType = ep0_buf[0];
+  s->bRequest = ep0_buf[1];
+  s->wValue = ep0_buf[2] | (ep0_buf[3] << 8);
+  s->wIndex = ep0_buf[4] | (ep0_buf[5] << 8);
+  s->wLength = ep0_buf[6] | (ep0_buf[7] << 8);
+  dev.tog_in = 1;       // Data and status stages start with DATA1
+  USBHSx->UEP[0].TX_CTRL = UEP_TOG | UEP_RES_NAK;
+  USBHSx->UEP[0].RX_CTRL = UEP_TOG | UEP_RES_NAK;
+
+  if ((s->bmRequestType & 0x60) == 0) {
+    ok = standard_request();
+  } else if (!dev.cls->request) {
+    ok = false;
+  } else if (s->bmRequestType & 0x80) {
+    ok = dev.cls->request(s, ep0_buf, &len);
+    if (ok) {
+      // request() built the reply in ep0_buf itself
+      ep0_send(ep0_buf, len);
+    }
+  } else if (s->wLength) {
+    ok = s->wLength <= USBHS_EP0_SIZE;
+    if (ok) {
+      dev.stage = CTL_DATA_OUT;
+      USBHSx->UEP[0].RX_CTRL = UEP_TOG | UEP_RES_ACK;
+    }
+  } else {
+    ok = dev.cls->request(s, ep0_buf, &len);
+    if (ok) {
+      ep0_status_in();
+    }
+  }
+  if (!ok) {
+    ep0_stall();
+  }
+}
+
+static void ep0_in_done(void) {
+  dev.tog_in ^= 1;
+  switch (dev.stage) {
+    case CTL_DATA_IN:
+      if (dev.left || dev.zlp) {
+        ep0_send_next();
+        return;
+      }
+      dev.stage = CTL_STATUS_OUT;
+      USBHSx->UEP[0].RX_CTRL = UEP_TOG | UEP_RES_ACK;
+      ep0_tx(UEP_RES_NAK);
+      return;
+    case CTL_STATUS_IN:
+      if (dev.setup.bRequest == REQ_SET_ADDRESS && (dev.setup.bmRequestType & 0x60) == 0) {
+        USBHSx->DEV_AD = dev.addr;
+      }
+      break;
+  }
+  dev.stage = CTL_IDLE;
+  ep0_tx(UEP_RES_NAK);
+}
+
+static void ep0_out_done(void) {
+  uint16_t len = USBHSx->RX_LEN;
+
+  if (dev.stage == CTL_DATA_OUT) {
+    USBHSx->UEP[0].RX_CTRL = UEP_RES_NAK;
+    if (len != dev.setup.wLength || !dev.cls->request(&dev.setup, ep0_buf, &len)) {
+      ep0_stall();
+      return;
+    }
+    ep0_status_in();
+    return;
+  }
+  dev.stage = CTL_IDLE;
+  USBHSx->UEP[0].RX_CTRL = UEP_RES_NAK;
+}
+
+// Points the endpoint at the next packet of the transfer at head
+static void ep_arm(uint8_t ep) {
+  ep_state_t *e = ep_state(ep);
+  uint8_t n = ep & 0x7F;
+  uint8_t *p = e->buf[e->head] + e->pos;
+  uint32_t left = e->len[e->head] - e->pos;
+
+  if (ep & USBHS_EP_IN) {
+    USBHSx->UEP_TX_DMA[n - 1] = (uint32_t)p;
+    USBHSx->UEP[n].T_LEN = left > e->mps ? e->mps : left;
+    USBHSx->UEP[n].TX_CTRL = (USBHSx->UEP[n].TX_CTRL & ~UEP_RES_MASK) | UEP_RES_ACK;
+  } else {
+    USBHSx->UEP_RX_DMA[n - 1] = (uint32_t)p;
+    USBHSx->UEP[n].RX_CTRL = (USBHSx->UEP[n].RX_CTRL & ~UEP_RES_MASK) | UEP_RES_ACK;
+  }
+}
+
+// Retires the transfer at head and starts the queued one, if any
+static void ep_complete(uint8_t ep) {
+  ep_state_t *e = ep_state(ep);
+  uint8_t n = ep & 0x7F;
+  uint32_t moved = e->pos;
+
+  e->head ^= 1;
+  e->count--;
+  e->pos = 0;
+  e->zlp_sent = false;
+  if (e->count) {
+    ep_arm(ep);
+  } else if (ep & USBHS_EP_IN) {
+    USBHSx->UEP[n].TX_CTRL = (USBHSx->UEP[n].TX_CTRL & ~UEP_RES_MASK) | UEP_RES_NAK;
+  } else {
+    USBHSx->UEP[n].RX_CTRL = (USBHSx->UEP[n].RX_CTRL & ~UEP_RES_MASK) | UEP_RES_NAK;
+  }
+  if (e->done) {
+    e->done(e->ctx, ep, moved);
+  }
+}
+
+static void ep_in_done(uint8_t n) {
+  uint8_t ep = n | USBHS_EP_IN;
+  ep_state_t *e = ep_state(ep);
+  uint32_t sent;
+
+  USBHSx->UEP[n].TX_CTRL ^= UEP_TOG;
+  if (!e->count) {
+    return;
+  }
+  sent = USBHSx->UEP[n].T_LEN;
+  e->pos += sent;
+  if (e->pos < e->len[e->head]) {
+    ep_arm(ep);
+  } else if (e->zlp && sent == e->mps && !e->zlp_sent) {
+    e->zlp_sent = true;
+    USBHSx->UEP[n].T_LEN = 0;
+    USBHSx->UEP[n].TX_CTRL = (USBHSx->UEP[n].TX_CTRL & ~UEP_RES_MASK) | UEP_RES_ACK;
+  } else {
+    ep_complete(ep);
+  }
+}
+
+static void ep_out_done(uint8_t n, uint8_t st) {
+  ep_state_t *e = ep_state(n);
+  uint32_t len = USBHSx->RX_LEN;
+
+  if (!(st & UIS_TOG_OK) || !e->count) {
+    return; // Retransmission of a packet already taken
+  }
+  USBHSx->UEP[n].RX_CTRL ^= UEP_TOG;
+  e->pos += len;
+  if (len < e->mps || e->pos >= e->len[e->head]) {
+    ep_complete(n);
+  } else {
+    ep_arm(n);
+  }
+}
+
+static void bus_reset(void) {
+  if (dev.config && dev.cls->configured) {
+    dev.cls->configured(false);
+  }
+  dev.config = 0;
+  dev.stage = CTL_IDLE;
+  USBHSx->DEV_AD = 0;
+  ep_reset_all();
+  USBHSx->UEP0_DMA = (uint32_t)ep0_buf;
+  USBHSx->UEP_MAX[0].LEN = USBHS_EP0_SIZE;
+  USBHSx->UEP[0].T_LEN = 0;
+  USBHSx->UEP[0].TX_CTRL = UEP_RES_NAK;
+  USBHSx->UEP[0].RX_CTRL = UEP_RES_NAK;
+}
+
+/**
+ * @brief USBHS interrupt: one flag per pass, in priority order.
+ *
+ * @details The transfer flag is cleared last, after the endpoint has been
+ * pointed at its next buffer, because the controller NAKs the endpoint until
+ * then.
+ */
+IRQ_HANDLER_FPU(usbhs_irq_handler) {
+  uint8_t fg = USBHSx->INT_FG;
+  uint8_t st = USBHSx->INT_ST;
+  uint8_t n = UIS_ENDP(st);
+
+  if (fg & UIF_TRANSFER) {
+    if (UIS_TOKEN(st) == UIS_TOKEN_IN) {
+      if (n == 0) {
+        ep0_in_done();
+      } else if (n < USBHS_EPS) {
+        ep_in_done(n);
+      }
+    } else if (UIS_TOKEN(st) == UIS_TOKEN_OUT) {
+      if (n == 0) {
+        ep0_out_done();
+      } else if (n < USBHS_EPS) {
+        ep_out_done(n, st);
+      }
+    }
+    USBHSx->INT_FG = UIF_TRANSFER;
+  } else if (fg & UIF_SETUP_ACT) {
+    ep0_setup();
+    USBHSx->INT_FG = UIF_SETUP_ACT;
+  } else if (fg & UIF_BUS_RST) {
+    bus_reset();
+    USBHSx->INT_FG = UIF_BUS_RST;
+  } else {
+    USBHSx->INT_FG = fg;
+  }
+}
+
+/**
+ * @brief Brings up the PHY and connects as a high-speed device.
+ *
+ * @details The PHY PLL needs a 4 MHz reference: HSE is divided down to it in
+ * RCC_CFGR2 (USBHSDIV bits 26:24, reference select bits 29:28 = 4 MHz, PLL
+ * alive bit 30). Uses systime_delay_ms(), so call systime_init() first.
+ */
+void usbhs_init(const usbhs_class_t *cls) {
+  dev.cls = cls;
+  RCC->CFGR2 = (RCC->CFGR2 & ~(0x7Fu << 24)) | ((HSE_VALUE / 4000000 - 1) << 24) |
+               (0x1u << 28) | (1u << 30);
+  if (!dev.clocked) {
+    rcc_clock_acquire(RCC_USBHS);
+    dev.clocked = true;
+  }
+
+  USBHSx->CONTROL = UC_CLR_ALL | UC_RESET_SIE;
+  systime_delay_ms(1);
+  USBHSx->CONTROL &= ~UC_RESET_SIE;
+  USBHSx->HOST_CTRL = UH_PHY_SUSPENDM;
+  USBHSx->CONTROL = UC_DMA_EN | UC_INT_BUSY | UC_SPEED_HIGH;
+  USBHSx->INT_EN = UIF_SETUP_ACT | UIF_TRANSFER | UIF_BUS_RST | UIF_SUSPEND;
+  bus_reset();
+  pfic_enable_irq(USBHS_IRQn);
+  USBHSx->CONTROL |= UC_DEV_PU_EN;
+}
+
+void usbhs_disconnect(void) {
+  USBHSx->CONTROL &= ~UC_DEV_PU_EN;
+  pfic_disable_irq(USBHS_IRQn);
+  bus_reset();
+}
+
+bool usbhs_high_speed(void) {
+  return (USBHSx->SPEED_TYPE & 0x3) == 1;
+}
+
+bool usbhs_configured(void) {
+  return dev.config != 0;
+}
+
+bool usbhs_ep_open(uint8_t ep, uint16_t mps, bool zlp, usbhs_done_t done, void *ctx) {
+  ep_state_t *e = ep_state(ep);
+  uint8_t n = ep & 0x7F;
+
+  if (n == 0 || n >= USBHS_EPS) {
+    return false;
+  }
+  e->mps = mps;
+  e->zlp = zlp;
+  e->done = done;
+  e->ctx = ctx;
+  e->count = 0;
+  e->head = 0;
+  e->pos = 0;
+  e->zlp_sent = false;
+  e->open = true;
+  USBHSx->UEP_MAX[n].LEN = mps;
+  if (ep & USBHS_EP_IN) {
+    USBHSx->UEP[n].T_LEN = 0;
+    USBHSx->UEP[n].TX_CTRL = UEP_RES_NAK;
+    USBHSx->ENDP_CONFIG |= 1u << n;
+  } else {
+    USBHSx->UEP[n].RX_CTRL = UEP_RES_NAK;
+    USBHSx->ENDP_CONFIG |= 1u << (16 + n);
+  }
+  return true;
+}
+
+void usbhs_ep_close(uint8_t ep) {
+  uint8_t n = ep & 0x7F;
+
+  pfic_disable_irq(USBHS_IRQn);
+  ep_state(ep)->open = false;
+  ep_state(ep)->count = 0;
+  USBHSx->ENDP_CONFIG &= ~(1u << (ep & USBHS_EP_IN ? n : 16 + n));
+  pfic_enable_irq(USBHS_IRQn);
+}
+
+bool usbhs_ep_submit(uint8_t ep, void *buf, uint32_t len) {
+  ep_state_t *e = ep_state(ep);
+  bool ok = false;
+
+  if (((uintptr_t)buf & 3) || (len && (uintptr_t)buf - SRAM >= PHY - SRAM) ||
+      (!(ep & USBHS_EP_IN) && (len == 0 || len % e->mps))) {
+    return false;
+  }
+  pfic_disable_irq(USBHS_IRQn);
+  if (e->open && e->count < 2) {
+    e->buf[e->head ^ e->count] = buf;
+    e->len[e->head ^ e->count] = len;
+    if (e->count++ == 0) {
+      e->pos = 0;
+      ep_arm(ep);
+    }
+    ok = true;
+  }
+  pfic_enable_irq(USBHS_IRQn);
+  return ok;
+}
+
+uint32_t usbhs_ep_queued(uint8_t ep) {
+  return ep_state(ep)->count;
+}
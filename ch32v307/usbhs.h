@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+#include "mem_mapping.h"
+
+
+/**
+ * @brief USB high-speed controller register block (device mode)
+ *
+ * @details The USBHS controller has its own UTMI PHY on PB6/PB7 and its own DMA:
+ * every endpoint direction has a buffer address register, and packets move
+ * between that RAM address and the bus with no CPU involvement. It needs the AHB
+ * clock (RCC_AHBENR bit 11) and the PHY PLL, which runs from a 4 MHz reference
+ * derived from HSE through RCC_CFGR2.
+ *
+ * Bit fields of CONTROL:
+ * - Bit 0   : DMA_EN     - Endpoint DMA enable
+ * - Bit 1   : CLR_ALL    - Clear FIFOs and interrupt flags
+ * - Bit 2   : RESET_SIE  - Hold the serial interface engine in reset
+ * - Bit 3   : INT_BUSY   - NAK automatically while INT_FG holds a transfer flag
+ * - Bit 4   : DEV_PU_EN  - Enable the D+ pull-up (connect)
+ * - Bits 6:5: SPEED      - 00: full, 01: high, 10: low speed
+ *
+ * Bit fields of INT_EN / INT_FG (write 1 to clear):
+ * - Bit 0 : BUS_RST   - Bus reset
+ * - Bit 1 : TRANSFER  - A token completed, see INT_ST
+ * - Bit 2 : SUSPEND   - Suspend or resume
+ * - Bit 5 : SETUP_ACT - SETUP packet received into the EP0 buffer
+ *
+ * Bit fields of INT_ST:
+ * - Bits 3:0 : ENDP    - Endpoint of the last token
+ * - Bits 5:4 : TOKEN   - 00: OUT, 10: IN, 11: SETUP
+ * - Bit 6    : TOG_OK  - Received data toggle matched
+ *
+ * Bit fields of UEPn_TX_CTRL / UEPn_RX_CTRL:
+ * - Bits 1:0 : RES  - Handshake: 00 ACK, 01 NYET, 10 NAK, 11 STALL
+ * - Bit 3    : TOG  - Expected/sent data toggle, DATA1 when set
+ *
+ * ENDP_CONFIG enables endpoint n transmit with bit n and receive with bit
+ * 16 + n. SPEED_TYPE bits 1:0 report the negotiated speed (01: high).
+ *
+ * @note The DMA reaches SRAM only, and buffers must be 4-byte aligned. With
+ * INT_BUSY set the controller NAKs while a flag is pending, so the interrupt can
+ * repoint an endpoint at the next buffer before the host gets another packet.
+ */
+typedef struct {
+  volatile uint8_t CONTROL;
+  volatile uint8_t HOST_CTRL;
+  volatile uint8_t INT_EN;
+  volatile uint8_t DEV_AD;
+  volatile uint16_t FRAME_NO;
+  volatile uint8_t SUSPEND;
+  uint8_t RESERVED0;
+  volatile uint8_t SPEED_TYPE;
+  volatile uint8_t MIS_ST;
+  volatile uint8_t INT_FG;
+  volatile uint8_t INT_ST;
+  volatile uint16_t RX_LEN;
+  uint16_t RESERVED1;
+  volatile uint32_t ENDP_CONFIG;
+  volatile uint32_t ENDP_TYPE;
+  volatile uint32_t BUF_MODE;
+  volatile uint32_t UEP0_DMA;
+  volatile uint32_t UEP_RX_DMA[15];     // Endpoints 1-15
+  volatile uint32_t UEP_TX_DMA[15];
+  struct {
+    volatile uint16_t LEN;
+    uint16_t RESERVED;
+  } UEP_MAX[16];
+  struct {
+    volatile uint16_t T_LEN;
+    volatile uint8_t TX_CTRL;
+    volatile uint8_t RX_CTRL;
+  } UEP[16];
+} USBHS_TypeDef;
+
+#define USBHS_EP0_SIZE      64
+#define USBHS_EPS           8   // Endpoints 0..7 are served
+#define USBHS_EP_IN         0x80
+
+typedef struct {
+  uint8_t bmRequestType;
+  uint8_t bRequest;
+  uint16_t wValue;
+  uint16_t wIndex;
+  uint16_t wLength;
+} usb_setup_t;
+
+/**
+ * @brief Descriptors and hooks of the function on top of the controller.
+ *
+ * @details The configuration descriptor is given with high-speed packet sizes;
+ * the stack rewrites bulk endpoints to 64 bytes when answering at full speed
+ * and for the other-speed configuration.
+ *
+ * request() handles class and vendor requests. For device-to-host requests it
+ * fills buf (up to USBHS_EP0_SIZE bytes) and sets *len; for host-to-device
+ * requests it is called after the data stage with the data in buf. Returning
+ * false stalls the request.
+ */
+typedef struct {
+  const uint8_t *device;
+  const uint8_t *config;
+  const uint8_t *const *strings;        // [0] is the language ID list
+  uint8_t nstrings;
+  void (*configured)(bool on);          // Open endpoints here
+  bool (*request)(const usb_setup_t *setup, uint8_t *buf, uint16_t *len);
+} usbhs_class_t;
+
+// ISR context: a queued transfer finished; len is what was moved
+typedef void (*usbhs_done_t)(void *ctx, uint8_t ep, uint32_t len);
+
+void usbhs_init(const usbhs_class_t *cls);
+void usbhs_disconnect(void);
+bool usbhs_high_speed(void);
+bool usbhs_configured(void);
+
+/**
+ * Endpoints take whole transfers, split into packets by the interrupt without
+ * copying. Two transfers can be queued per endpoint so the next one starts from
+ * the interrupt that ends the current one. OUT transfers end on a short packet
+ * or when len is full, and len must be a multiple of the packet size. With zlp
+ * set, an IN transfer that is a multiple of the packet size ends with a
+ * zero-length packet. Buffers must be 4-byte aligned and, unless len is 0, in
+ * SRAM: the DMA cannot reach EXTRAM or flash, so those are refused.
+ */
+bool usbhs_ep_open(uint8_t ep, uint16_t mps, bool zlp, usbhs_done_t done, void *ctx);
+void usbhs_ep_close(uint8_t ep);
+bool usbhs_ep_submit(uint8_t ep, void *buf, uint32_t len);
+uint32_t usbhs_ep_queued(uint8_t ep);
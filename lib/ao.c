@@ -0,0 +1,205 @@
+#include "ao.h"
+
+#include <stddef.h>
+#include "bitops.h"
+
+static struct framework {
+  ao_t *aos[AO_MAX];
+  uint32_t ready;                       // Bit p: aos[p] may have events
+  uint32_t subscribers[AO_MAX_SIGNALS]; // Bit p: aos[p] gets the signal
+  ao_pool_t *pools[AO_POOLS];
+  uint32_t npools;
+} fw;
+
+static ao_event_t init_event = AO_EVENT(AO_SIG_INIT);
+
+
+void ao_init(void) {
+  fw = (struct framework){0};
+}
+
+void ao_pool_add(ao_pool_t *pool, void *buf, uint32_t block_size, uint32_t n, uint32_t *used) {
+  uint32_t i;
+
+  *pool = (ao_pool_t){buf, block_size, n, used, 0, 0, 0};
+  for (i = 0; i < (n + 31) / 32; i++) {
+    used[i] = 0;
+  }
+  fw.pools[fw.npools++] = pool;
+}
+
+// Claims a clear bit with amoor; a bit someone else set first is simply skipped
+static ao_event_t *pool_take(ao_pool_t *p) {
+  uint32_t w, free, bit, valid, in_use;
+
+  for (w = 0; w < (p->n + 31) / 32; w++) {
+    valid = p->n - w * 32 >= 32 ? 0xFFFFFFFF : (1u << (p->n - w * 32)) - 1;
+    while ((free = ~bits_get(&p->used[w], valid) & valid)) {
+      bit = __builtin_ctz(free);
+      if (!bits_set(&p->used[w], 1u << bit)) {
+        in_use = __atomic_add_fetch(&p->in_use, 1, __ATOMIC_RELAXED);
+        if (in_use > p->in_use_max) {
+          p->in_use_max = in_use;
+        }
+        return (ao_event_t *)(p->blocks + (w * 32 + bit) * p->block_size);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void pool_give(ao_event_t *e) {
+  ao_pool_t *p = fw.pools[e->pool - 1];
+  uint32_t i = ((uint8_t *)e - p->blocks) / p->block_size;
+
+  __atomic_sub_fetch(&p->in_use, 1, __ATOMIC_RELAXED);
+  bits_clear(&p->used[i / 32], 1u << (i % 32));
+}
+
+// Drops one reference; the last one returns a pool event
+static void release(ao_event_t *e) {
+  if (e->pool && __atomic_sub_fetch(&e->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    pool_give(e);
+  }
+}
+
+static bool post(ao_t *me, ao_event_t *e) {
+  if (e->pool) {
+    __atomic_add_fetch(&e->refs, 1, __ATOMIC_RELAXED);
+  }
+  if (!mpsc_push(&me->queue, &e)) {
+    release(e);
+    return false;
+  }
+  // After the push: a dispatcher that sees the bit finds the event
+  bits_set(&fw.ready, 1u << me->prio);
+  return true;
+}
+
+void ao_start(ao_t *me, uint8_t prio, ao_handler_t initial, void *queue_buf, uint32_t len) {
+  *me = (ao_t){0};
+  me->handler = initial;
+  me->prio = prio;
+  mpsc_init(&me->queue, queue_buf, sizeof(ao_event_t *), len);
+  fw.aos[prio] = me;
+  ao_post(me, &init_event);
+}
+
+ao_event_t *ao_new(uint32_t size, uint16_t sig) {
+  ao_event_t *e = NULL;
+  ao_pool_t *fit = NULL;
+  uint32_t i;
+
+  for (i = 0; i < fw.npools && !e; i++) {
+    if (fw.pools[i]->block_size < size) {
+      continue;
+    }
+    if (!fit) {
+      fit = fw.pools[i];
+    }
+    // A larger block rather than none
+    if ((e = pool_take(fw.pools[i]))) {
+      e->sig = sig;
+      e->pool = i + 1;
+      e->refs = 0;
+    }
+  }
+  if (!e && fit) {
+    __atomic_add_fetch(&fit->failed, 1, __ATOMIC_RELAXED);
+  }
+  return e;
+}
+
+bool ao_post(ao_t *me, ao_event_t *e) {
+  bool ok;
+
+  e->posted = ao_port_now();
+  // Held across the post, so an event that does not make it still goes back
+  if (e->pool) {
+    __atomic_add_fetch(&e->refs, 1, __ATOMIC_RELAXED);
+  }
+  ok = post(me, e);
+  release(e);
+  return ok;
+}
+
+uint32_t ao_publish(ao_event_t *e) {
+  uint32_t subs = bits_get(&fw.subscribers[e->sig], 0xFFFFFFFF);
+  uint32_t n = 0, p;
+
+  e->posted = ao_port_now();
+  if (e->pool) {
+    __atomic_add_fetch(&e->refs, 1, __ATOMIC_RELAXED);
+  }
+  while (subs) {
+    p = __builtin_ctz(subs);
+    subs &= subs - 1;
+    if (fw.aos[p] && post(fw.aos[p], e)) {
+      n++;
+    }
+  }
+  release(e);
+  return n;
+}
+
+void ao_subscribe(ao_t *me, uint16_t sig) {
+  bits_set(&fw.subscribers[sig], 1u << me->prio);
+}
+
+void ao_unsubscribe(ao_t *me, uint16_t sig) {
+  bits_clear(&fw.subscribers[sig], 1u << me->prio);
+}
+
+bool ao_dispatch(void) {
+  uint32_t ready = bits_get(&fw.ready, 0xFFFFFFFF);
+  uint32_t p, depth, latency;
+  ao_event_t *e;
+  ao_t *me;
+
+  if (!ready) {
+    return false;
+  }
+  p = __builtin_ctz(ready);
+  me = fw.aos[p];
+  // Clear before popping: a post landing in between sets it again
+  bits_clear(&fw.ready, 1u << p);
+  depth = mpsc_count(&me->queue);
+  if (!mpsc_pop(&me->queue, &e)) {
+    return true;
+  }
+  if (depth > 1) {
+    bits_set(&fw.ready, 1u << p);
+  }
+  if (depth > me->depth_max) {
+    me->depth_max = depth;
+  }
+  latency = ao_port_now() - e->posted;
+  if (latency > me->latency_max) {
+    me->latency_max = latency;
+  }
+  me->latency_sum += latency;
+  me->dispatched++;
+  me->handler(me, e);
+  release(e);
+  return true;
+}
+
+bool ao_pending(void) {
+  return bits_get(&fw.ready, 0xFFFFFFFF) != 0;
+}
+
+void ao_run(void) {
+  while (1) {
+    if (!ao_dispatch()) {
+      ao_port_idle();
+    }
+  }
+}
+
+void ao_stats(const ao_t *me, ao_stats_t *stats) {
+  stats->dispatched = me->dispatched;
+  stats->dropped = mpsc_dropped(&me->queue);
+  stats->latency_max = me->latency_max;
+  stats->latency_avg = me->dispatched ? me->latency_sum / me->dispatched : 0;
+  stats->depth_max = me->depth_max;
+}
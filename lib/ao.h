@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lfq.h"
+
+/**
+ * @brief Active objects: event-driven, run-to-completion handlers in place of
+ * a polling superloop.
+ *
+ * @details An active object owns a queue of events and a handler that
+ * processes one event at a time, start to finish, without blocking. Each has a
+ * unique priority from 0 (the most urgent) to AO_MAX - 1, and the dispatcher
+ * always takes the next event of the most urgent object that has one. All
+ * handlers run in the one dispatcher loop, so they share nothing that needs a
+ * lock. When every queue is empty the dispatcher sleeps in ao_port_idle().
+ *
+ * Events are posted to one object or published to every object subscribed to
+ * the signal. Either may come from an interrupt: the queues are lfq.h MPSC
+ * rings and the ready set is updated with AMOs, so posting never masks
+ * interrupts. Events with parameters come from fixed-block pools, taken and
+ * returned with AMOs on a bitmap, and go back to their pool after the last
+ * handler that received them returns. Static events (AO_EVENT()) are never
+ * returned.
+ *
+ * Every event is stamped when posted and the dispatcher keeps the worst and
+ * total post-to-handler delay per object (ao_stats()); tools/ao_replay.c
+ * drives the same code from event traces on the host.
+ *
+ * Nothing here touches hardware; ao_port_now() and ao_port_idle() come from
+ * ch32v307/ao_port.c or the host harness.
+ */
+
+#define AO_MAX              32      // Objects, one per priority
+#define AO_MAX_SIGNALS      64
+#define AO_POOLS            3
+
+// Reserved signals; application signals start at AO_SIG_USER
+#define AO_SIG_INIT         0       // First event every object gets
+#define AO_SIG_USER         1
+
+typedef struct {
+  uint16_t sig;
+  uint8_t pool;             // 0: static, else pool index + 1
+  uint8_t reserved;
+  uint32_t refs;            // Queues still holding it (pool events)
+  uint32_t posted;          // ao_port_now() at post or publish
+} ao_event_t;
+
+#define AO_EVENT(s)         {(s), 0, 0, 0, 0}
+
+typedef struct ao ao_t;
+typedef void (*ao_handler_t)(ao_t *me, const ao_event_t *e);
+
+struct ao {
+  ao_handler_t handler;     // Current state; a handler changes state by replacing it
+  mpsc_t queue;             // Of ao_event_t *
+  uint8_t prio;
+  uint32_t dispatched;
+  uint32_t latency_max;     // Post to handler, in ao_port_now() units
+  uint64_t latency_sum;
+  uint32_t depth_max;       // Most events seen waiting at once
+};
+
+typedef struct {
+  uint8_t *blocks;
+  uint32_t block_size;
+  uint32_t n;
+  uint32_t *used;           // Bitmap, (n + 31) / 32 words
+  uint32_t in_use;
+  uint32_t in_use_max;
+  uint32_t failed;          // ao_new() calls that found it empty
+} ao_pool_t;
+
+typedef struct {
+  uint32_t dispatched;
+  uint32_t dropped;
+  uint32_t latency_max;
+  uint32_t latency_avg;
+  uint32_t depth_max;
+} ao_stats_t;
+
+// Bytes of queue buffer for an object holding len (a power of two) events
+#define AO_QUEUE_SIZE(len)  MPSC_BUF_SIZE(sizeof(ao_event_t *), (len))
+
+void ao_init(void);
+
+/**
+ * @brief Adds a pool of n blocks of block_size bytes (events included) at buf.
+ *
+ * @details Pools must be added smallest blocks first; ao_new() takes from the
+ * first one whose blocks are big enough. used holds (n + 31) / 32 words.
+ */
+void ao_pool_add(ao_pool_t *pool, void *buf, uint32_t block_size, uint32_t n, uint32_t *used);
+
+/**
+ * @brief Registers me at prio and posts AO_SIG_INIT to it.
+ *
+ * @details queue_buf holds AO_QUEUE_SIZE(len) bytes, word aligned.
+ */
+void ao_start(ao_t *me, uint8_t prio, ao_handler_t initial, void *queue_buf, uint32_t len);
+
+/**
+ * @brief A pool event of size bytes (at least sizeof(ao_event_t)) with its
+ * signal set, for the caller to fill in and post or publish; NULL if no pool
+ * has a free block that big. Safe in interrupts.
+ */
+ao_event_t *ao_new(uint32_t size, uint16_t sig);
+
+// Safe in interrupts. False (and counted) if the queue is full; a pool event is then freed.
+// Stamps e, so a static event posted again before it is handled shows the later time.
+bool ao_post(ao_t *me, ao_event_t *e);
+// Safe in interrupts. Returns the number of subscribers that got the event
+uint32_t ao_publish(ao_event_t *e);
+void ao_subscribe(ao_t *me, uint16_t sig);
+void ao_unsubscribe(ao_t *me, uint16_t sig);
+
+// Handles the next event of the most urgent ready object; false if none was ready
+bool ao_dispatch(void);
+// True while some object has events waiting; the port checks it with interrupts off
+bool ao_pending(void);
+// Dispatches forever, sleeping in ao_port_idle() whenever nothing is pending
+void ao_run(void);
+
+void ao_stats(const ao_t *me, ao_stats_t *stats);
+
+/*
+ * Port interface.
+ */
+
+// Free-running time for the latency stamps (microseconds on the target)
+uint32_t ao_port_now(void);
+// Sleeps until an interrupt unless ao_pending(), checked with interrupts off
+void ao_port_idle(void);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Atomic bit operations on flag words shared between tasks and
+ * interrupts.
+ *
+ * @details Each is a single AMO instruction on rv32imac (amoor.w, amoand.w,
+ * amoxor.w): no interrupt masking and no retry loop, and a handler that
+ * preempts one and updates other bits of the same word loses nothing. Each
+ * returns which of the bits in mask were set before, so a caller can tell
+ * whether it was the one that changed them.
+ *
+ * For RAM only. Peripheral registers do not take AMOs; they still need a
+ * critical section around a read-modify-write.
+ *
+ * Nothing here touches hardware; the same code runs on the host.
+ */
+
+static inline uint32_t bits_set(uint32_t *w, uint32_t mask) {
+  return __atomic_fetch_or(w, mask, __ATOMIC_ACQ_REL) & mask;
+}
+
+static inline uint32_t bits_clear(uint32_t *w, uint32_t mask) {
+  return __atomic_fetch_and(w, ~mask, __ATOMIC_ACQ_REL) & mask;
+}
+
+static inline uint32_t bits_toggle(uint32_t *w, uint32_t mask) {
+  return __atomic_fetch_xor(w, mask, __ATOMIC_ACQ_REL) & mask;
+}
+
+static inline uint32_t bits_get(const uint32_t *w, uint32_t mask) {
+  return __atomic_load_n(w, __ATOMIC_ACQUIRE) & mask;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief 512-byte block device, as seen by the file layers.
+ *
+ * @details Calls are synchronous and move count consecutive blocks; drivers turn
+ * them into multi-block transfers. Buffers are 4-byte aligned so they can go to
+ * DMA untouched.
+ */
+
+#define BLOCK_SIZE          512
+
+typedef struct {
+  bool (*read)(void *ctx, uint32_t lba, void *buf, uint32_t count);
+  bool (*write)(void *ctx, uint32_t lba, const void *buf, uint32_t count);
+  void *ctx;
+  uint32_t blocks;
+} blockdev_t;
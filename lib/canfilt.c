@@ -0,0 +1,254 @@
+#include "canfilt.h"
+
+#include <stddef.h>
+
+
+static inline uint32_t full_mask(const canfilt_rule_t *r) {
+  return r->ext ? CANFILT_EXT_MASK : CANFILT_STD_MASK;
+}
+
+static inline bool is_exact(const canfilt_rule_t *r) {
+  return r->mask == full_mask(r);
+}
+
+static inline bool same_kind(const canfilt_rule_t *a, const canfilt_rule_t *b) {
+  return a->ext == b->ext && a->fifo == b->fifo;
+}
+
+// a accepts everything b does
+static inline bool covers(const canfilt_rule_t *a, const canfilt_rule_t *b) {
+  return same_kind(a, b) && !(a->mask & ~b->mask) && (b->id & a->mask) == a->id;
+}
+
+static void drop_covered(canfilt_rule_t *r, uint32_t *n) {
+  uint32_t i, j;
+
+  for (i = 0; i < *n; i++) {
+    for (j = 0; j < *n; j++) {
+      if (j != i && covers(&r[i], &r[j])) {
+        r[j] = r[--*n];
+        i = (uint32_t)-1;   // Start over, r[i] may have moved
+        break;
+      }
+    }
+  }
+}
+
+// One lossless merge: same mask, ids one cared-for bit apart
+static bool merge_one(canfilt_rule_t *r, uint32_t *n) {
+  uint32_t i, j, diff;
+
+  for (i = 0; i < *n; i++) {
+    for (j = i + 1; j < *n; j++) {
+      diff = r[i].id ^ r[j].id;
+      if (same_kind(&r[i], &r[j]) && r[i].mask == r[j].mask && __builtin_popcount(diff) == 1) {
+        r[i].mask &= ~diff;
+        r[i].id &= ~diff;
+        r[j] = r[--*n];
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Banks needed for a rule set.
+ *
+ * @details Per FIFO: one 32-bit mask bank per masked extended rule, 32-bit
+ * list banks for exact extended IDs two at a time, 16-bit mask banks for
+ * masked standard rules two at a time, 16-bit list banks for the remaining
+ * exact standard IDs four at a time. An odd list or mask bank leaves one slot
+ * that an exact standard ID can fill.
+ */
+static uint32_t cost(const canfilt_rule_t *r, uint32_t n) {
+  uint32_t fifo, i, a, b, c, d, spare, total = 0;
+
+  for (fifo = 0; fifo < 2; fifo++) {
+    a = b = c = d = 0;
+    for (i = 0; i < n; i++) {
+      if (r[i].fifo != fifo) {
+        continue;
+      }
+      if (r[i].ext) {
+        *(is_exact(&r[i]) ? &c : &d) += 1;
+      } else {
+        *(is_exact(&r[i]) ? &a : &b) += 1;
+      }
+    }
+    spare = (c & 1) + (b & 1);
+    a = a > spare ? a - spare : 0;
+    total += d + (c + 1) / 2 + (b + 1) / 2 + (a + 3) / 4;
+  }
+  return total;
+}
+
+static uint32_t tidy(canfilt_rule_t *r, uint32_t *n) {
+  do {
+    drop_covered(r, n);
+  } while (merge_one(r, n));
+  return cost(r, *n);
+}
+
+uint32_t canfilt_merge(canfilt_rule_t *rules, uint32_t *n) {
+  canfilt_rule_t merged[CANFILT_MAX_RULES];
+  uint32_t i, m = *n, plain;
+
+  for (i = 0; i < *n; i++) {
+    rules[i].mask &= full_mask(&rules[i]);
+    rules[i].id &= rules[i].mask;
+    rules[i].fifo &= 1;
+  }
+  if (*n > CANFILT_MAX_RULES) {
+    return tidy(rules, n);
+  }
+  // Merging exact IDs into masks can round up worse; keep whichever is cheaper
+  drop_covered(rules, n);
+  plain = cost(rules, *n);
+  m = *n;
+  for (i = 0; i < m; i++) {
+    merged[i] = rules[i];
+  }
+  if (tidy(merged, &m) >= plain) {
+    return plain;
+  }
+  for (i = 0; i < m; i++) {
+    rules[i] = merged[i];
+  }
+  *n = m;
+  return cost(rules, m);
+}
+
+// Lossy: merge the same-kind pair that keeps the most mask bits
+static bool widen(canfilt_rule_t *r, uint32_t *n) {
+  uint32_t i, j, mask, bi = 0, bj = 0;
+  int best = -1;
+
+  for (i = 0; i < *n; i++) {
+    for (j = i + 1; j < *n; j++) {
+      mask = r[i].mask & r[j].mask & ~(r[i].id ^ r[j].id);
+      if (same_kind(&r[i], &r[j]) && __builtin_popcount(mask) > best) {
+        best = __builtin_popcount(mask);
+        bi = i;
+        bj = j;
+      }
+    }
+  }
+  if (best < 0) {
+    return false;
+  }
+  r[bi].mask &= r[bj].mask & ~(r[bi].id ^ r[bj].id);
+  r[bi].id &= r[bi].mask;
+  r[bj] = r[--*n];
+  return true;
+}
+
+// Register images: STID[31:21] EXID[20:3] IDE[2] RTR[1]; 16-bit STID[15:5] RTR[4] IDE[3]
+static inline uint32_t enc32(const canfilt_rule_t *r, uint32_t v) {
+  return r->ext ? (v << 3) | 4 : v << 21;
+}
+
+static inline uint32_t enc32_mask(const canfilt_rule_t *r) {
+  return (r->ext ? r->mask << 3 : r->mask << 21) | 4 | 2;
+}
+
+static inline uint32_t enc16(const canfilt_rule_t *r) {
+  return r->id << 5;
+}
+
+static inline uint32_t enc16_pair(const canfilt_rule_t *r) {
+  return enc16(r) | (((r->mask << 5) | (1 << 4) | (1 << 3)) << 16);
+}
+
+// Moves one rule of a class past the end of the pool; NULL when none is left
+static const canfilt_rule_t *take(canfilt_rule_t *r, uint32_t *n, uint8_t fifo, bool ext, bool exact) {
+  canfilt_rule_t t;
+  uint32_t i;
+
+  for (i = 0; i < *n; i++) {
+    if (r[i].fifo == fifo && r[i].ext == ext && is_exact(&r[i]) == exact) {
+      t = r[i];
+      r[i] = r[--*n];
+      r[*n] = t;
+      return &r[*n];
+    }
+  }
+  return NULL;
+}
+
+static uint32_t emit(canfilt_rule_t *r, uint32_t n, canfilt_bank_t *banks) {
+  const canfilt_rule_t *x, *y, *q[4];
+  canfilt_bank_t *b = banks;
+  uint32_t k;
+  uint8_t fifo;
+
+  for (fifo = 0; fifo < 2; fifo++) {
+    while ((x = take(r, &n, fifo, true, false)) != NULL) {
+      *b++ = (canfilt_bank_t){enc32(x, x->id), enc32_mask(x), fifo, true, false};
+    }
+    while ((x = take(r, &n, fifo, true, true)) != NULL) {
+      if (!(y = take(r, &n, fifo, true, true)) && !(y = take(r, &n, fifo, false, true))) {
+        y = x;
+      }
+      *b++ = (canfilt_bank_t){enc32(x, x->id), enc32(y, y->id), fifo, true, true};
+    }
+    while ((x = take(r, &n, fifo, false, false)) != NULL) {
+      if (!(y = take(r, &n, fifo, false, false)) && !(y = take(r, &n, fifo, false, true))) {
+        y = x;
+      }
+      *b++ = (canfilt_bank_t){enc16_pair(x), enc16_pair(y), fifo, false, false};
+    }
+    while ((q[0] = take(r, &n, fifo, false, true)) != NULL) {
+      for (k = 1; k < 4; k++) {
+        if (!(q[k] = take(r, &n, fifo, false, true))) {
+          q[k] = q[k - 1];
+        }
+      }
+      *b++ = (canfilt_bank_t){enc16(q[0]) | (enc16(q[1]) << 16), enc16(q[2]) | (enc16(q[3]) << 16),
+                              fifo, false, true};
+    }
+  }
+  return b - banks;
+}
+
+uint32_t canfilt_pack(canfilt_rule_t *rules, uint32_t n, canfilt_bank_t *banks,
+                      uint32_t budget, bool *exact) {
+  uint32_t need = canfilt_merge(rules, &n);
+
+  *exact = true;
+  while (need > budget) {
+    if (!widen(rules, &n)) {
+      return 0;
+    }
+    *exact = false;
+    need = tidy(rules, &n);
+  }
+  return emit(rules, n, banks);
+}
+
+uint32_t canfilt_share(canfilt_rule_t *can1, uint32_t n1, canfilt_rule_t *can2, uint32_t n2,
+                       canfilt_bank_t banks[CANFILT_BANKS], uint32_t *split, bool *exact) {
+  uint32_t c1 = 0, c2 = 0, b1, k1 = 0, k2 = 0;
+  bool e1 = true, e2 = true;
+
+  if (n1) {
+    c1 = canfilt_merge(can1, &n1);
+  }
+  if (n2) {
+    c2 = canfilt_merge(can2, &n2);
+  }
+  b1 = c1;
+  if (c1 + c2 > CANFILT_BANKS) {
+    b1 = (CANFILT_BANKS * c1 + (c1 + c2) / 2) / (c1 + c2);
+    b1 = b1 < 1 && n1 ? 1 : b1 >= CANFILT_BANKS && n2 ? CANFILT_BANKS - 1 : b1;
+  }
+  if (n1 && !(k1 = canfilt_pack(can1, n1, banks, b1, &e1))) {
+    return 0;
+  }
+  if (n2 && !(k2 = canfilt_pack(can2, n2, banks + k1, CANFILT_BANKS - k1, &e2))) {
+    return 0;
+  }
+  *split = k1;
+  *exact = e1 && e2;
+  return k1 + k2;
+}
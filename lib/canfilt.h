@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Compiles wanted CAN IDs into bxCAN filter bank register values.
+ *
+ * @details A rule accepts every frame whose ID matches id in the bits set in
+ * mask (an exact ID has all 11 or 29 bits set); the IDE bit always has to
+ * match and only data frames pass. Rules are first merged without changing what they
+ * accept: covered rules are dropped and pairs differing in one cared-for bit
+ * become one rule with that bit cleared from the mask. They are then packed
+ * into the densest bank layouts:
+ *
+ * - 16-bit list:  4 exact standard IDs
+ * - 16-bit mask:  2 masked standard IDs
+ * - 32-bit list:  2 exact IDs of either kind
+ * - 32-bit mask:  1 masked extended ID
+ *
+ * with odd leftovers sharing a slot with exact standard IDs. Only when the
+ * result still does not fit the bank budget are rules widened: the pair whose
+ * merge loses the fewest mask bits goes first. Such filters accept frames
+ * beyond the rules, so the receiver must check IDs again.
+ *
+ * Nothing here touches hardware; the same code runs on the host, where
+ * tools/canfilt_test.c checks it.
+ */
+
+#define CANFILT_BANKS       28  // Shared by CAN1 and CAN2
+#define CANFILT_STD_MASK    0x7FF
+#define CANFILT_EXT_MASK    0x1FFFFFFF
+#define CANFILT_MAX_RULES   64  // Beyond this, merges are not checked for cost
+
+typedef struct {
+  uint32_t id;
+  uint32_t mask;
+  bool ext;
+  uint8_t fifo;                 // 0 or 1
+} canfilt_rule_t;
+
+typedef struct {
+  uint32_t fr1, fr2;            // Filter registers, as written to the bank
+  uint8_t fifo;
+  bool scale32;
+  bool list;
+} canfilt_bank_t;
+
+// Banks the rules need once merged. Rules are rewritten in place; returns the
+// new rule count in *n.
+uint32_t canfilt_merge(canfilt_rule_t *rules, uint32_t *n);
+
+/**
+ * @brief Merges and packs rules into at most budget banks.
+ *
+ * @return Banks written, 0 if they cannot fit (only possible with a budget
+ * below one bank per FIFO and ID kind). *exact tells whether the banks accept
+ * nothing but the rules.
+ */
+uint32_t canfilt_pack(canfilt_rule_t *rules, uint32_t n, canfilt_bank_t *banks,
+                      uint32_t budget, bool *exact);
+
+/**
+ * @brief Packs both controllers' rules into the shared 28 banks.
+ *
+ * @details CAN1 gets banks [0, *split), CAN2 gets [*split, 28). When the exact
+ * filters do not fit, the banks are shared in proportion to what each side
+ * needs and both are widened to fit.
+ *
+ * @return Banks written, 0 on failure.
+ */
+uint32_t canfilt_share(canfilt_rule_t *can1, uint32_t n1, canfilt_rule_t *can2, uint32_t n2,
+                       canfilt_bank_t banks[CANFILT_BANKS], uint32_t *split, bool *exact);
@@ -0,0 +1,55 @@
+#include "crc32.h"
+
+#define POLY                0x04C11DB7
+
+
+/**
+ * @brief zlib-compatible CRC-32 update.
+ *
+ * @details Slicing-by-4: once the pointer is aligned each word is XORed into
+ * the reflected state and replaced by four independent table lookups, one per
+ * byte, instead of four dependent byte steps.
+ */
+uint32_t crc32_update(uint32_t crc, const void *buf, uint32_t len) {
+  const uint8_t *p = buf;
+  uint32_t w;
+
+  crc = ~crc;
+  while (len && ((uintptr_t)p & 3)) {
+    crc = crc32_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    len--;
+  }
+  while (len >= 4) {
+    __builtin_memcpy(&w, p, 4); // Aligned: a single load
+    crc ^= w;
+    crc = crc32_table[3][crc & 0xFF] ^ crc32_table[2][(crc >> 8) & 0xFF] ^
+          crc32_table[1][(crc >> 16) & 0xFF] ^ crc32_table[0][crc >> 24];
+    p += 4;
+    len -= 4;
+  }
+  while (len--) {
+    crc = crc32_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+uint32_t crc32_word(uint32_t state, uint32_t word) {
+  uint32_t i;
+
+  state ^= word;
+  for (i = 0; i < 32; i++) {
+    state = (state << 1) ^ (state & 0x80000000 ? POLY : 0);
+  }
+  return state;
+}
+
+// Each forward step XORs POLY (bit 0 set) exactly when it shifts out a one, so
+// bit 0 of the result tells which step to undo.
+uint32_t crc32_unshift(uint32_t state) {
+  uint32_t i;
+
+  for (i = 0; i < 32; i++) {
+    state = state & 1 ? ((state ^ POLY) >> 1) | 0x80000000 : state >> 1;
+  }
+  return state;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief CRC-32 as used by Ethernet, zlib and PNG, plus a model of the CRC unit.
+ *
+ * @details crc32_update() follows zlib's crc32(): start from 0 and pass the
+ * previous result to continue. It runs slicing-by-4 on aligned words with four
+ * 256-entry tables in flash (crc32_table.c), bytewise on the unaligned head
+ * and tail.
+ *
+ * The CH32V307 CRC unit computes the same polynomial (0x04C11DB7) MSB first on
+ * whole 32-bit words, without reflection or final inversion, and can only be
+ * reset to 0xFFFFFFFF. crc32_word() models one word write. Two identities link
+ * the unit to zlib and are what ch32v307/crc.c builds on:
+ *  - feeding rbit(w) for each little-endian word w leaves rbit(~crc) of the
+ *    zlib result in the unit;
+ *  - after a reset, writing ~crc32_unshift(s) leaves the unit in state s, which
+ *    is how a computation is resumed.
+ *
+ * Nothing here touches hardware; the same code runs on the host.
+ */
+
+uint32_t crc32_update(uint32_t crc, const void *buf, uint32_t len);
+
+// Model of the CRC unit: state after writing word
+uint32_t crc32_word(uint32_t state, uint32_t word);
+// The x with crc32_word(x, 0) == state
+uint32_t crc32_unshift(uint32_t state);
+
+static inline uint32_t crc32_rbit(uint32_t x) {
+  x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+  x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+  return __builtin_bswap32(x);
+}
+
+extern const uint32_t crc32_table[4][256];
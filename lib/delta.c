@@ -0,0 +1,148 @@
+#include "delta.h"
+
+enum { ST_HEADER, ST_CMD, ST_BODY, ST_DONE, ST_FAIL };
+
+
+static inline uint32_t le32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void delta_init(delta_t *d, const uint8_t *old, uint32_t old_size,
+                bool (*write)(void *ctx, uint32_t off, const void *page, uint32_t len),
+                uint32_t (*crc)(uint32_t crc, const void *buf, uint32_t len), void *ctx) {
+  d->old = old;
+  d->old_size = old_size;
+  d->write = write;
+  d->crc = crc;
+  d->ctx = ctx;
+  d->state = ST_HEADER;
+  d->value = 0;
+  d->pos = d->done = d->fill = 0;
+  d->crc_acc = 0;
+}
+
+bool delta_done(const delta_t *d) {
+  return d->state == ST_DONE;
+}
+
+static bool fail(delta_t *d) {
+  d->state = ST_FAIL;
+  return false;
+}
+
+// Appends one byte of the new image; full pages go out at once
+static bool emit(delta_t *d, uint8_t b) {
+  d->page[d->fill++] = b;
+  if (++d->done < d->new_size && d->fill < DELTA_PAGE) {
+    return true;
+  }
+  d->crc_acc = d->crc(d->crc_acc, d->page, d->fill);
+  if (!d->write(d->ctx, d->done - d->fill, d->page, d->fill)) {
+    return fail(d);
+  }
+  d->fill = 0;
+  if (d->done == d->new_size) {
+    d->state = d->crc_acc == d->new_crc ? ST_DONE : ST_FAIL;
+  }
+  return d->state != ST_FAIL;
+}
+
+static bool header(delta_t *d) {
+  const uint8_t *h = d->hdr;
+
+  if (le32(h) != DELTA_MAGIC || le32(h + 4) > d->old_size || le32(h + 12) == 0) {
+    return fail(d);
+  }
+  d->old_size = le32(h + 4);
+  d->old_crc = le32(h + 8);
+  d->new_size = le32(h + 12);
+  d->new_crc = le32(h + 16);
+  // Patching the wrong base would produce a wrong image that still gets written
+  if (d->crc(0, d->old, d->old_size) != d->old_crc) {
+    return fail(d);
+  }
+  d->state = ST_CMD;
+  return true;
+}
+
+// A command just decoded: COPY and SEEK run at once, the others wait for bytes
+static bool command(delta_t *d) {
+  uint32_t n = d->value >> 2;
+  int32_t seek;
+
+  d->kind = d->value & 3;
+  d->value = d->shift = 0;
+  switch (d->kind) {
+  case DELTA_SEEK:
+    seek = n & 1 ? -(int32_t)(n >> 1) - 1 : (int32_t)(n >> 1);
+    if ((seek < 0 && (uint32_t)-seek > d->pos) || (seek > 0 && (uint32_t)seek > d->old_size - d->pos)) {
+      return fail(d);
+    }
+    d->pos += seek;
+    return true;
+  case DELTA_COPY:
+  case DELTA_ADD:
+    if (n > d->old_size - d->pos) {
+      return fail(d);
+    }
+    break;
+  }
+  if (n > d->new_size - d->done) {
+    return fail(d);
+  }
+  if (d->kind == DELTA_COPY) {
+    while (n-- && d->state == ST_CMD) {
+      if (!emit(d, d->old[d->pos++])) {
+        return false;
+      }
+    }
+    return true;
+  }
+  d->left = n;
+  d->state = n ? ST_BODY : ST_CMD;
+  return true;
+}
+
+bool delta_feed(delta_t *d, const void *buf, uint32_t len) {
+  const uint8_t *p = buf;
+  uint8_t b;
+
+  for (; len; len--) {
+    b = *p++;
+    switch (d->state) {
+    case ST_HEADER:
+      d->hdr[d->value++] = b;
+      if (d->value == DELTA_HEADER) {
+        d->value = 0;
+        if (!header(d)) {
+          return false;
+        }
+      }
+      break;
+    case ST_CMD:
+      if (d->shift > 28) {
+        return fail(d);
+      }
+      d->value |= (uint32_t)(b & 0x7F) << d->shift;
+      d->shift += 7;
+      if (!(b & 0x80) && !command(d)) {
+        return false;
+      }
+      break;
+    case ST_BODY:
+      if (d->kind == DELTA_ADD) {
+        b += d->old[d->pos++];
+      }
+      if (--d->left == 0) {
+        d->state = ST_CMD;
+      }
+      if (!emit(d, b)) {
+        return false;
+      }
+      break;
+    default:
+      return fail(d);       // Past the end, or failed before
+    }
+  }
+  return true;
+}
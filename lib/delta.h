@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Streaming applier for bsdiff-style binary delta patches.
+ *
+ * @details A patch is a 20-byte header (DELTA_MAGIC, old size and CRC-32, new
+ * size and CRC-32, little-endian) followed by commands. Each command starts
+ * with a varint v; v & 3 is the kind and v >> 2 its count n:
+ *  - DELTA_COPY   n bytes of old from the cursor, which advances by n;
+ *  - DELTA_ADD    n bytes follow, each added to the old byte under the cursor
+ *    (bsdiff's diff block: code that only moved differs in a few bytes);
+ *  - DELTA_INSERT n literal bytes follow, the cursor stays;
+ *  - DELTA_SEEK   moves the cursor by n, zigzag encoded.
+ * The patch ends when the new image is complete.
+ *
+ * Patch bytes go into delta_feed() in chunks of any size as they arrive. The
+ * old image is read in place (memory-mapped flash on the target) and the new
+ * one leaves through write() one DELTA_PAGE at a time, so RAM use is the
+ * delta_t alone. The old image is checked against the header before anything
+ * is written, and the new one as it is produced, both through crc() (the CRC
+ * unit on the target, crc32_update() on the host).
+ *
+ * Nothing here touches hardware; tools/delta.c makes and applies patches on
+ * the host.
+ */
+
+#define DELTA_MAGIC         0x31544C44  // "DLT1"
+#define DELTA_HEADER        20
+#define DELTA_PAGE          256
+
+enum { DELTA_COPY, DELTA_ADD, DELTA_INSERT, DELTA_SEEK };
+
+typedef struct {
+  const uint8_t *old;
+  uint32_t old_size;
+  // off advances by DELTA_PAGE; only the last call is shorter
+  bool (*write)(void *ctx, uint32_t off, const void *page, uint32_t len);
+  uint32_t (*crc)(uint32_t crc, const void *buf, uint32_t len);
+  void *ctx;
+  // Header
+  uint32_t old_crc;
+  uint32_t new_size;
+  uint32_t new_crc;
+  // Decoder
+  uint8_t state;
+  uint8_t kind;
+  uint8_t shift;
+  uint32_t value;           // Varint, or header bytes seen
+  uint32_t left;            // Of the current command
+  uint32_t pos;             // Cursor into old
+  uint32_t done;            // New bytes produced
+  uint32_t crc_acc;
+  uint32_t fill;
+  uint8_t hdr[DELTA_HEADER];
+  uint8_t page[DELTA_PAGE] __attribute__((aligned(4)));
+} delta_t;
+
+void delta_init(delta_t *d, const uint8_t *old, uint32_t old_size,
+                bool (*write)(void *ctx, uint32_t off, const void *page, uint32_t len),
+                uint32_t (*crc)(uint32_t crc, const void *buf, uint32_t len), void *ctx);
+
+// False on a malformed patch, a wrong old image, a write failure or a CRC mismatch
+bool delta_feed(delta_t *d, const void *buf, uint32_t len);
+
+// The new image is complete, written and matches its CRC
+bool delta_done(const delta_t *d);
@@ -0,0 +1,622 @@
+#include "dsp.h"
+
+#define QTR                 (DSP_FFT_MAX / 4)
+
+
+static inline q15_t sat15(int32_t v) {
+  return v > 32767 ? 32767 : v < -32768 ? -32768 : (q15_t)v;
+}
+
+static inline q31_t sat31(int64_t v) {
+  return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (q31_t)v;
+}
+
+/*
+ * FIR
+ *
+ * state[pos] is the newest sample and state[pos + ntaps - 1] the oldest; every
+ * sample is written to both halves so the window never wraps.
+ */
+
+void dsp_fir_q15_init(dsp_fir_q15_t *f, const q15_t *coef, uint16_t ntaps, q15_t *state) {
+  uint32_t i;
+
+  f->coef = coef;
+  f->state = state;
+  f->ntaps = ntaps;
+  f->pos = 0;
+  for (i = 0; i < 2u * ntaps; i++) {
+    state[i] = 0;
+  }
+}
+
+static inline void push_q15(dsp_fir_q15_t *f, q15_t x) {
+  f->pos = f->pos ? f->pos - 1 : f->ntaps - 1;
+  f->state[f->pos] = x;
+  f->state[f->pos + f->ntaps] = x;
+}
+
+static inline q15_t dot_q15(const dsp_fir_q15_t *f) {
+  const q15_t *h = f->coef;
+  const q15_t *x = f->state + f->pos;
+  int32_t acc = 1 << 14;
+  uint32_t k;
+
+  for (k = f->ntaps >> 2; k; k--) {
+    acc += h[0] * x[0] + h[1] * x[1] + h[2] * x[2] + h[3] * x[3];
+    h += 4;
+    x += 4;
+  }
+  for (k = f->ntaps & 3; k; k--) {
+    acc += *h++ * *x++;
+  }
+  return sat15(acc >> 15);
+}
+
+void dsp_fir_q15(dsp_fir_q15_t *f, const q15_t *in, q15_t *out, uint32_t n) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    push_q15(f, in[i]);
+    out[i] = dot_q15(f);
+  }
+}
+
+void dsp_decim_q15(dsp_fir_q15_t *f, uint32_t factor, const q15_t *in, q15_t *out, uint32_t n) {
+  uint32_t i, k;
+
+  for (i = 0; i + factor <= n; i += factor) {
+    for (k = 0; k < factor; k++) {
+      push_q15(f, in[i + k]);
+    }
+    *out++ = dot_q15(f);
+  }
+}
+
+void dsp_fir_q31_init(dsp_fir_q31_t *f, const q31_t *coef, uint16_t ntaps, q31_t *state) {
+  uint32_t i;
+
+  f->coef = coef;
+  f->state = state;
+  f->ntaps = ntaps;
+  f->pos = 0;
+  for (i = 0; i < 2u * ntaps; i++) {
+    state[i] = 0;
+  }
+}
+
+static inline void push_q31(dsp_fir_q31_t *f, q31_t x) {
+  f->pos = f->pos ? f->pos - 1 : f->ntaps - 1;
+  f->state[f->pos] = x;
+  f->state[f->pos + f->ntaps] = x;
+}
+
+static inline q31_t dot_q31(const dsp_fir_q31_t *f) {
+  const q31_t *h = f->coef;
+  const q31_t *x = f->state + f->pos;
+  int64_t acc = 1 << 30;
+  uint32_t k;
+
+  for (k = f->ntaps >> 2; k; k--) {
+    acc += (int64_t)h[0] * x[0] + (int64_t)h[1] * x[1]
+         + (int64_t)h[2] * x[2] + (int64_t)h[3] * x[3];
+    h += 4;
+    x += 4;
+  }
+  for (k = f->ntaps & 3; k; k--) {
+    acc += (int64_t)*h++ * *x++;
+  }
+  return sat31(acc >> 31);
+}
+
+void dsp_fir_q31(dsp_fir_q31_t *f, const q31_t *in, q31_t *out, uint32_t n) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    push_q31(f, in[i]);
+    out[i] = dot_q31(f);
+  }
+}
+
+void dsp_decim_q31(dsp_fir_q31_t *f, uint32_t factor, const q31_t *in, q31_t *out, uint32_t n) {
+  uint32_t i, k;
+
+  for (i = 0; i + factor <= n; i += factor) {
+    for (k = 0; k < factor; k++) {
+      push_q31(f, in[i + k]);
+    }
+    *out++ = dot_q31(f);
+  }
+}
+
+void dsp_fir_f32_init(dsp_fir_f32_t *f, const float *coef, uint16_t ntaps, float *state) {
+  uint32_t i;
+
+  f->coef = coef;
+  f->state = state;
+  f->ntaps = ntaps;
+  f->pos = 0;
+  for (i = 0; i < 2u * ntaps; i++) {
+    state[i] = 0.0f;
+  }
+}
+
+static inline void push_f32(dsp_fir_f32_t *f, float x) {
+  f->pos = f->pos ? f->pos - 1 : f->ntaps - 1;
+  f->state[f->pos] = x;
+  f->state[f->pos + f->ntaps] = x;
+}
+
+static inline float dot_f32(const dsp_fir_f32_t *f) {
+  const float *h = f->coef;
+  const float *x = f->state + f->pos;
+  // Four independent sums keep the FPU adder pipeline busy
+  float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+  uint32_t k;
+
+  for (k = f->ntaps >> 2; k; k--) {
+    a0 += h[0] * x[0];
+    a1 += h[1] * x[1];
+    a2 += h[2] * x[2];
+    a3 += h[3] * x[3];
+    h += 4;
+    x += 4;
+  }
+  for (k = f->ntaps & 3; k; k--) {
+    a0 += *h++ * *x++;
+  }
+  return (a0 + a1) + (a2 + a3);
+}
+
+void dsp_fir_f32(dsp_fir_f32_t *f, const float *in, float *out, uint32_t n) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    push_f32(f, in[i]);
+    out[i] = dot_f32(f);
+  }
+}
+
+void dsp_decim_f32(dsp_fir_f32_t *f, uint32_t factor, const float *in, float *out, uint32_t n) {
+  uint32_t i, k;
+
+  for (i = 0; i + factor <= n; i += factor) {
+    for (k = 0; k < factor; k++) {
+      push_f32(f, in[i + k]);
+    }
+    *out++ = dot_f32(f);
+  }
+}
+
+/*
+ * Biquad cascades, run one stage at a time over the whole block so the five
+ * coefficients and the state stay in registers.
+ */
+
+void dsp_biquad_q15_init(dsp_biquad_q15_t *b, const q15_t *coef, uint8_t stages, uint8_t shift, q15_t *state) {
+  uint32_t i;
+
+  b->coef = coef;
+  b->state = state;
+  b->stages = stages;
+  b->shift = shift;
+  for (i = 0; i < 4u * stages; i++) {
+    state[i] = 0;
+  }
+}
+
+void dsp_biquad_q15(dsp_biquad_q15_t *b, const q15_t *in, q15_t *out, uint32_t n) {
+  const q15_t *c = b->coef;
+  q15_t *st = b->state;
+  uint32_t sh = 15 - b->shift;
+  uint32_t s, i;
+
+  for (s = 0; s < b->stages; s++, c += 5, st += 4) {
+    int32_t b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+    int32_t x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+    int32_t x, y;
+
+    for (i = 0; i < n; i++) {
+      x = in[i];
+      y = sat15(((1 << (sh - 1)) + b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2) >> sh);
+      x2 = x1;
+      x1 = x;
+      y2 = y1;
+      y1 = y;
+      out[i] = (q15_t)y;
+    }
+    st[0] = (q15_t)x1;
+    st[1] = (q15_t)x2;
+    st[2] = (q15_t)y1;
+    st[3] = (q15_t)y2;
+    in = out;
+  }
+}
+
+void dsp_biquad_q31_init(dsp_biquad_q31_t *b, const q31_t *coef, uint8_t stages, uint8_t shift, q31_t *state) {
+  uint32_t i;
+
+  b->coef = coef;
+  b->state = state;
+  b->stages = stages;
+  b->shift = shift;
+  for (i = 0; i < 4u * stages; i++) {
+    state[i] = 0;
+  }
+}
+
+void dsp_biquad_q31(dsp_biquad_q31_t *b, const q31_t *in, q31_t *out, uint32_t n) {
+  const q31_t *c = b->coef;
+  q31_t *st = b->state;
+  uint32_t sh = 31 - b->shift;
+  uint32_t s, i;
+
+  for (s = 0; s < b->stages; s++, c += 5, st += 4) {
+    int64_t b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+    q31_t x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+    q31_t x, y;
+
+    for (i = 0; i < n; i++) {
+      x = in[i];
+      y = sat31(((1LL << (sh - 1)) + b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2) >> sh);
+      x2 = x1;
+      x1 = x;
+      y2 = y1;
+      y1 = y;
+      out[i] = y;
+    }
+    st[0] = x1;
+    st[1] = x2;
+    st[2] = y1;
+    st[3] = y2;
+    in = out;
+  }
+}
+
+void dsp_biquad_f32_init(dsp_biquad_f32_t *b, const float *coef, uint8_t stages, float *state) {
+  uint32_t i;
+
+  b->coef = coef;
+  b->state = state;
+  b->stages = stages;
+  for (i = 0; i < 2u * stages; i++) {
+    state[i] = 0.0f;
+  }
+}
+
+void dsp_biquad_f32(dsp_biquad_f32_t *b, const float *in, float *out, uint32_t n) {
+  const float *c = b->coef;
+  float *st = b->state;
+  uint32_t s, i;
+
+  for (s = 0; s < b->stages; s++, c += 5, st += 2) {
+    float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+    float d1 = st[0], d2 = st[1];
+    float x, y;
+
+    for (i = 0; i < n; i++) {
+      x = in[i];
+      y = b0 * x + d1;
+      d1 = b1 * x - a1 * y + d2;
+      d2 = b2 * x - a2 * y;
+      out[i] = y;
+    }
+    st[0] = d1;
+    st[1] = d2;
+    in = out;
+  }
+}
+
+/*
+ * FFT
+ *
+ * The complex pass is decimation in frequency. Its radix-4 butterfly stores the
+ * two middle outputs swapped, which makes it equal to two radix-2 passes, so one
+ * bit reversal at the end fixes the order whatever the mix of passes.
+ *
+ * Twiddles W^k = cos(2 pi k / DSP_FFT_MAX) - i sin(2 pi k / DSP_FFT_MAX) are
+ * folded out of the quarter-wave tables; k stays below 3/4 of a turn.
+ */
+
+#define TWIDDLE(table, k, c, s) do {                                          \
+    uint32_t r_ = (k) & (QTR - 1);                                            \
+    switch ((k) / QTR) {                                                      \
+      case 0:  c = table[QTR - r_]; s = table[r_]; break;                     \
+      case 1:  c = -table[r_]; s = table[QTR - r_]; break;                    \
+      default: c = -table[QTR - r_]; s = -table[r_]; break;                   \
+    }                                                                         \
+  } while (0)
+
+static inline uint32_t bitrev_next(uint32_t j, uint32_t m) {
+  uint32_t bit = m >> 1;
+
+  while (j & bit) {
+    j ^= bit;
+    bit >>= 1;
+  }
+  return j | bit;
+}
+
+static bool fft_size_ok(uint32_t n) {
+  return n >= 8 && n <= DSP_FFT_MAX && !(n & (n - 1));
+}
+
+static void cfft_q15(q15_t *z, uint32_t m) {
+  uint32_t l, q, j, i;
+  int32_t c1, s1, c2, s2, c3, s3;
+
+  for (l = m; l >= 4; l >>= 2) {
+    q = l >> 2;
+    for (j = 0; j < q; j++) {
+      TWIDDLE(dsp_sin_q15, j * (DSP_FFT_MAX / l), c1, s1);
+      TWIDDLE(dsp_sin_q15, 2 * j * (DSP_FFT_MAX / l), c2, s2);
+      TWIDDLE(dsp_sin_q15, 3 * j * (DSP_FFT_MAX / l), c3, s3);
+      for (i = j; i < m; i += l) {
+        q15_t *p0 = z + 2 * i, *p1 = p0 + 2 * q, *p2 = p1 + 2 * q, *p3 = p2 + 2 * q;
+        int32_t ar = (p0[0] >> 2) + (p2[0] >> 2), ai = (p0[1] >> 2) + (p2[1] >> 2);
+        int32_t br = (p1[0] >> 2) + (p3[0] >> 2), bi = (p1[1] >> 2) + (p3[1] >> 2);
+        int32_t cr = (p0[0] >> 2) - (p2[0] >> 2), ci = (p0[1] >> 2) - (p2[1] >> 2);
+        int32_t dr = (p1[0] >> 2) - (p3[0] >> 2), di = (p1[1] >> 2) - (p3[1] >> 2);
+        int32_t tr, ti;
+
+        p0[0] = (q15_t)(ar + br);
+        p0[1] = (q15_t)(ai + bi);
+        tr = ar - br;
+        ti = ai - bi;
+        p1[0] = (q15_t)((tr * c2 + ti * s2 + (1 << 14)) >> 15);
+        p1[1] = (q15_t)((ti * c2 - tr * s2 + (1 << 14)) >> 15);
+        tr = cr + di;
+        ti = ci - dr;
+        p2[0] = (q15_t)((tr * c1 + ti * s1 + (1 << 14)) >> 15);
+        p2[1] = (q15_t)((ti * c1 - tr * s1 + (1 << 14)) >> 15);
+        tr = cr - di;
+        ti = ci + dr;
+        p3[0] = (q15_t)((tr * c3 + ti * s3 + (1 << 14)) >> 15);
+        p3[1] = (q15_t)((ti * c3 - tr * s3 + (1 << 14)) >> 15);
+      }
+    }
+  }
+  if (l == 2) {
+    for (i = 0; i < 2 * m; i += 4) {
+      int32_t ar = z[i] >> 1, ai = z[i + 1] >> 1, br = z[i + 2] >> 1, bi = z[i + 3] >> 1;
+
+      z[i] = (q15_t)(ar + br);
+      z[i + 1] = (q15_t)(ai + bi);
+      z[i + 2] = (q15_t)(ar - br);
+      z[i + 3] = (q15_t)(ai - bi);
+    }
+  }
+  for (i = 0, j = 0; i < m; i++, j = bitrev_next(j, m)) {
+    if (i < j) {
+      q15_t r = z[2 * i], im = z[2 * i + 1];
+
+      z[2 * i] = z[2 * j];
+      z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = r;
+      z[2 * j + 1] = im;
+    }
+  }
+}
+
+bool dsp_rfft_q15(q15_t *x, uint32_t n) {
+  uint32_t m = n >> 1;
+  uint32_t k;
+  int32_t c, s, er, ei, odr, odi, tr, ti;
+  q15_t *zk, *zm;
+
+  if (!fft_size_ok(n)) {
+    return false;
+  }
+  cfft_q15(x, m);
+
+  // X[k] = E[k] + W^k O[k] and X[m - k] = conj(E[k] - W^k O[k]), both / 2
+  for (k = 1; k < m / 2; k++) {
+    TWIDDLE(dsp_sin_q15, k * (DSP_FFT_MAX / n), c, s);
+    zk = x + 2 * k;
+    zm = x + 2 * (m - k);
+    er = (zk[0] + zm[0]) >> 2;
+    ei = (zk[1] - zm[1]) >> 2;
+    odr = (zk[1] + zm[1]) >> 2;
+    odi = (zm[0] - zk[0]) >> 2;
+    tr = (odr * c + odi * s + (1 << 14)) >> 15;
+    ti = (odi * c - odr * s + (1 << 14)) >> 15;
+    zk[0] = sat15(er + tr);
+    zk[1] = sat15(ei + ti);
+    zm[0] = sat15(er - tr);
+    zm[1] = sat15(ti - ei);
+  }
+  zk = x + m;
+  zk[0] = zk[0] >> 1;
+  zk[1] = (q15_t)(-(zk[1] >> 1));
+  tr = x[0];
+  ti = x[1];
+  x[0] = (q15_t)((tr + ti) >> 1);
+  x[1] = (q15_t)((tr - ti) >> 1);
+  return true;
+}
+
+static void cfft_q31(q31_t *z, uint32_t m) {
+  uint32_t l, q, j, i;
+  int64_t c1, s1, c2, s2, c3, s3;
+
+  for (l = m; l >= 4; l >>= 2) {
+    q = l >> 2;
+    for (j = 0; j < q; j++) {
+      TWIDDLE(dsp_sin_q31, j * (DSP_FFT_MAX / l), c1, s1);
+      TWIDDLE(dsp_sin_q31, 2 * j * (DSP_FFT_MAX / l), c2, s2);
+      TWIDDLE(dsp_sin_q31, 3 * j * (DSP_FFT_MAX / l), c3, s3);
+      for (i = j; i < m; i += l) {
+        q31_t *p0 = z + 2 * i, *p1 = p0 + 2 * q, *p2 = p1 + 2 * q, *p3 = p2 + 2 * q;
+        int32_t ar = (p0[0] >> 2) + (p2[0] >> 2), ai = (p0[1] >> 2) + (p2[1] >> 2);
+        int32_t br = (p1[0] >> 2) + (p3[0] >> 2), bi = (p1[1] >> 2) + (p3[1] >> 2);
+        int32_t cr = (p0[0] >> 2) - (p2[0] >> 2), ci = (p0[1] >> 2) - (p2[1] >> 2);
+        int32_t dr = (p1[0] >> 2) - (p3[0] >> 2), di = (p1[1] >> 2) - (p3[1] >> 2);
+        int64_t tr, ti;
+
+        p0[0] = ar + br;
+        p0[1] = ai + bi;
+        tr = ar - br;
+        ti = ai - bi;
+        p1[0] = (q31_t)((tr * c2 + ti * s2 + (1LL << 30)) >> 31);
+        p1[1] = (q31_t)((ti * c2 - tr * s2 + (1LL << 30)) >> 31);
+        tr = (int64_t)cr + di;
+        ti = (int64_t)ci - dr;
+        p2[0] = (q31_t)((tr * c1 + ti * s1 + (1LL << 30)) >> 31);
+        p2[1] = (q31_t)((ti * c1 - tr * s1 + (1LL << 30)) >> 31);
+        tr = (int64_t)cr - di;
+        ti = (int64_t)ci + dr;
+        p3[0] = (q31_t)((tr * c3 + ti * s3 + (1LL << 30)) >> 31);
+        p3[1] = (q31_t)((ti * c3 - tr * s3 + (1LL << 30)) >> 31);
+      }
+    }
+  }
+  if (l == 2) {
+    for (i = 0; i < 2 * m; i += 4) {
+      int32_t ar = z[i] >> 1, ai = z[i + 1] >> 1, br = z[i + 2] >> 1, bi = z[i + 3] >> 1;
+
+      z[i] = ar + br;
+      z[i + 1] = ai + bi;
+      z[i + 2] = ar - br;
+      z[i + 3] = ai - bi;
+    }
+  }
+  for (i = 0, j = 0; i < m; i++, j = bitrev_next(j, m)) {
+    if (i < j) {
+      q31_t r = z[2 * i], im = z[2 * i + 1];
+
+      z[2 * i] = z[2 * j];
+      z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = r;
+      z[2 * j + 1] = im;
+    }
+  }
+}
+
+bool dsp_rfft_q31(q31_t *x, uint32_t n) {
+  uint32_t m = n >> 1;
+  uint32_t k;
+  int64_t c, s, odr, odi, tr, ti;
+  int32_t er, ei;
+  q31_t *zk, *zm;
+
+  if (!fft_size_ok(n)) {
+    return false;
+  }
+  cfft_q31(x, m);
+
+  for (k = 1; k < m / 2; k++) {
+    TWIDDLE(dsp_sin_q31, k * (DSP_FFT_MAX / n), c, s);
+    zk = x + 2 * k;
+    zm = x + 2 * (m - k);
+    er = (zk[0] >> 2) + (zm[0] >> 2);
+    ei = (zk[1] >> 2) - (zm[1] >> 2);
+    odr = (zk[1] >> 2) + (zm[1] >> 2);
+    odi = (zm[0] >> 2) - (zk[0] >> 2);
+    tr = (odr * c + odi * s + (1LL << 30)) >> 31;
+    ti = (odi * c - odr * s + (1LL << 30)) >> 31;
+    zk[0] = sat31(er + tr);
+    zk[1] = sat31(ei + ti);
+    zm[0] = sat31(er - tr);
+    zm[1] = sat31(ti - ei);
+  }
+  zk = x + m;
+  zk[0] = zk[0] >> 1;
+  zk[1] = -(zk[1] >> 1);
+  tr = x[0];
+  ti = x[1];
+  x[0] = (q31_t)((tr + ti) >> 1);
+  x[1] = (q31_t)((tr - ti) >> 1);
+  return true;
+}
+
+static void cfft_f32(float *z, uint32_t m) {
+  uint32_t l, q, j, i;
+  float c1, s1, c2, s2, c3, s3;
+
+  for (l = m; l >= 4; l >>= 2) {
+    q = l >> 2;
+    for (j = 0; j < q; j++) {
+      TWIDDLE(dsp_sin_f32, j * (DSP_FFT_MAX / l), c1, s1);
+      TWIDDLE(dsp_sin_f32, 2 * j * (DSP_FFT_MAX / l), c2, s2);
+      TWIDDLE(dsp_sin_f32, 3 * j * (DSP_FFT_MAX / l), c3, s3);
+      for (i = j; i < m; i += l) {
+        float *p0 = z + 2 * i, *p1 = p0 + 2 * q, *p2 = p1 + 2 * q, *p3 = p2 + 2 * q;
+        float ar = p0[0] + p2[0], ai = p0[1] + p2[1];
+        float br = p1[0] + p3[0], bi = p1[1] + p3[1];
+        float cr = p0[0] - p2[0], ci = p0[1] - p2[1];
+        float dr = p1[0] - p3[0], di = p1[1] - p3[1];
+        float tr, ti;
+
+        p0[0] = ar + br;
+        p0[1] = ai + bi;
+        tr = ar - br;
+        ti = ai - bi;
+        p1[0] = tr * c2 + ti * s2;
+        p1[1] = ti * c2 - tr * s2;
+        tr = cr + di;
+        ti = ci - dr;
+        p2[0] = tr * c1 + ti * s1;
+        p2[1] = ti * c1 - tr * s1;
+        tr = cr - di;
+        ti = ci + dr;
+        p3[0] = tr * c3 + ti * s3;
+        p3[1] = ti * c3 - tr * s3;
+      }
+    }
+  }
+  if (l == 2) {
+    for (i = 0; i < 2 * m; i += 4) {
+      float ar = z[i], ai = z[i + 1], br = z[i + 2], bi = z[i + 3];
+
+      z[i] = ar + br;
+      z[i + 1] = ai + bi;
+      z[i + 2] = ar - br;
+      z[i + 3] = ai - bi;
+    }
+  }
+  for (i = 0, j = 0; i < m; i++, j = bitrev_next(j, m)) {
+    if (i < j) {
+      float r = z[2 * i], im = z[2 * i + 1];
+
+      z[2 * i] = z[2 * j];
+      z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = r;
+      z[2 * j + 1] = im;
+    }
+  }
+}
+
+bool dsp_rfft_f32(float *x, uint32_t n) {
+  uint32_t m = n >> 1;
+  uint32_t k;
+  float c, s, er, ei, odr, odi, tr, ti;
+  float *zk, *zm;
+
+  if (!fft_size_ok(n)) {
+    return false;
+  }
+  cfft_f32(x, m);
+
+  for (k = 1; k < m / 2; k++) {
+    TWIDDLE(dsp_sin_f32, k * (DSP_FFT_MAX / n), c, s);
+    zk = x + 2 * k;
+    zm = x + 2 * (m - k);
+    er = 0.5f * (zk[0] + zm[0]);
+    ei = 0.5f * (zk[1] - zm[1]);
+    odr = 0.5f * (zk[1] + zm[1]);
+    odi = 0.5f * (zm[0] - zk[0]);
+    tr = odr * c + odi * s;
+    ti = odi * c - odr * s;
+    zk[0] = er + tr;
+    zk[1] = ei + ti;
+    zm[0] = er - tr;
+    zm[1] = ti - ei;
+  }
+  zk = x + m;
+  zk[1] = -zk[1];
+  tr = x[0];
+  ti = x[1];
+  x[0] = tr + ti;
+  x[1] = tr - ti;
+  return true;
+}
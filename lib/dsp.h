@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Filter and spectrum kernels in Q15, Q31 and float32.
+ *
+ * @details Each kernel comes in three flavours with the same shape:
+ *  - FIR filters keep a doubled delay line (2 * ntaps samples) so the window is
+ *    always contiguous and the multiply-accumulate loop has no wrap test; the
+ *    loop is unrolled by four.
+ *  - Decimators push `factor` samples through the delay line and evaluate the
+ *    taps once, so they cost ntaps MACs per output instead of per input.
+ *  - Biquad cascades take five coefficients per stage {b0, b1, b2, a1, a2} for
+ *    H(z) = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2). The fixed-point
+ *    versions are direct form I with coefficients in Q(15 - shift) / Q(31 - shift)
+ *    so that |a1| up to 2 fits; the float version is transposed direct form II.
+ *  - The real FFT runs a radix-4 complex FFT of N/2 points (one radix-2 pass when
+ *    log2(N/2) is odd) on the interleaved input and splits the result in place.
+ *    The output is packed as {X[0], X[N/2], Re X[1], Im X[1], ...
+ *    Re X[N/2-1], Im X[N/2-1]}.
+ *
+ * Twiddles come from a quarter-wave sine table in flash (dsp_tables.c) sized
+ * for DSP_FFT_MAX points; smaller transforms stride through it.
+ *
+ * Fixed-point rounding is fixed by the code (no saturation inside the loops,
+ * round-half-up and saturation on output), so results are bit-exact between
+ * the target and a host build.
+ *
+ * @note The Q15 FIR and biquad accumulate in 32 bits: the FIR needs sum|h| <= 1
+ * and the biquad stages must not overshoot full scale internally. The Q31
+ * kernels accumulate in 64 bits. The fixed-point FFTs scale by 1/4 per radix-4
+ * pass, 1/2 per radix-2 pass and 1/2 in the split, so they return X[k] / N;
+ * the input must stay within +-0.7 of full scale, since pairs of samples are
+ * treated as one complex value whose magnitude must not exceed 1.
+ */
+
+#define DSP_FFT_MAX         2048  // Largest real FFT, power of two
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+
+typedef struct {
+  const q15_t *coef;
+  q15_t *state;         // 2 * ntaps samples
+  uint16_t ntaps;
+  uint16_t pos;
+} dsp_fir_q15_t;
+
+typedef struct {
+  const q31_t *coef;
+  q31_t *state;
+  uint16_t ntaps;
+  uint16_t pos;
+} dsp_fir_q31_t;
+
+typedef struct {
+  const float *coef;
+  float *state;
+  uint16_t ntaps;
+  uint16_t pos;
+} dsp_fir_f32_t;
+
+typedef struct {
+  const q15_t *coef;    // 5 per stage
+  q15_t *state;         // 4 per stage: x[n-1], x[n-2], y[n-1], y[n-2]
+  uint8_t stages;
+  uint8_t shift;        // Coefficients are Q(15 - shift)
+} dsp_biquad_q15_t;
+
+typedef struct {
+  const q31_t *coef;
+  q31_t *state;
+  uint8_t stages;
+  uint8_t shift;
+} dsp_biquad_q31_t;
+
+typedef struct {
+  const float *coef;
+  float *state;         // 2 per stage
+  uint8_t stages;
+} dsp_biquad_f32_t;
+
+// FIR: coef[k] multiplies x[n - k]. in and out may be the same buffer.
+void dsp_fir_q15_init(dsp_fir_q15_t *f, const q15_t *coef, uint16_t ntaps, q15_t *state);
+void dsp_fir_q15(dsp_fir_q15_t *f, const q15_t *in, q15_t *out, uint32_t n);
+void dsp_fir_q31_init(dsp_fir_q31_t *f, const q31_t *coef, uint16_t ntaps, q31_t *state);
+void dsp_fir_q31(dsp_fir_q31_t *f, const q31_t *in, q31_t *out, uint32_t n);
+void dsp_fir_f32_init(dsp_fir_f32_t *f, const float *coef, uint16_t ntaps, float *state);
+void dsp_fir_f32(dsp_fir_f32_t *f, const float *in, float *out, uint32_t n);
+
+// Decimating FIR on the same state: n must be a multiple of factor, writes n / factor
+void dsp_decim_q15(dsp_fir_q15_t *f, uint32_t factor, const q15_t *in, q15_t *out, uint32_t n);
+void dsp_decim_q31(dsp_fir_q31_t *f, uint32_t factor, const q31_t *in, q31_t *out, uint32_t n);
+void dsp_decim_f32(dsp_fir_f32_t *f, uint32_t factor, const float *in, float *out, uint32_t n);
+
+void dsp_biquad_q15_init(dsp_biquad_q15_t *b, const q15_t *coef, uint8_t stages, uint8_t shift, q15_t *state);
+void dsp_biquad_q15(dsp_biquad_q15_t *b, const q15_t *in, q15_t *out, uint32_t n);
+void dsp_biquad_q31_init(dsp_biquad_q31_t *b, const q31_t *coef, uint8_t stages, uint8_t shift, q31_t *state);
+void dsp_biquad_q31(dsp_biquad_q31_t *b, const q31_t *in, q31_t *out, uint32_t n);
+void dsp_biquad_f32_init(dsp_biquad_f32_t *b, const float *coef, uint8_t stages, float *state);
+void dsp_biquad_f32(dsp_biquad_f32_t *b, const float *in, float *out, uint32_t n);
+
+// In-place real FFT, n a power of two from 8 to DSP_FFT_MAX; false otherwise
+bool dsp_rfft_q15(q15_t *x, uint32_t n);
+bool dsp_rfft_q31(q31_t *x, uint32_t n);
+bool dsp_rfft_f32(float *x, uint32_t n);
+
+// Quarter-wave sine tables, DSP_FFT_MAX / 4 + 1 entries: sin(2 pi i / DSP_FFT_MAX)
+extern const q15_t dsp_sin_q15[];
+extern const q31_t dsp_sin_q31[];
+extern const float dsp_sin_f32[];
@@ -0,0 +1,247 @@
+// Generated by tools/dsp_tables.py 2048, do not edit
+#include "dsp.h"
+
+#if DSP_FFT_MAX != 2048
+#error "regenerate dsp_tables.c for DSP_FFT_MAX"
+#endif
+
+const q15_t dsp_sin_q15[DSP_FFT_MAX / 4 + 1] = {
+  0, 101, 201, 302, 402, 503, 603, 704, 804, 905, 1005, 1106,
+  1206, 1307, 1407, 1507, 1608, 1708, 1809, 1909, 2009, 2110, 2210, 2310,
+  2411, 2511, 2611, 2711, 2811, 2912, 3012, 3112, 3212, 3312, 3412, 3512,
+  3612, 3712, 3812, 3911, 4011, 4111, 4211, 4310, 4410, 4510, 4609, 4709,
+  4808, 4907, 5007, 5106, 5205, 5305, 5404, 5503, 5602, 5701, 5800, 5899,
+  5998, 6097, 6195, 6294, 6393, 6491, 6590, 6688, 6787, 6885, 6983, 7081,
+  7180, 7278, 7376, 7473, 7571, 7669, 7767, 7864, 7962, 8059, 8157, 8254,
+  8351, 8449, 8546, 8643, 8740, 8836, 8933, 9030, 9127, 9223, 9319, 9416,
+  9512, 9608, 9704, 9800, 9896, 9992, 10088, 10183, 10279, 10374, 10469, 10565,
+  10660, 10755, 10850, 10945, 11039, 11134, 11228, 11323, 11417, 11511, 11605, 11699,
+  11793, 11887, 11980, 12074, 12167, 12261, 12354, 12447, 12540, 12633, 12725, 12818,
+  12910, 13003, 13095, 13187, 13279, 13371, 13463, 13554, 13646, 13737, 13828, 13919,
+  14010, 14101, 14192, 14282, 14373, 14463, 14553, 14643, 14733, 14823, 14912, 15002,
+  15091, 15180, 15269, 15358, 15447, 15535, 15624, 15712, 15800, 15888, 15976, 16064,
+  16151, 16239, 16326, 16413, 16500, 16587, 16673, 16760, 16846, 16932, 17018, 17104,
+  17190, 17275, 17361, 17446, 17531, 17616, 17700, 17785, 17869, 17953, 18037, 18121,
+  18205, 18288, 18372, 18455, 18538, 18621, 18703, 18786, 18868, 18950, 19032, 19114,
+  19195, 19277, 19358, 19439, 19520, 19601, 19681, 19761, 19841, 19921, 20001, 20081,
+  20160, 20239, 20318, 20397, 20475, 20554, 20632, 20710, 20788, 20865, 20943, 21020,
+  21097, 21174, 21251, 21327, 21403, 21479, 21555, 21631, 21706, 21781, 21856, 21931,
+  22006, 22080, 22154, 22228, 22302, 22375, 22449, 22522, 22595, 22668, 22740, 22812,
+  22884, 22956, 23028, 23099, 23170, 23241, 23312, 23383, 23453, 23523, 23593, 23663,
+  23732, 23801, 23870, 23939, 24008, 24076, 24144, 24212, 24279, 24347, 24414, 24481,
+  24548, 24614, 24680, 24746, 24812, 24878, 24943, 25008, 25073, 25138, 25202, 25266,
+  25330, 25394, 25457, 25520, 25583, 25646, 25708, 25771, 25833, 25894, 25956, 26017,
+  26078, 26139, 26199, 26259, 26320, 26379, 26439, 26498, 26557, 26616, 26674, 26733,
+  26791, 26848, 26906, 26963, 27020, 27077, 27133, 27190, 27246, 27301, 27357, 27412,
+  27467, 27522, 27576, 27630, 27684, 27738, 27791, 27844, 27897, 27950, 28002, 28054,
+  28106, 28158, 28209, 28260, 28311, 28361, 28411, 28461, 28511, 28560, 28610, 28658,
+  28707, 28755, 28803, 28851, 28899, 28946, 28993, 29040, 29086, 29132, 29178, 29224,
+  29269, 29314, 29359, 29404, 29448, 29492, 29535, 29579, 29622, 29665, 29707, 29750,
+  29792, 29833, 29875, 29916, 29957, 29997, 30038, 30078, 30118, 30157, 30196, 30235,
+  30274, 30312, 30350, 30388, 30425, 30462, 30499, 30536, 30572, 30608, 30644, 30680,
+  30715, 30750, 30784, 30819, 30853, 30886, 30920, 30953, 30986, 31018, 31050, 31082,
+  31114, 31146, 31177, 31207, 31238, 31268, 31298, 31328, 31357, 31386, 31415, 31443,
+  31471, 31499, 31527, 31554, 31581, 31608, 31634, 31660, 31686, 31711, 31737, 31761,
+  31786, 31810, 31834, 31858, 31881, 31904, 31927, 31950, 31972, 31994, 32015, 32037,
+  32058, 32078, 32099, 32119, 32138, 32158, 32177, 32196, 32214, 32233, 32251, 32268,
+  32286, 32303, 32319, 32336, 32352, 32368, 32383, 32398, 32413, 32428, 32442, 32456,
+  32470, 32483, 32496, 32509, 32522, 32534, 32546, 32557, 32568, 32579, 32590, 32600,
+  32610, 32620, 32629, 32638, 32647, 32656, 32664, 32672, 32679, 32686, 32693, 32700,
+  32706, 32712, 32718, 32723, 32729, 32733, 32738, 32742, 32746, 32749, 32753, 32756,
+  32758, 32760, 32762, 32764, 32766, 32767, 32767, 32767, 32767,
+};
+
+const q31_t dsp_sin_q31[DSP_FFT_MAX / 4 + 1] = {
+  0, 6588387, 13176712, 19764913, 26352928, 32940695,
+  39528151, 46115236, 52701887, 59288042, 65873638, 72458615,
+  79042909, 85626460, 92209205, 98791081, 105372028, 111951983,
+  118530885, 125108670, 131685278, 138260647, 144834714, 151407418,
+  157978697, 164548489, 171116733, 177683365, 184248325, 190811551,
+  197372981, 203932553, 210490206, 217045878, 223599506, 230151030,
+  236700388, 243247518, 249792358, 256334847, 262874923, 269412525,
+  275947592, 282480061, 289009871, 295536961, 302061269, 308582734,
+  315101295, 321616889, 328129457, 334638936, 341145265, 347648383,
+  354148230, 360644742, 367137861, 373627523, 380113669, 386596237,
+  393075166, 399550396, 406021865, 412489512, 418953276, 425413098,
+  431868915, 438320667, 444768294, 451211734, 457650927, 464085813,
+  470516330, 476942419, 483364019, 489781069, 496193509, 502601279,
+  509004318, 515402566, 521795963, 528184449, 534567963, 540946445,
+  547319836, 553688076, 560051104, 566408860, 572761285, 579108320,
+  585449903, 591785976, 598116479, 604441352, 610760536, 617073971,
+  623381598, 629683357, 635979190, 642269036, 648552838, 654830535,
+  661102068, 667367379, 673626408, 679879097, 686125387, 692365218,
+  698598533, 704825272, 711045377, 717258790, 723465451, 729665303,
+  735858287, 742044345, 748223418, 754395449, 760560380, 766718151,
+  772868706, 779011986, 785147934, 791276492, 797397602, 803511207,
+  809617249, 815715670, 821806413, 827889422, 833964638, 840032004,
+  846091463, 852142959, 858186435, 864221832, 870249095, 876268167,
+  882278992, 888281512, 894275671, 900261413, 906238681, 912207419,
+  918167572, 924119082, 930061894, 935995952, 941921200, 947837582,
+  953745043, 959643527, 965532978, 971413342, 977284562, 983146583,
+  988999351, 994842810, 1000676905, 1006501581, 1012316784, 1018122458,
+  1023918550, 1029705004, 1035481766, 1041248781, 1047005996, 1052753357,
+  1058490808, 1064218296, 1069935768, 1075643169, 1081340445, 1087027544,
+  1092704411, 1098370993, 1104027237, 1109673089, 1115308496, 1120933406,
+  1126547765, 1132151521, 1137744621, 1143327011, 1148898640, 1154459456,
+  1160009405, 1165548435, 1171076495, 1176593533, 1182099496, 1187594332,
+  1193077991, 1198550419, 1204011567, 1209461382, 1214899813, 1220326809,
+  1225742318, 1231146291, 1236538675, 1241919421, 1247288478, 1252645794,
+  1257991320, 1263325005, 1268646800, 1273956653, 1279254516, 1284540337,
+  1289814068, 1295075659, 1300325060, 1305562222, 1310787095, 1315999631,
+  1321199781, 1326387494, 1331562723, 1336725419, 1341875533, 1347013017,
+  1352137822, 1357249901, 1362349204, 1367435685, 1372509294, 1377569986,
+  1382617710, 1387652422, 1392674072, 1397682613, 1402678000, 1407660183,
+  1412629117, 1417584755, 1422527051, 1427455956, 1432371426, 1437273414,
+  1442161874, 1447036760, 1451898025, 1456745625, 1461579514, 1466399645,
+  1471205974, 1475998456, 1480777044, 1485541696, 1490292364, 1495029006,
+  1499751576, 1504460029, 1509154322, 1513834411, 1518500250, 1523151797,
+  1527789007, 1532411837, 1537020244, 1541614183, 1546193612, 1550758488,
+  1555308768, 1559844408, 1564365367, 1568871601, 1573363068, 1577839726,
+  1582301533, 1586748447, 1591180426, 1595597428, 1599999411, 1604386335,
+  1608758157, 1613114838, 1617456335, 1621782608, 1626093616, 1630389319,
+  1634669676, 1638934646, 1643184191, 1647418269, 1651636841, 1655839867,
+  1660027308, 1664199124, 1668355276, 1672495725, 1676620432, 1680729357,
+  1684822463, 1688899711, 1692961062, 1697006479, 1701035922, 1705049355,
+  1709046739, 1713028037, 1716993211, 1720942225, 1724875040, 1728791620,
+  1732691928, 1736575927, 1740443581, 1744294853, 1748129707, 1751948107,
+  1755750017, 1759535401, 1763304224, 1767056450, 1770792044, 1774510970,
+  1778213194, 1781898681, 1785567396, 1789219305, 1792854372, 1796472565,
+  1800073849, 1803658189, 1807225553, 1810775906, 1814309216, 1817825449,
+  1821324572, 1824806552, 1828271356, 1831718951, 1835149306, 1838562388,
+  1841958164, 1845336604, 1848697674, 1852041343, 1855367581, 1858676355,
+  1861967634, 1865241388, 1868497586, 1871736196, 1874957189, 1878160535,
+  1881346202, 1884514161, 1887664383, 1890796837, 1893911494, 1897008325,
+  1900087301, 1903148392, 1906191570, 1909216806, 1912224073, 1915213340,
+  1918184581, 1921137767, 1924072871, 1926989864, 1929888720, 1932769411,
+  1935631910, 1938476190, 1941302225, 1944109987, 1946899451, 1949670589,
+  1952423377, 1955157788, 1957873796, 1960571375, 1963250501, 1965911148,
+  1968553292, 1971176906, 1973781967, 1976368450, 1978936331, 1981485585,
+  1984016189, 1986528118, 1989021350, 1991495860, 1993951625, 1996388622,
+  1998806829, 2001206222, 2003586779, 2005948478, 2008291295, 2010615210,
+  2012920201, 2015206245, 2017473321, 2019721407, 2021950484, 2024160529,
+  2026351522, 2028523442, 2030676269, 2032809982, 2034924562, 2037019988,
+  2039096241, 2041153301, 2043191150, 2045209767, 2047209133, 2049189231,
+  2051150040, 2053091544, 2055013723, 2056916560, 2058800036, 2060664133,
+  2062508835, 2064334124, 2066139983, 2067926394, 2069693342, 2071440808,
+  2073168777, 2074877233, 2076566160, 2078235540, 2079885360, 2081515603,
+  2083126254, 2084717298, 2086288720, 2087840505, 2089372638, 2090885105,
+  2092377892, 2093850985, 2095304370, 2096738032, 2098151960, 2099546139,
+  2100920556, 2102275199, 2103610054, 2104925109, 2106220352, 2107495770,
+  2108751352, 2109987085, 2111202959, 2112398960, 2113575080, 2114731305,
+  2115867626, 2116984031, 2118080511, 2119157054, 2120213651, 2121250292,
+  2122266967, 2123263666, 2124240380, 2125197100, 2126133817, 2127050522,
+  2127947206, 2128823862, 2129680480, 2130517052, 2131333572, 2132130030,
+  2132906420, 2133662734, 2134398966, 2135115107, 2135811153, 2136487095,
+  2137142927, 2137778644, 2138394240, 2138989708, 2139565043, 2140120240,
+  2140655293, 2141170197, 2141664948, 2142139541, 2142593971, 2143028234,
+  2143442326, 2143836244, 2144209982, 2144563539, 2144896910, 2145210092,
+  2145503083, 2145775880, 2146028480, 2146260881, 2146473080, 2146665076,
+  2146836866, 2146988450, 2147119825, 2147230991, 2147321946, 2147392690,
+  2147443222, 2147473542, 2147483647,
+};
+
+const float dsp_sin_f32[DSP_FFT_MAX / 4 + 1] = {
+  0.000000000e+00f, 3.067956763e-03f, 6.135884649e-03f, 9.203754782e-03f, 1.227153829e-02f,
+  1.533920628e-02f, 1.840672991e-02f, 2.147408028e-02f, 2.454122852e-02f, 2.760814578e-02f,
+  3.067480318e-02f, 3.374117185e-02f, 3.680722294e-02f, 3.987292759e-02f, 4.293825693e-02f,
+  4.600318213e-02f, 4.906767433e-02f, 5.213170468e-02f, 5.519524435e-02f, 5.825826450e-02f,
+  6.132073630e-02f, 6.438263093e-02f, 6.744391956e-02f, 7.050457339e-02f, 7.356456360e-02f,
+  7.662386139e-02f, 7.968243797e-02f, 8.274026455e-02f, 8.579731234e-02f, 8.885355258e-02f,
+  9.190895650e-02f, 9.496349533e-02f, 9.801714033e-02f, 1.010698628e-01f, 1.041216339e-01f,
+  1.071724250e-01f, 1.102222073e-01f, 1.132709522e-01f, 1.163186309e-01f, 1.193652148e-01f,
+  1.224106752e-01f, 1.254549834e-01f, 1.284981108e-01f, 1.315400287e-01f, 1.345807085e-01f,
+  1.376201216e-01f, 1.406582393e-01f, 1.436950332e-01f, 1.467304745e-01f, 1.497645347e-01f,
+  1.527971853e-01f, 1.558283977e-01f, 1.588581433e-01f, 1.618863938e-01f, 1.649131205e-01f,
+  1.679382950e-01f, 1.709618888e-01f, 1.739838734e-01f, 1.770042204e-01f, 1.800229014e-01f,
+  1.830398880e-01f, 1.860551517e-01f, 1.890686641e-01f, 1.920803970e-01f, 1.950903220e-01f,
+  1.980984107e-01f, 2.011046348e-01f, 2.041089661e-01f, 2.071113762e-01f, 2.101118369e-01f,
+  2.131103199e-01f, 2.161067971e-01f, 2.191012402e-01f, 2.220936210e-01f, 2.250839114e-01f,
+  2.280720832e-01f, 2.310581083e-01f, 2.340419586e-01f, 2.370236060e-01f, 2.400030224e-01f,
+  2.429801799e-01f, 2.459550503e-01f, 2.489276057e-01f, 2.518978182e-01f, 2.548656596e-01f,
+  2.578311022e-01f, 2.607941179e-01f, 2.637546790e-01f, 2.667127575e-01f, 2.696683256e-01f,
+  2.726213554e-01f, 2.755718193e-01f, 2.785196894e-01f, 2.814649379e-01f, 2.844075372e-01f,
+  2.873474595e-01f, 2.902846773e-01f, 2.932191627e-01f, 2.961508882e-01f, 2.990798263e-01f,
+  3.020059493e-01f, 3.049292297e-01f, 3.078496400e-01f, 3.107671527e-01f, 3.136817404e-01f,
+  3.165933756e-01f, 3.195020308e-01f, 3.224076788e-01f, 3.253102922e-01f, 3.282098436e-01f,
+  3.311063058e-01f, 3.339996514e-01f, 3.368898534e-01f, 3.397768844e-01f, 3.426607173e-01f,
+  3.455413250e-01f, 3.484186802e-01f, 3.512927561e-01f, 3.541635254e-01f, 3.570309612e-01f,
+  3.598950365e-01f, 3.627557244e-01f, 3.656129978e-01f, 3.684668300e-01f, 3.713171940e-01f,
+  3.741640630e-01f, 3.770074102e-01f, 3.798472089e-01f, 3.826834324e-01f, 3.855160538e-01f,
+  3.883450467e-01f, 3.911703843e-01f, 3.939920401e-01f, 3.968099874e-01f, 3.996241998e-01f,
+  4.024346509e-01f, 4.052413140e-01f, 4.080441629e-01f, 4.108431711e-01f, 4.136383122e-01f,
+  4.164295601e-01f, 4.192168884e-01f, 4.220002708e-01f, 4.247796812e-01f, 4.275550934e-01f,
+  4.303264813e-01f, 4.330938189e-01f, 4.358570799e-01f, 4.386162385e-01f, 4.413712687e-01f,
+  4.441221446e-01f, 4.468688402e-01f, 4.496113297e-01f, 4.523495872e-01f, 4.550835871e-01f,
+  4.578133036e-01f, 4.605387110e-01f, 4.632597836e-01f, 4.659764958e-01f, 4.686888220e-01f,
+  4.713967368e-01f, 4.741002147e-01f, 4.767992301e-01f, 4.794937577e-01f, 4.821837721e-01f,
+  4.848692480e-01f, 4.875501601e-01f, 4.902264833e-01f, 4.928981922e-01f, 4.955652618e-01f,
+  4.982276670e-01f, 5.008853826e-01f, 5.035383837e-01f, 5.061866453e-01f, 5.088301425e-01f,
+  5.114688504e-01f, 5.141027442e-01f, 5.167317990e-01f, 5.193559902e-01f, 5.219752929e-01f,
+  5.245896827e-01f, 5.271991348e-01f, 5.298036247e-01f, 5.324031279e-01f, 5.349976199e-01f,
+  5.375870763e-01f, 5.401714727e-01f, 5.427507849e-01f, 5.453249884e-01f, 5.478940592e-01f,
+  5.504579729e-01f, 5.530167056e-01f, 5.555702330e-01f, 5.581185312e-01f, 5.606615762e-01f,
+  5.631993440e-01f, 5.657318108e-01f, 5.682589527e-01f, 5.707807459e-01f, 5.732971667e-01f,
+  5.758081914e-01f, 5.783137964e-01f, 5.808139581e-01f, 5.833086529e-01f, 5.857978575e-01f,
+  5.882815482e-01f, 5.907597019e-01f, 5.932322950e-01f, 5.956993045e-01f, 5.981607070e-01f,
+  6.006164794e-01f, 6.030665985e-01f, 6.055110414e-01f, 6.079497850e-01f, 6.103828063e-01f,
+  6.128100824e-01f, 6.152315906e-01f, 6.176473079e-01f, 6.200572118e-01f, 6.224612794e-01f,
+  6.248594881e-01f, 6.272518155e-01f, 6.296382389e-01f, 6.320187359e-01f, 6.343932842e-01f,
+  6.367618612e-01f, 6.391244449e-01f, 6.414810128e-01f, 6.438315429e-01f, 6.461760130e-01f,
+  6.485144010e-01f, 6.508466850e-01f, 6.531728430e-01f, 6.554928530e-01f, 6.578066933e-01f,
+  6.601143421e-01f, 6.624157776e-01f, 6.647109782e-01f, 6.669999223e-01f, 6.692825883e-01f,
+  6.715589548e-01f, 6.738290004e-01f, 6.760927036e-01f, 6.783500431e-01f, 6.806009978e-01f,
+  6.828455464e-01f, 6.850836678e-01f, 6.873153409e-01f, 6.895405447e-01f, 6.917592584e-01f,
+  6.939714609e-01f, 6.961771315e-01f, 6.983762494e-01f, 7.005687939e-01f, 7.027547445e-01f,
+  7.049340804e-01f, 7.071067812e-01f, 7.092728264e-01f, 7.114321957e-01f, 7.135848688e-01f,
+  7.157308253e-01f, 7.178700451e-01f, 7.200025080e-01f, 7.221281939e-01f, 7.242470830e-01f,
+  7.263591551e-01f, 7.284643904e-01f, 7.305627692e-01f, 7.326542717e-01f, 7.347388781e-01f,
+  7.368165689e-01f, 7.388873245e-01f, 7.409511254e-01f, 7.430079521e-01f, 7.450577854e-01f,
+  7.471006060e-01f, 7.491363945e-01f, 7.511651319e-01f, 7.531867990e-01f, 7.552013769e-01f,
+  7.572088465e-01f, 7.592091890e-01f, 7.612023855e-01f, 7.631884173e-01f, 7.651672656e-01f,
+  7.671389119e-01f, 7.691033376e-01f, 7.710605243e-01f, 7.730104534e-01f, 7.749531066e-01f,
+  7.768884657e-01f, 7.788165124e-01f, 7.807372286e-01f, 7.826505962e-01f, 7.845565972e-01f,
+  7.864552136e-01f, 7.883464276e-01f, 7.902302214e-01f, 7.921065773e-01f, 7.939754776e-01f,
+  7.958369046e-01f, 7.976908409e-01f, 7.995372691e-01f, 8.013761717e-01f, 8.032075315e-01f,
+  8.050313311e-01f, 8.068475535e-01f, 8.086561816e-01f, 8.104571983e-01f, 8.122505866e-01f,
+  8.140363297e-01f, 8.158144108e-01f, 8.175848132e-01f, 8.193475201e-01f, 8.211025150e-01f,
+  8.228497814e-01f, 8.245893028e-01f, 8.263210628e-01f, 8.280450453e-01f, 8.297612338e-01f,
+  8.314696123e-01f, 8.331701647e-01f, 8.348628750e-01f, 8.365477272e-01f, 8.382247056e-01f,
+  8.398937942e-01f, 8.415549774e-01f, 8.432082396e-01f, 8.448535652e-01f, 8.464909388e-01f,
+  8.481203448e-01f, 8.497417680e-01f, 8.513551931e-01f, 8.529606049e-01f, 8.545579884e-01f,
+  8.561473284e-01f, 8.577286100e-01f, 8.593018184e-01f, 8.608669386e-01f, 8.624239561e-01f,
+  8.639728561e-01f, 8.655136241e-01f, 8.670462455e-01f, 8.685707060e-01f, 8.700869911e-01f,
+  8.715950867e-01f, 8.730949784e-01f, 8.745866523e-01f, 8.760700942e-01f, 8.775452902e-01f,
+  8.790122264e-01f, 8.804708891e-01f, 8.819212643e-01f, 8.833633387e-01f, 8.847970984e-01f,
+  8.862225301e-01f, 8.876396204e-01f, 8.890483559e-01f, 8.904487232e-01f, 8.918407094e-01f,
+  8.932243012e-01f, 8.945994856e-01f, 8.959662498e-01f, 8.973245807e-01f, 8.986744657e-01f,
+  9.000158920e-01f, 9.013488470e-01f, 9.026733182e-01f, 9.039892931e-01f, 9.052967593e-01f,
+  9.065957045e-01f, 9.078861165e-01f, 9.091679831e-01f, 9.104412923e-01f, 9.117060320e-01f,
+  9.129621904e-01f, 9.142097557e-01f, 9.154487161e-01f, 9.166790599e-01f, 9.179007756e-01f,
+  9.191138517e-01f, 9.203182767e-01f, 9.215140393e-01f, 9.227011283e-01f, 9.238795325e-01f,
+  9.250492408e-01f, 9.262102421e-01f, 9.273625257e-01f, 9.285060805e-01f, 9.296408958e-01f,
+  9.307669611e-01f, 9.318842656e-01f, 9.329927988e-01f, 9.340925504e-01f, 9.351835099e-01f,
+  9.362656672e-01f, 9.373390119e-01f, 9.384035341e-01f, 9.394592236e-01f, 9.405060706e-01f,
+  9.415440652e-01f, 9.425731976e-01f, 9.435934582e-01f, 9.446048373e-01f, 9.456073254e-01f,
+  9.466009131e-01f, 9.475855910e-01f, 9.485613499e-01f, 9.495281806e-01f, 9.504860739e-01f,
+  9.514350210e-01f, 9.523750127e-01f, 9.533060404e-01f, 9.542280951e-01f, 9.551411683e-01f,
+  9.560452513e-01f, 9.569403357e-01f, 9.578264130e-01f, 9.587034749e-01f, 9.595715131e-01f,
+  9.604305194e-01f, 9.612804858e-01f, 9.621214043e-01f, 9.629532669e-01f, 9.637760658e-01f,
+  9.645897933e-01f, 9.653944417e-01f, 9.661900034e-01f, 9.669764710e-01f, 9.677538371e-01f,
+  9.685220943e-01f, 9.692812354e-01f, 9.700312532e-01f, 9.707721407e-01f, 9.715038910e-01f,
+  9.722264971e-01f, 9.729399522e-01f, 9.736442497e-01f, 9.743393828e-01f, 9.750253451e-01f,
+  9.757021300e-01f, 9.763697313e-01f, 9.770281427e-01f, 9.776773578e-01f, 9.783173707e-01f,
+  9.789481753e-01f, 9.795697657e-01f, 9.801821360e-01f, 9.807852804e-01f, 9.813791933e-01f,
+  9.819638691e-01f, 9.825393023e-01f, 9.831054874e-01f, 9.836624192e-01f, 9.842100924e-01f,
+  9.847485018e-01f, 9.852776424e-01f, 9.857975092e-01f, 9.863080972e-01f, 9.868094018e-01f,
+  9.873014182e-01f, 9.877841416e-01f, 9.882575677e-01f, 9.887216920e-01f, 9.891765100e-01f,
+  9.896220175e-01f, 9.900582103e-01f, 9.904850843e-01f, 9.909026354e-01f, 9.913108598e-01f,
+  9.917097537e-01f, 9.920993131e-01f, 9.924795346e-01f, 9.928504145e-01f, 9.932119492e-01f,
+  9.935641355e-01f, 9.939069700e-01f, 9.942404495e-01f, 9.945645707e-01f, 9.948793308e-01f,
+  9.951847267e-01f, 9.954807555e-01f, 9.957674145e-01f, 9.960447009e-01f, 9.963126122e-01f,
+  9.965711458e-01f, 9.968202993e-01f, 9.970600703e-01f, 9.972904567e-01f, 9.975114561e-01f,
+  9.977230666e-01f, 9.979252862e-01f, 9.981181129e-01f, 9.983015449e-01f, 9.984755806e-01f,
+  9.986402182e-01f, 9.987954562e-01f, 9.989412932e-01f, 9.990777278e-01f, 9.992047586e-01f,
+  9.993223846e-01f, 9.994306046e-01f, 9.995294175e-01f, 9.996188225e-01f, 9.996988187e-01f,
+  9.997694054e-01f, 9.998305818e-01f, 9.998823475e-01f, 9.999247018e-01f, 9.999576446e-01f,
+  9.999811753e-01f, 9.999952938e-01f, 1.000000000e+00f,
+};
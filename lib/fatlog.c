@@ -0,0 +1,281 @@
+#include "fatlog.h"
+
+#define FAT_EOC             0x0FFFFFFF
+#define FAT_DATE            ((44 << 9) | (1 << 5) | 1)  // 2024-01-01
+#define DIR_ENTRY           32
+
+
+static inline uint32_t le16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t le32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void put16(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static inline bool rd(fatlog_t *f, uint32_t lba) {
+  return f->dev->read(f->dev->ctx, lba, f->sector, 1);
+}
+
+static inline bool wr(fatlog_t *f, uint32_t lba) {
+  return f->dev->write(f->dev->ctx, lba, f->sector, 1);
+}
+
+static inline uint32_t cluster_lba(const fatlog_t *f, uint32_t c) {
+  return f->data_lba + (c - 2) * f->spc;
+}
+
+bool fatlog_mount(fatlog_t *f, const blockdev_t *dev) {
+  uint8_t *s = f->sector;
+  uint32_t part = 0, total;
+
+  f->dev = dev;
+  f->open = false;
+  if (!rd(f, 0) || s[510] != 0x55 || s[511] != 0xAA) {
+    return false;
+  }
+  // No boot sector here: take the first MBR partition if it is FAT32
+  if ((s[0] != 0xEB && s[0] != 0xE9) || le16(s + 11) != BLOCK_SIZE) {
+    if (s[0x1BE + 4] != 0x0B && s[0x1BE + 4] != 0x0C) {
+      return false;
+    }
+    part = le32(s + 0x1BE + 8);
+    if (!rd(f, part) || s[510] != 0x55 || s[511] != 0xAA) {
+      return false;
+    }
+  }
+  if (le16(s + 11) != BLOCK_SIZE || s[13] == 0 || le16(s + 17) != 0 || le16(s + 22) != 0) {
+    return false; // Not FAT32
+  }
+  f->spc = s[13];
+  f->nfats = s[16];
+  f->fat_size = le32(s + 36);
+  f->fat_lba = part + le16(s + 14);
+  f->data_lba = f->fat_lba + f->nfats * f->fat_size;
+  f->root = le32(s + 44);
+  f->fsinfo_lba = part + le16(s + 48);
+  total = le32(s + 32);
+  if (total <= f->data_lba - part) {
+    return false;
+  }
+  f->clusters = (total - (f->data_lba - part)) / f->spc;
+  if (f->clusters > f->fat_size * (BLOCK_SIZE / 4) - 2) {
+    f->clusters = f->fat_size * (BLOCK_SIZE / 4) - 2;
+  }
+  return f->clusters >= 65525;
+}
+
+static bool fat_get(fatlog_t *f, uint32_t c, uint32_t *next) {
+  if (!rd(f, f->fat_lba + c / (BLOCK_SIZE / 4))) {
+    return false;
+  }
+  *next = le32(f->sector + 4 * (c % (BLOCK_SIZE / 4))) & 0x0FFFFFFF;
+  return true;
+}
+
+// First cluster of a free run of n, scanning the FAT sector by sector
+static uint32_t find_run(fatlog_t *f, uint32_t n) {
+  uint32_t start = 0, len = 0, c, i;
+
+  for (c = 0; c < f->clusters + 2; c++) {
+    i = c % (BLOCK_SIZE / 4);
+    if (i == 0 && !rd(f, f->fat_lba + c / (BLOCK_SIZE / 4))) {
+      return 0;
+    }
+    if (c < 2 || (le32(f->sector + 4 * i) & 0x0FFFFFFF) != 0) {
+      len = 0;
+      continue;
+    }
+    if (len++ == 0) {
+      start = c;
+    }
+    if (len == n) {
+      return start;
+    }
+  }
+  return 0;
+}
+
+// Links clusters first..first+n-1 into one chain, in every FAT copy
+static bool write_chain(fatlog_t *f, uint32_t first, uint32_t n) {
+  uint32_t c = first, last = first + n - 1;
+  uint32_t sec, i, k, v;
+
+  while (c <= last) {
+    sec = c / (BLOCK_SIZE / 4);
+    if (!rd(f, f->fat_lba + sec)) {
+      return false;
+    }
+    for (; c <= last && c / (BLOCK_SIZE / 4) == sec; c++) {
+      i = 4 * (c % (BLOCK_SIZE / 4));
+      v = c == last ? FAT_EOC : c + 1;
+      put32(f->sector + i, (le32(f->sector + i) & 0xF0000000) | v);
+    }
+    for (k = 0; k < f->nfats; k++) {
+      if (!wr(f, f->fat_lba + k * f->fat_size + sec)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Free counts are now stale; mark them unknown so hosts recount
+static bool touch_fsinfo(fatlog_t *f) {
+  if (!rd(f, f->fsinfo_lba)) {
+    return false;
+  }
+  if (le32(f->sector) != 0x41615252 || le32(f->sector + 484) != 0x61417272) {
+    return true;
+  }
+  put32(f->sector + 488, 0xFFFFFFFF);
+  put32(f->sector + 492, 0xFFFFFFFF);
+  return wr(f, f->fsinfo_lba);
+}
+
+/**
+ * @brief Finds a free root directory slot; fails if name is already there.
+ *
+ * @details Scans until the end-of-directory marker so a live entry after a
+ * deleted one is still seen.
+ */
+static bool find_slot(fatlog_t *f, const char name[11]) {
+  uint32_t c = f->root, s, off, i;
+  uint8_t *e;
+  bool found = false;
+
+  while (c >= 2 && c < 0x0FFFFFF8) {
+    for (s = 0; s < f->spc; s++) {
+      if (!rd(f, cluster_lba(f, c) + s)) {
+        return false;
+      }
+      for (off = 0; off < BLOCK_SIZE; off += DIR_ENTRY) {
+        e = f->sector + off;
+        if (e[0] == 0x00 || e[0] == 0xE5) {
+          if (!found) {
+            found = true;
+            f->dir_lba = cluster_lba(f, c) + s;
+            f->dir_off = off;
+          }
+          if (e[0] == 0x00) {
+            return true;
+          }
+          continue;
+        }
+        for (i = 0; i < 11 && e[i] == (uint8_t)name[i]; i++);
+        if (i == 11 && e[11] != 0x0F) {
+          return false;
+        }
+      }
+    }
+    if (!fat_get(f, c, &c)) {
+      return false;
+    }
+  }
+  return found;
+}
+
+bool fatlog_create(fatlog_t *f, const char name[11], uint32_t bytes) {
+  uint32_t cluster_bytes = f->spc * BLOCK_SIZE;
+  uint32_t n = bytes / cluster_bytes + (bytes % cluster_bytes != 0);
+  uint8_t *e;
+  uint32_t i;
+
+  f->open = false;
+  if (n == 0 || !find_slot(f, name)) {
+    return false;
+  }
+  f->first = find_run(f, n);
+  if (!f->first || !write_chain(f, f->first, n) || !touch_fsinfo(f)) {
+    return false;
+  }
+
+  if (!rd(f, f->dir_lba)) {
+    return false;
+  }
+  e = f->sector + f->dir_off;
+  for (i = 0; i < DIR_ENTRY; i++) {
+    e[i] = i < 11 ? (uint8_t)name[i] : 0;
+  }
+  e[11] = 0x20;         // Archive
+  put16(e + 16, FAT_DATE);
+  put16(e + 18, FAT_DATE);
+  put16(e + 20, f->first >> 16);
+  put16(e + 24, FAT_DATE);
+  put16(e + 26, f->first & 0xFFFF);
+  if (!wr(f, f->dir_lba)) {
+    return false;
+  }
+
+  f->capacity = n * cluster_bytes;
+  f->size = 0;
+  f->open = true;
+  return true;
+}
+
+bool fatlog_write(fatlog_t *f, const void *buf, uint32_t len) {
+  const uint8_t *p = buf;
+  uint32_t lba, pos, n, i;
+
+  if (!f->open || len > f->capacity - f->size) {
+    return false;
+  }
+  while (len) {
+    lba = cluster_lba(f, f->first) + f->size / BLOCK_SIZE;
+    pos = f->size % BLOCK_SIZE;
+    // Whole aligned sectors bypass the tail buffer in one multi-block write
+    if (pos == 0 && len >= BLOCK_SIZE && !((uintptr_t)p & 3)) {
+      n = len / BLOCK_SIZE;
+      if (!f->dev->write(f->dev->ctx, lba, p, n)) {
+        return false;
+      }
+      p += n * BLOCK_SIZE;
+      len -= n * BLOCK_SIZE;
+      f->size += n * BLOCK_SIZE;
+      continue;
+    }
+    if (pos == 0) {
+      for (i = 0; i < BLOCK_SIZE; i++) {
+        f->tail[i] = 0;
+      }
+    }
+    n = BLOCK_SIZE - pos < len ? BLOCK_SIZE - pos : len;
+    for (i = 0; i < n; i++) {
+      f->tail[pos + i] = p[i];
+    }
+    p += n;
+    len -= n;
+    f->size += n;
+    if (pos + n == BLOCK_SIZE && !f->dev->write(f->dev->ctx, lba, f->tail, 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool fatlog_sync(fatlog_t *f) {
+  if (!f->open) {
+    return false;
+  }
+  if (f->size % BLOCK_SIZE &&
+      !f->dev->write(f->dev->ctx, cluster_lba(f, f->first) + f->size / BLOCK_SIZE, f->tail, 1)) {
+    return false;
+  }
+  if (!rd(f, f->dir_lba)) {
+    return false;
+  }
+  put32(f->sector + f->dir_off + 28, f->size);
+  return wr(f, f->dir_lba);
+}
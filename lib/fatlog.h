@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "blockdev.h"
+
+/**
+ * @brief Append-only streaming writer for one file on a FAT32 volume.
+ *
+ * @details fatlog_create() finds a run of free contiguous clusters big enough
+ * for the whole file and writes its cluster chain into every FAT copy once, so
+ * appending is pure sequential data writes: whole sectors go straight from the
+ * caller's buffer to the device as multi-block writes, and only the partial
+ * sector at the end is staged in a 512-byte tail buffer. Because the tail is
+ * kept in RAM, rewriting it never needs a read either.
+ *
+ * fatlog_sync() writes the tail and the file size into the directory entry (the
+ * only read-modify-write, one sector); data written before a sync survives a
+ * power loss with the size of the last sync.
+ *
+ * The volume must be FAT32 (MBR partition or superfloppy); the file goes into
+ * the root directory, which is not extended. Nothing here touches hardware;
+ * tools/blockdev_file.c runs it against a disk image on the host.
+ */
+
+typedef struct {
+  const blockdev_t *dev;
+  // Volume
+  uint32_t fat_lba;
+  uint32_t fat_size;    // Sectors per FAT
+  uint8_t nfats;
+  uint8_t spc;          // Sectors per cluster
+  uint32_t data_lba;
+  uint32_t clusters;    // Data clusters, numbered from 2
+  uint32_t root;        // First cluster of the root directory
+  uint32_t fsinfo_lba;
+  // File
+  uint32_t first;       // First cluster
+  uint32_t capacity;    // Preallocated bytes
+  uint32_t size;
+  uint32_t dir_lba;
+  uint32_t dir_off;
+  bool open;
+  uint8_t tail[BLOCK_SIZE] __attribute__((aligned(4)));
+  uint8_t sector[BLOCK_SIZE] __attribute__((aligned(4)));
+} fatlog_t;
+
+bool fatlog_mount(fatlog_t *f, const blockdev_t *dev);
+
+// name is 8.3 in directory form, e.g. "LOG00001BIN"; fails if it exists
+bool fatlog_create(fatlog_t *f, const char name[11], uint32_t bytes);
+bool fatlog_write(fatlog_t *f, const void *buf, uint32_t len);
+bool fatlog_sync(fatlog_t *f);
+
+static inline uint32_t fatlog_remaining(const fatlog_t *f) {
+  return f->capacity - f->size;
+}
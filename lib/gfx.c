@@ -0,0 +1,214 @@
+#include "gfx.h"
+
+#include <stddef.h>
+
+
+static inline uint32_t area(const gfx_rect_t *r) {
+  return (uint32_t)r->w * r->h;
+}
+
+static gfx_rect_t rect_union(const gfx_rect_t *a, const gfx_rect_t *b) {
+  int32_t x0 = a->x < b->x ? a->x : b->x;
+  int32_t y0 = a->y < b->y ? a->y : b->y;
+  int32_t x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+  int32_t y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+  gfx_rect_t u = {(int16_t)x0, (int16_t)y0, (uint16_t)(x1 - x0), (uint16_t)(y1 - y0)};
+
+  return u;
+}
+
+static bool rect_clip(gfx_rect_t *r, const gfx_rect_t *bound) {
+  int32_t x0 = r->x > bound->x ? r->x : bound->x;
+  int32_t y0 = r->y > bound->y ? r->y : bound->y;
+  int32_t x1 = r->x + r->w < bound->x + bound->w ? r->x + r->w : bound->x + bound->w;
+  int32_t y1 = r->y + r->h < bound->y + bound->h ? r->y + r->h : bound->y + bound->h;
+
+  if (x1 <= x0 || y1 <= y0) {
+    return false;
+  }
+  r->x = x0;
+  r->y = y0;
+  r->w = x1 - x0;
+  r->h = y1 - y0;
+  return true;
+}
+
+// Change in flush cost when a and b are sent as one burst instead of two
+static int32_t merge_delta(const gfx_rect_t *a, const gfx_rect_t *b) {
+  gfx_rect_t u = rect_union(a, b);
+
+  return (int32_t)area(&u) - (int32_t)area(a) - (int32_t)area(b) - GFX_BURST_COST;
+}
+
+bool gfx_init(gfx_t *g, uint16_t width, uint16_t height, const gfx_panel_t *panel,
+              gfx_render_t render, void *render_ctx, uint16_t *buf0, uint16_t *buf1,
+              uint32_t tile_px) {
+  if (tile_px < width) {
+    return false;
+  }
+  g->width = width;
+  g->height = height;
+  g->panel = *panel;
+  g->render = render;
+  g->render_ctx = render_ctx;
+  g->buf[0] = buf0;
+  g->buf[1] = buf1;
+  g->tile_px = tile_px;
+  g->ndirty = 0;
+  g->nflush = 0;
+  g->cur = 0;
+  g->row = 0;
+  g->busy[0] = 0;
+  g->busy[1] = 0;
+  g->next_buf = 0;
+  g->bursts = 0;
+  g->pixels = 0;
+  return true;
+}
+
+void gfx_invalidate(gfx_t *g, gfx_rect_t r) {
+  gfx_rect_t screen = {0, 0, g->width, g->height};
+  uint32_t i, j, bi, bj;
+  int32_t best, d;
+
+  if (!rect_clip(&r, &screen)) {
+    return;
+  }
+
+  // Absorb r into any rectangle it is cheaper to merge with; the union may
+  // then become mergeable with others, so start over after each merge.
+  i = 0;
+  while (i < g->ndirty) {
+    if (merge_delta(&g->dirty[i], &r) <= 0) {
+      r = rect_union(&g->dirty[i], &r);
+      g->dirty[i] = g->dirty[--g->ndirty];
+      i = 0;
+    } else {
+      i++;
+    }
+  }
+  if (g->ndirty < GFX_MAX_DIRTY) {
+    g->dirty[g->ndirty++] = r;
+    return;
+  }
+
+  // Full: merge the cheapest pair among the existing rectangles and r
+  best = merge_delta(&g->dirty[0], &r);
+  bi = 0;
+  bj = GFX_MAX_DIRTY;
+  for (i = 0; i < GFX_MAX_DIRTY; i++) {
+    d = merge_delta(&g->dirty[i], &r);
+    if (d < best) {
+      best = d;
+      bi = i;
+      bj = GFX_MAX_DIRTY;
+    }
+    for (j = i + 1; j < GFX_MAX_DIRTY; j++) {
+      d = merge_delta(&g->dirty[i], &g->dirty[j]);
+      if (d < best) {
+        best = d;
+        bi = i;
+        bj = j;
+      }
+    }
+  }
+  if (bj == GFX_MAX_DIRTY) {
+    g->dirty[bi] = rect_union(&g->dirty[bi], &r);
+  } else {
+    g->dirty[bi] = rect_union(&g->dirty[bi], &g->dirty[bj]);
+    g->dirty[bj] = r;
+  }
+}
+
+/**
+ * @brief Advances the flush pipeline; call from the main loop.
+ *
+ * @details Takes the current dirty list once the previous one has been
+ * rendered, then renders and queues tiles while a tile buffer is free. Returns true while
+ * work is left.
+ */
+bool gfx_poll(gfx_t *g) {
+  gfx_tile_t tile;
+  gfx_rect_t *r;
+  uint32_t rows, b;
+
+  if (g->cur == g->nflush) {
+    if (g->ndirty == 0) {
+      return g->busy[0] || g->busy[1];
+    }
+    for (b = 0; b < g->ndirty; b++) {
+      g->flush[b] = g->dirty[b];
+    }
+    g->nflush = g->ndirty;
+    g->ndirty = 0;
+    g->cur = 0;
+    g->row = 0;
+  }
+
+  while (g->cur < g->nflush && !g->busy[g->next_buf]) {
+    b = g->next_buf;
+    r = &g->flush[g->cur];
+    rows = g->tile_px / r->w;
+    if (rows > (uint32_t)(r->h - g->row)) {
+      rows = r->h - g->row;
+    }
+    tile.area.x = r->x;
+    tile.area.y = r->y + g->row;
+    tile.area.w = r->w;
+    tile.area.h = rows;
+    tile.px = g->buf[b];
+    g->render(g->render_ctx, &tile);
+
+    g->row += rows;
+    if (g->row == r->h) {
+      g->cur++;
+      g->row = 0;
+    }
+    g->busy[b] = 1;
+    g->next_buf = b ^ 1;
+    g->bursts++;
+    g->pixels += area(&tile.area);
+    g->panel.write(g->panel.ctx, &tile.area, tile.px, area(&tile.area));
+  }
+  return true;
+}
+
+bool gfx_idle(const gfx_t *g) {
+  return g->cur == g->nflush && g->ndirty == 0 && !g->busy[0] && !g->busy[1];
+}
+
+void gfx_write_done(gfx_t *g, const uint16_t *px) {
+  g->busy[px == g->buf[1]] = 0;
+}
+
+void gfx_fill(gfx_tile_t *t, gfx_rect_t r, uint16_t color) {
+  uint16_t *row;
+  uint32_t x, y;
+
+  if (!rect_clip(&r, &t->area)) {
+    return;
+  }
+  row = t->px + (uint32_t)(r.y - t->area.y) * t->area.w + (r.x - t->area.x);
+  for (y = 0; y < r.h; y++, row += t->area.w) {
+    for (x = 0; x < r.w; x++) {
+      row[x] = color;
+    }
+  }
+}
+
+void gfx_blit(gfx_tile_t *t, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *src) {
+  gfx_rect_t r = {x, y, w, h};
+  uint16_t *dst;
+  uint32_t i, j;
+
+  if (!rect_clip(&r, &t->area)) {
+    return;
+  }
+  src += (uint32_t)(r.y - y) * w + (r.x - x);
+  dst = t->px + (uint32_t)(r.y - t->area.y) * t->area.w + (r.x - t->area.x);
+  for (j = 0; j < r.h; j++, src += w, dst += t->area.w) {
+    for (i = 0; i < r.w; i++) {
+      dst[i] = src[i];
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Tile-rendered graphics surface with dirty-rectangle flushing.
+ *
+ * @details There is no full framebuffer: a 320x240 RGB565 frame would not fit in
+ * RAM. The application invalidates the rectangles that changed and supplies a
+ * render callback that draws the scene clipped to a tile. gfx_poll() cuts each
+ * dirty rectangle into tiles of whole rows, renders a tile into whichever of the
+ * two tile buffers is free and hands it to the panel, so one tile is rendered
+ * while the previous one is still being clocked out by DMA.
+ *
+ * Dirty rectangles are merged whenever the merged rectangle costs no more than
+ * the two separate ones, counting GFX_BURST_COST pixels of overhead per burst
+ * (window commands plus DMA setup). When the list is full the cheapest pair is
+ * merged anyway.
+ *
+ * Pixels are RGB565 stored in panel byte order (big-endian unless
+ * GFX_PIXEL_SWAP is 0), so tile buffers go to the SPI DMA untouched.
+ *
+ * Nothing here touches hardware; tools/gfx_ppm.c is a host panel that writes
+ * the result to a PPM file.
+ */
+
+#define GFX_MAX_DIRTY       8
+#ifndef GFX_BURST_COST
+#define GFX_BURST_COST      64
+#endif
+#ifndef GFX_PIXEL_SWAP
+#define GFX_PIXEL_SWAP      1
+#endif
+
+#define GFX_RGB565(r, g, b) ((uint16_t)((((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | ((b) >> 3)))
+#if GFX_PIXEL_SWAP
+#define GFX_COLOR(r, g, b)  ((uint16_t)((GFX_RGB565(r, g, b) >> 8) | (GFX_RGB565(r, g, b) << 8)))
+#else
+#define GFX_COLOR(r, g, b)  GFX_RGB565(r, g, b)
+#endif
+
+typedef struct {
+  int16_t x, y;
+  uint16_t w, h;
+} gfx_rect_t;
+
+typedef struct {
+  gfx_rect_t area;      // Screen area covered by px
+  uint16_t *px;         // area.w * area.h pixels, row-major
+} gfx_tile_t;
+
+typedef struct {
+  // Queue a burst of count pixels into the panel window r. px stays owned by the
+  // panel until it calls gfx_write_done() (from any context).
+  void (*write)(void *ctx, const gfx_rect_t *r, const uint16_t *px, uint32_t count);
+  void *ctx;
+} gfx_panel_t;
+
+typedef void (*gfx_render_t)(void *ctx, gfx_tile_t *tile);
+
+typedef struct {
+  uint16_t width, height;
+  gfx_panel_t panel;
+  gfx_render_t render;
+  void *render_ctx;
+  uint16_t *buf[2];
+  uint32_t tile_px;
+  gfx_rect_t dirty[GFX_MAX_DIRTY];
+  uint32_t ndirty;
+  gfx_rect_t flush[GFX_MAX_DIRTY];
+  uint32_t nflush;
+  uint32_t cur;         // Rectangle being flushed
+  uint16_t row;         // Next row within it
+  volatile uint8_t busy[2];
+  uint8_t next_buf;
+  uint32_t bursts;      // Statistics: bursts and pixels sent
+  uint32_t pixels;
+} gfx_t;
+
+// tile_px pixels per buffer, at least one screen row
+bool gfx_init(gfx_t *g, uint16_t width, uint16_t height, const gfx_panel_t *panel,
+              gfx_render_t render, void *render_ctx, uint16_t *buf0, uint16_t *buf1,
+              uint32_t tile_px);
+void gfx_invalidate(gfx_t *g, gfx_rect_t r);
+bool gfx_poll(gfx_t *g);
+bool gfx_idle(const gfx_t *g);
+void gfx_write_done(gfx_t *g, const uint16_t *px);
+
+// Drawing helpers for render callbacks; everything is clipped to the tile
+void gfx_fill(gfx_tile_t *t, gfx_rect_t r, uint16_t color);
+void gfx_blit(gfx_tile_t *t, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *src);
@@ -0,0 +1,91 @@
+#include "heap.h"
+
+#include <stddef.h>
+
+#define HDR                 sizeof(heap_block_t)
+#define ALIGN               8
+
+
+void heap_init(heap_t *h, void *base, uint32_t size) {
+  uintptr_t start = ((uintptr_t)base + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1);
+
+  size = size > start - (uintptr_t)base ? size - (start - (uintptr_t)base) : 0;
+  size &= ~(uint32_t)(ALIGN - 1);
+  h->size = size;
+  h->used = h->peak = 0;
+  h->free = NULL;
+  if (size > HDR) {
+    h->free = (heap_block_t *)start;
+    h->free->size = size;
+    h->free->next = NULL;
+  }
+}
+
+void *heap_alloc(heap_t *h, uint32_t size) {
+  heap_block_t **link, *b, *rest;
+  uint32_t need;
+
+  if (size == 0 || size > h->size) {
+    return NULL;
+  }
+  need = (size + HDR + ALIGN - 1) & ~(uint32_t)(ALIGN - 1);
+  for (link = &h->free; (b = *link) != NULL; link = &b->next) {
+    if (b->size < need) {
+      continue;
+    }
+    // Split unless the remainder could not hold a header and some data
+    if (b->size - need > HDR) {
+      rest = (heap_block_t *)((uint8_t *)b + need);
+      rest->size = b->size - need;
+      rest->next = b->next;
+      b->size = need;
+      *link = rest;
+    } else {
+      *link = b->next;
+    }
+    h->used += b->size;
+    if (h->used > h->peak) {
+      h->peak = h->used;
+    }
+    return (uint8_t *)b + HDR;
+  }
+  return NULL;
+}
+
+void heap_free(heap_t *h, void *p) {
+  heap_block_t *b, *prev = NULL, *next;
+
+  if (!p) {
+    return;
+  }
+  b = (heap_block_t *)((uint8_t *)p - HDR);
+  h->used -= b->size;
+  for (next = h->free; next && next < b; next = next->next) {
+    prev = next;
+  }
+  if (next && (uint8_t *)b + b->size == (uint8_t *)next) {
+    b->size += next->size;
+    next = next->next;
+  }
+  b->next = next;
+  if (prev && (uint8_t *)prev + prev->size == (uint8_t *)b) {
+    prev->size += b->size;
+    prev->next = b->next;
+  } else if (prev) {
+    prev->next = b;
+  } else {
+    h->free = b;
+  }
+}
+
+uint32_t heap_largest(const heap_t *h) {
+  const heap_block_t *b;
+  uint32_t max = 0;
+
+  for (b = h->free; b; b = b->next) {
+    if (b->size > max) {
+      max = b->size;
+    }
+  }
+  return max > HDR ? max - HDR : 0;
+}
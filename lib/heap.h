@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief First-fit allocator over one caller-supplied memory region.
+ *
+ * @details Meant for big, long-lived buffers in a region the C heap does not
+ * cover (external SRAM through FSMC). Free blocks sit in an address-ordered
+ * list and merge with both neighbours when freed, so fragmentation stays
+ * bounded by the allocation pattern rather than by history. Blocks carry an
+ * 8-byte header and are 8-byte aligned.
+ *
+ * Nothing here touches hardware; the same code runs on the host. Not
+ * reentrant: callers that allocate from interrupts must lock around it.
+ */
+
+typedef struct heap_block {
+  uint32_t size;                // Bytes including this header
+  struct heap_block *next;      // Next free block, by address
+} heap_block_t;
+
+typedef struct {
+  heap_block_t *free;
+  uint32_t size;
+  uint32_t used;                // Bytes allocated, headers included
+  uint32_t peak;
+} heap_t;
+
+void heap_init(heap_t *h, void *base, uint32_t size);
+void *heap_alloc(heap_t *h, uint32_t size);
+void heap_free(heap_t *h, void *p);
+
+// Largest block heap_alloc() could return right now
+uint32_t heap_largest(const heap_t *h);
@@ -0,0 +1,406 @@
+#include "kvstore.h"
+
+#include <stddef.h>
+#include "crc32.h"
+
+#define MAGIC               0x564B
+#define TOMB                (1 << 0)
+#define GC_STEPS            2   // Per kv_set() while collecting
+
+enum { GC_IDLE, GC_COPY, GC_ERASE };
+
+typedef struct {
+  uint32_t crc;             // Over the rest of the header and the records
+  uint16_t magic;
+  uint16_t used;            // Header included
+  uint32_t seq;
+} kv_page_t;
+
+typedef struct {
+  uint32_t key;
+  uint16_t len;
+  uint16_t flags;
+} kv_rec_t;
+
+#define HDR                 sizeof(kv_page_t)
+#define REC                 sizeof(kv_rec_t)
+
+
+static inline uint32_t rec_size(uint32_t len) {
+  return REC + ((len + 3) & ~3u);
+}
+
+static inline const uint8_t *page_ptr(const kv_t *kv, uint32_t p) {
+  return kv->fl->base + p * kv->fl->page_size;
+}
+
+static inline uint32_t pages(const kv_t *kv) {
+  return kv->nsegs * kv->seg_pages;
+}
+
+static bool page_valid(const kv_t *kv, uint32_t p) {
+  const kv_page_t *h = (const kv_page_t *)page_ptr(kv, p);
+
+  return h->magic == MAGIC && h->used >= HDR && h->used <= kv->fl->page_size &&
+    h->crc == crc32_update(0, (const uint8_t *)h + 4, h->used - 4);
+}
+
+static bool blank(const kv_t *kv, uint32_t off, uint32_t len) {
+  const uint32_t *w = (const uint32_t *)(kv->fl->base + off);
+  uint32_t i;
+
+  for (i = 0; i < len / 4; i++) {
+    if (w[i] != kv->fl->erased) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Wrap-safe: page a was written before page b
+static inline bool older(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+static inline uint32_t hash(const kv_t *kv, uint32_t key) {
+  key ^= key >> 16;
+  key *= 0x85EBCA6B;
+  key ^= key >> 13;
+  key *= 0xC2B2AE35;
+  key ^= key >> 16;
+  return key & kv->mask;
+}
+
+static int32_t find(const kv_t *kv, uint32_t key) {
+  uint32_t i;
+
+  for (i = hash(kv, key); kv->slots[i].loc != KV_NONE; i = (i + 1) & kv->mask) {
+    if (kv->slots[i].key == key) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static bool index_put(kv_t *kv, uint32_t key, uint32_t loc) {
+  uint32_t i;
+
+  for (i = hash(kv, key); kv->slots[i].loc != KV_NONE; i = (i + 1) & kv->mask) {
+    if (kv->slots[i].key == key) {
+      kv->slots[i].loc = loc;
+      return true;
+    }
+  }
+  if (kv->count * 4 >= (kv->mask + 1) * 3) {
+    return false;
+  }
+  kv->slots[i].key = key;
+  kv->slots[i].loc = loc;
+  kv->count++;
+  return true;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_del(kv_t *kv, uint32_t key) {
+  int32_t at = find(kv, key);
+  uint32_t i, j, h;
+
+  if (at < 0) {
+    return;
+  }
+  kv->count--;
+  for (i = at, j = (i + 1) & kv->mask; kv->slots[j].loc != KV_NONE; j = (j + 1) & kv->mask) {
+    h = hash(kv, kv->slots[j].key);
+    // Move j into the hole unless its home lies cyclically in (i, j]
+    if (((j - h) & kv->mask) >= ((j - i) & kv->mask)) {
+      kv->slots[i] = kv->slots[j];
+      i = j;
+    }
+  }
+  kv->slots[i].loc = KV_NONE;
+}
+
+static bool replay(kv_t *kv, uint32_t p) {
+  const uint8_t *pg = page_ptr(kv, p);
+  const kv_page_t *h = (const kv_page_t *)pg;
+  const kv_rec_t *r;
+  uint32_t off;
+
+  for (off = HDR; off + REC <= h->used; off += rec_size(r->len)) {
+    r = (const kv_rec_t *)(pg + off);
+    if (r->flags & TOMB) {
+      index_del(kv, r->key);
+    } else if (!index_put(kv, r->key, p << 16 | off)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool flush(kv_t *kv) {
+  kv_page_t *h = (kv_page_t *)kv->buf;
+  bool ok;
+
+  if (kv->used == HDR) {
+    return true;
+  }
+  h->magic = MAGIC;
+  h->used = kv->used;
+  h->seq = kv->seq++;
+  h->crc = crc32_update(0, kv->buf + 4, kv->used - 4);
+  ok = kv->fl->program(kv->fl->ctx, kv->head * kv->fl->page_size, kv->buf);
+  kv->programs++;
+  kv->head = (kv->head + 1) % pages(kv);
+  kv->open = kv->head % kv->seg_pages != 0;
+  kv->used = HDR;
+  return ok;
+}
+
+static bool erase_seg(kv_t *kv, uint32_t s, bool all) {
+  uint32_t off;
+
+  for (off = s * kv->seg_size; off < (s + 1) * kv->seg_size; off += kv->fl->erase_size) {
+    if (!all && blank(kv, off, kv->fl->erase_size)) {
+      continue;
+    }
+    kv->erases++;
+    if (!kv->fl->erase(kv->fl->ctx, off)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool kv_mount(kv_t *kv, const kv_flash_t *fl, uint32_t seg_size, kv_slot_t *slots, uint32_t nslots) {
+  uint32_t s, p, n, last, seq0 = 0, live = 0;
+  bool found = false;
+
+  kv->fl = fl;
+  kv->seg_size = seg_size;
+  kv->nsegs = fl->size / seg_size;
+  kv->seg_pages = seg_size / fl->page_size;
+  kv->slots = slots;
+  kv->mask = nslots - 1;
+  kv->count = 0;
+  kv->used = HDR;
+  kv->gc_phase = GC_IDLE;
+  kv->programs = kv->erases = 0;
+  if (fl->page_size > KV_PAGE_MAX || fl->page_size < HDR + REC || fl->page_size % 4 ||
+      fl->erase_size % fl->page_size || seg_size % fl->erase_size || kv->nsegs < 3 ||
+      pages(kv) > 0x10000 || nslots < 2 || (nslots & kv->mask)) {
+    return false;
+  }
+  for (n = 0; n < nslots; n++) {
+    slots[n].loc = KV_NONE;
+  }
+
+  // A segment is in the log if its first page checks out; the oldest is the tail
+  for (s = 0; s < kv->nsegs; s++) {
+    p = s * kv->seg_pages;
+    if (page_valid(kv, p) && (!found || older(((const kv_page_t *)page_ptr(kv, p))->seq, seq0))) {
+      seq0 = ((const kv_page_t *)page_ptr(kv, p))->seq;
+      kv->tail = s;
+      found = true;
+    }
+  }
+  if (!found) {
+    for (s = 0; s < kv->nsegs; s++) {
+      if (!erase_seg(kv, s, false)) {
+        return false;
+      }
+    }
+    kv->tail = kv->head = 0;
+    kv->open = false;
+    kv->free = kv->nsegs;
+    kv->seq = 0;
+    return true;
+  }
+
+  // Replay forward from the tail while the segments keep getting newer
+  kv->seq = seq0;
+  last = kv->tail * kv->seg_pages;
+  for (s = kv->tail; live < kv->nsegs; s = (s + 1) % kv->nsegs, live++) {
+    p = s * kv->seg_pages;
+    if (!page_valid(kv, p) || older(((const kv_page_t *)page_ptr(kv, p))->seq, kv->seq)) {
+      break;
+    }
+    for (n = 0; n < kv->seg_pages; n++, p++) {
+      if (page_valid(kv, p)) {
+        if (!replay(kv, p)) {
+          return false;
+        }
+        kv->seq = ((const kv_page_t *)page_ptr(kv, p))->seq + 1;
+        last = p;
+      } else if (!blank(kv, p * fl->page_size, fl->page_size)) {
+        last = p;           // Torn: never programmed again before an erase
+      }
+    }
+  }
+  kv->head = (last + 1) % pages(kv);
+  kv->open = kv->head % kv->seg_pages != 0;
+  kv->free = kv->nsegs - live;
+
+  // Everything outside the log is erased, including a collection cut short
+  for (n = 0; n < kv->free; n++) {
+    if (!erase_seg(kv, (kv->tail + live + n) % kv->nsegs, false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Makes room for need bytes in the buffer page.
+ *
+ * @details Writers other than the collector may not take the last free
+ * segment, nor add to the log while the collector is using it; they run
+ * collection steps until that is over, and fail when a full pass over the log
+ * frees nothing (the store is full).
+ */
+static bool room(kv_t *kv, uint32_t need, bool user) {
+  uint32_t steps = kv->nsegs * (kv->seg_pages + kv->seg_size / kv->fl->erase_size);
+  bool reserve;
+
+  for (;;) {
+    reserve = user && kv->free == 0 && kv->gc_phase != GC_IDLE;
+    if (kv->used + need > kv->fl->page_size) {
+      if (!flush(kv)) {
+        return false;
+      }
+    } else if (kv->open && !reserve) {
+      return true;
+    } else if (!kv->open && kv->free >= (user ? 2u : 1u)) {
+      kv->free--;
+      kv->open = true;
+    } else if (!user || !steps-- || !kv_gc_step(kv)) {
+      return false;
+    }
+  }
+}
+
+static bool append(kv_t *kv, uint32_t key, const void *value, uint32_t len, uint32_t flags, bool user) {
+  kv_rec_t *r;
+  const uint8_t *src = value;
+  uint32_t i;
+
+  if (!room(kv, rec_size(len), user)) {
+    return false;
+  }
+  r = (kv_rec_t *)(kv->buf + kv->used);
+  r->key = key;
+  r->len = len;
+  r->flags = flags;
+  for (i = 0; i < len; i++) {
+    kv->buf[kv->used + REC + i] = src[i];
+  }
+  for (; i < rec_size(len) - REC; i++) {
+    kv->buf[kv->used + REC + i] = 0;
+  }
+  if (flags & TOMB) {
+    index_del(kv, key);
+  } else {
+    index_put(kv, key, kv->head << 16 | kv->used);
+  }
+  kv->used += rec_size(len);
+  return true;
+}
+
+bool kv_gc_step(kv_t *kv) {
+  const uint8_t *pg;
+  const kv_page_t *h;
+  const kv_rec_t *r;
+  uint32_t p, off;
+  int32_t i;
+
+  if (kv->gc_phase == GC_IDLE) {
+    if (kv->free >= 2 || kv->nsegs - kv->free < 2) {
+      return false;
+    }
+    kv->gc_phase = GC_COPY;
+    kv->gc_pos = 0;
+  }
+
+  if (kv->gc_phase == GC_COPY) {
+    if (kv->gc_pos < kv->seg_pages) {
+      p = kv->tail * kv->seg_pages + kv->gc_pos++;
+      if (!page_valid(kv, p)) {
+        return true;
+      }
+      // Live means the index still points here; tombstones die with the tail
+      pg = page_ptr(kv, p);
+      h = (const kv_page_t *)pg;
+      for (off = HDR; off + REC <= h->used; off += rec_size(r->len)) {
+        r = (const kv_rec_t *)(pg + off);
+        i = find(kv, r->key);
+        if (i >= 0 && kv->slots[i].loc == (p << 16 | off) &&
+            !append(kv, r->key, r + 1, r->len, 0, false)) {
+          kv->gc_pos--;
+          return false;
+        }
+      }
+      return true;
+    }
+    // The copies must be on flash before the originals go
+    if (!flush(kv)) {
+      return false;
+    }
+    kv->gc_phase = GC_ERASE;
+    kv->gc_pos = 0;
+    return true;
+  }
+
+  // Unit 0 first: its page 0 takes the segment out of the log in one go
+  kv->erases++;
+  if (!kv->fl->erase(kv->fl->ctx, kv->tail * kv->seg_size + kv->gc_pos * kv->fl->erase_size)) {
+    return false;
+  }
+  if (++kv->gc_pos == kv->seg_size / kv->fl->erase_size) {
+    kv->tail = (kv->tail + 1) % kv->nsegs;
+    kv->free++;
+    kv->gc_phase = GC_IDLE;
+  }
+  return true;
+}
+
+bool kv_set(kv_t *kv, uint32_t key, const void *value, uint32_t len) {
+  uint32_t i;
+
+  if (len > kv->fl->page_size - HDR - REC || (find(kv, key) < 0 && kv->count * 4 >= (kv->mask + 1) * 3)) {
+    return false;
+  }
+  for (i = 0; i < GC_STEPS && kv_gc_step(kv); i++);
+  return append(kv, key, value, len, 0, true);
+}
+
+bool kv_delete(kv_t *kv, uint32_t key) {
+  uint32_t i;
+
+  if (find(kv, key) < 0) {
+    return false;
+  }
+  for (i = 0; i < GC_STEPS && kv_gc_step(kv); i++);
+  return append(kv, key, NULL, 0, TOMB, true);
+}
+
+int32_t kv_get(kv_t *kv, uint32_t key, void *value, uint32_t max) {
+  int32_t i = find(kv, key);
+  const uint8_t *src;
+  const kv_rec_t *r;
+  uint8_t *dst = value;
+  uint32_t p, n;
+
+  if (i < 0) {
+    return -1;
+  }
+  p = kv->slots[i].loc >> 16;
+  src = kv->open && p == kv->head ? kv->buf : page_ptr(kv, p);
+  r = (const kv_rec_t *)(src + (kv->slots[i].loc & 0xFFFF));
+  for (n = 0; n < r->len && n < max; n++) {
+    dst[n] = ((const uint8_t *)(r + 1))[n];
+  }
+  return r->len;
+}
+
+bool kv_sync(kv_t *kv) {
+  return flush(kv);
+}
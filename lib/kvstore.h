@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Log-structured key-value store for a reserved flash region.
+ *
+ * @details Records (32-bit key, up to KV_VALUE_MAX bytes) are packed into a
+ * one-page RAM buffer that is programmed as a whole page, so flash is only ever
+ * appended to in page units and an update never costs an erase. Each page
+ * carries a sequence number and a CRC-32 over its contents; a page that fails
+ * the check (torn by a power loss) is ignored and skipped over.
+ *
+ * The region is a ring of segments of seg_size bytes, written oldest to
+ * newest. An open-addressing hash index in RAM maps each key to its latest
+ * record and is rebuilt by kv_mount(), which replays the segments in sequence
+ * order. Garbage collection runs in small steps from kv_set() once the free
+ * segments run low (or from kv_gc_step() when idle): one step copies the live
+ * records out of one page of the oldest segment, or erases one erase unit of
+ * it. Page 0 of a segment is erased first, which retires the whole segment at
+ * once, so a half-erased segment never brings stale records back.
+ *
+ * Durability: a record is on flash once its page is programmed, which happens
+ * when the buffer fills or on kv_sync(). A power loss can cost the unsynced
+ * records, never older ones.
+ *
+ * Nothing here touches hardware; flash.c provides the on-chip region and
+ * tools/flash_sim.c a file-backed one with power-cut injection.
+ */
+
+#define KV_PAGE_MAX         256
+#define KV_VALUE_MAX        (KV_PAGE_MAX - 12 - 8)
+#define KV_NONE             0xFFFFFFFF
+
+typedef struct {
+  const uint8_t *base;      // Region, memory-mapped for reads
+  uint32_t size;
+  uint32_t page_size;       // Program unit, at most KV_PAGE_MAX
+  uint32_t erase_size;      // Smallest erase unit, a multiple of page_size
+  uint32_t erased;          // Word read back from erased flash
+  bool (*erase)(void *ctx, uint32_t off);                   // erase_size bytes
+  bool (*program)(void *ctx, uint32_t off, const void *page);  // page_size bytes
+  void *ctx;
+} kv_flash_t;
+
+typedef struct {
+  uint32_t key;
+  uint32_t loc;             // Page << 16 | offset of the record, KV_NONE if free
+} kv_slot_t;
+
+typedef struct {
+  const kv_flash_t *fl;
+  uint32_t seg_size;
+  uint32_t nsegs;
+  uint32_t seg_pages;       // Pages per segment
+  // Index
+  kv_slot_t *slots;
+  uint32_t mask;
+  uint32_t count;
+  // Log
+  uint32_t tail;            // Oldest live segment
+  uint32_t head;            // Page the buffer goes to
+  bool open;                // Segment of head is taken
+  uint32_t free;            // Erased segments not in the log
+  uint32_t seq;             // Of the next page
+  uint32_t used;            // Bytes in buf, header included
+  // Garbage collection
+  uint8_t gc_phase;
+  uint32_t gc_pos;          // Page being copied or unit being erased
+  // Counters
+  uint32_t programs, erases;
+  uint8_t buf[KV_PAGE_MAX] __attribute__((aligned(4)));
+} kv_t;
+
+/**
+ * @brief Rebuilds the index from flash, formatting a region with no valid log.
+ *
+ * @details seg_size is a multiple of erase_size, with at least 3 segments;
+ * nslots is a power of two, and at most 3/4 of the slots are used. Finishes
+ * erasing any segment a power loss left half-erased.
+ */
+bool kv_mount(kv_t *kv, const kv_flash_t *fl, uint32_t seg_size, kv_slot_t *slots, uint32_t nslots);
+
+bool kv_set(kv_t *kv, uint32_t key, const void *value, uint32_t len);
+// Length of the value, -1 if the key is not there; copies at most max bytes
+int32_t kv_get(kv_t *kv, uint32_t key, void *value, uint32_t max);
+bool kv_delete(kv_t *kv, uint32_t key);
+
+// Programs the partially filled buffer page
+bool kv_sync(kv_t *kv);
+
+// One bounded step of garbage collection; false when there is nothing to do
+bool kv_gc_step(kv_t *kv);
@@ -0,0 +1,128 @@
+#include "lfq.h"
+
+#include <stddef.h>
+
+
+// Whole words when everything is word aligned, as for most driver items
+static void copy(uint8_t *dst, const uint8_t *src, uint32_t n) {
+  if (!(((uintptr_t)dst | (uintptr_t)src | n) & 3)) {
+    for (; n; n -= 4, dst += 4, src += 4) {
+      *(uint32_t *)dst = *(const uint32_t *)src;
+    }
+    return;
+  }
+  while (n--) {
+    *dst++ = *src++;
+  }
+}
+
+void spsc_init(spsc_t *q, void *buf, uint32_t item_size, uint32_t len) {
+  q->head = 0;
+  q->tail_cache = 0;
+  q->tail = 0;
+  q->head_cache = 0;
+  q->buf = buf;
+  q->mask = len - 1;
+  q->item_size = item_size;
+}
+
+bool spsc_push(spsc_t *q, const void *item) {
+  uint32_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+
+  // Only touch the consumer's line when the cached tail says full
+  if (head - q->tail_cache > q->mask) {
+    q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (head - q->tail_cache > q->mask) {
+      return false;
+    }
+  }
+  copy(q->buf + (head & q->mask) * q->item_size, item, q->item_size);
+  __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool spsc_pop(spsc_t *q, void *item) {
+  uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+  if (tail == q->head_cache) {
+    q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (tail == q->head_cache) {
+      return false;
+    }
+  }
+  copy(item, q->buf + (tail & q->mask) * q->item_size, q->item_size);
+  __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+uint32_t spsc_count(const spsc_t *q) {
+  return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Each slot starts with a sequence word: pos while slot pos & mask is free for
+ * the producer claiming pos, pos + 1 once that item is published, and
+ * pos + len again when the consumer has taken it.
+ */
+void mpsc_init(mpsc_t *q, void *buf, uint32_t item_size, uint32_t len) {
+  uint32_t i;
+
+  q->head = 0;
+  q->dropped = 0;
+  q->tail = 0;
+  q->buf = buf;
+  q->mask = len - 1;
+  q->item_size = item_size;
+  q->slot_size = MPSC_BUF_SIZE(item_size, 1);
+  for (i = 0; i < len; i++) {
+    *(uint32_t *)(q->buf + i * q->slot_size) = i;
+  }
+}
+
+bool mpsc_push(mpsc_t *q, const void *item) {
+  uint32_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  uint32_t *seq;
+  int32_t d;
+
+  while (1) {
+    seq = (uint32_t *)(q->buf + (pos & q->mask) * q->slot_size);
+    d = (int32_t)(__atomic_load_n(seq, __ATOMIC_ACQUIRE) - pos);
+    if (d == 0) {
+      // The slot is free for pos: claim it, unless another producer got there first
+      if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (d < 0) {
+      // Still holds the item from a lap ago
+      __atomic_fetch_add(&q->dropped, 1, __ATOMIC_RELAXED);
+      return false;
+    } else {
+      pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    }
+  }
+  copy((uint8_t *)(seq + 1), item, q->item_size);
+  __atomic_store_n(seq, pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool mpsc_pop(mpsc_t *q, void *item) {
+  uint32_t tail = q->tail;
+  uint32_t *seq = (uint32_t *)(q->buf + (tail & q->mask) * q->slot_size);
+
+  if (__atomic_load_n(seq, __ATOMIC_ACQUIRE) != tail + 1) {
+    return false;
+  }
+  copy(item, (const uint8_t *)(seq + 1), q->item_size);
+  __atomic_store_n(seq, tail + q->mask + 1, __ATOMIC_RELEASE);
+  q->tail = tail + 1;
+  return true;
+}
+
+uint32_t mpsc_dropped(const mpsc_t *q) {
+  return __atomic_load_n(&q->dropped, __ATOMIC_RELAXED);
+}
+
+uint32_t mpsc_count(const mpsc_t *q) {
+  return __atomic_load_n(&q->head, __ATOMIC_RELAXED) - q->tail;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free queues for handing items from interrupts to tasks.
+ *
+ * @details Neither queue masks interrupts, so they add nothing to interrupt
+ * latency. Items are copied in and out and are item_size bytes each; the
+ * capacity is a power of two so that indices are free-running 32-bit counters
+ * reduced with a mask.
+ *
+ * spsc_t has one producer and one consumer, for example one interrupt and one
+ * task. Push and pop are wait-free: a plain load of the other side's index,
+ * the copy and a release store of their own.
+ *
+ * mpsc_t takes any number of producers (tasks and interrupts of any
+ * priority, preempting each other) and one consumer. Producers claim a slot
+ * with a compare-and-swap on the head (lr.w/sc.w on rv32imac) and publish it
+ * through the slot's sequence number; drops are counted with amoadd.w. A
+ * producer preempted between claiming and publishing holds back the consumer,
+ * not the other producers.
+ *
+ * The fields each side writes are grouped and aligned to LFQ_LINE so the two
+ * sides do not share a cache line. The CH32V307 has no data cache, so there the
+ * groups are only word aligned and the padding costs nothing.
+ *
+ * Nothing here touches hardware; the same code runs on the host
+ * (tools/lfq_stress.c).
+ */
+
+#ifndef LFQ_LINE
+#if defined(__riscv) && !defined(__linux__)
+#define LFQ_LINE            4
+#else
+#define LFQ_LINE            64
+#endif
+#endif
+
+// Bytes of mpsc_t buffer for len items of size bytes
+#define MPSC_BUF_SIZE(size, len) ((4 + ((size) + 3) / 4 * 4) * (len))
+
+typedef struct {
+  // Producer
+  __attribute__((aligned(LFQ_LINE))) uint32_t head;
+  uint32_t tail_cache;          // Last tail seen, reloaded only when it looks full
+  // Consumer
+  __attribute__((aligned(LFQ_LINE))) uint32_t tail;
+  uint32_t head_cache;
+  // Read-only after init
+  __attribute__((aligned(LFQ_LINE))) uint8_t *buf;
+  uint32_t mask;
+  uint32_t item_size;
+} spsc_t;
+
+typedef struct {
+  // Producers
+  __attribute__((aligned(LFQ_LINE))) uint32_t head;
+  uint32_t dropped;             // Pushes that found the queue full
+  // Consumer
+  __attribute__((aligned(LFQ_LINE))) uint32_t tail;
+  // Read-only after init
+  __attribute__((aligned(LFQ_LINE))) uint8_t *buf;
+  uint32_t mask;
+  uint32_t item_size;
+  uint32_t slot_size;           // Sequence word and the item, in bytes
+} mpsc_t;
+
+// buf holds len (a power of two) items of item_size bytes
+void spsc_init(spsc_t *q, void *buf, uint32_t item_size, uint32_t len);
+// False if full
+bool spsc_push(spsc_t *q, const void *item);
+// False if empty
+bool spsc_pop(spsc_t *q, void *item);
+uint32_t spsc_count(const spsc_t *q);
+
+// buf holds MPSC_BUF_SIZE(item_size, len) bytes, word aligned; len a power of two
+void mpsc_init(mpsc_t *q, void *buf, uint32_t item_size, uint32_t len);
+// False (and counted) if full
+bool mpsc_push(mpsc_t *q, const void *item);
+// False if empty or the oldest item is still being written
+bool mpsc_pop(mpsc_t *q, void *item);
+uint32_t mpsc_dropped(const mpsc_t *q);
+// Items claimed and not yet popped, some perhaps still being written; consumer side
+uint32_t mpsc_count(const mpsc_t *q);
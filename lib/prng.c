@@ -0,0 +1,70 @@
+#include "prng.h"
+
+
+static inline uint32_t rotl(uint32_t x, uint32_t k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+// SplitMix32-style finalizer, used to spread seed words over the whole state
+static uint32_t scramble(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7FEB352D;
+  x ^= x >> 15;
+  x *= 0x846CA68B;
+  x ^= x >> 16;
+  return x;
+}
+
+void prng_seed(prng_t *p, const uint32_t seed[4]) {
+  uint32_t i;
+
+  for (i = 0; i < 4; i++) {
+    p->s[i] = 0;
+  }
+  prng_mix(p, seed, 4);
+}
+
+void prng_mix(prng_t *p, const uint32_t *words, uint32_t n) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    p->s[i & 3] ^= scramble(words[i] + 0x9E3779B9 * (i + 1));
+  }
+  // The all-zero state is the one fixed point
+  if (!(p->s[0] | p->s[1] | p->s[2] | p->s[3])) {
+    p->s[0] = 0x9E3779B9;
+  }
+  for (i = 0; i < 8; i++) {
+    prng_next(p);
+  }
+}
+
+uint32_t prng_next(prng_t *p) {
+  uint32_t *s = p->s;
+  uint32_t r = rotl(s[1] * 5, 7) * 9;
+  uint32_t t = s[1] << 9;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotl(s[3], 11);
+  return r;
+}
+
+// Lemire's multiply-and-reject: one multiply, a division only on rejection
+uint32_t prng_below(prng_t *p, uint32_t bound) {
+  uint64_t m = (uint64_t)prng_next(p) * bound;
+  uint32_t lo = (uint32_t)m;
+  uint32_t t;
+
+  if (lo < bound) {
+    t = -bound % bound;
+    while (lo < t) {
+      m = (uint64_t)prng_next(p) * bound;
+      lo = (uint32_t)m;
+    }
+  }
+  return (uint32_t)(m >> 32);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief xoshiro128** pseudo-random generator.
+ *
+ * @details 128 bits of state, a few shifts, rotates and one multiply per 32-bit
+ * output, period 2^128 - 1. prng_mix() folds fresh entropy into a running state
+ * and stirs it, so a generator can be reseeded without losing what it already
+ * had. Not a cryptographic generator: fine for sequence numbers, transaction IDs
+ * and jitter, not for keys.
+ *
+ * Nothing here touches hardware; the same code runs on the host.
+ */
+
+typedef struct {
+  uint32_t s[4];
+} prng_t;
+
+void prng_seed(prng_t *p, const uint32_t seed[4]);
+void prng_mix(prng_t *p, const uint32_t *words, uint32_t n);
+uint32_t prng_next(prng_t *p);
+
+// Uniform in [0, bound) without modulo bias; bound 0 returns 0
+uint32_t prng_below(prng_t *p, uint32_t bound);
@@ -0,0 +1,39 @@
+#include "rng_health.h"
+
+
+void rng_health_init(rng_health_t *h) {
+  h->last = 0;
+  h->run = 0;
+  h->apt_seen = 0;
+  h->apt_count = 0;
+  h->rct_failures = 0;
+  h->apt_failures = 0;
+}
+
+bool rng_health_feed(rng_health_t *h, uint32_t sample) {
+  bool ok = true;
+
+  if (h->run && sample == h->last) {
+    if (++h->run >= RNG_HEALTH_RCT_CUTOFF) {
+      h->rct_failures++;
+      h->run = 0;
+      ok = false;
+    }
+  } else {
+    h->last = sample;
+    h->run = 1;
+  }
+
+  if (h->apt_seen == 0) {
+    h->apt_ref = sample & 0xFF;
+    h->apt_count = 1;
+  } else if ((sample & 0xFF) == h->apt_ref && ++h->apt_count >= RNG_HEALTH_APT_CUTOFF) {
+    h->apt_failures++;
+    h->apt_seen = 0;
+    return false;
+  }
+  if (++h->apt_seen == RNG_HEALTH_APT_WINDOW) {
+    h->apt_seen = 0;
+  }
+  return ok;
+}
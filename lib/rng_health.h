@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Continuous health tests on raw noise-source output (NIST SP 800-90B 4.4).
+ *
+ * @details Both tests use a false-alarm rate of 2^-20:
+ *  - repetition count: RNG_HEALTH_RCT_CUTOFF identical words in a row fail,
+ *    assuming at least 16 bits of min-entropy per 32-bit word;
+ *  - adaptive proportion: within a window of RNG_HEALTH_APT_WINDOW samples the
+ *    low byte of the first one may not come back RNG_HEALTH_APT_CUTOFF times,
+ *    assuming at least 4 bits of min-entropy per byte.
+ *
+ * rng_health_feed() returns false for a sample that completed a failure; the
+ * caller should drop it and whatever it has not yet used from the source.
+ *
+ * Nothing here touches hardware; the same code runs on the host.
+ */
+
+#define RNG_HEALTH_RCT_CUTOFF   3
+#define RNG_HEALTH_APT_WINDOW   512
+#define RNG_HEALTH_APT_CUTOFF   63
+
+typedef struct {
+  uint32_t last;
+  uint32_t run;
+  uint32_t apt_ref;
+  uint32_t apt_seen;
+  uint32_t apt_count;
+  uint32_t rct_failures;
+  uint32_t apt_failures;
+} rng_health_t;
+
+void rng_health_init(rng_health_t *h);
+bool rng_health_feed(rng_health_t *h, uint32_t sample);
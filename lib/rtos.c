@@ -0,0 +1,494 @@
+#include "rtos.h"
+
+#include <stddef.h>
+
+static struct kernel {
+  rtos_task_t *current;
+  rtos_task_t *ready[RTOS_PRIOS];
+  rtos_task_t *ready_tail[RTOS_PRIOS];
+  uint32_t ready_mask;          // Bit n: ready[n] is not empty
+  swtimer_list_t timers;
+  rtos_task_t idle;
+  uint32_t switches;
+  bool started;
+} k;
+
+
+static void ready_push(rtos_task_t *t) {
+  t->next = NULL;
+  if (k.ready[t->prio]) {
+    k.ready_tail[t->prio]->next = t;
+  } else {
+    k.ready[t->prio] = t;
+  }
+  k.ready_tail[t->prio] = t;
+  k.ready_mask |= 1u << t->prio;
+}
+
+// The running task goes back to the front, so a priority change does not cost it its turn
+static void ready_push_front(rtos_task_t *t) {
+  if (!k.ready[t->prio]) {
+    ready_push(t);
+    return;
+  }
+  t->next = k.ready[t->prio];
+  k.ready[t->prio] = t;
+}
+
+static void ready_remove(rtos_task_t *t) {
+  rtos_task_t **p, *prev = NULL;
+
+  for (p = &k.ready[t->prio]; *p && *p != t; p = &(*p)->next) {
+    prev = *p;
+  }
+  if (!*p) {
+    return;
+  }
+  *p = t->next;
+  if (k.ready_tail[t->prio] == t) {
+    k.ready_tail[t->prio] = prev;
+  }
+  if (!k.ready[t->prio]) {
+    k.ready_mask &= ~(1u << t->prio);
+  }
+  t->next = NULL;
+}
+
+static void waitq_insert(rtos_waitq_t *q, rtos_task_t *t) {
+  rtos_task_t **p;
+
+  for (p = &q->head; *p && (*p)->prio <= t->prio; p = &(*p)->next) {
+  }
+  t->next = *p;
+  *p = t;
+  t->waitq = q;
+}
+
+static void waitq_remove(rtos_task_t *t) {
+  rtos_task_t **p;
+
+  for (p = &t->waitq->head; *p; p = &(*p)->next) {
+    if (*p == t) {
+      *p = t->next;
+      break;
+    }
+  }
+  t->next = NULL;
+  t->waitq = NULL;
+}
+
+static rtos_task_t *highest_ready(void) {
+  return k.ready[__builtin_ctz(k.ready_mask)];
+}
+
+// Asks the port for a switch if someone should run instead of the current task
+static void schedule(void) {
+  if (k.started && highest_ready() != k.current) {
+    rtos_port_pend_switch();
+  }
+}
+
+static void arm(void) {
+  if (k.timers.head) {
+    rtos_port_alarm(true, k.timers.head->due);
+  } else {
+    rtos_port_alarm(false, 0);
+  }
+}
+
+static void set_prio(rtos_task_t *t, uint8_t prio) {
+  if (t->prio == prio) {
+    return;
+  }
+  if (t->state == RTOS_READY) {
+    ready_remove(t);
+    t->prio = prio;
+    if (t == k.current) {
+      ready_push_front(t);
+    } else {
+      ready_push(t);
+    }
+  } else if (t->waitq) {
+    rtos_waitq_t *q = t->waitq;
+
+    waitq_remove(t);
+    t->prio = prio;
+    waitq_insert(q, t);
+  } else {
+    t->prio = prio;
+  }
+}
+
+// Base priority, or that of the most urgent task waiting for a mutex t holds
+static uint8_t inherited_prio(const rtos_task_t *t) {
+  const rtos_mutex_t *m;
+  uint8_t prio = t->base_prio;
+
+  for (m = t->held; m; m = m->next_held) {
+    if (m->waiters.head && m->waiters.head->prio < prio) {
+      prio = m->waiters.head->prio;
+    }
+  }
+  return prio;
+}
+
+/**
+ * @brief Brings t's priority in line with the mutexes it holds, then that of
+ * the owner of the mutex t waits for, and so on down the chain.
+ */
+static void inherit_update(rtos_task_t *t) {
+  uint8_t prio;
+
+  while (t) {
+    prio = inherited_prio(t);
+    if (prio == t->prio) {
+      break;
+    }
+    set_prio(t, prio);
+    t = t->waiting_for ? t->waiting_for->owner : NULL;
+  }
+}
+
+static void wake(rtos_task_t *t, bool timed_out) {
+  if (t->waitq) {
+    waitq_remove(t);
+  }
+  swtimer_remove(&k.timers, &t->timer);
+  t->waiting_for = NULL;
+  t->timed_out = timed_out;
+  t->state = RTOS_READY;
+  ready_push(t);
+}
+
+static void timeout_expired(void *ctx) {
+  rtos_task_t *t = ctx;
+  rtos_mutex_t *m = t->waiting_for;
+
+  wake(t, true);
+  if (m) {
+    // One waiter less may lower what the owner inherited
+    inherit_update(m->owner);
+  }
+}
+
+// Takes the current task off the CPU until a wake() or its timeout
+static void block(rtos_waitq_t *q, uint32_t timeout) {
+  rtos_task_t *t = k.current;
+
+  ready_remove(t);
+  t->state = RTOS_BLOCKED;
+  t->timed_out = false;
+  if (q) {
+    waitq_insert(q, t);
+  }
+  if (timeout != RTOS_FOREVER) {
+    t->timer.due = rtos_port_now() + timeout;
+    t->timer.period = 0;
+    t->timer.fn = timeout_expired;
+    t->timer.ctx = t;
+    swtimer_insert(&k.timers, &t->timer);
+    arm();
+  }
+  schedule();
+}
+
+/**
+ * @brief Leaves the critical section entered with irq until the task, having
+ * blocked, has been switched out and is ready again.
+ *
+ * @details A port may take the switch a few instructions after the section
+ * ends (a priority threshold written over the bus), so a task that finds itself
+ * still blocked lets go again rather than carrying on.
+ */
+static void switch_away(uint32_t irq) {
+  do {
+    rtos_port_irq_restore(irq);
+    rtos_port_irq_save();
+  } while (k.current->state != RTOS_READY);
+}
+
+// What is left of timeout since start; false once it has run out
+static bool remaining(uint32_t start, uint32_t timeout, uint32_t *left) {
+  uint32_t spent;
+
+  if (timeout == RTOS_FOREVER) {
+    *left = RTOS_FOREVER;
+    return true;
+  }
+  spent = rtos_port_now() - start;
+  if (spent >= timeout) {
+    return false;
+  }
+  *left = timeout - spent;
+  return true;
+}
+
+/**
+ * @brief Blocks on q for what is left of timeout, called in the critical
+ * section entered with irq.
+ *
+ * @details The switch happens while the critical section is briefly left, and
+ * the task is back in it when this returns. False if it timed out; otherwise
+ * the caller checks its condition again, as another task may have got there
+ * first.
+ */
+static bool wait(rtos_waitq_t *q, uint32_t start, uint32_t timeout, uint32_t irq) {
+  uint32_t left;
+
+  if (!remaining(start, timeout, &left)) {
+    return false;
+  }
+  block(q, left);
+  switch_away(irq);
+  return !k.current->timed_out;
+}
+
+static void idle_task(void *arg) {
+  (void)arg;
+  while (1) {
+    rtos_port_idle();
+  }
+}
+
+void rtos_init(uint32_t *idle_stack, uint32_t words) {
+  k = (struct kernel){0};
+  rtos_task_create(&k.idle, "idle", RTOS_PRIOS - 1, idle_stack, words, idle_task, NULL);
+}
+
+void rtos_task_create(rtos_task_t *t, const char *name, uint8_t prio,
+                      uint32_t *stack, uint32_t words, rtos_entry_t entry, void *arg) {
+  uint32_t irq, i;
+
+  *t = (rtos_task_t){0};
+  t->name = name;
+  t->prio = t->base_prio = prio;
+  t->stack = stack;
+  t->stack_words = words;
+  for (i = 0; i < words; i++) {
+    stack[i] = RTOS_STACK_FILL;
+  }
+  rtos_port_task_init(t, entry, arg);
+  irq = rtos_port_irq_save();
+  t->state = RTOS_READY;
+  ready_push(t);
+  schedule();
+  rtos_port_irq_restore(irq);
+}
+
+void rtos_start(void) {
+  rtos_port_irq_save();
+  k.started = true;
+  rtos_port_start();
+}
+
+rtos_task_t *rtos_switch_in(void) {
+  uint32_t irq = rtos_port_irq_save();
+  rtos_task_t *t = highest_ready();
+
+  if (t != k.current) {
+    k.current = t;
+    t->switches++;
+    k.switches++;
+  }
+  rtos_port_irq_restore(irq);
+  return t;
+}
+
+void rtos_timeout_isr(void) {
+  uint32_t irq = rtos_port_irq_save();
+
+  swtimer_expire(&k.timers, rtos_port_now());
+  arm();
+  schedule();
+  rtos_port_irq_restore(irq);
+}
+
+void rtos_task_exit(void) {
+  rtos_task_t *t = k.current;
+  uint32_t irq;
+
+  while (t->held) {
+    rtos_mutex_unlock(t->held);
+  }
+  irq = rtos_port_irq_save();
+  ready_remove(t);
+  t->state = RTOS_DONE;
+  schedule();
+  rtos_port_irq_restore(irq);
+  while (1) {
+  }
+}
+
+rtos_task_t *rtos_self(void) {
+  return k.current;
+}
+
+uint32_t rtos_now(void) {
+  return rtos_port_now();
+}
+
+void rtos_yield(void) {
+  uint32_t irq = rtos_port_irq_save();
+  rtos_task_t *t = k.current;
+
+  ready_remove(t);
+  ready_push(t);
+  schedule();
+  rtos_port_irq_restore(irq);
+}
+
+void rtos_sleep(uint32_t us) {
+  uint32_t irq = rtos_port_irq_save();
+
+  block(NULL, us);
+  switch_away(irq);
+  rtos_port_irq_restore(irq);
+}
+
+uint32_t rtos_stack_free(const rtos_task_t *t) {
+  uint32_t n = 0;
+
+  while (n < t->stack_words && t->stack[n] == RTOS_STACK_FILL) {
+    n++;
+  }
+  return n;
+}
+
+uint32_t rtos_switches(void) {
+  return k.switches;
+}
+
+void rtos_sem_init(rtos_sem_t *s, uint32_t count, uint32_t max) {
+  *s = (rtos_sem_t){{NULL}, count, max};
+}
+
+bool rtos_sem_take(rtos_sem_t *s, uint32_t timeout) {
+  uint32_t irq = rtos_port_irq_save();
+  uint32_t start = rtos_port_now();
+  bool ok;
+
+  while (!(ok = s->count > 0) && wait(&s->waiters, start, timeout, irq)) {
+  }
+  if (ok) {
+    s->count--;
+  }
+  rtos_port_irq_restore(irq);
+  return ok;
+}
+
+bool rtos_sem_give(rtos_sem_t *s) {
+  uint32_t irq = rtos_port_irq_save();
+  bool ok = s->count < s->max;
+
+  if (ok) {
+    s->count++;
+    if (s->waiters.head) {
+      wake(s->waiters.head, false);
+      schedule();
+    }
+  }
+  rtos_port_irq_restore(irq);
+  return ok;
+}
+
+void rtos_mutex_init(rtos_mutex_t *m) {
+  *m = (rtos_mutex_t){{NULL}, NULL, NULL};
+}
+
+bool rtos_mutex_lock(rtos_mutex_t *m, uint32_t timeout) {
+  uint32_t irq = rtos_port_irq_save();
+  uint32_t start = rtos_port_now(), left;
+  rtos_task_t *self = k.current;
+  bool ok;
+
+  while (!(ok = !m->owner)) {
+    if (m->owner == self || !remaining(start, timeout, &left)) {
+      break;
+    }
+    self->waiting_for = m;
+    block(&m->waiters, left);
+    inherit_update(m->owner);
+    switch_away(irq);
+    if (self->timed_out) {
+      break;
+    }
+  }
+  if (ok) {
+    m->owner = self;
+    m->next_held = self->held;
+    self->held = m;
+    // Tasks still queued behind the one woken now push on the new owner
+    inherit_update(self);
+  }
+  rtos_port_irq_restore(irq);
+  return ok;
+}
+
+void rtos_mutex_unlock(rtos_mutex_t *m) {
+  uint32_t irq = rtos_port_irq_save();
+  rtos_task_t *self = k.current;
+  rtos_mutex_t **p;
+
+  if (m->owner == self) {
+    for (p = &self->held; *p != m; p = &(*p)->next_held) {
+    }
+    *p = m->next_held;
+    m->next_held = NULL;
+    m->owner = NULL;
+    if (m->waiters.head) {
+      wake(m->waiters.head, false);
+    }
+    inherit_update(self);
+    schedule();
+  }
+  rtos_port_irq_restore(irq);
+}
+
+void rtos_queue_init(rtos_queue_t *q, void *buf, uint32_t item_size, uint32_t len) {
+  *q = (rtos_queue_t){{NULL}, {NULL}, buf, item_size, len, 0, 0};
+}
+
+static void copy(uint8_t *dst, const uint8_t *src, uint32_t n) {
+  while (n--) {
+    *dst++ = *src++;
+  }
+}
+
+bool rtos_queue_send(rtos_queue_t *q, const void *item, uint32_t timeout) {
+  uint32_t irq = rtos_port_irq_save();
+  uint32_t start = rtos_port_now();
+  bool ok;
+
+  while (!(ok = q->count < q->len) && wait(&q->senders, start, timeout, irq)) {
+  }
+  if (ok) {
+    copy(q->buf + (q->head + q->count) % q->len * q->item_size, item, q->item_size);
+    q->count++;
+    if (q->receivers.head) {
+      wake(q->receivers.head, false);
+      schedule();
+    }
+  }
+  rtos_port_irq_restore(irq);
+  return ok;
+}
+
+bool rtos_queue_recv(rtos_queue_t *q, void *item, uint32_t timeout) {
+  uint32_t irq = rtos_port_irq_save();
+  uint32_t start = rtos_port_now();
+  bool ok;
+
+  while (!(ok = q->count > 0) && wait(&q->receivers, start, timeout, irq)) {
+  }
+  if (ok) {
+    copy(item, q->buf + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->len;
+    q->count--;
+    if (q->senders.head) {
+      wake(q->senders.head, false);
+      schedule();
+    }
+  }
+  rtos_port_irq_restore(irq);
+  return ok;
+}
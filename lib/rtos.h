@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "swtimer.h"
+
+/**
+ * @brief Small preemptive kernel with fixed-priority tasks.
+ *
+ * @details Priority 0 is the highest, as for the PFIC. The highest-priority
+ * ready task always runs; tasks of equal priority run in the order they became
+ * ready and only give way to each other by blocking or rtos_yield(). There is
+ * no tick: timeouts and sleeps sit in a swtimer list and the port arms a single
+ * alarm for the earliest one, so an idle system takes no interrupts at all and
+ * the idle task sleeps through rtos_port_idle().
+ *
+ * Switches are requested with rtos_port_pend_switch() and happen when the
+ * critical section or interrupt that requested them ends; on the CH32V307 that
+ * is the lowest-priority software interrupt (ch32v307/rtos_port.c).
+ *
+ * Mutexes use priority inheritance, passed along chains of blocked owners.
+ * Semaphore gives and queue sends with a zero timeout may be made from
+ * interrupts; everything that can block is for tasks only.
+ *
+ * Nothing here touches hardware; tools/rtos_host.c runs the same code on the
+ * host for logic tests.
+ */
+
+#define RTOS_PRIOS          32
+#define RTOS_FOREVER        0xFFFFFFFFu  // Timeout: wait as long as it takes
+#define RTOS_STACK_FILL     0xA5A5A5A5u  // Unused stack, see rtos_stack_free()
+
+typedef enum {
+  RTOS_READY,
+  RTOS_BLOCKED,             // On a wait queue, a timeout or both
+  RTOS_DONE                 // Returned from its entry function
+} rtos_state_t;
+
+typedef struct rtos_task rtos_task_t;
+typedef struct rtos_mutex rtos_mutex_t;
+
+typedef struct {
+  rtos_task_t *head;        // Highest priority first, FIFO within a priority
+} rtos_waitq_t;
+
+struct rtos_task {
+  void *sp;                 // Saved context; the port's switch code relies on this being first
+  rtos_task_t *next;        // Ready list or wait queue
+  uint8_t prio;             // Effective, raised by inheritance
+  uint8_t base_prio;
+  uint8_t state;
+  bool timed_out;
+  rtos_waitq_t *waitq;
+  rtos_mutex_t *waiting_for; // Mutex it is blocked on, for inheritance chains
+  rtos_mutex_t *held;       // Mutexes it owns, linked through next_held
+  swtimer_t timer;          // Timeout or sleep
+  uint32_t *stack;
+  uint32_t stack_words;
+  uint32_t switches;        // Times switched in
+  const char *name;
+  void *port;               // Owned by the port
+};
+
+struct rtos_mutex {
+  rtos_waitq_t waiters;
+  rtos_task_t *owner;
+  rtos_mutex_t *next_held;
+};
+
+typedef struct {
+  rtos_waitq_t waiters;
+  uint32_t count;
+  uint32_t max;
+} rtos_sem_t;
+
+typedef struct {
+  rtos_waitq_t senders;
+  rtos_waitq_t receivers;
+  uint8_t *buf;
+  uint32_t item_size;
+  uint32_t len;             // Capacity in items
+  uint32_t head;
+  uint32_t count;
+} rtos_queue_t;
+
+typedef void (*rtos_entry_t)(void *arg);
+
+/**
+ * @brief Sets up the kernel and its idle task (lowest priority).
+ *
+ * @details idle_stack holds words 32-bit words; the port knows what its
+ * rtos_port_idle() needs.
+ */
+void rtos_init(uint32_t *idle_stack, uint32_t words);
+
+/**
+ * @brief Creates a ready task; may be called before rtos_start() or from a task.
+ *
+ * @details The stack is filled with RTOS_STACK_FILL and must stay valid while
+ * the task exists. Returning from entry ends the task.
+ */
+void rtos_task_create(rtos_task_t *t, const char *name, uint8_t prio,
+                      uint32_t *stack, uint32_t words, rtos_entry_t entry, void *arg);
+
+// Switches to the highest-priority task; does not return
+void rtos_start(void);
+
+rtos_task_t *rtos_self(void);
+uint32_t rtos_now(void);
+void rtos_yield(void);
+void rtos_sleep(uint32_t us);
+// Words at the bottom of t's stack never written so far
+uint32_t rtos_stack_free(const rtos_task_t *t);
+// Total context switches
+uint32_t rtos_switches(void);
+
+// Timeouts are in microseconds: 0 polls, RTOS_FOREVER never expires
+void rtos_sem_init(rtos_sem_t *s, uint32_t count, uint32_t max);
+bool rtos_sem_take(rtos_sem_t *s, uint32_t timeout);
+// Also from interrupts; false if the count is already at max
+bool rtos_sem_give(rtos_sem_t *s);
+
+// Not recursive; only the owner may unlock
+void rtos_mutex_init(rtos_mutex_t *m);
+bool rtos_mutex_lock(rtos_mutex_t *m, uint32_t timeout);
+void rtos_mutex_unlock(rtos_mutex_t *m);
+
+// buf holds len items of item_size bytes; items are copied in and out
+void rtos_queue_init(rtos_queue_t *q, void *buf, uint32_t item_size, uint32_t len);
+// Also from interrupts with timeout 0
+bool rtos_queue_send(rtos_queue_t *q, const void *item, uint32_t timeout);
+bool rtos_queue_recv(rtos_queue_t *q, void *item, uint32_t timeout);
+
+/*
+ * Port interface: ch32v307/rtos_port.c on the target, tools/rtos_host.c on the
+ * host.
+ */
+
+// Nestable critical section against interrupts and switches
+uint32_t rtos_port_irq_save(void);
+void rtos_port_irq_restore(uint32_t state);
+// Switch to rtos_switch_in() once the current critical section or interrupt ends
+void rtos_port_pend_switch(void);
+// Builds t's first context so that it starts in entry(arg); sets t->sp
+void rtos_port_task_init(rtos_task_t *t, rtos_entry_t entry, void *arg);
+// Enters the first task; does not return
+void rtos_port_start(void);
+// Free-running microseconds
+uint32_t rtos_port_now(void);
+// Calls rtos_timeout_isr() from an interrupt at time at; armed false cancels
+void rtos_port_alarm(bool armed, uint32_t at);
+// Waits for an interrupt; the idle task loops on it
+void rtos_port_idle(void);
+
+/*
+ * Kernel entry points for the port.
+ */
+
+// Makes the highest-priority ready task current and returns it
+rtos_task_t *rtos_switch_in(void);
+// Runs expired timeouts and re-arms the alarm
+void rtos_timeout_isr(void);
+// Where a task's entry function returns to
+void rtos_task_exit(void);
@@ -0,0 +1,108 @@
+#include "rxring.h"
+
+#include <stddef.h>
+
+#define barrier()           __asm__ volatile("" ::: "memory")
+
+
+void rxring_init(rxring_t *r, uint8_t *buf, uint32_t size) {
+  r->buf = buf;
+  r->mask = size - 1;
+  r->head = 0;
+  r->tail = 0;
+  r->open = 0;
+  r->msg_head = 0;
+  r->msg_tail = 0;
+  r->overruns = 0;
+}
+
+/**
+ * @brief Moves the producer to the DMA write index pos (0..size-1).
+ *
+ * @details Must be called at least once per half ring (DMA half/full transfer
+ * interrupts), otherwise a full lap is indistinguishable from no progress.
+ * Returns the number of new bytes.
+ */
+uint32_t rxring_advance(rxring_t *r, uint32_t pos) {
+  uint32_t head = r->head;
+  uint32_t delta = (pos - head) & r->mask;
+
+  // Count the transition only, not every sample while the consumer is behind
+  if (head - r->tail <= r->mask + 1 && head + delta - r->tail > r->mask + 1) {
+    r->overruns++;
+  }
+  head += delta;
+  r->head = head;
+  return delta;
+}
+
+/**
+ * @brief Ends the current message at the producer position (idle line).
+ *
+ * @details When the boundary queue is full the boundary is dropped and the bytes
+ * are merged into the next message. Returns true if a message was queued.
+ */
+bool rxring_commit(rxring_t *r) {
+  uint32_t head = r->head;
+
+  if (head == r->open || r->msg_head - r->msg_tail == RXRING_MAX_MSGS) {
+    return false;
+  }
+  r->ends[r->msg_head & (RXRING_MAX_MSGS - 1)] = head;
+  r->open = head;
+  barrier();
+  r->msg_head++;
+  return true;
+}
+
+bool rxring_peek(rxring_t *r, rxring_msg_t *msg) {
+  uint32_t size = r->mask + 1;
+  uint32_t start, end, idx, first;
+
+  while (1) {
+    if (r->msg_tail == r->msg_head) {
+      return false;
+    }
+    barrier();
+    end = r->ends[r->msg_tail & (RXRING_MAX_MSGS - 1)];
+    if (r->head - r->tail <= size) {
+      break;
+    }
+    // Already overwritten by the DMA: drop it without handing it out
+    r->tail = end;
+    r->msg_tail++;
+  }
+
+  start = r->tail;
+  idx = start & r->mask;
+  msg->len = end - start;
+  first = size - idx;
+  if (first > msg->len) {
+    first = msg->len;
+  }
+  msg->part[0].data = r->buf + idx;
+  msg->part[0].len = first;
+  msg->part[1].data = r->buf;
+  msg->part[1].len = msg->len - first;
+  return true;
+}
+
+/**
+ * @brief Releases the message returned by the last rxring_peek().
+ *
+ * @details Returns false if the producer overwrote part of the message before it
+ * was released, in which case whatever the consumer read must be discarded.
+ */
+bool rxring_release(rxring_t *r) {
+  uint32_t size = r->mask + 1;
+  bool intact;
+
+  if (r->msg_tail == r->msg_head) {
+    return false;
+  }
+  intact = r->head - r->tail <= size;
+  barrier();
+  r->tail = r->ends[r->msg_tail & (RXRING_MAX_MSGS - 1)];
+  r->msg_tail++;
+  return intact;
+}
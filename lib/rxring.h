@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Zero-copy receive ring filled by a circular DMA channel.
+ *
+ * @details The producer (DMA interrupt / idle-line interrupt) reports the DMA
+ * write position with rxring_advance() and closes a message with rxring_commit().
+ * The consumer gets each complete message as at most two spans pointing into the
+ * ring (two when the message wraps) and hands the bytes back with
+ * rxring_release(). Positions are free-running 32-bit byte counters, so the ring
+ * size must be a power of two.
+ *
+ * Nothing here touches hardware; the same code runs on the host, where
+ * tools/rxring_test.c checks it.
+ *
+ * @note The DMA never stops, so a consumer that holds a message for more than one
+ * lap of the ring loses it. rxring_release() reports whether the bytes were still
+ * intact when they were released.
+ */
+
+#define RXRING_MAX_MSGS     16 // Pending message boundaries, power of two
+
+typedef struct {
+  const uint8_t *data;
+  uint32_t len;
+} span_t;
+
+typedef struct {
+  span_t part[2]; // part[1].len != 0 when the message wraps the ring
+  uint32_t len;
+} rxring_msg_t;
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t mask;
+  volatile uint32_t head;       // Bytes written by the producer
+  volatile uint32_t tail;       // Bytes released by the consumer
+  uint32_t open;                // Start of the message still being received
+  volatile uint32_t ends[RXRING_MAX_MSGS];
+  volatile uint32_t msg_head;
+  volatile uint32_t msg_tail;
+  volatile uint32_t overruns;   // Producer laps over unreleased data
+} rxring_t;
+
+void rxring_init(rxring_t *r, uint8_t *buf, uint32_t size);
+
+// Producer side
+uint32_t rxring_advance(rxring_t *r, uint32_t pos);
+bool rxring_commit(rxring_t *r);
+
+// Consumer side
+bool rxring_peek(rxring_t *r, rxring_msg_t *msg);
+bool rxring_release(rxring_t *r);
@@ -0,0 +1,59 @@
+#include "swtimer.h"
+
+#include <stddef.h>
+
+
+void swtimer_insert(swtimer_list_t *l, swtimer_t *t) {
+  swtimer_t **p;
+
+  if (t->armed) {
+    swtimer_remove(l, t);
+  }
+  // Equal deadlines keep the order they were armed in
+  for (p = &l->head; *p && (int32_t)((*p)->due - t->due) <= 0; p = &(*p)->next) {
+  }
+  t->next = *p;
+  *p = t;
+  t->armed = true;
+}
+
+void swtimer_remove(swtimer_list_t *l, swtimer_t *t) {
+  swtimer_t **p;
+
+  if (!t->armed) {
+    return;
+  }
+  for (p = &l->head; *p; p = &(*p)->next) {
+    if (*p == t) {
+      *p = t->next;
+      break;
+    }
+  }
+  t->next = NULL;
+  t->armed = false;
+}
+
+uint32_t swtimer_expire(swtimer_list_t *l, uint32_t now) {
+  swtimer_t *t;
+  uint32_t n = 0, late, skip;
+
+  while ((t = l->head) && (int32_t)(now - t->due) >= 0) {
+    late = now - t->due;
+    if (late > l->late_max) {
+      l->late_max = late;
+    }
+    l->head = t->next;
+    t->next = NULL;
+    t->armed = false;
+    if (t->period) {
+      skip = late / t->period;
+      l->missed += skip;
+      t->due += (skip + 1) * t->period;
+      swtimer_insert(l, t);
+    }
+    l->fired++;
+    n++;
+    t->fn(t->ctx);
+  }
+  return n;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Software timers kept in a list sorted by deadline.
+ *
+ * @details Times are free-running 32-bit counts in whatever unit the caller's
+ * clock uses (microseconds for systime.h) and are compared modulo 2^32, so
+ * every deadline must lie within 2^31 units of the current time. The head of
+ * the list is the next deadline, which is all a tickless time base or a power
+ * manager needs to look at.
+ *
+ * A periodic timer is re-armed from its previous deadline, not from the time
+ * it actually ran, so it does not drift; periods it missed entirely are
+ * skipped and counted.
+ *
+ * Nothing here touches hardware; the same code runs on the host.
+ */
+
+typedef void (*swtimer_fn_t)(void *ctx);
+
+typedef struct swtimer {
+  struct swtimer *next;
+  uint32_t due;             // Absolute deadline
+  uint32_t period;          // 0: one-shot
+  bool armed;
+  swtimer_fn_t fn;
+  void *ctx;
+} swtimer_t;
+
+typedef struct {
+  swtimer_t *head;
+  uint32_t fired;
+  uint32_t missed;          // Periods skipped because a timer ran too late
+  uint32_t late_max;        // Largest delay between a deadline and its callback
+} swtimer_list_t;
+
+// (Re)arms t for t->due; a timer that is already armed is moved
+void swtimer_insert(swtimer_list_t *l, swtimer_t *t);
+void swtimer_remove(swtimer_list_t *l, swtimer_t *t);
+
+/**
+ * @brief Runs every timer due at or before now, earliest first.
+ *
+ * @details A timer is unlinked (periodic ones re-armed) before its callback
+ * runs, so the callback may stop, restart or re-arm any timer, itself
+ * included. Returns the number of callbacks run.
+ */
+uint32_t swtimer_expire(swtimer_list_t *l, uint32_t now);
+
+// Time until the next deadline (0 if overdue); false if no timer is armed
+static inline bool swtimer_next(const swtimer_list_t *l, uint32_t now, uint32_t *in) {
+  int32_t d;
+
+  if (!l->head) {
+    return false;
+  }
+  d = (int32_t)(l->head->due - now);
+  *in = d > 0 ? (uint32_t)d : 0;
+  return true;
+}
@@ -0,0 +1,94 @@
+#include "tlog.h"
+
+#define MASK                (TLOG_RING_WORDS - 1)
+
+static struct {
+  uint32_t words[TLOG_RING_WORDS];
+  uint32_t head;        // Next word to reserve (producers, CAS)
+  uint32_t tail;        // First unreleased word (drain)
+  uint32_t inflight;    // Words handed to the transport
+  uint32_t carry;       // Words of a wrapped record left for the next span
+  uint32_t dropped;
+} ring;
+
+
+void tlog_write(uint32_t id, const uint32_t *args, uint32_t nargs) {
+  uint32_t n = nargs + 1;
+  uint32_t head = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+  uint32_t i;
+
+  do {
+    if (head + n - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) > TLOG_RING_WORDS) {
+      __atomic_fetch_add(&ring.dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&ring.head, &head, head + n, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  for (i = 0; i < nargs; i++) {
+    ring.words[(head + 1 + i) & MASK] = args[i];
+  }
+  // The header goes last: a non-zero header is what marks the record committed
+  __atomic_store_n(&ring.words[head & MASK],
+                   TLOG_VALID | (nargs << 24) | (id & 0xFFFFFF), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Hands the next run of committed records to send().
+ *
+ * @details The span is contiguous in RAM, so it stops at the first record still
+ * being written and at the end of the ring; a record that wraps is split and its
+ * remainder leads the next span. Only one span is in flight at a time; returns
+ * false if one already is or there is nothing to send.
+ */
+bool tlog_drain(tlog_send_t send, void *ctx) {
+  uint32_t start = ring.tail;
+  uint32_t prev = ring.carry;
+  uint32_t end = start + prev;
+  uint32_t limit = TLOG_RING_WORDS - (start & MASK);
+  uint32_t carry = 0;
+  uint32_t h;
+
+  if (ring.inflight) {
+    return false;
+  }
+  while (end - start < limit) {
+    h = __atomic_load_n(&ring.words[end & MASK], __ATOMIC_ACQUIRE);
+    if (!(h & TLOG_VALID)) {
+      break;
+    }
+    end += 1 + ((h >> 24) & 0xF);
+  }
+  if (end - start > limit) {
+    carry = end - start - limit;
+    end = start + limit;
+  }
+  if (end == start) {
+    return false;
+  }
+
+  // Both before send(): its DMA may finish, and tlog_sent() run, before it returns
+  ring.inflight = end - start;
+  ring.carry = carry;
+  if (!send(ctx, &ring.words[start & MASK], ring.inflight * 4)) {
+    ring.carry = prev;
+    ring.inflight = 0;
+    return false;
+  }
+  return true;
+}
+
+void tlog_sent(void) {
+  uint32_t i;
+
+  // Clear the headers so the space reads as uncommitted on the next lap
+  for (i = 0; i < ring.inflight; i++) {
+    ring.words[(ring.tail + i) & MASK] = 0;
+  }
+  __atomic_store_n(&ring.tail, ring.tail + ring.inflight, __ATOMIC_RELEASE);
+  ring.inflight = 0;
+}
+
+uint32_t tlog_dropped(void) {
+  return __atomic_load_n(&ring.dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Deferred tokenized logging.
+ *
+ * @details TLOG("adc %d overrun %x", n, flags) does no formatting on the MCU.
+ * The format string is placed in the .tlog_fmt section, which the linker script
+ * keeps in the ELF at address 0 but never loads into flash, and the string's
+ * address in that section is its ID. A record of one header word plus one word
+ * per argument is reserved in a RAM ring with a single compare-and-swap, so any
+ * context (thread or ISR of any priority) may log concurrently without masking
+ * interrupts.
+ *
+ * Header word: bit 31 valid, bits 27:24 argument count, bits 23:0 string ID.
+ * Arguments are raw 32-bit words; float/double are sent as float bits and
+ * strings as pointers into flash, resolved by tools/tlog_decode.py from the ELF.
+ *
+ * The ring is drained by tlog_drain() into any transport (UART DMA, Ethernet):
+ * the transport gets a contiguous span of committed records straight out of the
+ * ring, with the ctx given to tlog_drain(), and calls tlog_sent() once its DMA
+ * is done with it. ch32v307/tlog_uart.h does this over a USART.
+ */
+
+#ifndef TLOG_RING_WORDS
+#define TLOG_RING_WORDS     1024 // Power of two
+#endif
+
+#define TLOG_VALID          0x80000000u
+#define TLOG_MAX_ARGS       8
+
+typedef bool (*tlog_send_t)(void *ctx, const void *data, uint32_t len);
+
+void tlog_write(uint32_t id, const uint32_t *args, uint32_t nargs);
+bool tlog_drain(tlog_send_t send, void *ctx);
+void tlog_sent(void);
+uint32_t tlog_dropped(void);
+
+static inline uint32_t tlog_f2u(double v) {
+  union { float f; uint32_t u; } x = {(float)v};
+  return x.u;
+}
+
+static inline uint32_t tlog_i2u(uint32_t v) {
+  return v;
+}
+
+static inline uint32_t tlog_p2u(const void *p) {
+  return (uint32_t)(uintptr_t)p;
+}
+
+#define TLOG_ARG(x) _Generic((x),                                       \
+    float: tlog_f2u, double: tlog_f2u,                                  \
+    char *: tlog_p2u, const char *: tlog_p2u,                           \
+    void *: tlog_p2u, const void *: tlog_p2u,                           \
+    default: tlog_i2u)(x)
+
+#define TLOG_NARGS(...)     TLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define TLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define TLOG_CAT(a, b)      TLOG_CAT_(a, b)
+#define TLOG_CAT_(a, b)     a##b
+
+#define TLOG_MAP0()
+#define TLOG_MAP1(a)                    , TLOG_ARG(a)
+#define TLOG_MAP2(a, ...)               , TLOG_ARG(a) TLOG_MAP1(__VA_ARGS__)
+#define TLOG_MAP3(a, ...)               , TLOG_ARG(a) TLOG_MAP2(__VA_ARGS__)
+#define TLOG_MAP4(a, ...)               , TLOG_ARG(a) TLOG_MAP3(__VA_ARGS__)
+#define TLOG_MAP5(a, ...)               , TLOG_ARG(a) TLOG_MAP4(__VA_ARGS__)
+#define TLOG_MAP6(a, ...)               , TLOG_ARG(a) TLOG_MAP5(__VA_ARGS__)
+#define TLOG_MAP7(a, ...)               , TLOG_ARG(a) TLOG_MAP6(__VA_ARGS__)
+#define TLOG_MAP8(a, ...)               , TLOG_ARG(a) TLOG_MAP7(__VA_ARGS__)
+
+#define TLOG(fmt, ...) do {                                                   \
+    static const char tlog_fmt_[] __attribute__((section(".tlog_fmt"), used)) = fmt; \
+    const uint32_t tlog_args_[] = {0 TLOG_CAT(TLOG_MAP, TLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)}; \
+    tlog_write((uint32_t)(uintptr_t)tlog_fmt_, tlog_args_ + 1, TLOG_NARGS(__VA_ARGS__)); \
+  } while (0)
@@ -0,0 +1,87 @@
+#include "wave.h"
+
+#include "dsp.h"
+
+#define QTR                 (DSP_FFT_MAX / 4)
+#define TURN_BITS           __builtin_ctz(DSP_FFT_MAX)
+
+
+static inline uint16_t level(int32_t s, uint16_t amp, uint16_t mid) {
+  int32_t v = mid + ((s * amp + (1 << 14)) >> 15);
+
+  return v < 0 ? 0 : v > WAVE_MAX ? WAVE_MAX : (uint16_t)v;
+}
+
+// Point i of a full turn of DSP_FFT_MAX points, folded out of the quarter table
+static inline int32_t sin_at(uint32_t i) {
+  uint32_t r = i & (QTR - 1);
+
+  switch ((i / QTR) & 3) {
+    case 0:  return dsp_sin_q15[r];
+    case 1:  return dsp_sin_q15[QTR - r];
+    case 2:  return -dsp_sin_q15[r];
+    default: return -dsp_sin_q15[QTR - r];
+  }
+}
+
+int16_t wave_sin(uint32_t phase) {
+  uint32_t i = phase >> (32 - TURN_BITS);
+  int32_t frac = (phase >> (17 - TURN_BITS)) & 0x7FFF;
+  int32_t a = sin_at(i);
+  int32_t b = sin_at(i + 1);
+
+  return (int16_t)(a + (((b - a) * frac) >> 15));
+}
+
+uint32_t wave_sine(uint16_t *out, uint32_t n, uint32_t phase, uint32_t step, uint16_t amp, uint16_t mid) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++, phase += step) {
+    out[i] = level(wave_sin(phase), amp, mid);
+  }
+  return phase;
+}
+
+/**
+ * @brief Linear sweep from step0 to step1 over n samples.
+ *
+ * @details The increment itself is stepped by a signed 32.16 fixed-point delta,
+ * so the frequency error at the end of the sweep stays below one LSB of step.
+ */
+uint32_t wave_chirp(uint16_t *out, uint32_t n, uint32_t phase, uint32_t step0, uint32_t step1, uint16_t amp, uint16_t mid) {
+  int64_t step = (int64_t)step0 << 16;
+  int64_t delta = n > 1 ? ((int64_t)step1 - step0) * 65536 / (int64_t)(n - 1) : 0;
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    out[i] = level(wave_sin(phase), amp, mid);
+    phase += (uint32_t)(step >> 16);
+    step += delta;
+  }
+  return phase;
+}
+
+uint32_t wave_lut(uint16_t *out, uint32_t n, uint32_t phase, uint32_t step,
+                  const int16_t *table, uint32_t len, uint16_t amp, uint16_t mid) {
+  uint64_t pos;
+  uint32_t i, k;
+  int32_t a, b, frac;
+
+  for (i = 0; i < n; i++, phase += step) {
+    pos = (uint64_t)phase * len;
+    k = (uint32_t)(pos >> 32);
+    frac = (int32_t)((uint32_t)pos >> 17);
+    a = table[k];
+    b = table[k + 1 < len ? k + 1 : 0];
+    out[i] = level(a + (((b - a) * frac) >> 15), amp, mid);
+  }
+  return phase;
+}
+
+void wave_pair(uint32_t *out, const uint16_t *a, const uint16_t *b, uint32_t n) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    out[i] = (a[i] & 0xFFF) | ((uint32_t)(b[i] & 0xFFF) << 16);
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Waveform synthesis into DAC sample buffers.
+ *
+ * @details Generators run a 32-bit phase accumulator (one turn is 2^32) and write
+ * unsigned 12-bit DAC codes: mid + amp * shape, clamped to 0..4095. The sine is
+ * interpolated from the quarter-wave table of lib/dsp, lookup tables of any
+ * length are interpolated the same way.
+ *
+ * A buffer that is played in a loop has no seam when it holds a whole number of
+ * cycles: use wave_step(cycles, len). For a frequency at a sample rate use
+ * wave_step(f_hz, rate_hz).
+ *
+ * Nothing here touches hardware; the same code runs on the host, where
+ * tools/wave_test.c checks it.
+ */
+
+#define WAVE_MAX            4095  // 12-bit DAC full scale
+
+// Phase increment of num / den turns per sample
+static inline uint32_t wave_step(uint32_t num, uint32_t den) {
+  return (uint32_t)(((uint64_t)num << 32) / den);
+}
+
+int16_t wave_sin(uint32_t phase);
+
+// Each returns the phase after the last sample, to continue in the next buffer
+uint32_t wave_sine(uint16_t *out, uint32_t n, uint32_t phase, uint32_t step, uint16_t amp, uint16_t mid);
+uint32_t wave_chirp(uint16_t *out, uint32_t n, uint32_t phase, uint32_t step0, uint32_t step1, uint16_t amp, uint16_t mid);
+uint32_t wave_lut(uint16_t *out, uint32_t n, uint32_t phase, uint32_t step,
+                  const int16_t *table, uint32_t len, uint16_t amp, uint16_t mid);
+
+// Packs two channels for the dual DAC holding register (a in 11:0, b in 27:16)
+void wave_pair(uint32_t *out, const uint16_t *a, const uint16_t *b, uint32_t n);
@@ -7,20 +7,41 @@
 *
 */
 #include "ch32v307.h"
-#include "timers.h"
+#include "ao_port.h"
+#include "pfic.h"
+#include "power.h"
+#include "systime.h"
 #include <string.h>
 
-#define RCC_AHBPeriph_ETH_MAC            ((uint32_t)0x00004000)
-#define RCC_AHBPeriph_ETH_MAC_Tx         ((uint32_t)0x00008000)
-#define RCC_AHBPeriph_ETH_MAC_Rx         ((uint32_t)0x00010000)
+enum {
+  SIG_BLINK = AO_SIG_USER,
+};
+
+static ao_t blinker;
+static uint32_t blinker_queue[AO_QUEUE_SIZE(4) / 4];
+static ao_timer_t blink_timer;
+static ao_event_t blink_event = AO_EVENT(SIG_BLINK);
+
+static void blinker_run(ao_t *me, const ao_event_t *e) {
+  switch (e->sig) {
+  case AO_SIG_INIT:
+    ao_timer_start(&blink_timer, me, &blink_event, 1000000, 1000000);
+    break;
+  case SIG_BLINK:
+    led1_toggle();
+    GPIOA_ODR ^= (1 << 5);
+    break;
+  }
+}
 
 
 void main(void) {
+  // Whatever reset or the bootloader left on, drivers take what they need
+  rcc_clock_gate_unused();
   enable_afioen();
-  tim2_init();
   enable_gpioa();
-
-  RCC->AHBENR &= ~(RCC_AHBPeriph_ETH_MAC | RCC_AHBPeriph_ETH_MAC_Tx | RCC_AHBPeriph_ETH_MAC_Rx);
+  systime_init();
+  pm_init();
 
   // Disable JTAG/SWD so PA15 can be used
   AFIO_PCFR1 |= (0b100 << 24); // Full disable: SWJ_CFG = 0b100
@@ -33,15 +54,10 @@ void main(void) {
   GPIOA_CRL &= ~(0xF << 20);
   GPIOA_CRL |=  (0x2 << 20);
 
-  while (1) {
-      led1_toggle();
-      GPIOA_ODR ^= (1 << 5);
-      delay_ms(1000);
-  }
-}
-
-__attribute__((naked, section(".init"))) void _start(void) {
-    main();
-    while (1);
+  // The LEDs keep their state through stop; nothing else needs waking
+  ao_init();
+  ao_start(&blinker, 1, blinker_run, blinker_queue, 4);
+  irq_global_enable();
+  ao_run();
 }
 
@@ -0,0 +1,40 @@
+#include "blockdev_file.h"
+
+
+static bool file_read(void *ctx, uint32_t lba, void *buf, uint32_t count) {
+  blockdev_file_t *b = ctx;
+
+  b->reads++;
+  return fseek(b->f, (long)lba * BLOCK_SIZE, SEEK_SET) == 0 &&
+    fread(buf, BLOCK_SIZE, count, b->f) == count;
+}
+
+static bool file_write(void *ctx, uint32_t lba, const void *buf, uint32_t count) {
+  blockdev_file_t *b = ctx;
+
+  b->writes++;
+  return fseek(b->f, (long)lba * BLOCK_SIZE, SEEK_SET) == 0 &&
+    fwrite(buf, BLOCK_SIZE, count, b->f) == count;
+}
+
+bool blockdev_file_open(blockdev_file_t *b, const char *path, blockdev_t *dev) {
+  long size;
+
+  b->f = fopen(path, "r+b");
+  b->reads = b->writes = 0;
+  if (!b->f || fseek(b->f, 0, SEEK_END) != 0 || (size = ftell(b->f)) < 0) {
+    return false;
+  }
+  dev->read = file_read;
+  dev->write = file_write;
+  dev->ctx = b;
+  dev->blocks = size / BLOCK_SIZE;
+  return true;
+}
+
+void blockdev_file_close(blockdev_file_t *b) {
+  if (b->f) {
+    fclose(b->f);
+    b->f = NULL;
+  }
+}
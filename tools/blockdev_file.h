@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "blockdev.h"
+
+/**
+ * @brief Host-side block device backed by a disk image file.
+ *
+ * @details Lets the file layers run against an image that the host can mount
+ * or fsck afterwards. tools/fatlog_test.c is the example; build it with
+ * cc -O2 -Ilib -Itools tools/fatlog_test.c tools/blockdev_file.c lib/fatlog.c
+ */
+typedef struct {
+  FILE *f;
+  uint32_t reads, writes;   // Calls, to check the access pattern
+} blockdev_file_t;
+
+bool blockdev_file_open(blockdev_file_t *b, const char *path, blockdev_t *dev);
+void blockdev_file_close(blockdev_file_t *b);
@@ -0,0 +1,254 @@
+/*
+ * Host test for the CAN filter compiler (lib/canfilt.h).
+ *
+ *   canfilt_test [rounds]
+ *
+ * Each round draws a random rule set (exact and masked IDs, standard and
+ * extended, both FIFOs, with runs of neighbouring IDs so the lossless merges
+ * fire) and packs it, into a random bank budget with canfilt_pack() and for two
+ * controllers with canfilt_share(). The banks are then run through a model of
+ * the bxCAN filter match, built from the reference manual's register layouts
+ * rather than from canfilt.c, over every standard ID and over extended IDs
+ * drawn from the rules, their one-bit neighbours and at random:
+ *  - every ID a rule wants reaches that rule's FIFO, and remote frames never
+ *    pass;
+ *  - when the result is reported exact, nothing else passes, so exact-match
+ *    rules still accept their ID alone;
+ *  - the banks fit the budget, and whenever the merged rules need no more
+ *    than it (canfilt_merge()) they are exact and that many;
+ *  - packing fails only when the budget is below one bank per FIFO and ID kind.
+ * Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -o canfilt_test tools/canfilt_test.c lib/canfilt.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "canfilt.h"
+
+#define MAX_RULES           40
+#define EXT_SAMPLES         2000
+
+typedef struct {
+  const canfilt_rule_t *rules;
+  uint32_t n;
+} want_t;
+
+static uint32_t seed = 1;
+static uint32_t round_no;
+
+
+#define FAIL(...) do {                                                  \
+    printf("round %u: ", round_no);                                     \
+    printf(__VA_ARGS__);                                                \
+    printf("\n");                                                       \
+    exit(1);                                                            \
+  } while (0)
+
+static uint32_t rnd(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8 ^ seed << 24;
+}
+
+static uint32_t full(bool ext) {
+  return ext ? CANFILT_EXT_MASK : CANFILT_STD_MASK;
+}
+
+// Filter register images of a frame, RM0008 24.7.4 / CH32V307 RM 24.3.4
+static uint32_t image32(uint32_t id, bool ext, bool rtr) {
+  return (ext ? id << 3 | 4 : id << 21) | (rtr ? 2 : 0);
+}
+
+static uint32_t image16(uint32_t id, bool ext, bool rtr) {
+  uint32_t stid = ext ? id >> 18 : id, exid = ext ? (id >> 15) & 7 : 0;
+
+  return stid << 5 | (rtr ? 1 << 4 : 0) | (ext ? 1 << 3 : 0) | exid;
+}
+
+// Bitmask of the FIFOs the banks pass the frame to
+static uint32_t hw_accepts(const canfilt_bank_t *b, uint32_t k, uint32_t id, bool ext, bool rtr) {
+  uint32_t w32 = image32(id, ext, rtr), w16 = image16(id, ext, rtr), fifos = 0, i;
+  bool hit;
+
+  for (i = 0; i < k; i++, b++) {
+    if (b->scale32 && b->list) {
+      hit = w32 == b->fr1 || w32 == b->fr2;
+    } else if (b->scale32) {
+      hit = !((w32 ^ b->fr1) & b->fr2);
+    } else if (b->list) {
+      hit = w16 == (b->fr1 & 0xFFFF) || w16 == b->fr1 >> 16 ||
+            w16 == (b->fr2 & 0xFFFF) || w16 == b->fr2 >> 16;
+    } else {
+      hit = !((w16 ^ b->fr1) & b->fr1 >> 16 & 0xFFFF) || !((w16 ^ b->fr2) & b->fr2 >> 16 & 0xFFFF);
+    }
+    if (hit) {
+      fifos |= 1u << b->fifo;
+    }
+  }
+  return fifos;
+}
+
+// Bitmask of the FIFOs the original rules want the frame in
+static uint32_t wanted(const want_t *w, uint32_t id, bool ext) {
+  const canfilt_rule_t *r = w->rules;
+  uint32_t fifos = 0, i, mask;
+
+  for (i = 0; i < w->n; i++, r++) {
+    mask = r->mask & full(r->ext);
+    if (r->ext == ext && !((id ^ r->id) & mask)) {
+      fifos |= 1u << (r->fifo & 1);
+    }
+  }
+  return fifos;
+}
+
+static void check_id(const char *what, const want_t *w, const canfilt_bank_t *b, uint32_t k,
+                     bool exact, uint32_t id, bool ext) {
+  uint32_t want = wanted(w, id, ext), got = hw_accepts(b, k, id, ext, false);
+
+  if (want & ~got) {
+    FAIL("%s: %s ID %x wanted in FIFOs %x, passed to %x", what, ext ? "extended" : "standard", id, want, got);
+  }
+  if (exact && got != want) {
+    FAIL("%s: exact banks pass %s ID %x to FIFOs %x, wanted %x", what, ext ? "extended" : "standard", id, got,
+         want);
+  }
+  if (hw_accepts(b, k, id, ext, true)) {
+    FAIL("%s: remote frame with %s ID %x passes", what, ext ? "extended" : "standard", id);
+  }
+}
+
+static void check_banks(const char *what, const want_t *w, const canfilt_bank_t *b, uint32_t k, bool exact) {
+  const canfilt_rule_t *r;
+  uint32_t id, i, j;
+
+  for (id = 0; id <= CANFILT_STD_MASK; id++) {
+    check_id(what, w, b, k, exact, id, false);
+  }
+  for (i = 0, r = w->rules; i < w->n; i++, r++) {
+    if (!r->ext) {
+      continue;
+    }
+    id = ((r->id & r->mask) | (rnd() & ~r->mask)) & CANFILT_EXT_MASK;
+    check_id(what, w, b, k, exact, id, true);
+    for (j = 0; j < 29; j++) {
+      check_id(what, w, b, k, exact, id ^ (1u << j), true);
+    }
+    // Same low bits under a standard frame: caught only by IDE
+    check_id(what, w, b, k, exact, id & CANFILT_STD_MASK, false);
+  }
+  for (i = 0; i < EXT_SAMPLES; i++) {
+    check_id(what, w, b, k, exact, rnd() & CANFILT_EXT_MASK, true);
+  }
+}
+
+static canfilt_rule_t draw_rule(void) {
+  canfilt_rule_t r;
+  uint32_t bits;
+
+  r.ext = rnd() % 3 == 0;
+  r.fifo = rnd() & 1;
+  r.id = rnd() & full(r.ext);
+  switch (rnd() % 4) {
+  case 0:
+  case 1:
+    r.mask = full(r.ext);
+    break;
+  case 2:
+    // A range: low bits free
+    bits = rnd() % (r.ext ? 12 : 6) + 1;
+    r.mask = full(r.ext) & ~((1u << bits) - 1);
+    break;
+  default:
+    // A few scattered don't-care bits
+    r.mask = full(r.ext) & ~(rnd() & rnd() & rnd());
+    break;
+  }
+  // Stray bits outside the mask and ID width must not matter
+  r.id |= rnd() & ~r.mask;
+  r.mask |= rnd() & ~full(r.ext);
+  return r;
+}
+
+static uint32_t draw_rules(canfilt_rule_t *rules) {
+  uint32_t n = rnd() % MAX_RULES + 1, i = 0, run, k;
+
+  while (i < n) {
+    rules[i] = draw_rule();
+    // Sometimes a run of neighbouring exact IDs, as a device's message block
+    run = !(~rules[i].mask & full(rules[i].ext)) && rnd() % 3 == 0 ? rnd() % 8 + 1 : 1;
+    for (k = 1; k < run && i + k < n; k++) {
+      rules[i + k] = rules[i];
+      rules[i + k].id = (rules[i].id + k) & full(rules[i].ext);
+    }
+    i += k;
+  }
+  return n;
+}
+
+// FIFO and ID kind pairs the rules use: the least any packing can do with
+static uint32_t kinds(const canfilt_rule_t *r, uint32_t n) {
+  uint32_t seen = 0, i;
+
+  for (i = 0; i < n; i++) {
+    seen |= 1u << ((r[i].fifo & 1) * 2 + r[i].ext);
+  }
+  return __builtin_popcount(seen);
+}
+
+static void test_pack(void) {
+  canfilt_rule_t orig[MAX_RULES], rules[MAX_RULES];
+  canfilt_bank_t banks[CANFILT_BANKS];
+  want_t w = {orig, draw_rules(orig)};
+  uint32_t budget = rnd() % 3 ? CANFILT_BANKS : rnd() % 8 + 1, need, m = w.n, k;
+  bool exact;
+
+  memcpy(rules, orig, sizeof(orig));
+  need = canfilt_merge(rules, &m);
+  memcpy(rules, orig, sizeof(orig));
+  k = canfilt_pack(rules, w.n, banks, budget, &exact);
+  if (!k) {
+    if (budget >= kinds(orig, w.n)) {
+      FAIL("canfilt_pack of %u rules failed with %u banks for %u kinds", w.n, budget, kinds(orig, w.n));
+    }
+    return;
+  }
+  if (k > budget) {
+    FAIL("canfilt_pack wrote %u banks, budget %u", k, budget);
+  }
+  if (need <= budget && (!exact || k != need)) {
+    FAIL("%u rules need %u banks, packed into %u (%s) with budget %u", w.n, need, k,
+         exact ? "exact" : "widened", budget);
+  }
+  check_banks("canfilt_pack", &w, banks, k, exact);
+}
+
+static void test_share(void) {
+  canfilt_rule_t orig1[MAX_RULES], orig2[MAX_RULES], r1[MAX_RULES], r2[MAX_RULES];
+  canfilt_bank_t banks[CANFILT_BANKS];
+  want_t w1 = {orig1, draw_rules(orig1)}, w2 = {orig2, draw_rules(orig2)};
+  uint32_t k, split;
+  bool exact;
+
+  memcpy(r1, orig1, sizeof(orig1));
+  memcpy(r2, orig2, sizeof(orig2));
+  k = canfilt_share(r1, w1.n, r2, w2.n, banks, &split, &exact);
+  if (!k) {
+    FAIL("canfilt_share of %u + %u rules failed", w1.n, w2.n);
+  }
+  if (k > CANFILT_BANKS || split > k) {
+    FAIL("canfilt_share wrote %u banks split at %u", k, split);
+  }
+  check_banks("canfilt_share CAN1", &w1, banks, split, exact);
+  check_banks("canfilt_share CAN2", &w2, banks + split, k - split, exact);
+}
+
+int main(int argc, char **argv) {
+  uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+
+  for (round_no = 0; round_no < rounds; round_no++) {
+    test_pack();
+    test_share();
+  }
+  printf("%u rounds ok\n", rounds);
+  return 0;
+}
@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+"""Generate the slicing-by-4 tables of lib/crc32_table.c.
+
+    tools/crc32_table.py > lib/crc32_table.c
+"""
+
+
+def main():
+    t0 = []
+    for i in range(256):
+        c = i
+        for _ in range(8):
+            c = (c >> 1) ^ (0xEDB88320 if c & 1 else 0)
+        t0.append(c)
+    tables = [t0]
+    for _ in range(3):
+        prev = tables[-1]
+        tables.append([(prev[i] >> 8) ^ t0[prev[i] & 0xFF] for i in range(256)])
+
+    print('// Generated by tools/crc32_table.py, do not edit')
+    print('#include "crc32.h"')
+    print()
+    print('// crc32_table[k][b]: byte b followed by k zero bytes, reflected 0xEDB88320')
+    print('const uint32_t crc32_table[4][256] = {')
+    for t in tables:
+        print('  {')
+        for i in range(0, 256, 6):
+            print('    ' + ' '.join('0x%08X,' % v for v in t[i:i + 6]))
+        print('  },')
+    print('};')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,208 @@
+/*
+ * Host test for the CRC-32 code (lib/crc32.h) and the way ch32v307/crc.c
+ * drives the CRC unit with it.
+ *
+ *   crc_test [rounds]
+ *
+ * Two bit-at-a-time references written from the definitions: zlib's reflected
+ * CRC-32 and the unit, a register reset to 0xFFFFFFFF that shifts each 32-bit
+ * write in MSB first with no reflection. Each round draws a random buffer,
+ * start alignment and length, then checks:
+ *  - crc32_update() against the zlib reference, whole and continued across a
+ *    random split;
+ *  - crc32_word() against the unit, crc32_unshift() as its inverse and
+ *    crc32_rbit() against a plain bit reversal;
+ *  - crc_hw_update()'s steps replayed on the unit (software head, reset and
+ *    seed, bit-reversed words, reversed and inverted result, software tail)
+ *    against the zlib reference, from a random starting CRC;
+ *  - a run of words split into crc_hw_words() calls, each seeded from the
+ *    last result, against the unit fed them in one go (as a DMA job does).
+ * Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -o crc_test tools/crc_test.c lib/crc32.c lib/crc32_table.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crc32.h"
+
+#define MAX_LEN             4096
+#define CHUNK               37        // Words per crc_hw_words() call
+
+typedef struct {
+  uint32_t datar;
+} unit_t;
+
+static uint32_t seed = 1;
+static uint32_t round_no;
+
+
+#define FAIL(...) do {                                                  \
+    printf("round %u: ", round_no);                                     \
+    printf(__VA_ARGS__);                                                \
+    printf("\n");                                                       \
+    exit(1);                                                            \
+  } while (0)
+
+static uint32_t rnd(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8 ^ seed << 24;
+}
+
+static uint32_t ref_zlib(uint32_t crc, const uint8_t *p, uint32_t len) {
+  uint32_t i;
+
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (i = 0; i < 8; i++) {
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+static void unit_reset(unit_t *u) {
+  u->datar = 0xFFFFFFFF;
+}
+
+static void unit_write(unit_t *u, uint32_t word) {
+  uint32_t i, feedback;
+
+  for (i = 32; i--;) {
+    feedback = (u->datar >> 31) ^ (word >> i & 1);
+    u->datar = (u->datar << 1) ^ (feedback ? 0x04C11DB7 : 0);
+  }
+}
+
+static uint32_t rbit(uint32_t x) {
+  uint32_t r = 0, i;
+
+  for (i = 0; i < 32; i++) {
+    r |= (x >> i & 1) << (31 - i);
+  }
+  return r;
+}
+
+// crc.c's crc_seed(): reset, then the word that leads to state
+static void seed_unit(unit_t *u, uint32_t state) {
+  unit_reset(u);
+  if (state != 0xFFFFFFFF) {
+    unit_write(u, ~crc32_unshift(state));
+  }
+  if (u->datar != state) {
+    FAIL("seeding with %08x left %08x", state, u->datar);
+  }
+}
+
+// crc.c's crc_hw_update() on the model, taking the unit from the first whole
+// word where crc.c would wait for CRC_HW_MIN of them
+static uint32_t hw_update(uint32_t crc, const uint8_t *p, uint32_t len) {
+  uint32_t head = (4 - ((uintptr_t)p & 3)) & 3, n, w;
+  unit_t u;
+
+  if (len < head + 4) {
+    return crc32_update(crc, p, len);
+  }
+  crc = crc32_update(crc, p, head);
+  p += head;
+  len -= head;
+  seed_unit(&u, crc32_rbit(~crc));
+  for (n = len >> 2; n; n--) {
+    memcpy(&w, p, 4);
+    unit_write(&u, crc32_rbit(w));
+    p += 4;
+  }
+  crc = ~crc32_rbit(u.datar);
+  return crc32_update(crc, p, len & 3);
+}
+
+static void check_bytes(const uint8_t *p, uint32_t len) {
+  uint32_t start = rnd(), want = ref_zlib(start, p, len), cut = len ? rnd() % (len + 1) : 0, got;
+
+  got = crc32_update(start, p, len);
+  if (got != want) {
+    FAIL("crc32_update of %u bytes at +%u: %08x, want %08x", len, (uint32_t)((uintptr_t)p & 3), got, want);
+  }
+  got = crc32_update(crc32_update(start, p, cut), p + cut, len - cut);
+  if (got != want) {
+    FAIL("crc32_update split at %u of %u: %08x, want %08x", cut, len, got, want);
+  }
+  got = hw_update(start, p, len);
+  if (got != want) {
+    FAIL("unit path over %u bytes at +%u: %08x, want %08x", len, (uint32_t)((uintptr_t)p & 3), got, want);
+  }
+}
+
+static void check_words(const uint32_t *w, uint32_t n) {
+  uint32_t state = rnd(), i, k, chunk, got;
+  unit_t u;
+
+  for (i = 0; i < 8; i++) {
+    unit_reset(&u);
+    unit_write(&u, w[i]);
+    got = crc32_word(0xFFFFFFFF, w[i]);
+    if (got != u.datar) {
+      FAIL("crc32_word(ffffffff, %08x): %08x, unit %08x", w[i], got, u.datar);
+    }
+    if (crc32_word(crc32_unshift(w[i]), 0) != w[i]) {
+      FAIL("crc32_unshift(%08x) is no inverse", w[i]);
+    }
+    if (crc32_rbit(w[i]) != rbit(w[i])) {
+      FAIL("crc32_rbit(%08x): %08x", w[i], crc32_rbit(w[i]));
+    }
+  }
+
+  // Reference: the unit seeded once and fed everything
+  seed_unit(&u, state);
+  for (i = 0; i < n; i++) {
+    unit_write(&u, w[i]);
+  }
+
+  got = state;
+  for (i = 0; i < n; i++) {
+    got = crc32_word(got, w[i]);
+  }
+  if (got != u.datar) {
+    FAIL("crc32_word over %u words: %08x, unit %08x", n, got, u.datar);
+  }
+
+  // The same words as separate crc_hw_words() calls, each seeded from the
+  // last result
+  got = state;
+  for (i = 0; i < n; i += chunk) {
+    unit_t c;
+
+    chunk = n - i < CHUNK ? n - i : CHUNK;
+    seed_unit(&c, got);
+    for (k = 0; k < chunk; k++) {
+      unit_write(&c, w[i + k]);
+    }
+    got = c.datar;
+  }
+  if (got != u.datar) {
+    FAIL("resumed words over %u: %08x, unit %08x", n, got, u.datar);
+  }
+}
+
+int main(int argc, char **argv) {
+  static uint32_t buf[MAX_LEN / 4 + 1];
+  uint8_t *bytes = (uint8_t *)buf;
+  uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000, i, off, len;
+
+  // The check value every CRC-32 implementation publishes
+  if (crc32_update(0, "123456789", 9) != 0xCBF43926) {
+    printf("crc32_update(\"123456789\") = %08x, want cbf43926\n", crc32_update(0, "123456789", 9));
+    return 1;
+  }
+  for (round_no = 0; round_no < rounds; round_no++) {
+    for (i = 0; i < MAX_LEN / 4 + 1; i++) {
+      buf[i] = rnd();
+    }
+    off = rnd() & 3;
+    len = round_no < 64 ? round_no : rnd() % (MAX_LEN - 3);
+    check_bytes(bytes + off, len);
+    check_words(buf, len / 4 + 8 < MAX_LEN / 4 ? len / 4 + 8 : MAX_LEN / 4);
+  }
+  printf("%u rounds ok\n", rounds);
+  return 0;
+}
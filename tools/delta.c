@@ -0,0 +1,431 @@
+/*
+ * Binary delta patches for firmware updates (lib/delta.h).
+ *
+ *   delta diff  old new patch      make a patch
+ *   delta apply old patch out.bin  apply it through lib/delta.c
+ *   delta test  old new            both in memory, plus a patch on a damaged base
+ *
+ * old and new are raw images or ELF files; ELF files are flattened like
+ * objcopy -O binary (PT_LOAD segments at their load addresses, gaps zeroed).
+ * diff is bsdiff's algorithm, a suffix array of the old image and approximate
+ * matches extended both ways, writing the commands of lib/delta.h instead of
+ * bzip2 blocks. apply and test feed the patch in small chunks of random size
+ * to exercise the streaming decoder.
+ * Build: cc -O2 -Ilib -o delta tools/delta.c lib/delta.c lib/crc32.c lib/crc32_table.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crc32.h"
+#include "delta.h"
+
+#define MIN_COPY            8   // Zero diff bytes worth a COPY of their own
+
+typedef struct {
+  uint8_t *data;
+  uint32_t size, cap;
+} buf_t;
+
+
+static void put(buf_t *b, const void *p, uint32_t n) {
+  if (b->size + n > b->cap) {
+    b->cap = (b->size + n) * 2;
+    b->data = realloc(b->data, b->cap);
+  }
+  memcpy(b->data + b->size, p, n);
+  b->size += n;
+}
+
+static void put32(buf_t *b, uint32_t v) {
+  uint8_t p[4] = { v, v >> 8, v >> 16, v >> 24 };
+
+  put(b, p, 4);
+}
+
+static void put_cmd(buf_t *b, uint32_t kind, uint32_t n) {
+  uint32_t v = n << 2 | kind;
+  uint8_t c;
+
+  do {
+    c = v & 0x7F;
+    v >>= 7;
+    c |= v ? 0x80 : 0;
+    put(b, &c, 1);
+  } while (v);
+}
+
+static uint64_t rd(const uint8_t *p, int wide) {
+  uint64_t v = 0;
+  int i;
+
+  for (i = wide ? 7 : 3; i >= 0; i--) {
+    v = v << 8 | p[i];
+  }
+  return v;
+}
+
+// ELF32/64 little-endian: the PT_LOAD file contents laid out by physical address.
+// Every header and segment is checked against the file, which may be truncated.
+static int flatten_elf(buf_t *b) {
+  const uint8_t *e = b->data;
+  int wide = e[4] == 2;
+  uint64_t phoff, lo = ~0ull, hi = 0, pa, off, sz;
+  uint32_t phentsize, phnum, i, pass;
+  const uint8_t *ph;
+  uint8_t *img = NULL;
+
+  if (e[5] != 1 || (e[4] != 1 && !wide) || b->size < (wide ? 64u : 52u)) {
+    return 0;
+  }
+  phoff = rd(e + (wide ? 32 : 28), wide);
+  phentsize = e[wide ? 54 : 42] | e[wide ? 55 : 43] << 8;
+  phnum = e[wide ? 56 : 44] | e[wide ? 57 : 45] << 8;
+  if (phentsize < (wide ? 56u : 32u) || phoff > b->size ||
+      (uint64_t)phnum * phentsize > b->size - phoff) {
+    return 0;
+  }
+  for (pass = 0; pass < 2; pass++) {
+    for (i = 0; i < phnum; i++) {
+      ph = e + phoff + i * phentsize;
+      if (rd(ph, 0) != 1 || !(sz = rd(ph + (wide ? 32 : 16), wide))) {
+        continue;         // Not PT_LOAD, or nothing in the file
+      }
+      off = rd(ph + (wide ? 8 : 4), wide);
+      pa = rd(ph + (wide ? 24 : 12), wide);
+      if (off > b->size || sz > b->size - off || pa + sz < pa) {
+        return 0;
+      }
+      if (pass == 0) {
+        lo = pa < lo ? pa : lo;
+        hi = pa + sz > hi ? pa + sz : hi;
+      } else {
+        memcpy(img + (pa - lo), e + off, sz);
+      }
+    }
+    if (pass == 0) {
+      if (hi <= lo || hi - lo > 64 << 20) {
+        return 0;
+      }
+      img = calloc(1, hi - lo);
+      if (!img) {
+        return 0;
+      }
+    }
+  }
+  free(b->data);
+  b->data = img;
+  b->size = b->cap = hi - lo;
+  return 1;
+}
+
+static int load(const char *path, buf_t *b) {
+  FILE *f = fopen(path, "rb");
+  long n;
+
+  memset(b, 0, sizeof(*b));
+  if (!f || fseek(f, 0, SEEK_END) || (n = ftell(f)) <= 0 || fseek(f, 0, SEEK_SET)) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return 0;
+  }
+  b->data = malloc(n);
+  b->size = b->cap = n;
+  if (fread(b->data, 1, n, f) != (size_t)n) {
+    return 0;
+  }
+  fclose(f);
+  if (n > 52 && !memcmp(b->data, "\x7F" "ELF", 4) && !flatten_elf(b)) {
+    fprintf(stderr, "%s: unsupported or truncated ELF\n", path);
+    free(b->data);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Suffix array of s, with the empty suffix first (I[0] == n).
+ *
+ * @details Prefix doubling, each round two counting sorts: O(n log n).
+ */
+static int32_t *suffix_array(const uint8_t *s, int32_t n) {
+  int32_t N = n + 1, *sa = malloc(N * 4), *sa2 = malloc(N * 4);
+  int32_t *rank = malloc(N * 4), *tmp = malloc(N * 4);
+  int32_t *cnt = malloc((N > 257 ? N : 257) * 4);
+  int32_t i, k, p, m = 257;
+
+  for (i = 0; i < N; i++) {
+    rank[i] = i < n ? s[i] + 1 : 0;
+    sa2[i] = i;
+  }
+  for (k = 0;; k = k ? k << 1 : 1) {
+    // sa2 holds the suffixes ordered by the second key; sort stably by the first
+    if (k) {
+      for (p = 0, i = N - k; i < N; i++) {
+        sa2[p++] = i;
+      }
+      for (i = 0; i < N; i++) {
+        if (sa[i] >= k) {
+          sa2[p++] = sa[i] - k;
+        }
+      }
+    }
+    memset(cnt, 0, m * 4);
+    for (i = 0; i < N; i++) {
+      cnt[rank[i]]++;
+    }
+    for (i = 1; i < m; i++) {
+      cnt[i] += cnt[i - 1];
+    }
+    for (i = N - 1; i >= 0; i--) {
+      sa[--cnt[rank[sa2[i]]]] = sa2[i];
+    }
+    tmp[sa[0]] = 0;
+    for (p = 0, i = 1; i < N; i++) {
+      if (rank[sa[i]] != rank[sa[i - 1]] ||
+          (sa[i] + k < N ? rank[sa[i] + k] : -1) != (sa[i - 1] + k < N ? rank[sa[i - 1] + k] : -1)) {
+        p++;
+      }
+      tmp[sa[i]] = p;
+    }
+    memcpy(rank, tmp, N * 4);
+    m = p + 1;
+    if (m == N) {
+      break;
+    }
+  }
+  free(sa2);
+  free(rank);
+  free(tmp);
+  free(cnt);
+  return sa;
+}
+
+static int32_t match_len(const uint8_t *a, int32_t an, const uint8_t *b, int32_t bn) {
+  int32_t i;
+
+  for (i = 0; i < an && i < bn && a[i] == b[i]; i++);
+  return i;
+}
+
+// Longest match of new in old, by binary search over the suffix array
+static int32_t search(const int32_t *I, const uint8_t *old, int32_t oldsize,
+                      const uint8_t *new, int32_t newsize, int32_t st, int32_t en, int32_t *pos) {
+  int32_t x, y;
+
+  while (en - st >= 2) {
+    x = st + (en - st) / 2;
+    if (memcmp(old + I[x], new, oldsize - I[x] < newsize ? oldsize - I[x] : newsize) < 0) {
+      st = x;
+    } else {
+      en = x;
+    }
+  }
+  x = match_len(old + I[st], oldsize - I[st], new, newsize);
+  y = match_len(old + I[en], oldsize - I[en], new, newsize);
+  *pos = x > y ? I[st] : I[en];
+  return x > y ? x : y;
+}
+
+// new[ns..ns+n) against old[os..): zero runs become COPY, the rest ADD
+static void put_diff(buf_t *b, const uint8_t *old, int32_t os, const uint8_t *new, int32_t ns, int32_t n) {
+  int32_t i = 0, add = 0, z;
+  uint8_t d;
+
+  while (i < n) {
+    for (z = 0; i + z < n && new[ns + i + z] == old[os + i + z]; z++);
+    if (z >= MIN_COPY || (z && i + z == n && add == i)) {
+      if (add < i) {
+        put_cmd(b, DELTA_ADD, i - add);
+        for (; add < i; add++) {
+          d = new[ns + add] - old[os + add];
+          put(b, &d, 1);
+        }
+      }
+      put_cmd(b, DELTA_COPY, z);
+      i += z;
+      add = i;
+    } else {
+      i += z ? z : 1;
+    }
+  }
+  if (add < n) {
+    put_cmd(b, DELTA_ADD, n - add);
+    for (; add < n; add++) {
+      d = new[ns + add] - old[os + add];
+      put(b, &d, 1);
+    }
+  }
+}
+
+static void diff(const buf_t *o, const buf_t *nw, buf_t *patch) {
+  const uint8_t *old = o->data, *new = nw->data;
+  int32_t oldsize = o->size, newsize = nw->size;
+  int32_t *I = suffix_array(old, oldsize);
+  int32_t scan = 0, len = 0, pos = 0, lastscan = 0, lastpos = 0, lastoffset = 0;
+  int32_t oldscore, scsc, s, Sf, lenf, Sb, lenb, overlap, Ss, lens, i, seek;
+
+  put32(patch, DELTA_MAGIC);
+  put32(patch, oldsize);
+  put32(patch, crc32_update(0, old, oldsize));
+  put32(patch, newsize);
+  put32(patch, crc32_update(0, new, newsize));
+
+  while (scan < newsize) {
+    oldscore = 0;
+    for (scsc = scan += len; scan < newsize; scan++) {
+      len = search(I, old, oldsize, new + scan, newsize - scan, 0, oldsize, &pos);
+      for (; scsc < scan + len; scsc++) {
+        if (scsc + lastoffset < oldsize && old[scsc + lastoffset] == new[scsc]) {
+          oldscore++;
+        }
+      }
+      if ((len == oldscore && len != 0) || len > oldscore + 8) {
+        break;
+      }
+      if (scan + lastoffset < oldsize && old[scan + lastoffset] == new[scan]) {
+        oldscore--;
+      }
+    }
+    if (len == oldscore && scan != newsize) {
+      continue;
+    }
+
+    // Extend the last match forward and this one backward, then split the overlap
+    for (s = Sf = lenf = i = 0; lastscan + i < scan && lastpos + i < oldsize;) {
+      if (old[lastpos + i] == new[lastscan + i]) {
+        s++;
+      }
+      i++;
+      if (s * 2 - i > Sf * 2 - lenf) {
+        Sf = s;
+        lenf = i;
+      }
+    }
+    lenb = 0;
+    if (scan < newsize) {
+      for (s = Sb = 0, i = 1; scan >= lastscan + i && pos >= i; i++) {
+        if (old[pos - i] == new[scan - i]) {
+          s++;
+        }
+        if (s * 2 - i > Sb * 2 - lenb) {
+          Sb = s;
+          lenb = i;
+        }
+      }
+    }
+    if (lastscan + lenf > scan - lenb) {
+      overlap = lastscan + lenf - (scan - lenb);
+      for (s = Ss = lens = i = 0; i < overlap; i++) {
+        if (new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]) {
+          s++;
+        }
+        if (new[scan - lenb + i] == old[pos - lenb + i]) {
+          s--;
+        }
+        if (s > Ss) {
+          Ss = s;
+          lens = i + 1;
+        }
+      }
+      lenf += lens - overlap;
+      lenb -= lens;
+    }
+
+    put_diff(patch, old, lastpos, new, lastscan, lenf);
+    if (scan - lenb > lastscan + lenf) {
+      put_cmd(patch, DELTA_INSERT, scan - lenb - (lastscan + lenf));
+      put(patch, new + lastscan + lenf, scan - lenb - (lastscan + lenf));
+    }
+    seek = (pos - lenb) - (lastpos + lenf);
+    if (seek && scan < newsize) {
+      put_cmd(patch, DELTA_SEEK, seek < 0 ? ((uint32_t)(-seek - 1) << 1) | 1 : (uint32_t)seek << 1);
+    }
+    lastscan = scan - lenb;
+    lastpos = pos - lenb;
+    lastoffset = pos - scan;
+  }
+  free(I);
+}
+
+static uint32_t crc_sw(uint32_t crc, const void *buf, uint32_t len) {
+  return crc32_update(crc, buf, len);
+}
+
+static bool out_write(void *ctx, uint32_t off, const void *page, uint32_t len) {
+  buf_t *b = ctx;
+
+  if (off != b->size) {
+    return false;
+  }
+  put(b, page, len);
+  return true;
+}
+
+// Through lib/delta.c, in chunks of 1..64 bytes
+static int apply(const buf_t *old, const buf_t *patch, buf_t *out) {
+  static delta_t d;
+  uint32_t off, n;
+
+  memset(out, 0, sizeof(*out));
+  delta_init(&d, old->data, old->size, out_write, crc_sw, out);
+  for (off = 0; off < patch->size; off += n) {
+    n = 1 + rand() % 64;
+    n = n < patch->size - off ? n : patch->size - off;
+    if (!delta_feed(&d, patch->data + off, n)) {
+      return 0;
+    }
+  }
+  return delta_done(&d);
+}
+
+static int save(const char *path, const buf_t *b) {
+  FILE *f = fopen(path, "wb");
+  int ok = f && fwrite(b->data, 1, b->size, f) == b->size;
+
+  if (f) {
+    fclose(f);
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  buf_t old, new, patch = {0}, out;
+
+  if (argc == 5 && !strcmp(argv[1], "diff")) {
+    if (!load(argv[2], &old) || !load(argv[3], &new)) {
+      return 1;
+    }
+    diff(&old, &new, &patch);
+    printf("%u -> %u bytes, patch %u\n", old.size, new.size, patch.size);
+    return !save(argv[4], &patch);
+  }
+  if (argc == 5 && !strcmp(argv[1], "apply")) {
+    if (!load(argv[2], &old) || !load(argv[3], &patch)) {
+      return 1;
+    }
+    if (!apply(&old, &patch, &out)) {
+      fprintf(stderr, "patch rejected\n");
+      return 1;
+    }
+    return !save(argv[4], &out);
+  }
+  if (argc == 4 && !strcmp(argv[1], "test")) {
+    if (!load(argv[2], &old) || !load(argv[3], &new)) {
+      return 1;
+    }
+    diff(&old, &new, &patch);
+    if (!apply(&old, &patch, &out) || out.size != new.size || memcmp(out.data, new.data, new.size)) {
+      printf("FAIL: patch does not reproduce the new image\n");
+      return 1;
+    }
+    old.data[old.size / 2] ^= 1;
+    if (apply(&old, &patch, &out)) {
+      printf("FAIL: patch accepted on a damaged base\n");
+      return 1;
+    }
+    printf("%u -> %u bytes, patch %u (%.1f%%)\n", old.size, new.size, patch.size,
+      100.0 * patch.size / new.size);
+    return 0;
+  }
+  fprintf(stderr, "usage: delta diff old new patch | apply old patch out | test old new\n");
+  return 2;
+}
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+"""Generate the quarter-wave sine tables of lib/dsp_tables.c.
+
+    tools/dsp_tables.py 2048 > lib/dsp_tables.c
+
+The argument must match DSP_FFT_MAX in lib/dsp.h.
+"""
+import math
+import sys
+
+
+def rows(values, per_line):
+    for i in range(0, len(values), per_line):
+        yield '  ' + ' '.join(v + ',' for v in values[i:i + per_line])
+
+
+def main():
+    n = int(sys.argv[1]) if len(sys.argv) > 1 else 2048
+    if n < 8 or n & (n - 1):
+        raise SystemExit('size must be a power of two >= 8')
+    sines = [math.sin(2 * math.pi * i / n) for i in range(n // 4 + 1)]
+
+    print('// Generated by tools/dsp_tables.py %d, do not edit' % n)
+    print('#include "dsp.h"')
+    print()
+    print('#if DSP_FFT_MAX != %d' % n)
+    print('#error "regenerate dsp_tables.c for DSP_FFT_MAX"')
+    print('#endif')
+    print()
+    print('const q15_t dsp_sin_q15[DSP_FFT_MAX / 4 + 1] = {')
+    print('\n'.join(rows(['%d' % min(32767, round(v * 32768)) for v in sines], 12)))
+    print('};')
+    print()
+    print('const q31_t dsp_sin_q31[DSP_FFT_MAX / 4 + 1] = {')
+    print('\n'.join(rows(['%d' % min(2147483647, round(v * 2147483648)) for v in sines], 6)))
+    print('};')
+    print()
+    print('const float dsp_sin_f32[DSP_FFT_MAX / 4 + 1] = {')
+    print('\n'.join(rows(['%.9ef' % v for v in sines], 5)))
+    print('};')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,446 @@
+/*
+ * Host test for the filter and spectrum kernels (lib/dsp.h) against a
+ * double-precision reference.
+ *
+ *   dsp_test [seed]
+ *
+ * Every kernel runs on pseudo-random signals and coefficient sets, fed in
+ * blocks of uneven size so the state carried between calls is exercised too.
+ * The reference is computed in double from the same quantised coefficients and
+ * inputs: a direct-form FIR (also sampled for the decimators), a direct-form I
+ * biquad cascade and a plain O(N^2) DFT, scaled by 1/N for the fixed-point
+ * FFTs. The fixed-point FIRs must round the exact result (within half an LSB,
+ * i.e. bit-exact). A biquad's only error is the rounding of each stage's output,
+ * which recirculates through that stage's poles and the stages after it, so its
+ * budget is half an LSB times the L1 norm of that path's impulse response; the
+ * FFTs get an LSB per pass and float is held to a fraction of full scale.
+ * Reports the worst error of every kernel. Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -o dsp_test tools/dsp_test.c lib/dsp.c lib/dsp_tables.c -lm
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "dsp.h"
+
+#define LEN                 DSP_FFT_MAX
+#define MAX_TAPS            64
+#define STAGES              2
+#define SHIFT               1         // Biquad coefficients in Q14 / Q30
+#define FACTOR              3
+
+#define Q15                 32768.0
+#define Q31                 2147483648.0
+
+// Error budgets in LSBs of the output format, float ones of full scale
+#define FIR_TOL             0.5
+#define FFT_TOL(log2n)      (1.0 + (log2n))
+#define F32_TOL             1e-5
+#define F32_ULP             (1.0 / (1 << 24))
+
+typedef struct {
+  const char *name;
+  double max;              // Worst error
+  double tol;              // Largest budget it was held to
+} stat_t;
+
+static stat_t stats[] = {
+  {"fir_q15", 0, 0}, {"fir_q31", 0, 0}, {"fir_f32", 0, 0},
+  {"decim_q15", 0, 0}, {"decim_q31", 0, 0}, {"decim_f32", 0, 0},
+  {"biquad_q15", 0, 0}, {"biquad_q31", 0, 0}, {"biquad_f32", 0, 0},
+  {"rfft_q15", 0, 0}, {"rfft_q31", 0, 0}, {"rfft_f32", 0, 0},
+};
+
+enum {
+  FIR_Q15, FIR_Q31, FIR_F32, DECIM_Q15, DECIM_Q31, DECIM_F32,
+  BIQUAD_Q15, BIQUAD_Q31, BIQUAD_F32, RFFT_Q15, RFFT_Q31, RFFT_F32,
+};
+
+static uint32_t seed = 1;
+static const uint32_t blocks[] = {1, 7, 64, 3, 200, 16, 2};
+
+static double xd[LEN], yd[LEN];
+static q15_t x15[LEN], y15[LEN];
+static q31_t x31[LEN], y31[LEN];
+static float xf[LEN], yf[LEN];
+
+
+static double uniform(double amp) {
+  seed = seed * 1103515245 + 12345;
+  return ((double)(seed >> 8) / (1 << 23) * 2 - 1) * amp;
+}
+
+static q15_t to_q15(double v) {
+  v = floor(v * Q15 + 0.5);
+  return v > 32767 ? 32767 : v < -32768 ? -32768 : (q15_t)v;
+}
+
+static q31_t to_q31(double v) {
+  v = floor(v * Q31 + 0.5);
+  return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (q31_t)v;
+}
+
+// err in LSBs (or of full scale for float); fails past the budget
+static void check(int kernel, const char *what, uint32_t i, double err, double tol) {
+  stat_t *s = &stats[kernel];
+
+  err = fabs(err);
+  if (err > s->max) {
+    s->max = err;
+  }
+  if (tol > s->tol) {
+    s->tol = tol;
+  }
+  if (err > tol) {
+    printf("%s%s%s: sample %u off by %g (budget %g)\n", s->name, *what ? " " : "", what, i, err, tol);
+    exit(1);
+  }
+}
+
+// Random signal in xd at amp, with the fixed-point copies; xd then holds
+// exactly what the Q15 / Q31 / float inputs represent
+static void signal(double amp, uint32_t n, int fmt) {
+  uint32_t i;
+
+  for (i = 0; i < n; i++) {
+    xd[i] = uniform(amp);
+    x15[i] = to_q15(xd[i]);
+    x31[i] = to_q31(xd[i]);
+    xf[i] = (float)xd[i];
+    xd[i] = fmt == 15 ? x15[i] / Q15 : fmt == 31 ? x31[i] / Q31 : xf[i];
+  }
+}
+
+/*
+ * Reference kernels
+ */
+
+static void ref_fir(const double *h, uint32_t ntaps, const double *x, double *y, uint32_t n) {
+  uint32_t i, k;
+
+  for (i = 0; i < n; i++) {
+    y[i] = 0;
+    for (k = 0; k < ntaps && k <= i; k++) {
+      y[i] += h[k] * x[i - k];
+    }
+  }
+}
+
+static void ref_biquad(const double *c, uint32_t stages, const double *x, double *y, uint32_t n) {
+  double x1, x2, y1, y2, v;
+  uint32_t s, i;
+
+  for (i = 0; i < n; i++) {
+    y[i] = x[i];
+  }
+  for (s = 0; s < stages; s++, c += 5) {
+    x1 = x2 = y1 = y2 = 0;
+    for (i = 0; i < n; i++) {
+      v = c[0] * y[i] + c[1] * x1 + c[2] * x2 - c[3] * y1 - c[4] * y2;
+      x2 = x1;
+      x1 = y[i];
+      y2 = y1;
+      y1 = v;
+      y[i] = v;
+    }
+  }
+}
+
+// Packed like dsp_rfft_*: {X[0], X[N/2], Re X[1], Im X[1], ...}
+static void ref_dft(const double *x, double *X, uint32_t n) {
+  double re, im;
+  uint32_t k, i;
+
+  for (k = 0; k <= n / 2; k++) {
+    re = im = 0;
+    for (i = 0; i < n; i++) {
+      re += x[i] * cos(2 * M_PI * (double)((uint64_t)k * i % n) / n);
+      im -= x[i] * sin(2 * M_PI * (double)((uint64_t)k * i % n) / n);
+    }
+    if (k == 0) {
+      X[0] = re;
+    } else if (k == n / 2) {
+      X[1] = re;
+    } else {
+      X[2 * k] = re;
+      X[2 * k + 1] = im;
+    }
+  }
+}
+
+// Sum over the stages of the L1 norm of 1 / A_s(z) followed by stages s + 1..
+static double noise_gain(const double *c, uint32_t stages) {
+  double y1, y2, sum = 0;
+  uint32_t s, i;
+
+  for (s = 0; s < stages; s++) {
+    y1 = y2 = 0;
+    for (i = 0; i < LEN; i++) {
+      xd[i] = (i == 0) - c[5 * s + 3] * y1 - c[5 * s + 4] * y2;
+      y2 = y1;
+      y1 = xd[i];
+    }
+    ref_biquad(c + 5 * (s + 1), stages - s - 1, xd, yd, LEN);
+    for (i = 0; i < LEN; i++) {
+      sum += fabs(yd[i]);
+    }
+  }
+  return sum;
+}
+
+/*
+ * FIR and decimators
+ */
+
+static void test_fir(uint32_t ntaps) {
+  static q15_t h15[MAX_TAPS], s15[2 * MAX_TAPS];
+  static q31_t h31[MAX_TAPS], s31[2 * MAX_TAPS];
+  static float hf[MAX_TAPS], sf[2 * MAX_TAPS];
+  double h[MAX_TAPS], sum = 0;
+  dsp_fir_q15_t f15;
+  dsp_fir_q31_t f31;
+  dsp_fir_f32_t ff;
+  uint32_t i, k, b, n;
+
+  // sum |h| = 0.95 keeps the Q15 accumulator in range
+  for (k = 0; k < ntaps; k++) {
+    h[k] = uniform(1);
+    sum += fabs(h[k]);
+  }
+  for (k = 0; k < ntaps; k++) {
+    h[k] *= 0.95 / sum;
+  }
+
+  for (k = 0; k < ntaps; k++) {
+    h15[k] = to_q15(h[k]);
+    h[k] = h15[k] / Q15;
+  }
+  signal(1, LEN, 15);
+  ref_fir(h, ntaps, xd, yd, LEN);
+  dsp_fir_q15_init(&f15, h15, ntaps, s15);
+  for (i = 0, b = 0; i < LEN; i += n, b++) {
+    n = blocks[b % 7] < LEN - i ? blocks[b % 7] : LEN - i;
+    dsp_fir_q15(&f15, x15 + i, y15 + i, n);
+  }
+  for (i = 0; i < LEN; i++) {
+    check(FIR_Q15, "", i, y15[i] - yd[i] * Q15, FIR_TOL);
+  }
+  dsp_fir_q15_init(&f15, h15, ntaps, s15);
+  dsp_decim_q15(&f15, FACTOR, x15, y15, LEN / FACTOR * FACTOR);
+  for (i = 0; i < LEN / FACTOR; i++) {
+    check(DECIM_Q15, "", i, y15[i] - yd[i * FACTOR + FACTOR - 1] * Q15, FIR_TOL);
+  }
+
+  for (k = 0; k < ntaps; k++) {
+    h31[k] = to_q31(h[k]);
+    h[k] = h31[k] / Q31;
+  }
+  signal(1, LEN, 31);
+  ref_fir(h, ntaps, xd, yd, LEN);
+  dsp_fir_q31_init(&f31, h31, ntaps, s31);
+  for (i = 0, b = 0; i < LEN; i += n, b++) {
+    n = blocks[b % 7] < LEN - i ? blocks[b % 7] : LEN - i;
+    dsp_fir_q31(&f31, x31 + i, y31 + i, n);
+  }
+  for (i = 0; i < LEN; i++) {
+    check(FIR_Q31, "", i, y31[i] - yd[i] * Q31, FIR_TOL + 1e-3);
+  }
+  dsp_fir_q31_init(&f31, h31, ntaps, s31);
+  dsp_decim_q31(&f31, FACTOR, x31, y31, LEN / FACTOR * FACTOR);
+  for (i = 0; i < LEN / FACTOR; i++) {
+    check(DECIM_Q31, "", i, y31[i] - yd[i * FACTOR + FACTOR - 1] * Q31, FIR_TOL + 1e-3);
+  }
+
+  for (k = 0; k < ntaps; k++) {
+    hf[k] = (float)h[k];
+    h[k] = hf[k];
+  }
+  signal(1, LEN, 0);
+  ref_fir(h, ntaps, xd, yd, LEN);
+  dsp_fir_f32_init(&ff, hf, ntaps, sf);
+  for (i = 0, b = 0; i < LEN; i += n, b++) {
+    n = blocks[b % 7] < LEN - i ? blocks[b % 7] : LEN - i;
+    dsp_fir_f32(&ff, xf + i, yf + i, n);
+  }
+  for (i = 0; i < LEN; i++) {
+    check(FIR_F32, "", i, yf[i] - yd[i], F32_TOL);
+  }
+  dsp_fir_f32_init(&ff, hf, ntaps, sf);
+  dsp_decim_f32(&ff, FACTOR, xf, yf, LEN / FACTOR * FACTOR);
+  for (i = 0; i < LEN / FACTOR; i++) {
+    check(DECIM_F32, "", i, yf[i] - yd[i * FACTOR + FACTOR - 1], F32_TOL);
+  }
+}
+
+/*
+ * Biquads: an RBJ low-pass and high-pass in cascade, driven at a quarter of
+ * full scale so the output never saturates
+ */
+
+static void rbj(double *c, double fc, double q, bool high) {
+  double w = 2 * M_PI * fc, alpha = sin(w) / (2 * q), cw = cos(w), a0 = 1 + alpha;
+
+  c[0] = (high ? (1 + cw) : (1 - cw)) / 2 / a0;
+  c[1] = (high ? -(1 + cw) : (1 - cw)) / a0;
+  c[2] = c[0];
+  c[3] = -2 * cw / a0;
+  c[4] = (1 - alpha) / a0;
+}
+
+static void test_biquad(double fc_low, double fc_high) {
+  static q15_t c15[5 * STAGES], s15[4 * STAGES];
+  static q31_t c31[5 * STAGES], s31[4 * STAGES];
+  static float cf[5 * STAGES], sf[2 * STAGES];
+  double c[5 * STAGES], cq[5 * STAGES];
+  dsp_biquad_q15_t b15;
+  dsp_biquad_q31_t b31;
+  dsp_biquad_f32_t bf;
+  double tol;
+  uint32_t i, k, b, n;
+
+  rbj(c, fc_low, 0.707, false);
+  rbj(c + 5, fc_high, 0.707, true);
+
+  for (k = 0; k < 5 * STAGES; k++) {
+    c15[k] = to_q15(c[k] / (1 << SHIFT));
+    cq[k] = c15[k] / Q15 * (1 << SHIFT);
+  }
+  tol = 0.5 * noise_gain(cq, STAGES) + 1e-3;
+  signal(0.25, LEN, 15);
+  ref_biquad(cq, STAGES, xd, yd, LEN);
+  dsp_biquad_q15_init(&b15, c15, STAGES, SHIFT, s15);
+  for (i = 0, b = 0; i < LEN; i += n, b++) {
+    n = blocks[b % 7] < LEN - i ? blocks[b % 7] : LEN - i;
+    dsp_biquad_q15(&b15, x15 + i, y15 + i, n);
+  }
+  for (i = 0; i < LEN; i++) {
+    check(BIQUAD_Q15, "", i, y15[i] - yd[i] * Q15, tol);
+  }
+
+  for (k = 0; k < 5 * STAGES; k++) {
+    c31[k] = to_q31(c[k] / (1 << SHIFT));
+    cq[k] = c31[k] / Q31 * (1 << SHIFT);
+  }
+  tol = 0.5 * noise_gain(cq, STAGES) + 1e-3;
+  signal(0.25, LEN, 31);
+  ref_biquad(cq, STAGES, xd, yd, LEN);
+  dsp_biquad_q31_init(&b31, c31, STAGES, SHIFT, s31);
+  for (i = 0, b = 0; i < LEN; i += n, b++) {
+    n = blocks[b % 7] < LEN - i ? blocks[b % 7] : LEN - i;
+    dsp_biquad_q31(&b31, x31 + i, y31 + i, n);
+  }
+  for (i = 0; i < LEN; i++) {
+    check(BIQUAD_Q31, "", i, y31[i] - yd[i] * Q31, tol);
+  }
+
+  for (k = 0; k < 5 * STAGES; k++) {
+    cf[k] = (float)c[k];
+    cq[k] = cf[k];
+  }
+  // A few roundings per sample and stage, each an ULP of a value below 1
+  tol = 4 * F32_ULP * noise_gain(cq, STAGES);
+  signal(0.25, LEN, 0);
+  ref_biquad(cq, STAGES, xd, yd, LEN);
+  dsp_biquad_f32_init(&bf, cf, STAGES, sf);
+  for (i = 0, b = 0; i < LEN; i += n, b++) {
+    n = blocks[b % 7] < LEN - i ? blocks[b % 7] : LEN - i;
+    dsp_biquad_f32(&bf, xf + i, yf + i, n);
+  }
+  for (i = 0; i < LEN; i++) {
+    check(BIQUAD_F32, "", i, yf[i] - yd[i], tol);
+  }
+}
+
+/*
+ * Real FFTs: random input at the documented +-0.7 limit and a full-scale tone
+ */
+
+static void test_rfft(uint32_t n, bool tone) {
+  static q15_t z15[DSP_FFT_MAX];
+  static q31_t z31[DSP_FFT_MAX];
+  static float zf[DSP_FFT_MAX];
+  static double in[DSP_FFT_MAX], X[DSP_FFT_MAX];
+  const char *what = tone ? "tone" : "noise";
+  uint32_t log2n = 0, i;
+
+  while ((1u << log2n) < n) {
+    log2n++;
+  }
+  for (i = 0; i < n; i++) {
+    in[i] = tone ? 0.7 * cos(2 * M_PI * 3 * i / n + 0.3) : uniform(0.7);
+  }
+
+  for (i = 0; i < n; i++) {
+    z15[i] = to_q15(in[i]);
+    xd[i] = z15[i] / Q15;
+  }
+  ref_dft(xd, X, n);
+  if (!dsp_rfft_q15(z15, n)) {
+    printf("rfft_q15: refused %u points\n", n);
+    exit(1);
+  }
+  for (i = 0; i < n; i++) {
+    check(RFFT_Q15, what, i, z15[i] - X[i] / n * Q15, FFT_TOL(log2n));
+  }
+
+  for (i = 0; i < n; i++) {
+    z31[i] = to_q31(in[i]);
+    xd[i] = z31[i] / Q31;
+  }
+  ref_dft(xd, X, n);
+  if (!dsp_rfft_q31(z31, n)) {
+    printf("rfft_q31: refused %u points\n", n);
+    exit(1);
+  }
+  for (i = 0; i < n; i++) {
+    check(RFFT_Q31, what, i, z31[i] - X[i] / n * Q31, FFT_TOL(log2n));
+  }
+
+  for (i = 0; i < n; i++) {
+    zf[i] = (float)in[i];
+    xd[i] = zf[i];
+  }
+  ref_dft(xd, X, n);
+  if (!dsp_rfft_f32(zf, n)) {
+    printf("rfft_f32: refused %u points\n", n);
+    exit(1);
+  }
+  for (i = 0; i < n; i++) {
+    check(RFFT_F32, what, i, (zf[i] - X[i]) / n, F32_TOL);
+  }
+}
+
+int main(int argc, char **argv) {
+  static const uint32_t taps[] = {1, 3, 4, 5, 17, 32, 63};
+  static const uint32_t bad[] = {0, 4, 12, 100, 2 * DSP_FFT_MAX};
+  q15_t z15[8] = {0};
+  q31_t z31[8] = {0};
+  float zf[8] = {0};
+  uint32_t i, n;
+
+  if (argc > 1) {
+    seed = strtoul(argv[1], NULL, 0);
+  }
+  for (i = 0; i < sizeof(taps) / sizeof(taps[0]); i++) {
+    test_fir(taps[i]);
+  }
+  test_biquad(0.02, 0.002);
+  test_biquad(0.1, 0.01);
+  test_biquad(0.3, 0.05);
+  for (n = 8; n <= DSP_FFT_MAX; n *= 2) {
+    test_rfft(n, false);
+    test_rfft(n, true);
+  }
+  for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    if (dsp_rfft_q15(z15, bad[i]) || dsp_rfft_q31(z31, bad[i]) || dsp_rfft_f32(zf, bad[i])) {
+      printf("rfft: accepted %u points\n", bad[i]);
+      return 1;
+    }
+  }
+
+  printf("kernel         worst   budget\n");
+  for (i = 0; i < sizeof(stats) / sizeof(stats[0]); i++) {
+    printf("%-11s %9.3g %8.3g %s\n", stats[i].name, stats[i].max, stats[i].tol,
+           i % 3 == 2 ? "of full scale" : "LSB");
+  }
+  return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * Host test for the FAT32 log writer (lib/fatlog.h) on a disk image
+ * (tools/blockdev_file.h).
+ *
+ *   fatlog_test [image]
+ *
+ * Formats a 34 MB FAT32 image (one sector per cluster, two FATs, FSInfo), once
+ * as a superfloppy and once behind an MBR partition, with a file already in the
+ * root directory, a deleted entry before it and a used cluster further on.
+ * Then, through fatlog: mount, create a log that must reuse the deleted slot
+ * and skip the used clusters, refuse the same name again, write a pattern in
+ * chunks of random size and alignment (whole aligned sectors included), sync,
+ * write more without syncing, and refuse to write past the preallocation.
+ *
+ * The image is then reopened and read with a separate minimal FAT32 reader: the
+ * directory entry must carry the size of the last sync, the chain must be
+ * contiguous, end-of-chain terminated, identical in both FATs and clear of the
+ * other file, FSInfo's free count must be invalidated and the file contents
+ * must be the pattern up to the synced size. fatlog_write() must not read the
+ * device at all. The image (default fatlog_test.img) is left behind for
+ * fsck.fat -n. Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -Itools -o fatlog_test tools/fatlog_test.c tools/blockdev_file.c lib/fatlog.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "blockdev_file.h"
+#include "fatlog.h"
+
+#define CLUSTERS            66000     // Over FAT32's 65525 minimum
+#define RESERVED            32
+#define FAT_SECTORS         ((CLUSTERS + 2) * 4 / BLOCK_SIZE + 1)
+#define DATA_LBA            (RESERVED + 2 * FAT_SECTORS)
+#define TOTAL               (DATA_LBA + CLUSTERS)
+#define PART_LBA            2048
+
+#define OTHER_FIRST         3         // The existing file: clusters 3-5
+#define OTHER_LEN           3
+#define USED                10        // A lone used cluster
+#define LOG_BYTES           (100 * 1024 + 100)
+
+static const char log_name[11] = "LOG00001BIN";
+static const char other_name[11] = "EXISTS  TXT";
+
+static uint8_t sector[BLOCK_SIZE];
+static uint32_t data_buf[(LOG_BYTES + 8) / 4];
+
+
+#define FAIL(...) do {                                                  \
+    printf(__VA_ARGS__);                                                \
+    printf("\n");                                                       \
+    exit(1);                                                            \
+  } while (0)
+
+static uint8_t pattern(uint32_t i) {
+  return (uint8_t)(i * 2654435761u >> 24);
+}
+
+static void put16(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  put16(p, v);
+  put16(p + 2, v >> 16);
+}
+
+static uint32_t le16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t le32(const uint8_t *p) {
+  return le16(p) | le16(p + 2) << 16;
+}
+
+static void put_sector(FILE *f, uint32_t lba) {
+  if (fseek(f, (long)lba * BLOCK_SIZE, SEEK_SET) || fwrite(sector, BLOCK_SIZE, 1, f) != 1) {
+    FAIL("image: write of sector %u failed", lba);
+  }
+}
+
+static void get_sector(FILE *f, uint32_t lba) {
+  if (fseek(f, (long)lba * BLOCK_SIZE, SEEK_SET) || fread(sector, BLOCK_SIZE, 1, f) != 1) {
+    FAIL("image: read of sector %u failed", lba);
+  }
+}
+
+static void fat_entry(FILE *f, uint32_t part, uint32_t c, uint32_t v) {
+  uint32_t k, lba = c / (BLOCK_SIZE / 4);
+
+  for (k = 0; k < 2; k++) {
+    get_sector(f, part + RESERVED + k * FAT_SECTORS + lba);
+    put32(sector + 4 * (c % (BLOCK_SIZE / 4)), v);
+    put_sector(f, part + RESERVED + k * FAT_SECTORS + lba);
+  }
+}
+
+static void format(const char *path, uint32_t part) {
+  FILE *f = fopen(path, "w+b");
+  uint32_t c;
+
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  memset(sector, 0, BLOCK_SIZE);
+  put_sector(f, part + TOTAL - 1);      // Sizes the (sparse) image
+  if (part) {
+    sector[0x1BE + 4] = 0x0C;           // FAT32 LBA
+    put32(sector + 0x1BE + 8, part);
+    put32(sector + 0x1BE + 12, TOTAL);
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+    put_sector(f, 0);
+  }
+
+  memset(sector, 0, BLOCK_SIZE);
+  memcpy(sector, "\xEB\x58\x90MSWIN4.1", 11);
+  put16(sector + 11, BLOCK_SIZE);
+  sector[13] = 1;                       // Sectors per cluster
+  put16(sector + 14, RESERVED);
+  sector[16] = 2;                       // FATs
+  sector[21] = 0xF8;
+  put32(sector + 28, part);
+  put32(sector + 32, TOTAL);
+  put32(sector + 36, FAT_SECTORS);
+  put32(sector + 44, 2);                // Root directory cluster
+  put16(sector + 48, 1);                // FSInfo sector
+  put16(sector + 50, 6);                // Backup boot sector
+  sector[66] = 0x29;
+  memcpy(sector + 71, "NO NAME    FAT32   ", 19);
+  sector[510] = 0x55;
+  sector[511] = 0xAA;
+  put_sector(f, part);
+  put_sector(f, part + 6);
+
+  memset(sector, 0, BLOCK_SIZE);
+  put32(sector, 0x41615252);
+  put32(sector + 484, 0x61417272);
+  put32(sector + 488, CLUSTERS - 1 - OTHER_LEN - 1);
+  put32(sector + 492, USED + 1);
+  put32(sector + 508, 0xAA550000);
+  put_sector(f, part + 1);
+
+  fat_entry(f, part, 0, 0x0FFFFFF8);
+  fat_entry(f, part, 1, 0x0FFFFFFF);
+  fat_entry(f, part, 2, 0x0FFFFFFF);    // Root directory, one cluster
+  for (c = OTHER_FIRST; c < OTHER_FIRST + OTHER_LEN; c++) {
+    fat_entry(f, part, c, c + 1 < OTHER_FIRST + OTHER_LEN ? c + 1 : 0x0FFFFFFF);
+  }
+  fat_entry(f, part, USED, 0x0FFFFFFF);
+
+  // Root: a deleted entry, then the existing file
+  memset(sector, 0, BLOCK_SIZE);
+  memcpy(sector, "\xE5OLD    TXT", 11);
+  sector[11] = 0x20;
+  memcpy(sector + 32, other_name, 11);
+  sector[32 + 11] = 0x20;
+  put16(sector + 32 + 26, OTHER_FIRST);
+  put32(sector + 32 + 28, OTHER_LEN * BLOCK_SIZE);
+  put_sector(f, part + DATA_LBA);
+  fclose(f);
+}
+
+// Reads back the log with its own FAT32 walk
+static void verify(const char *path, uint32_t part, uint32_t synced) {
+  FILE *f = fopen(path, "rb");
+  uint32_t fat_lba, data_lba, first, size, c, next, n = 0, i, k, want;
+  uint8_t fat2[BLOCK_SIZE];
+
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  get_sector(f, part);
+  fat_lba = part + le16(sector + 14);
+  data_lba = fat_lba + sector[16] * le32(sector + 36);
+
+  get_sector(f, part + le16(sector + 48));
+  if (le32(sector + 488) != 0xFFFFFFFF) {
+    FAIL("FSInfo free count still %u", le32(sector + 488));
+  }
+
+  get_sector(f, data_lba);
+  if (memcmp(sector, log_name, 11) || sector[11] != 0x20) {
+    FAIL("the log did not take the deleted slot");
+  }
+  if (memcmp(sector + 32, other_name, 11)) {
+    FAIL("the existing entry was overwritten");
+  }
+  first = le16(sector + 20) << 16 | le16(sector + 26);
+  size = le32(sector + 28);
+  if (size != synced) {
+    FAIL("directory entry says %u bytes, last sync was %u", size, synced);
+  }
+  if (first <= USED) {
+    FAIL("log starts at cluster %u, inside the used ones", first);
+  }
+
+  // Contiguous, terminated, the same in both FATs
+  for (c = first;; c = next, n++) {
+    get_sector(f, fat_lba + FAT_SECTORS + c / (BLOCK_SIZE / 4));
+    memcpy(fat2, sector, BLOCK_SIZE);
+    get_sector(f, fat_lba + c / (BLOCK_SIZE / 4));
+    if (memcmp(fat2, sector, BLOCK_SIZE)) {
+      FAIL("the FAT copies differ around cluster %u", c);
+    }
+    next = le32(sector + 4 * (c % (BLOCK_SIZE / 4))) & 0x0FFFFFFF;
+    if (next >= 0x0FFFFFF8) {
+      n++;
+      break;
+    }
+    if (next != c + 1) {
+      FAIL("chain jumps from %u to %u", c, next);
+    }
+  }
+  if (n != (LOG_BYTES + BLOCK_SIZE - 1) / BLOCK_SIZE) {
+    FAIL("chain has %u clusters for %u bytes", n, LOG_BYTES);
+  }
+
+  for (i = 0; i < size; i += BLOCK_SIZE) {
+    get_sector(f, data_lba + (first - 2) + i / BLOCK_SIZE);
+    for (k = 0; k < BLOCK_SIZE && i + k < size; k++) {
+      want = pattern(i + k);
+      if (sector[k] != want) {
+        FAIL("byte %u is %02x, want %02x", i + k, sector[k], want);
+      }
+    }
+  }
+  fclose(f);
+}
+
+static void run(const char *path, uint32_t part) {
+  static fatlog_t log, probe;
+  blockdev_file_t file;
+  blockdev_t dev;
+  uint8_t *bytes = (uint8_t *)data_buf;
+  uint32_t seed = part + 1, pos = 0, synced = 0, len, off, reads, writes, i;
+
+  format(path, part);
+  if (!blockdev_file_open(&file, path, &dev)) {
+    FAIL("%s: cannot open", path);
+  }
+  if (!fatlog_mount(&log, &dev)) {
+    FAIL("mount failed (partition at %u)", part);
+  }
+  if (fatlog_create(&log, other_name, 1000)) {
+    FAIL("created a file over an existing name");
+  }
+  if (!fatlog_create(&log, log_name, LOG_BYTES)) {
+    FAIL("create failed");
+  }
+  // A second mount of the same volume must see the new entry
+  if (!fatlog_mount(&probe, &dev) || fatlog_create(&probe, log_name, 1000)) {
+    FAIL("created the log twice");
+  }
+
+  reads = file.reads;
+  while (pos < LOG_BYTES) {
+    seed = seed * 1103515245 + 12345;
+    len = (seed >> 8) % 3 == 0 ? BLOCK_SIZE * (1 + (seed >> 12) % 8) : (seed >> 12) % 700 + 1;
+    off = (seed >> 20) % 4;
+    if (len > LOG_BYTES - pos) {
+      len = LOG_BYTES - pos;
+    }
+    for (i = 0; i < len; i++) {
+      bytes[off + i] = pattern(pos + i);
+    }
+    if (!fatlog_write(&log, bytes + off, len)) {
+      FAIL("write of %u at %u failed", len, pos);
+    }
+    pos += len;
+    if (log.size != pos || fatlog_remaining(&log) != log.capacity - pos) {
+      FAIL("size %u after writing %u", log.size, pos);
+    }
+    if (file.reads != reads) {
+      FAIL("fatlog_write read the device");
+    }
+    // Sync at about two thirds; what follows is lost to a power cut
+    if (!synced && pos >= LOG_BYTES * 2 / 3) {
+      if (!fatlog_sync(&log)) {
+        FAIL("sync failed");
+      }
+      synced = pos;
+      reads = file.reads;
+    }
+  }
+  if (fatlog_write(&log, bytes, log.capacity - log.size + 1)) {
+    FAIL("wrote past the preallocation");
+  }
+  writes = file.writes;
+  blockdev_file_close(&file);
+  verify(path, part, synced);
+
+  // A final sync makes everything visible
+  if (!blockdev_file_open(&file, path, &dev) || !fatlog_sync(&log)) {
+    FAIL("final sync failed");
+  }
+  writes += file.writes;
+  blockdev_file_close(&file);
+  verify(path, part, LOG_BYTES);
+  printf("%s: %u bytes, %u synced at the cut, %u device writes\n",
+         part ? "MBR partition" : "superfloppy", LOG_BYTES, synced, writes);
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "fatlog_test.img";
+
+  run(path, 0);
+  run(path, PART_LBA);
+  return 0;
+}
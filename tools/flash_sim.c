@@ -0,0 +1,113 @@
+#include "flash_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE                256
+#define ERASED              0xE339E339
+
+
+static uint32_t sim_rand(flash_sim_t *s) {
+  s->seed ^= s->seed << 13;
+  s->seed ^= s->seed >> 17;
+  s->seed ^= s->seed << 5;
+  return s->seed;
+}
+
+// Words of this op that land before the power goes, PAGE / 4 if it completes
+static uint32_t sim_words(flash_sim_t *s) {
+  if (s->dead) {
+    return 0;
+  }
+  if (++s->ops == s->cut_at) {
+    s->dead = true;
+    return sim_rand(s) % (PAGE / 4);
+  }
+  return PAGE / 4;
+}
+
+static bool sim_erase(void *ctx, uint32_t off) {
+  flash_sim_t *s = ctx;
+  uint32_t *w = (uint32_t *)(s->mem + off);
+  uint32_t n, i;
+
+  if (off % PAGE || off >= s->size || s->dead) {
+    return false;
+  }
+  n = sim_words(s);
+  for (i = 0; i < PAGE / 4; i++) {
+    if (i < n) {
+      w[i] = ERASED;
+    } else if (s->dead) {
+      w[i] ^= sim_rand(s);
+    }
+  }
+  s->wear[off / PAGE]++;
+  return !s->dead;
+}
+
+static bool sim_program(void *ctx, uint32_t off, const void *page) {
+  flash_sim_t *s = ctx;
+  uint32_t *w = (uint32_t *)(s->mem + off);
+  uint32_t n, i;
+
+  if (off % PAGE || off >= s->size || s->dead) {
+    return false;
+  }
+  for (i = 0; i < PAGE / 4; i++) {
+    if (w[i] != ERASED) {
+      s->violations++;
+      break;
+    }
+  }
+  n = sim_words(s);
+  memcpy(w, page, n * 4);
+  return !s->dead;
+}
+
+bool flash_sim_open(flash_sim_t *s, const char *path, uint32_t size, kv_flash_t *fl) {
+  FILE *f;
+  uint32_t i;
+
+  s->size = size & ~(PAGE - 1);
+  s->path = path;
+  s->mem = malloc(s->size);
+  s->wear = calloc(s->size / PAGE, sizeof(uint32_t));
+  s->ops = s->cut_at = s->violations = 0;
+  s->dead = false;
+  s->seed = 0x2545F491;
+  if (!s->mem || !s->wear) {
+    return false;
+  }
+  for (i = 0; i < s->size / 4; i++) {
+    ((uint32_t *)s->mem)[i] = ERASED;
+  }
+  if ((f = fopen(path, "rb")) != NULL) {
+    (void)fread(s->mem, 1, s->size, f);   // A short image stays erased past its end
+    fclose(f);
+  }
+  fl->base = s->mem;
+  fl->size = s->size;
+  fl->page_size = PAGE;
+  fl->erase_size = PAGE;
+  fl->erased = ERASED;
+  fl->erase = sim_erase;
+  fl->program = sim_program;
+  fl->ctx = s;
+  return true;
+}
+
+bool flash_sim_close(flash_sim_t *s) {
+  FILE *f = fopen(s->path, "wb");
+  bool ok = f && fwrite(s->mem, 1, s->size, f) == s->size;
+
+  if (f) {
+    fclose(f);
+  }
+  free(s->mem);
+  free(s->wear);
+  s->mem = NULL;
+  s->wear = NULL;
+  return ok;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "kvstore.h"
+
+/**
+ * @brief Host-side model of the on-chip flash, backed by an image file.
+ *
+ * @details Same geometry and erased value as the CH32V307 (256-byte fast
+ * program and erase pages reading back FLASH_ERASED). Programming a page that
+ * is not erased is counted as a violation rather than silently merged.
+ *
+ * Power-cut injection: when ops reaches cut_at, that erase or program stops
+ * after a random number of words (an erase leaves garbage in the rest) and the
+ * part goes dead, failing every later call until the caller "reboots" by
+ * clearing dead. Build with the lib/ sources, e.g.
+ * cc -Ilib tools/flash_sim.c lib/kvstore.c lib/crc32.c lib/crc32_table.c app.c
+ */
+typedef struct {
+  uint8_t *mem;
+  uint32_t size;
+  const char *path;
+  uint32_t ops;             // Erases and programs so far
+  uint32_t cut_at;          // Op that loses power, 0 for none
+  bool dead;
+  uint32_t violations;      // Programs over data
+  uint32_t *wear;           // Erases per page
+  uint32_t seed;
+} flash_sim_t;
+
+// Loads path if it exists (missing or short images read as erased)
+bool flash_sim_open(flash_sim_t *s, const char *path, uint32_t size, kv_flash_t *fl);
+// Writes the image back
+bool flash_sim_close(flash_sim_t *s);
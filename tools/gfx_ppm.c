@@ -0,0 +1,51 @@
+#include "gfx_ppm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+static void ppm_write(void *ctx, const gfx_rect_t *r, const uint16_t *px, uint32_t count) {
+  gfx_ppm_t *p = ctx;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    p->fb[(uint32_t)(r->y + i / r->w) * p->width + r->x + i % r->w] = px[i];
+  }
+  gfx_write_done(p->gfx, px);
+}
+
+bool gfx_ppm_init(gfx_ppm_t *p, gfx_t *gfx, uint16_t width, uint16_t height, gfx_panel_t *panel) {
+  p->gfx = gfx;
+  p->width = width;
+  p->height = height;
+  p->fb = calloc((size_t)width * height, sizeof(uint16_t));
+  panel->write = ppm_write;
+  panel->ctx = p;
+  return p->fb != NULL;
+}
+
+bool gfx_ppm_save(const gfx_ppm_t *p, const char *path) {
+  FILE *f = fopen(path, "wb");
+  uint32_t i;
+  uint16_t c;
+
+  if (!f) {
+    return false;
+  }
+  fprintf(f, "P6\n%u %u\n255\n", p->width, p->height);
+  for (i = 0; i < (uint32_t)p->width * p->height; i++) {
+    c = p->fb[i];
+#if GFX_PIXEL_SWAP
+    c = (uint16_t)((c >> 8) | (c << 8));
+#endif
+    fputc(((c >> 11) & 0x1F) << 3, f);
+    fputc(((c >> 5) & 0x3F) << 2, f);
+    fputc((c & 0x1F) << 3, f);
+  }
+  return fclose(f) == 0;
+}
+
+void gfx_ppm_free(gfx_ppm_t *p) {
+  free(p->fb);
+  p->fb = NULL;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gfx.h"
+
+/**
+ * @brief Host-side gfx panel: keeps the "screen" in RAM and saves it as PPM.
+ *
+ * @details Writes complete immediately, so gfx_poll() runs the whole pipeline
+ * synchronously. gfx_ppm_init() fills in the panel for gfx_init() on gfx, which
+ * is where it reports each write done. tools/gfx_test.c uses it.
+ */
+typedef struct {
+  gfx_t *gfx;
+  uint16_t width, height;
+  uint16_t *fb;
+} gfx_ppm_t;
+
+bool gfx_ppm_init(gfx_ppm_t *p, gfx_t *gfx, uint16_t width, uint16_t height, gfx_panel_t *panel);
+bool gfx_ppm_save(const gfx_ppm_t *p, const char *path);
+void gfx_ppm_free(gfx_ppm_t *p);
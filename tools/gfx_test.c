@@ -0,0 +1,171 @@
+/*
+ * Host test and benchmark for the tile pipeline (lib/gfx.h) on the PPM panel
+ * (tools/gfx_ppm.h).
+ *
+ *   gfx_test [frames] [out.ppm]
+ *
+ * A 320x240 scene (a gradient, a sprite and boxes bouncing around) is animated
+ * for frames frames; each frame invalidates only where boxes were and are now,
+ * flushes through two 8-row tile buffers and then compares the whole panel with
+ * the scene rendered in one piece, so any pixel the dirty list or the tile
+ * cutting missed shows up. A burst of scattered one-pixel updates exercises the
+ * merge of a full dirty list the same way. Reports pixels sent per frame
+ * against a full redraw and the host time per frame; writes the last frame to
+ * out.ppm if given. Exits 1 on the first mismatch.
+ * Build: cc -O2 -Ilib -Itools -o gfx_test tools/gfx_test.c tools/gfx_ppm.c lib/gfx.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gfx_ppm.h"
+
+#define W                   320
+#define H                   240
+#define TILE_PX             (W * 8)
+#define BOXES               6
+#define SPRITE              24
+
+typedef struct {
+  int16_t x, y, dx, dy;
+  uint16_t size, color;
+} box_t;
+
+static box_t boxes[BOXES];
+static uint16_t sprite[SPRITE * SPRITE];
+static uint16_t dots[W];    // Per column: a dot's row + 1, 0 for none
+static uint16_t buf0[TILE_PX], buf1[TILE_PX];
+static uint16_t ref[W * H];
+
+
+static void render(void *ctx, gfx_tile_t *t) {
+  gfx_rect_t row;
+  uint32_t i, y;
+
+  (void)ctx;
+  for (y = 0; y < t->area.h; y++) {
+    row = (gfx_rect_t){t->area.x, (int16_t)(t->area.y + y), t->area.w, 1};
+    gfx_fill(t, row, GFX_COLOR(0, (t->area.y + y) * 255 / H, 96));
+  }
+  gfx_blit(t, (W - SPRITE) / 2, (H - SPRITE) / 2, SPRITE, SPRITE, sprite);
+  for (i = 0; i < BOXES; i++) {
+    gfx_fill(t, (gfx_rect_t){boxes[i].x, boxes[i].y, boxes[i].size, boxes[i].size}, boxes[i].color);
+  }
+  for (i = 0; i < W; i++) {
+    if (dots[i]) {
+      gfx_fill(t, (gfx_rect_t){(int16_t)i, (int16_t)(dots[i] - 1), 1, 1}, GFX_COLOR(255, 255, 255));
+    }
+  }
+}
+
+static void box_rect(gfx_t *g, const box_t *b) {
+  gfx_invalidate(g, (gfx_rect_t){b->x, b->y, b->size, b->size});
+}
+
+static void move(gfx_t *g) {
+  box_t *b;
+  uint32_t i;
+
+  for (i = 0; i < BOXES; i++) {
+    b = &boxes[i];
+    box_rect(g, b);
+    if (b->x + b->dx < -b->size / 2 || b->x + b->dx > W - b->size / 2) {
+      b->dx = -b->dx;
+    }
+    if (b->y + b->dy < -b->size / 2 || b->y + b->dy > H - b->size / 2) {
+      b->dy = -b->dy;
+    }
+    b->x += b->dx;
+    b->y += b->dy;
+    box_rect(g, b);
+  }
+}
+
+static uint32_t flush(gfx_t *g) {
+  uint32_t before = g->pixels;
+
+  while (gfx_poll(g)) {
+  }
+  return g->pixels - before;
+}
+
+static int check(const gfx_ppm_t *p, uint32_t frame) {
+  gfx_tile_t whole = {{0, 0, W, H}, ref};
+  uint32_t i;
+
+  render(NULL, &whole);
+  for (i = 0; i < W * H; i++) {
+    if (p->fb[i] != ref[i]) {
+      printf("frame %u: pixel (%u, %u) is %04x, expected %04x\n",
+             frame, i % W, i / W, p->fb[i], ref[i]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = argc > 1 ? strtoul(argv[1], NULL, 0) : 500;
+  uint64_t sent = 0;
+  uint32_t seed = 1, i, f;
+  struct timespec t0, t1;
+  gfx_panel_t panel;
+  gfx_ppm_t ppm;
+  gfx_t g;
+  double s;
+
+  for (i = 0; i < SPRITE * SPRITE; i++) {
+    sprite[i] = (i / SPRITE + i % SPRITE) & 4 ? GFX_COLOR(255, 64, 0) : GFX_COLOR(0, 0, 0);
+  }
+  for (i = 0; i < BOXES; i++) {
+    boxes[i] = (box_t){(int16_t)(i * 47 % W), (int16_t)(i * 31 % H), (int16_t)(1 + i % 3),
+                       (int16_t)(2 - i % 2 * 4), (uint16_t)(8 + i * 6),
+                       GFX_COLOR(40 * i, 255 - 40 * i, 128)};
+  }
+  if (!gfx_ppm_init(&ppm, &g, W, H, &panel) ||
+      !gfx_init(&g, W, H, &panel, render, NULL, buf0, buf1, TILE_PX)) {
+    printf("init failed\n");
+    return 1;
+  }
+
+  gfx_invalidate(&g, (gfx_rect_t){0, 0, W, H});
+  flush(&g);
+  if (check(&ppm, 0)) {
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (f = 1; f <= frames; f++) {
+    move(&g);
+    sent += flush(&g);
+    if (check(&ppm, f)) {
+      return 1;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+  printf("boxes: %u frames, %.0f pixels/frame (%.1f%% of a full redraw), %.1f us/frame "
+         "with the check\n", frames, (double)sent / frames, 100.0 * sent / frames / (W * H),
+         s * 1e6 / frames);
+
+  // Scattered single pixels overflow the dirty list and force merges
+  for (i = 0; i < 40; i++) {
+    seed = seed * 1103515245 + 12345;
+    f = (seed >> 8) % W;
+    if (dots[f]) {
+      gfx_invalidate(&g, (gfx_rect_t){(int16_t)f, (int16_t)(dots[f] - 1), 1, 1});
+    }
+    dots[f] = 1 + (seed >> 20) % H;
+    gfx_invalidate(&g, (gfx_rect_t){(int16_t)f, (int16_t)(dots[f] - 1), 1, 1});
+  }
+  printf("dots: %u pixels sent for 40 changes, %u bursts in all\n", flush(&g), g.bursts);
+  if (check(&ppm, frames + 1)) {
+    return 1;
+  }
+
+  if (argc > 2 && !gfx_ppm_save(&ppm, argv[2])) {
+    perror(argv[2]);
+    return 1;
+  }
+  gfx_ppm_free(&ppm);
+  return 0;
+}
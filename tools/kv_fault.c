@@ -0,0 +1,187 @@
+/*
+ * Power-cut test for the flash key-value store (lib/kvstore.h).
+ *
+ *   kv_fault [image] [cuts] [seed]
+ *
+ * Runs random sets, deletes and syncs of up to 60-byte values over a simulated
+ * 16 KiB region (tools/flash_sim.h) and cuts the power during a random erase or
+ * program, mounts included. After every remount each key must hold its value from the
+ * last kv_sync() or one written after it, and a key may only be missing if it
+ * was missing then or deleted since. Exits 1 on the first mismatch.
+ * Build: cc -O2 -Ilib -Itools -o kv_fault tools/kv_fault.c tools/flash_sim.c
+ *        lib/kvstore.c lib/crc32.c lib/crc32_table.c lib/prng.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "flash_sim.h"
+#include "kvstore.h"
+#include "prng.h"
+
+#define REGION              (16 * 1024)
+#define SEGMENT             4096
+#define KEYS                48
+#define SLOTS               64
+
+static flash_sim_t sim;
+static kv_flash_t fl;
+static kv_t kv;
+static kv_slot_t slots[SLOTS];
+static prng_t rng;
+
+static uint32_t version;            // Last one written
+static uint32_t synced;             // version at the last sync or remount
+static uint32_t durable[KEYS];      // Version on flash at that point, 0 if none
+static uint32_t current[KEYS];      // What kv_get() must return now
+static uint8_t deleted[KEYS];       // Deleted since then
+
+
+static uint32_t value_len(uint32_t k, uint32_t v) {
+  return 4 + (k * 7 + v) % 57;
+}
+
+static void make_value(uint32_t k, uint32_t v, uint8_t *buf) {
+  uint32_t i;
+
+  for (i = 0; i < 4; i++) {
+    buf[i] = v >> (8 * i);
+  }
+  for (; i < value_len(k, v); i++) {
+    buf[i] = v * 31 + k + i;
+  }
+}
+
+// Version held by key k, 0 if missing; exits if the value is not one we wrote
+static uint32_t read_key(uint32_t k) {
+  uint8_t buf[KV_VALUE_MAX], want[KV_VALUE_MAX];
+  int32_t len = kv_get(&kv, k, buf, sizeof(buf));
+  uint32_t v, i;
+
+  if (len < 0) {
+    return 0;
+  }
+  v = buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t)buf[3] << 24;
+  make_value(k, v, want);
+  if (v == 0 || v > version || (uint32_t)len != value_len(k, v)) {
+    printf("key %u: bad value (len %d, version %u)\n", k, len, v);
+    exit(1);
+  }
+  for (i = 0; i < (uint32_t)len; i++) {
+    if (buf[i] != want[i]) {
+      printf("key %u: corrupt byte %u\n", k, i);
+      exit(1);
+    }
+  }
+  return v;
+}
+
+static void check_current(void) {
+  uint32_t k;
+
+  for (k = 0; k < KEYS; k++) {
+    if (read_key(k) != current[k]) {
+      printf("key %u: version %u, expected %u\n", k, read_key(k), current[k]);
+      exit(1);
+    }
+  }
+}
+
+static void check_remount(void) {
+  uint32_t k, v;
+
+  for (k = 0; k < KEYS; k++) {
+    v = read_key(k);
+    if (v ? v != durable[k] && v <= synced : durable[k] && !deleted[k]) {
+      printf("key %u: version %u after power loss, synced %u\n", k, v, durable[k]);
+      exit(1);
+    }
+    durable[k] = current[k] = v;
+    deleted[k] = 0;
+  }
+  synced = version;
+}
+
+static void sync_model(void) {
+  uint32_t k;
+
+  for (k = 0; k < KEYS; k++) {
+    durable[k] = current[k];
+    deleted[k] = 0;
+  }
+  synced = version;
+}
+
+// One random operation; false if the power went
+static bool step(void) {
+  uint8_t buf[KV_VALUE_MAX];
+  uint32_t k = prng_below(&rng, KEYS), r = prng_below(&rng, 100);
+  bool ok;
+
+  if (r < 10) {
+    ok = kv_sync(&kv);
+    if (ok) {
+      sync_model();
+    }
+  } else if (r < 20) {
+    if (!current[k]) {
+      return true;
+    }
+    deleted[k] = 1;
+    current[k] = 0;
+    ok = kv_delete(&kv, k);
+  } else {
+    make_value(k, ++version, buf);
+    current[k] = version;
+    ok = kv_set(&kv, k, buf, value_len(k, version));
+  }
+  if (!ok && !sim.dead) {
+    printf("operation failed without a power cut\n");
+    exit(1);
+  }
+  return !sim.dead;
+}
+
+int main(int argc, char **argv) {
+  const char *path = argc > 1 ? argv[1] : "kv_fault.img";
+  uint32_t cuts = argc > 2 ? strtoul(argv[2], NULL, 0) : 2000;
+  uint32_t seed[4] = { argc > 3 ? strtoul(argv[3], NULL, 0) : 1, 2, 3, 4 };
+  uint32_t c, n, ops = 0, lo = ~0u, hi = 0;
+  bool mounted;
+
+  prng_seed(&rng, seed);
+  remove(path);
+  if (!flash_sim_open(&sim, path, REGION, &fl)) {
+    return 1;
+  }
+  for (c = 0; c <= cuts; c++) {
+    sim.dead = false;
+    sim.cut_at = c < cuts ? sim.ops + 1 + prng_below(&rng, 600) : 0;
+    mounted = false;
+    while (!sim.dead) {
+      if (!mounted) {
+        if (!kv_mount(&kv, &fl, SEGMENT, slots, SLOTS)) {
+          if (!sim.dead) {
+            printf("mount failed without a power cut\n");
+            return 1;
+          }
+          break;
+        }
+        check_remount();
+        mounted = true;
+      }
+      if (c == cuts && ops++ >= 20000) {
+        break;
+      }
+      if (step() && prng_below(&rng, 50) == 0) {
+        check_current();
+      }
+    }
+  }
+  check_current();
+  for (n = 0; n < REGION / 256; n++) {
+    lo = sim.wear[n] < lo ? sim.wear[n] : lo;
+    hi = sim.wear[n] > hi ? sim.wear[n] : hi;
+  }
+  printf("%u power cuts, %u flash ops, %u versions, erases per page %u..%u, %u programs over data\n",
+    cuts, sim.ops, version, lo, hi, sim.violations);
+  return !flash_sim_close(&sim) || sim.violations != 0;
+}
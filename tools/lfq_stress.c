@@ -0,0 +1,166 @@
+/*
+ * Thread stress test for the lock-free queues (lib/lfq.h).
+ *
+ *   lfq_stress [items] [producers]
+ *
+ * SPSC: one thread pushes items sequence numbers through a 64-entry ring while
+ * another pops them; every number must come out once and in order. MPSC: each
+ * of producers threads pushes items (producer, sequence) pairs, retrying while
+ * the queue is full, into one consumer that must see every producer's sequence
+ * complete and in order. The small rings keep both sides colliding on
+ * full and empty; a side that finds it so yields, which keeps the test usable
+ * on a single core. Exits 1 on the first error.
+ * Build: cc -O2 -pthread -Ilib -o lfq_stress tools/lfq_stress.c lib/lfq.c
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lfq.h"
+
+#define LEN                 64
+#define MAX_PRODUCERS       16
+
+typedef struct {
+  uint32_t producer;
+  uint32_t seq;
+  uint32_t check;           // Catches torn items
+} item_t;
+
+static uint32_t items = 10000000;
+static uint32_t producers = 4;
+
+static spsc_t spsc;
+static item_t spsc_buf[LEN];
+static mpsc_t mpsc;
+static uint32_t mpsc_buf[MPSC_BUF_SIZE(sizeof(item_t), LEN) / 4];
+static uint32_t push_retries;
+
+
+static uint32_t check_of(uint32_t producer, uint32_t seq) {
+  return (producer * 0x9E3779B9u) ^ (seq * 0x85EBCA6Bu);
+}
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *spsc_producer(void *arg) {
+  item_t it = {0, 0, 0};
+
+  (void)arg;
+  while (it.seq < items) {
+    it.check = check_of(0, it.seq);
+    if (spsc_push(&spsc, &it)) {
+      it.seq++;
+    } else {
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static int run_spsc(void) {
+  pthread_t th;
+  item_t it;
+  uint32_t next = 0;
+  double t = now();
+
+  spsc_init(&spsc, spsc_buf, sizeof(item_t), LEN);
+  pthread_create(&th, NULL, spsc_producer, NULL);
+  while (next < items) {
+    if (!spsc_pop(&spsc, &it)) {
+      sched_yield();
+      continue;
+    }
+    if (it.seq != next || it.check != check_of(0, it.seq)) {
+      printf("spsc: got %u (check %08x), expected %u\n", it.seq, it.check, next);
+      return 1;
+    }
+    next++;
+  }
+  pthread_join(th, NULL);
+  if (spsc_pop(&spsc, &it)) {
+    printf("spsc: extra item %u\n", it.seq);
+    return 1;
+  }
+  printf("spsc: %u items, %.2f M/s\n", items, items / (now() - t) / 1e6);
+  return 0;
+}
+
+static void *mpsc_producer(void *arg) {
+  item_t it = {(uint32_t)(uintptr_t)arg, 0, 0};
+  uint32_t retries = 0;
+
+  while (it.seq < items) {
+    it.check = check_of(it.producer, it.seq);
+    if (mpsc_push(&mpsc, &it)) {
+      it.seq++;
+    } else {
+      retries++;
+      sched_yield();
+    }
+  }
+  __atomic_fetch_add(&push_retries, retries, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+static int run_mpsc(void) {
+  pthread_t th[MAX_PRODUCERS];
+  uint32_t next[MAX_PRODUCERS] = {0};
+  uint64_t total = (uint64_t)items * producers, n = 0;
+  item_t it;
+  uint32_t i;
+  double t = now();
+
+  mpsc_init(&mpsc, mpsc_buf, sizeof(item_t), LEN);
+  for (i = 0; i < producers; i++) {
+    pthread_create(&th[i], NULL, mpsc_producer, (void *)(uintptr_t)i);
+  }
+  while (n < total) {
+    if (!mpsc_pop(&mpsc, &it)) {
+      sched_yield();
+      continue;
+    }
+    if (it.producer >= producers || it.seq != next[it.producer] ||
+        it.check != check_of(it.producer, it.seq)) {
+      printf("mpsc: got %u:%u (check %08x), expected %u\n", it.producer, it.seq, it.check,
+             it.producer < producers ? next[it.producer] : 0);
+      return 1;
+    }
+    next[it.producer]++;
+    n++;
+  }
+  for (i = 0; i < producers; i++) {
+    pthread_join(th[i], NULL);
+  }
+  if (mpsc_pop(&mpsc, &it)) {
+    printf("mpsc: extra item %u:%u\n", it.producer, it.seq);
+    return 1;
+  }
+  if (mpsc_dropped(&mpsc) != push_retries) {
+    printf("mpsc: %u drops counted, %u pushes failed\n", mpsc_dropped(&mpsc), push_retries);
+    return 1;
+  }
+  printf("mpsc: %u producers x %u items, %.2f M/s, %u pushes found it full\n",
+         producers, items, total / (now() - t) / 1e6, push_retries);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    items = strtoul(argv[1], NULL, 0);
+  }
+  if (argc > 2) {
+    producers = strtoul(argv[2], NULL, 0);
+  }
+  if (!producers || producers > MAX_PRODUCERS) {
+    printf("1..%u producers\n", MAX_PRODUCERS);
+    return 1;
+  }
+  return run_spsc() || run_mpsc();
+}
@@ -0,0 +1,197 @@
+/*
+ * Host test for the noise-source health tests (lib/rng_health.h) and the
+ * generator behind random_u32() (lib/prng.h).
+ *
+ *   rng_test [samples]
+ *
+ * Health tests, each on a fresh rng_health_t fed synthetic sources:
+ *  - a stuck source must fail the repetition count on exactly its cutoff-th
+ *    word, again every cutoff words after, and the adaptive proportion test
+ *    within the first window;
+ *  - sources below the assumed min-entropy must trip: words drawn from only
+ *    four values (the repetition count) and a low byte that repeats one value
+ *    an eighth of the time (the adaptive proportion);
+ *  - sources at the assumed min-entropy, 16 bits per word and a low byte
+ *    whose commonest value comes up a sixteenth of the time, and a full-entropy
+ *    one must not trip in samples words.
+ * Generator: the xoshiro128** reference outputs from state {1, 2, 3, 4},
+ * prng_below() within [0, bound) for edge bounds (0, 1, powers of two,
+ * 2^32 - 1) and free of modulo bias, by a chi-square over small bounds and the
+ * share of the lower third for bound 3 * 2^30, where modulo reduction would
+ * give it half. Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -o rng_test tools/rng_test.c lib/rng_health.c lib/prng.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "prng.h"
+#include "rng_health.h"
+
+static uint64_t sm = 0x243F6A8885A308D3;
+
+
+#define FAIL(...) do {                                                  \
+    printf(__VA_ARGS__);                                                \
+    printf("\n");                                                       \
+    exit(1);                                                            \
+  } while (0)
+
+// SplitMix64, independent of the generator under test
+static uint32_t noise(void) {
+  uint64_t z = (sm += 0x9E3779B97F4A7C15);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+  return (uint32_t)((z ^ (z >> 31)) >> 32);
+}
+
+typedef uint32_t (*source_t)(void);
+
+static uint32_t stuck(void) {
+  return 0x5A5A5A5A;
+}
+
+static uint32_t four_values(void) {
+  return 0x1234567 * (noise() & 3);
+}
+
+static uint32_t word16(void) {
+  return (noise() & 0xFFFF) * 0x10001;
+}
+
+// Low byte 0x42 with probability p / 256, else uniform over the other 255
+static uint32_t biased_byte(uint32_t p) {
+  uint32_t w = noise(), b = noise() & 0xFF;
+
+  if (b < p) {
+    return (w & ~0xFFu) | 0x42;
+  }
+  b = noise() % 255;
+  return (w & ~0xFFu) | (b >= 0x42 ? b + 1 : b);
+}
+
+static uint32_t byte_eighth(void) {
+  return biased_byte(32);
+}
+
+static uint32_t byte_sixteenth(void) {
+  return biased_byte(16);
+}
+
+static void run(const char *name, source_t src, uint32_t n, rng_health_t *h) {
+  uint32_t i;
+
+  rng_health_init(h);
+  for (i = 0; i < n; i++) {
+    rng_health_feed(h, src());
+  }
+  printf("%-28s %10u samples %8u rct %8u apt failures\n", name, n, h->rct_failures, h->apt_failures);
+}
+
+static void test_health(uint32_t samples) {
+  rng_health_t h;
+  uint32_t i, first_apt = 0;
+
+  rng_health_init(&h);
+  for (i = 1; i <= 4 * RNG_HEALTH_RCT_CUTOFF; i++) {
+    bool ok = rng_health_feed(&h, stuck());
+
+    if (ok != (i % RNG_HEALTH_RCT_CUTOFF != 0)) {
+      FAIL("stuck source: word %u %s", i, ok ? "passed" : "failed");
+    }
+  }
+  if (h.rct_failures != 4) {
+    FAIL("stuck source: %u repetition failures in %u words", h.rct_failures, 4 * RNG_HEALTH_RCT_CUTOFF);
+  }
+  rng_health_init(&h);
+  for (i = 1; i <= RNG_HEALTH_APT_WINDOW && !first_apt; i++) {
+    rng_health_feed(&h, stuck());
+    if (h.apt_failures) {
+      first_apt = i;
+    }
+  }
+  if (first_apt != RNG_HEALTH_APT_CUTOFF) {
+    FAIL("stuck source: adaptive proportion failed on word %u, want %u", first_apt, RNG_HEALTH_APT_CUTOFF);
+  }
+
+  run("four values (2 bits/word)", four_values, 100000, &h);
+  if (!h.rct_failures) {
+    FAIL("four-valued source passed the repetition count");
+  }
+  run("low byte 1/8 (3 bits/byte)", byte_eighth, 100000, &h);
+  if (!h.apt_failures) {
+    FAIL("biased low byte passed the adaptive proportion test");
+  }
+
+  run("16 bits/word", word16, samples, &h);
+  if (h.rct_failures || h.apt_failures) {
+    FAIL("source at the assumed word entropy failed");
+  }
+  run("low byte 1/16 (4 bits/byte)", byte_sixteenth, samples, &h);
+  if (h.rct_failures || h.apt_failures) {
+    FAIL("source at the assumed byte entropy failed");
+  }
+  run("full entropy", noise, samples, &h);
+  if (h.rct_failures || h.apt_failures) {
+    FAIL("full-entropy source failed");
+  }
+}
+
+static void test_prng(uint32_t samples) {
+  static const uint32_t ref[] = {11520, 0, 5927040, 70819200};
+  static const uint32_t bounds[] = {0, 1, 2, 3, 7, 256, 1000, 0x80000000, 0x80000001, 0xFFFFFFFF};
+  static const uint32_t small[] = {2, 3, 5, 6, 10, 12};
+  prng_t p = {{1, 2, 3, 4}};
+  uint32_t i, k, v, counts[12], low = 0;
+  double chi, e;
+
+  for (i = 0; i < 4; i++) {
+    v = prng_next(&p);
+    if (v != ref[i]) {
+      FAIL("prng_next output %u: %u, want %u", i, v, ref[i]);
+    }
+  }
+
+  p.s[0] = noise();
+  for (k = 0; k < sizeof(bounds) / sizeof(bounds[0]); k++) {
+    for (i = 0; i < 100000; i++) {
+      v = prng_below(&p, bounds[k]);
+      if (bounds[k] ? v >= bounds[k] : v != 0) {
+        FAIL("prng_below(%u) returned %u", bounds[k], v);
+      }
+    }
+  }
+
+  // 99.9th percentile of chi-square with up to 11 degrees of freedom: 31.3
+  for (k = 0; k < sizeof(small) / sizeof(small[0]); k++) {
+    for (i = 0; i < small[k]; i++) {
+      counts[i] = 0;
+    }
+    for (i = 0; i < samples; i++) {
+      counts[prng_below(&p, small[k])]++;
+    }
+    e = (double)samples / small[k];
+    for (i = 0, chi = 0; i < small[k]; i++) {
+      chi += (counts[i] - e) * (counts[i] - e) / e;
+    }
+    if (chi > 31.3) {
+      FAIL("prng_below(%u): chi-square %.1f", small[k], chi);
+    }
+  }
+
+  for (i = 0; i < samples; i++) {
+    low += prng_below(&p, 0xC0000000) < 0x40000000;
+  }
+  e = (double)low / samples;
+  printf("prng_below(3 * 2^30): %.4f in the lower third\n", e);
+  if (e < 0.33 || e > 0.337) {
+    FAIL("prng_below(3 * 2^30) is biased: %.4f in the lower third", e);
+  }
+}
+
+int main(int argc, char **argv) {
+  uint32_t samples = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000000;
+
+  test_health(samples);
+  test_prng(samples);
+  return 0;
+}
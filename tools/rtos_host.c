@@ -0,0 +1,160 @@
+#include "rtos_host.h"
+
+#include <stdlib.h>
+#include <ucontext.h>
+
+#define HOST_STACK          (64 * 1024)
+
+typedef struct {
+  ucontext_t ctx;
+  rtos_entry_t entry;
+  void *arg;
+} host_task_t;
+
+static struct {
+  ucontext_t main_ctx;
+  bool enabled;             // Interrupts (and switches) allowed
+  bool in_isr;
+  bool pending;             // Switch requested
+  bool alarm_armed;
+  uint32_t alarm_at;
+  uint32_t now;
+} host;
+
+
+static ucontext_t *task_ctx(rtos_task_t *t) {
+  return &((host_task_t *)t->port)->ctx;
+}
+
+static void switch_now(void) {
+  rtos_task_t *prev = rtos_self(), *next;
+
+  host.pending = false;
+  next = rtos_switch_in();
+  if (next != prev) {
+    swapcontext(task_ctx(prev), task_ctx(next));
+  }
+}
+
+static void isr_exit(bool enabled) {
+  host.in_isr = false;
+  host.enabled = enabled;
+  if (host.pending && host.enabled) {
+    switch_now();
+  }
+}
+
+static void alarm_isr(void) {
+  bool enabled = host.enabled;
+
+  host.in_isr = true;
+  host.enabled = false;
+  host.alarm_armed = false;
+  rtos_timeout_isr();
+  isr_exit(enabled);
+}
+
+static void trampoline(void) {
+  host_task_t *h = rtos_self()->port;
+
+  h->entry(h->arg);
+  rtos_task_exit();
+}
+
+uint32_t rtos_port_irq_save(void) {
+  bool enabled = host.enabled;
+
+  host.enabled = false;
+  return enabled;
+}
+
+void rtos_port_irq_restore(uint32_t state) {
+  if (state) {
+    host.enabled = true;
+    if (host.pending && !host.in_isr) {
+      switch_now();
+    }
+  }
+}
+
+void rtos_port_pend_switch(void) {
+  host.pending = true;
+}
+
+void rtos_port_task_init(rtos_task_t *t, rtos_entry_t entry, void *arg) {
+  host_task_t *h = calloc(1, sizeof(*h));
+
+  h->entry = entry;
+  h->arg = arg;
+  getcontext(&h->ctx);
+  h->ctx.uc_stack.ss_sp = malloc(HOST_STACK);
+  h->ctx.uc_stack.ss_size = HOST_STACK;
+  h->ctx.uc_link = NULL;
+  makecontext(&h->ctx, trampoline, 0);
+  t->port = h;
+  t->sp = h->ctx.uc_stack.ss_sp;
+}
+
+void rtos_port_start(void) {
+  host.enabled = true;
+  host.pending = false;
+  swapcontext(&host.main_ctx, task_ctx(rtos_switch_in()));
+}
+
+uint32_t rtos_port_now(void) {
+  return host.now;
+}
+
+void rtos_port_alarm(bool armed, uint32_t at) {
+  host.alarm_armed = armed;
+  host.alarm_at = at;
+}
+
+// Nothing else can run: skip to the next timeout, or end the run
+void rtos_port_idle(void) {
+  if (!host.alarm_armed) {
+    rtos_host_stop();
+    return;
+  }
+  if ((int32_t)(host.alarm_at - host.now) > 0) {
+    host.now = host.alarm_at;
+  }
+  alarm_isr();
+}
+
+void rtos_host_run(void) {
+  host.now = 0;
+  host.alarm_armed = false;
+  host.in_isr = false;
+  rtos_start();
+}
+
+void rtos_host_stop(void) {
+  host.enabled = false;
+  swapcontext(task_ctx(rtos_self()), &host.main_ctx);
+}
+
+void rtos_host_isr(void (*fn)(void *arg), void *arg) {
+  bool enabled = host.enabled;
+
+  host.in_isr = true;
+  host.enabled = false;
+  fn(arg);
+  isr_exit(enabled);
+}
+
+void rtos_host_busy(uint32_t us) {
+  uint32_t step;
+
+  while (us) {
+    step = us;
+    if (host.alarm_armed && (int32_t)(host.alarm_at - host.now) < (int32_t)step) {
+      step = (int32_t)(host.alarm_at - host.now) > 0 ? host.alarm_at - host.now : 0;
+    }
+    host.now += step;
+    us -= step;
+    if (host.alarm_armed && (int32_t)(host.now - host.alarm_at) >= 0) {
+      alarm_isr();
+    }
+  }
+}
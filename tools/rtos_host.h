@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rtos.h"
+
+/**
+ * @brief Host port of the kernel (lib/rtos.h) on ucontext, in virtual time.
+ *
+ * @details Every task gets its own host stack; the stack given to
+ * rtos_task_create() is only filled, never run on. Time stands still while
+ * tasks run unless they call rtos_host_busy(), and the idle task jumps straight
+ * to the next timeout, so a run is deterministic and takes no real time.
+ * "Interrupts" are function calls made through rtos_host_isr() or the alarm
+ * firing; a switch they ask for happens when they return, as on the target.
+ * Build with the lib/ sources, e.g.
+ * cc -Ilib -Itools tools/rtos_host.c lib/rtos.c lib/swtimer.c app.c
+ */
+
+// Words for the idle task's (unused) stack
+#define RTOS_IDLE_WORDS     64
+
+/**
+ * @brief Starts the kernel and returns once no task can ever run again (every
+ * task done or blocked with no timeout pending) or rtos_host_stop() is called.
+ *
+ * @details Create the tasks after rtos_init() and before this; call rtos_init()
+ * again for the next run.
+ */
+void rtos_host_run(void);
+void rtos_host_stop(void);
+
+// Runs fn(arg) as an interrupt taken now
+void rtos_host_isr(void (*fn)(void *arg), void *arg);
+// Spends us of virtual CPU time in the calling task, taking timeouts on the way
+void rtos_host_busy(uint32_t us);
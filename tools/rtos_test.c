@@ -0,0 +1,301 @@
+/*
+ * Logic tests for the kernel (lib/rtos.h) on the host port (tools/rtos_host.h).
+ *
+ *   rtos_test
+ *
+ * Each case creates a few tasks, runs them to completion in virtual time and
+ * checks the order they ran in (a trace of one letter per step), the times they
+ * woke at and their priorities along the way: preemption, round robin, tickless
+ * sleeps, timeouts, queues, wake-ups from interrupts and priority inheritance
+ * through a chain of mutexes. Exits 1 on the first failure.
+ * Build: cc -O2 -Ilib -Itools -o rtos_test tools/rtos_test.c tools/rtos_host.c
+ *        lib/rtos.c lib/swtimer.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rtos_host.h"
+
+#define WORDS               64
+
+#define CHECK(c) do {                                                   \
+    if (!(c)) {                                                         \
+      printf("%s:%d: %s failed (trace \"%s\")\n", __func__, __LINE__, #c, trace); \
+      exit(1);                                                          \
+    }                                                                   \
+  } while (0)
+
+static uint32_t idle_stack[RTOS_IDLE_WORDS];
+static uint32_t stacks[6][WORDS];
+static rtos_task_t tasks[6];
+static char trace[128];
+static uint32_t trace_len;
+
+static rtos_sem_t sem;
+static rtos_mutex_t m1, m2;
+static rtos_queue_t queue;
+static uint32_t queue_buf[2];
+
+
+static void mark(char c) {
+  trace[trace_len++] = c;
+  trace[trace_len] = 0;
+}
+
+static void setup(void) {
+  trace_len = 0;
+  trace[0] = 0;
+  rtos_init(idle_stack, RTOS_IDLE_WORDS);
+}
+
+static void spawn(int i, uint8_t prio, rtos_entry_t entry, void *arg) {
+  rtos_task_create(&tasks[i], "t", prio, stacks[i], WORDS, entry, arg);
+}
+
+static void expect(const char *want) {
+  if (strcmp(trace, want)) {
+    printf("trace \"%s\", expected \"%s\"\n", trace, want);
+    exit(1);
+  }
+}
+
+// A give to a higher-priority waiter switches to it at once
+static void preempt_high(void *arg) {
+  (void)arg;
+  rtos_sem_take(&sem, RTOS_FOREVER);
+  mark('H');
+}
+
+static void preempt_low(void *arg) {
+  (void)arg;
+  mark('a');
+  rtos_sem_give(&sem);
+  mark('b');
+}
+
+static void test_preempt(void) {
+  setup();
+  rtos_sem_init(&sem, 0, 1);
+  spawn(0, 5, preempt_low, NULL);
+  spawn(1, 1, preempt_high, NULL);
+  rtos_host_run();
+  expect("aHb");
+  CHECK(tasks[0].state == RTOS_DONE && tasks[1].state == RTOS_DONE);
+}
+
+// Equal priorities take turns only when they yield
+static void yielder(void *arg) {
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    mark(*(char *)arg);
+    rtos_yield();
+  }
+}
+
+static void test_yield(void) {
+  setup();
+  spawn(0, 4, yielder, "a");
+  spawn(1, 4, yielder, "b");
+  rtos_host_run();
+  expect("ababab");
+}
+
+// Sleeps wake in deadline order at the exact time, with nothing in between
+static uint32_t woke[3];
+
+static void sleeper(void *arg) {
+  int i = (intptr_t)arg;
+
+  rtos_sleep((3 - i) * 100);
+  woke[i] = rtos_now();
+  mark('0' + i);
+}
+
+static void test_sleep(void) {
+  setup();
+  spawn(0, 3, sleeper, (void *)0);
+  spawn(1, 3, sleeper, (void *)1);
+  spawn(2, 3, sleeper, (void *)2);
+  rtos_host_run();
+  expect("210");
+  CHECK(woke[0] == 300 && woke[1] == 200 && woke[2] == 100);
+  // Each task in to sleep and to wake, idle whenever all are asleep: no ticks
+  CHECK(rtos_switches() == 3 * 2 + 4);
+}
+
+// Timeouts report failure once they have run out, and not before
+static void timeout_task(void *arg) {
+  uint32_t item, t;
+
+  (void)arg;
+  CHECK(!rtos_sem_take(&sem, 0));
+  t = rtos_now();
+  CHECK(!rtos_sem_take(&sem, 250));
+  CHECK(rtos_now() - t == 250);
+  t = rtos_now();
+  CHECK(!rtos_queue_recv(&queue, &item, 70));
+  CHECK(rtos_now() - t == 70);
+  rtos_mutex_lock(&m1, RTOS_FOREVER);
+  CHECK(!rtos_mutex_lock(&m1, 0));      // Not recursive
+  rtos_mutex_unlock(&m1);
+  CHECK(rtos_sem_give(&sem));
+  CHECK(!rtos_sem_give(&sem));          // At max
+  mark('t');
+}
+
+static void test_timeout(void) {
+  setup();
+  rtos_sem_init(&sem, 0, 1);
+  rtos_mutex_init(&m1);
+  rtos_queue_init(&queue, queue_buf, sizeof(uint32_t), 2);
+  spawn(0, 2, timeout_task, NULL);
+  rtos_host_run();
+  expect("t");
+}
+
+// A producer outrunning its consumer blocks on the full queue; order is kept
+static void producer(void *arg) {
+  uint32_t i;
+
+  (void)arg;
+  for (i = 0; i < 6; i++) {
+    CHECK(rtos_queue_send(&queue, &i, RTOS_FOREVER));
+    mark('p');
+  }
+}
+
+static void consumer(void *arg) {
+  uint32_t i, item;
+
+  (void)arg;
+  for (i = 0; i < 6; i++) {
+    CHECK(rtos_queue_recv(&queue, &item, RTOS_FOREVER));
+    CHECK(item == i);
+    mark('c');
+    rtos_host_busy(10);
+  }
+}
+
+static void test_queue(void) {
+  setup();
+  rtos_queue_init(&queue, queue_buf, sizeof(uint32_t), 2);
+  spawn(0, 2, producer, NULL);
+  spawn(1, 5, consumer, NULL);
+  rtos_host_run();
+  // Two fit and the third blocks; each receive lets the producer put in one
+  // more before the consumer gets on with it
+  expect("pppcpcpcpccc");
+}
+
+// An interrupt's give takes effect when it returns, before the task it hit
+static void give(void *arg) {
+  (void)arg;
+  mark('i');
+  rtos_sem_give(&sem);
+  mark('j');
+}
+
+static void isr_low(void *arg) {
+  (void)arg;
+  mark('a');
+  rtos_host_isr(give, NULL);
+  mark('b');
+}
+
+static void test_isr(void) {
+  setup();
+  rtos_sem_init(&sem, 0, 1);
+  spawn(0, 5, isr_low, NULL);
+  spawn(1, 1, preempt_high, NULL);
+  rtos_host_run();
+  expect("aijHb");
+}
+
+/*
+ * Priority inheritance. L (6) holds m1; M (4) takes m2 and waits for m1; H (1)
+ * waits for m2 with a timeout. L must run at H's priority until H gives up,
+ * then at M's until it lets go of m1, then at its own. Observer O (0) looks at
+ * L's priority while L is busy; N (5) is CPU-bound, above L but below M, and
+ * must not get in L's way until L lets go of m1.
+ */
+static void pi_low(void *arg) {
+  (void)arg;
+  rtos_mutex_lock(&m1, RTOS_FOREVER);
+  mark('L');
+  rtos_host_busy(200);
+  mark('l');
+  rtos_mutex_unlock(&m1);
+  CHECK(tasks[0].prio == 6);
+  mark('e');
+}
+
+static void pi_mid(void *arg) {
+  (void)arg;
+  rtos_sleep(10);
+  rtos_mutex_lock(&m2, RTOS_FOREVER);
+  mark('M');
+  rtos_mutex_lock(&m1, RTOS_FOREVER);
+  mark('m');
+  rtos_mutex_unlock(&m1);
+  rtos_mutex_unlock(&m2);
+}
+
+static void pi_high(void *arg) {
+  uint32_t t;
+
+  (void)arg;
+  rtos_sleep(20);
+  mark('H');
+  t = rtos_now();
+  CHECK(!rtos_mutex_lock(&m2, 50));
+  CHECK(rtos_now() - t == 50);
+  mark('h');
+}
+
+static void pi_observer(void *arg) {
+  (void)arg;
+  rtos_sleep(15);
+  CHECK(tasks[0].prio == 4);            // From M through m1
+  rtos_sleep(15);
+  CHECK(tasks[0].prio == 1);            // From H through m2, M and m1
+  CHECK(tasks[1].prio == 1);
+  rtos_sleep(50);
+  CHECK(tasks[0].prio == 4);            // H timed out
+  CHECK(tasks[1].prio == 4);
+  mark('o');
+}
+
+static void pi_cpu(void *arg) {
+  (void)arg;
+  rtos_sleep(40);
+  mark('N');
+  rtos_host_busy(100);
+  mark('n');
+}
+
+static void test_inherit(void) {
+  setup();
+  rtos_mutex_init(&m1);
+  rtos_mutex_init(&m2);
+  spawn(0, 6, pi_low, NULL);
+  spawn(1, 4, pi_mid, NULL);
+  spawn(2, 1, pi_high, NULL);
+  spawn(3, 0, pi_observer, NULL);
+  spawn(4, 5, pi_cpu, NULL);
+  rtos_host_run();
+  // N only runs once L has handed m1 to M and M has finished
+  expect("LMHholmNne");
+}
+
+int main(void) {
+  test_preempt();
+  test_yield();
+  test_sleep();
+  test_timeout();
+  test_queue();
+  test_isr();
+  test_inherit();
+  printf("ok\n");
+  return 0;
+}
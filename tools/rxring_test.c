@@ -0,0 +1,323 @@
+/*
+ * Host test for the DMA receive ring (lib/rxring.h).
+ *
+ *   rxring_test [rounds]
+ *
+ * A simulated circular DMA writes a byte stream whose every byte encodes its
+ * stream position, and reports its write index the way the half/full transfer
+ * and idle-line interrupts do. Fixed cases first:
+ *  - messages delivered in order and byte for byte while the stream wraps the
+ *    ring many times, with a message that crosses the buffer end coming back as
+ *    two spans;
+ *  - a message reported in pieces (half-transfer interrupts) stays invisible
+ *    until the idle line commits it, and an empty commit queues nothing;
+ *  - a full boundary queue merges the next message into the one after;
+ *  - a stalled consumer counts one overrun per lap it falls behind, not per
+ *    interrupt, loses the overwritten messages without seeing them and gets the
+ *    ones still intact; a message held while the DMA laps it is released as
+ *    damaged.
+ * Then rounds of random interleavings of writes, commits, peeks and releases,
+ * checked against a model of where each message starts and ends.
+ * Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -o rxring_test tools/rxring_test.c lib/rxring.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "rxring.h"
+
+#define SIZE                64
+
+typedef struct {
+  rxring_t r;
+  uint8_t buf[SIZE];
+  uint32_t pos;                 // Bytes the DMA has written
+} sim_t;
+
+static uint32_t seed = 1;
+static uint32_t round_no;
+
+
+#define FAIL(...) do {                                                  \
+    printf("round %u: ", round_no);                                     \
+    printf(__VA_ARGS__);                                                \
+    printf("\n");                                                       \
+    exit(1);                                                            \
+  } while (0)
+
+static uint32_t rnd(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8 ^ seed << 24;
+}
+
+static uint8_t pat(uint32_t p) {
+  return (p * 2654435761u) >> 24;
+}
+
+static void sim_init(sim_t *s) {
+  rxring_init(&s->r, s->buf, SIZE);
+  s->pos = 0;
+}
+
+// The DMA writes n bytes; the driver sees its index at least every half ring
+static void dma_write(sim_t *s, uint32_t n) {
+  uint32_t step;
+
+  while (n) {
+    step = n < SIZE / 2 ? n : SIZE / 2;
+    for (n -= step; step; step--, s->pos++) {
+      s->buf[s->pos % SIZE] = pat(s->pos);
+    }
+    rxring_advance(&s->r, s->pos % SIZE);
+  }
+}
+
+// A message must be the stream from start on, laid out as the ring holds it
+static void check_msg(const sim_t *s, const rxring_msg_t *m, uint32_t start, uint32_t len) {
+  uint32_t i, k, p = start;
+
+  if (m->len != len || m->part[0].len + m->part[1].len != len) {
+    FAIL("message at %u: %u bytes in spans of %u + %u, want %u", start, m->len, m->part[0].len,
+         m->part[1].len, len);
+  }
+  if (m->part[0].data != s->buf + start % SIZE || (m->part[1].len && m->part[1].data != s->buf)) {
+    FAIL("message at %u: spans at +%d and +%d", start, (int)(m->part[0].data - s->buf),
+         (int)(m->part[1].data - s->buf));
+  }
+  if (m->part[1].len != (start % SIZE + len > SIZE ? start % SIZE + len - SIZE : 0)) {
+    FAIL("message at %u of %u bytes: second span %u", start, len, m->part[1].len);
+  }
+  for (k = 0; k < 2; k++) {
+    for (i = 0; i < m->part[k].len; i++, p++) {
+      if (m->part[k].data[i] != pat(p)) {
+        FAIL("message at %u: byte %u is %02x, want %02x", start, p - start, m->part[k].data[i], pat(p));
+      }
+    }
+  }
+}
+
+static void test_wrap(void) {
+  sim_t s;
+  rxring_msg_t m;
+  uint32_t i, len, start = 0, crossed = 0;
+
+  sim_init(&s);
+  for (i = 0; i < 1000; i++) {
+    len = i % 3 ? i % (SIZE / 2) + 1 : SIZE - 1;
+    dma_write(&s, len);
+    if (!rxring_commit(&s.r) || !rxring_peek(&s.r, &m)) {
+      FAIL("message %u of %u bytes not delivered", i, len);
+    }
+    check_msg(&s, &m, start, len);
+    crossed += m.part[1].len != 0;
+    if (!rxring_release(&s.r) || rxring_peek(&s.r, &m)) {
+      FAIL("message %u: released damaged or followed by another", i);
+    }
+    start += len;
+  }
+  if (!crossed || s.r.overruns) {
+    FAIL("wrap: %u messages across the end, %u overruns", crossed, s.r.overruns);
+  }
+}
+
+static void test_idle(void) {
+  sim_t s;
+  rxring_msg_t m;
+
+  sim_init(&s);
+  if (rxring_commit(&s.r)) {
+    FAIL("empty commit queued a message");
+  }
+  dma_write(&s, 40);
+  rxring_commit(&s.r);
+  rxring_peek(&s.r, &m);
+  rxring_release(&s.r);
+  // 58 bytes over three half-transfer interrupts, across the buffer end
+  dma_write(&s, 30);
+  dma_write(&s, 25);
+  if (rxring_peek(&s.r, &m)) {
+    FAIL("message handed out before the idle line");
+  }
+  dma_write(&s, 3);
+  if (!rxring_commit(&s.r) || rxring_commit(&s.r)) {
+    FAIL("idle line: commit, then an empty one");
+  }
+  dma_write(&s, 6);
+  if (!rxring_peek(&s.r, &m)) {
+    FAIL("committed message not delivered");
+  }
+  check_msg(&s, &m, 40, 58);
+  rxring_release(&s.r);
+  if (rxring_peek(&s.r, &m)) {
+    FAIL("bytes still being received handed out");
+  }
+  rxring_commit(&s.r);
+  if (!rxring_peek(&s.r, &m)) {
+    FAIL("second message not delivered");
+  }
+  check_msg(&s, &m, 98, 6);
+  if (!rxring_release(&s.r)) {
+    FAIL("second message released damaged");
+  }
+}
+
+static void test_queue_full(void) {
+  sim_t s;
+  rxring_msg_t m;
+  uint32_t i;
+
+  sim_init(&s);
+  for (i = 0; i < RXRING_MAX_MSGS; i++) {
+    dma_write(&s, 2);
+    if (!rxring_commit(&s.r)) {
+      FAIL("commit %u refused", i);
+    }
+  }
+  dma_write(&s, 3);
+  if (rxring_commit(&s.r)) {
+    FAIL("commit past %u pending boundaries accepted", RXRING_MAX_MSGS);
+  }
+  for (i = 0; i < RXRING_MAX_MSGS; i++) {
+    if (!rxring_peek(&s.r, &m)) {
+      FAIL("queued message %u missing", i);
+    }
+    check_msg(&s, &m, 2 * i, 2);
+    rxring_release(&s.r);
+  }
+  dma_write(&s, 4);
+  rxring_commit(&s.r);
+  if (!rxring_peek(&s.r, &m)) {
+    FAIL("merged message missing");
+  }
+  check_msg(&s, &m, 2 * RXRING_MAX_MSGS, 7);
+}
+
+static void test_overrun(void) {
+  sim_t s;
+  rxring_msg_t m;
+  uint32_t i;
+
+  sim_init(&s);
+  // Eight 16-byte messages while the consumer sleeps: two laps
+  for (i = 0; i < 8; i++) {
+    dma_write(&s, 16);
+    rxring_commit(&s.r);
+  }
+  if (s.r.overruns != 1) {
+    FAIL("stalled consumer: %u overruns, want 1", s.r.overruns);
+  }
+  // The first four are gone; the last four are the ring and still intact
+  for (i = 4; i < 8; i++) {
+    if (!rxring_peek(&s.r, &m)) {
+      FAIL("intact message %u missing", i);
+    }
+    check_msg(&s, &m, 16 * i, 16);
+    if (!rxring_release(&s.r)) {
+      FAIL("intact message %u released damaged", i);
+    }
+  }
+  if (rxring_peek(&s.r, &m)) {
+    FAIL("message after the last one");
+  }
+
+  // A message held while the DMA laps it
+  dma_write(&s, 10);
+  rxring_commit(&s.r);
+  if (!rxring_peek(&s.r, &m)) {
+    FAIL("held message missing");
+  }
+  dma_write(&s, SIZE);
+  if (s.r.overruns != 2) {
+    FAIL("lap under a held message: %u overruns, want 2", s.r.overruns);
+  }
+  if (rxring_release(&s.r)) {
+    FAIL("overwritten message released intact");
+  }
+}
+
+// Random interleavings against a model of the boundaries and the consumer
+static void test_random(void) {
+  sim_t s;
+  rxring_msg_t m;
+  uint32_t ends[RXRING_MAX_MSGS], n = 0, open = 0, tail = 0, overruns = 0, op, len, i, before;
+  bool held = false, got;
+
+  sim_init(&s);
+  for (op = 0; op < 2000; op++) {
+    switch (rnd() % 4) {
+    case 0:
+      len = rnd() % (rnd() % 8 ? SIZE / 2 : 3 * SIZE) + 1;
+      for (before = s.pos; len;) {
+        i = len < SIZE / 2 ? len : SIZE / 2;
+        dma_write(&s, i);
+        len -= i;
+        if (before - tail <= SIZE && s.pos - tail > SIZE) {
+          overruns++;
+        }
+        before = s.pos;
+      }
+      break;
+    case 1:
+      got = rxring_commit(&s.r);
+      if (got != (s.pos != open && n < RXRING_MAX_MSGS)) {
+        FAIL("commit at %u with %u pending returned %d", s.pos, n, got);
+      }
+      if (got) {
+        ends[n++] = open = s.pos;
+      }
+      break;
+    case 2:
+      // One message at a time: peek, then release
+      if (held) {
+        break;
+      }
+      got = rxring_peek(&s.r, &m);
+      while (n && s.pos - tail > SIZE) {
+        tail = ends[0];
+        for (i = 1; i < n; i++) {
+          ends[i - 1] = ends[i];
+        }
+        n--;
+      }
+      if (got != (n != 0)) {
+        FAIL("peek with %u pending returned %d", n, got);
+      }
+      if (got) {
+        check_msg(&s, &m, tail, ends[0] - tail);
+        held = true;
+      }
+      break;
+    default:
+      if (!held) {
+        break;
+      }
+      got = rxring_release(&s.r);
+      if (got != (s.pos - tail <= SIZE)) {
+        FAIL("release %u bytes behind returned %d", s.pos - tail, got);
+      }
+      tail = ends[0];
+      for (i = 1; i < n; i++) {
+        ends[i - 1] = ends[i];
+      }
+      n--;
+      held = false;
+      break;
+    }
+    if (s.r.overruns != overruns) {
+      FAIL("%u overruns, want %u", s.r.overruns, overruns);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+
+  test_wrap();
+  test_idle();
+  test_queue_full();
+  test_overrun();
+  for (round_no = 0; round_no < rounds; round_no++) {
+    test_random();
+  }
+  printf("%u rounds ok\n", rounds);
+  return 0;
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Decode a TLOG binary stream (lib/tlog.h) using the firmware ELF.
+
+    tlog_decode.py build/firmware.elf capture.bin
+    cat /dev/ttyUSB0 | tlog_decode.py build/firmware.elf -
+"""
+import re
+import struct
+import sys
+
+SPEC = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXcsfFeEgGp%])')
+
+
+class Elf:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] != 1:
+            raise SystemExit('%s: not an ELF32 file' % path)
+        shoff, = struct.unpack_from('<I', self.data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', self.data, 0x2E)
+        hdrs = [struct.unpack_from('<IIIIII', self.data, shoff + i * shentsize)
+                for i in range(shnum)]
+        strtab = hdrs[shstrndx][4]
+        self.sections = {}
+        for name, typ, flags, addr, offset, size in hdrs:
+            end = self.data.index(b'\0', strtab + name)
+            self.sections[self.data[strtab + name:end].decode()] = (typ, flags, addr, offset, size)
+
+    def cstring(self, addr, section=None):
+        for name, (typ, flags, base, offset, size) in self.sections.items():
+            if section is not None and name != section:
+                continue
+            if section is None and (typ != 1 or not flags & 0x2):  # PROGBITS, ALLOC
+                continue
+            if base <= addr < base + size:
+                start = offset + addr - base
+                return self.data[start:self.data.index(b'\0', start)].decode(errors='replace')
+        return None
+
+
+def render(elf, fmt, args):
+    args = list(args)
+
+    def conv(m):
+        flags, kind = m.group(1), m.group(2)
+        if kind == '%':
+            return '%'
+        v = args.pop(0) if args else 0
+        if kind in 'di':
+            v = v - (1 << 32) if v & 0x80000000 else v
+            kind = 'd'
+        elif kind == 'u':
+            kind = 'd'
+        elif kind in 'fFeEgG':
+            v = struct.unpack('<f', struct.pack('<I', v))[0]
+        elif kind == 's':
+            s = elf.cstring(v)
+            v = s if s is not None else '<%08x>' % v
+        elif kind == 'p':
+            return '0x%08x' % v
+        elif kind == 'c':
+            v = chr(v & 0xFF)
+        return ('%' + flags + kind) % v
+
+    return SPEC.sub(conv, fmt)
+
+
+def main():
+    if len(sys.argv) != 3:
+        raise SystemExit(__doc__.strip())
+    elf = Elf(sys.argv[1])
+    if '.tlog_fmt' not in elf.sections:
+        raise SystemExit('%s: no .tlog_fmt section' % sys.argv[1])
+    stream = sys.stdin.buffer if sys.argv[2] == '-' else open(sys.argv[2], 'rb')
+
+    while True:
+        word = stream.read(4)
+        if len(word) < 4:
+            break
+        header, = struct.unpack('<I', word)
+        if not header & 0x80000000:
+            print('<lost sync: %08x>' % header, file=sys.stderr)
+            continue
+        nargs = (header >> 24) & 0xF
+        raw = stream.read(4 * nargs)
+        if len(raw) < 4 * nargs:
+            break
+        fmt = elf.cstring(header & 0xFFFFFF, '.tlog_fmt')
+        if fmt is None:
+            print('<unknown id %06x>' % (header & 0xFFFFFF))
+            continue
+        print(render(elf, fmt, struct.unpack('<%dI' % nargs, raw)), flush=True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,140 @@
+/*
+ * Host-side throughput test for the USBHS composite device (ch32v307/usb_cdc.h).
+ *
+ *   usb_bench in  [MB]            read the vendor bulk IN pipe through libusb
+ *   usb_bench out [MB]            write the vendor bulk OUT pipe
+ *   usb_bench tty /dev/ttyACM0 [MB]  read the CDC-ACM port
+ *
+ * The firmware side just keeps the pipe busy (resubmit from the completion
+ * callback). Build: cc -O2 -o usb_bench tools/usb_bench.c -lusb-1.0
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <libusb-1.0/libusb.h>
+
+#define VID                 0x1209
+#define PID                 0x0001
+#define IFACE               2
+#define EP_IN               0x82
+#define EP_OUT              0x02
+#define XFER_SIZE           (64 * 1024)
+#define XFERS               8   // In flight, so the host controller never idles
+
+static long long total, target;
+static int active;
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *what, long long bytes, double secs) {
+  printf("%s: %lld bytes in %.3f s = %.2f MB/s\n", what, bytes, secs, bytes / secs / 1e6);
+}
+
+static void LIBUSB_CALL xfer_done(struct libusb_transfer *t) {
+  if (t->status != LIBUSB_TRANSFER_COMPLETED) {
+    fprintf(stderr, "transfer: %s\n", libusb_error_name(t->status));
+    active--;
+    return;
+  }
+  total += t->actual_length;
+  if (total < target && libusb_submit_transfer(t) == 0) {
+    return;
+  }
+  active--;
+}
+
+static int bench_usb(int in, long long bytes) {
+  libusb_device_handle *h;
+  struct libusb_transfer *t[XFERS];
+  double t0;
+  int i, rc;
+
+  if (libusb_init(NULL) != 0) {
+    return 1;
+  }
+  h = libusb_open_device_with_vid_pid(NULL, VID, PID);
+  if (!h) {
+    fprintf(stderr, "device %04x:%04x not found\n", VID, PID);
+    return 1;
+  }
+  if ((rc = libusb_claim_interface(h, IFACE)) != 0) {
+    fprintf(stderr, "claim interface %d: %s\n", IFACE, libusb_error_name(rc));
+    return 1;
+  }
+  target = bytes;
+  t0 = now();
+  for (i = 0; i < XFERS; i++) {
+    unsigned char *buf = malloc(XFER_SIZE);
+
+    memset(buf, 0x5A, XFER_SIZE);
+    t[i] = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(t[i], h, in ? EP_IN : EP_OUT, buf, XFER_SIZE, xfer_done, NULL, 5000);
+    if (libusb_submit_transfer(t[i]) == 0) {
+      active++;
+    }
+  }
+  while (active) {
+    libusb_handle_events(NULL);
+  }
+  report(in ? "bulk in" : "bulk out", total, now() - t0);
+
+  for (i = 0; i < XFERS; i++) {
+    free(t[i]->buffer);
+    libusb_free_transfer(t[i]);
+  }
+  libusb_release_interface(h, IFACE);
+  libusb_close(h);
+  libusb_exit(NULL);
+  return 0;
+}
+
+static int bench_tty(const char *path, long long bytes) {
+  static unsigned char buf[XFER_SIZE];
+  struct termios tio;
+  double t0;
+  ssize_t n;
+  int fd = open(path, O_RDWR | O_NOCTTY);
+
+  if (fd < 0) {
+    perror(path);
+    return 1;
+  }
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd, TCSANOW, &tio); // Also raises DTR, which starts the stream
+  t0 = now();
+  while (total < bytes && (n = read(fd, buf, sizeof(buf))) > 0) {
+    total += n;
+  }
+  report("tty", total, now() - t0);
+  close(fd);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  long long mb = 100;
+
+  if (argc >= 2 && !strcmp(argv[1], "tty") && argc >= 3) {
+    if (argc >= 4) {
+      mb = atoll(argv[3]);
+    }
+    return bench_tty(argv[2], mb * 1000000);
+  }
+  if (argc >= 2 && (!strcmp(argv[1], "in") || !strcmp(argv[1], "out"))) {
+    if (argc >= 3) {
+      mb = atoll(argv[2]);
+    }
+    return bench_usb(argv[1][0] == 'i', mb * 1000000);
+  }
+  fprintf(stderr, "usage: %s in|out [MB] | tty DEVICE [MB]\n", argv[0]);
+  return 2;
+}
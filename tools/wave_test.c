@@ -0,0 +1,228 @@
+/*
+ * Host test for the DAC waveform generators (lib/wave.h).
+ *
+ *   wave_test
+ *
+ * Checks, against the C library's sin():
+ *  - wave_sin() over a full turn, every quadrant seam included, within 1.6
+ *    LSB (the table's rounding and the interpolation's truncation);
+ *  - wave_sine() and wave_lut() on sine tables of several lengths (powers of
+ *    two and not) in DAC codes, within the table's interpolation error plus
+ *    rounding; clamping at both rails;
+ *  - the phase accumulator: wave_step(f, rate) within one LSB of f / rate
+ *    turns, the phase returned after n samples exactly n steps on, a loop
+ *    buffer from wave_step(cycles, len) seamless to within len LSB, and the
+ *    number of zero crossings of a long tone the frequency asks for;
+ *  - wave_chirp(): the phase it ends on against the integral of the linear
+ *    sweep, and its start and end frequencies within 0.01 Hz, read from the
+ *    output itself by fitting a quadratic to the phase of a sine and cosine
+ *    pair of sweeps.
+ * Exits 1 on the first error.
+ * Build: cc -O2 -Ilib -o wave_test tools/wave_test.c lib/wave.c lib/dsp_tables.c -lm
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "wave.h"
+
+#define TURN                4294967296.0
+#define RATE                48000
+#define CHIRP_LEN           20000
+#define MID                 2048
+#define AMP                 2047      // Full swing, codes 1..4095
+
+static uint16_t out[RATE], out2[CHIRP_LEN];
+
+
+#define FAIL(...) do {                                                  \
+    printf(__VA_ARGS__);                                                \
+    printf("\n");                                                       \
+    exit(1);                                                            \
+  } while (0)
+
+static double code(double s, uint16_t amp, uint16_t mid) {
+  double v = mid + s * amp / 32768;
+
+  return v < 0 ? 0 : v > WAVE_MAX ? WAVE_MAX : v;
+}
+
+// Q15 sine of phase, as the tables round it: full scale saturates at 32767
+static double ref_sin(uint32_t phase) {
+  double v = 32768 * sin(2 * M_PI * phase / TURN);
+
+  return v > 32767 ? 32767 : v < -32767 ? -32767 : v;
+}
+
+static void test_sin(void) {
+  double err, worst = 0;
+  uint32_t i, phase;
+
+  for (i = 0; i < 1u << 20; i++) {
+    phase = i << 12 | (i * 2654435761u) >> 20;
+    err = fabs(wave_sin(phase) - ref_sin(phase));
+    worst = err > worst ? err : worst;
+  }
+  printf("wave_sin: worst %.2f LSB\n", worst);
+  if (worst > 1.6) {
+    FAIL("wave_sin off by %.2f LSB", worst);
+  }
+}
+
+static void check_codes(const char *what, uint32_t n, uint32_t phase, uint32_t step, uint16_t amp, uint16_t mid,
+                        double tol) {
+  double want;
+  uint32_t i;
+
+  for (i = 0; i < n; i++, phase += step) {
+    want = code(ref_sin(phase), amp, mid);
+    if (fabs(out[i] - want) > tol) {
+      FAIL("%s: sample %u at phase %08x is %u, want %.2f", what, i, phase, out[i], want);
+    }
+  }
+}
+
+static void test_lut(void) {
+  static const uint32_t lens[] = {16, 64, 100, 256, 1000};
+  static int16_t table[1000];
+  uint32_t k, i, len, step = wave_step(997, RATE), phase = 0x12345678;
+  double interp;
+  char what[32];
+
+  wave_sine(out, RATE, phase, step, AMP, MID);
+  check_codes("wave_sine", RATE, phase, step, AMP, MID, 0.75);
+  wave_sine(out, RATE, phase, step, 3000, MID + 500);
+  check_codes("wave_sine clamped", RATE, phase, step, 3000, MID + 500, 0.75);
+
+  for (k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+    len = lens[k];
+    for (i = 0; i < len; i++) {
+      table[i] = (int16_t)lrint(ref_sin((uint32_t)(TURN * i / len)));
+    }
+    // Chord error of linear interpolation on a sine: (2 pi / len)^2 / 8
+    interp = 2047 * (2 * M_PI / len) * (2 * M_PI / len) / 8;
+    snprintf(what, sizeof(what), "wave_lut, %u points", len);
+    wave_lut(out, RATE, phase, step, table, len, AMP, MID);
+    check_codes(what, RATE, phase, step, AMP, MID, interp + 0.75);
+  }
+}
+
+static void test_phase(void) {
+  static const uint32_t freqs[] = {1, 50, 997, 1000, 12345, 15001};
+  uint32_t k, f, step, end, phase = 0x9E3779B9, crossings, i;
+  double err;
+
+  for (k = 0; k < sizeof(freqs) / sizeof(freqs[0]); k++) {
+    f = freqs[k];
+    step = wave_step(f, RATE);
+    err = fabs(step - TURN * f / RATE);
+    if (err >= 1) {
+      FAIL("wave_step(%u, %u) = %u, %.2f LSB off", f, RATE, step, err);
+    }
+    end = wave_sine(out, RATE, phase, step, AMP, MID);
+    if (end != phase + RATE * step) {
+      FAIL("%u Hz: phase after %u samples %08x, want %08x", f, RATE, end, phase + RATE * step);
+    }
+    // One second of tone from a quarter turn on: f rising mid-scale crossings
+    wave_sine(out, RATE, 0xC0000000, step, AMP, MID);
+    for (i = 1, crossings = 0; i < RATE; i++) {
+      crossings += out[i - 1] < MID && out[i] >= MID;
+    }
+    if (crossings + 1 < f || crossings > f + 1) {
+      FAIL("%u Hz: %u rising crossings in a second", f, crossings);
+    }
+  }
+
+  // A loop buffer of a whole number of cycles has no seam
+  for (k = 1; k < 200; k += 7) {
+    step = wave_step(k, 1000 + k);
+    end = wave_sine(out, 1000 + k, phase, step, AMP, MID) - phase;
+    if (end > 1000 + k && -end > 1000 + k) {
+      FAIL("%u cycles in %u samples leave the phase %d LSB off", k, 1000 + k, (int32_t)end);
+    }
+  }
+}
+
+// Least-squares quadratic through the unwrapped phase (turns) of the sweep
+static void fit_chirp(double *f0, double *f1) {
+  double s[5] = {0}, t[3] = {0}, turns = 0, prev = 0, a, x, m[3][4];
+  uint32_t i, r, c, p;
+
+  for (i = 0; i < CHIRP_LEN; i++) {
+    a = atan2((double)out[i] - MID, (double)out2[i] - MID) / (2 * M_PI);
+    turns += a - prev - floor(a - prev + 0.5);
+    prev = a;
+    x = (double)i / CHIRP_LEN;
+    for (p = 0; p < 5; p++) {
+      s[p] += pow(x, p);
+    }
+    for (p = 0; p < 3; p++) {
+      t[p] += turns * pow(x, p);
+    }
+  }
+  for (r = 0; r < 3; r++) {
+    for (c = 0; c < 3; c++) {
+      m[r][c] = s[r + c];
+    }
+    m[r][3] = t[r];
+  }
+  for (p = 0; p < 3; p++) {
+    for (r = p + 1; r < 3; r++) {
+      for (c = 3; c + 1 > p; c--) {
+        m[r][c] -= m[p][c] * m[r][p] / m[p][p];
+      }
+    }
+  }
+  for (p = 3; p--;) {
+    for (c = p + 1; c < 3; c++) {
+      m[p][3] -= m[p][c] * m[c][3];
+    }
+    m[p][3] /= m[p][p];
+  }
+  // turns(x) = c0 + c1 x + c2 x^2 with x = i / CHIRP_LEN. Step i takes sample
+  // i to i + 1, so it is the slope half a sample on; in turns per sample.
+  *f0 = (m[1][3] + 2 * m[2][3] * 0.5 / CHIRP_LEN) / CHIRP_LEN;
+  *f1 = (m[1][3] + 2 * m[2][3] * (CHIRP_LEN - 0.5) / CHIRP_LEN) / CHIRP_LEN;
+}
+
+static void test_chirp(void) {
+  static const uint32_t sweeps[][2] = {{100, 8000}, {8000, 100}, {20, 20000}, {1000, 1000}};
+  uint32_t k, s0, s1, end, phase = 0x01234567;
+  double want, f0, f1;
+
+  for (k = 0; k < sizeof(sweeps) / sizeof(sweeps[0]); k++) {
+    s0 = wave_step(sweeps[k][0], RATE);
+    s1 = wave_step(sweeps[k][1], RATE);
+    end = wave_chirp(out, CHIRP_LEN, phase, s0, s1, AMP, MID) - phase;
+    // Steps s0 .. s1 in a straight line over CHIRP_LEN samples
+    want = fmod((double)CHIRP_LEN * ((double)s0 + s1) / 2, TURN);
+    if (fabs(fmod(end - want + 1.5 * TURN, TURN) - TURN / 2) > CHIRP_LEN + (double)CHIRP_LEN * CHIRP_LEN / 65536) {
+      FAIL("chirp %u-%u Hz: phase %08x after the sweep, want %08x", sweeps[k][0], sweeps[k][1], end,
+           (uint32_t)want);
+    }
+    if (s0 == s1) {
+      wave_sine(out2, CHIRP_LEN, phase, s0, AMP, MID);
+      for (end = 0; end < CHIRP_LEN; end++) {
+        if (out[end] != out2[end]) {
+          FAIL("flat chirp differs from wave_sine at sample %u", end);
+        }
+      }
+    }
+
+    wave_chirp(out, CHIRP_LEN, phase, s0, s1, AMP, MID);
+    wave_chirp(out2, CHIRP_LEN, phase + 0x40000000, s0, s1, AMP, MID);
+    fit_chirp(&f0, &f1);
+    printf("chirp %5u-%5u Hz: fitted %10.4f-%10.4f Hz\n", sweeps[k][0], sweeps[k][1], f0 * RATE, f1 * RATE);
+    if (fabs(f0 * RATE - sweeps[k][0]) > 0.01 || fabs(f1 * RATE - sweeps[k][1]) > 0.01) {
+      FAIL("chirp %u-%u Hz sweeps %.3f-%.3f Hz", sweeps[k][0], sweeps[k][1], f0 * RATE, f1 * RATE);
+    }
+  }
+}
+
+int main(void) {
+  test_sin();
+  test_lut();
+  test_phase();
+  test_chirp();
+  printf("ok\n");
+  return 0;
+}